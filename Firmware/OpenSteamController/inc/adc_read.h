@@ -53,6 +53,7 @@ void enableJoystick(bool en);
 
 void updateAdcVals(void);
 uint16_t getAdcVal(AdcChan chan);
+void getAdcVals(const AdcChan* chans, uint16_t* vals, int num);
 
 int adcReadCmdFnc(int argc, const char* argv[]);
 void adcReadCmdUsage(void);
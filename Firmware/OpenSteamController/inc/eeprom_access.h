@@ -39,10 +39,30 @@
 #define DST_ADDR_NOT_MAPPED (3) // Destination address is not mapped in the 
 	// memory map. Count value is taken in to consideration where applicable.
 
+/**
+ * Describes a record type saved in EEPROM with eepromRecordSave(). Record is
+ *  a header (magic word, version, instance), payload and checksum. One 
+ *  record per instance (i.e. per Trackpad) is kept, each stride bytes apart.
+ */
+typedef struct EepromRecordDesc {
+	uint32_t offset; //!< Where record for instance 0 lives.
+	uint32_t stride; //!< Space reserved per instance.
+	uint16_t magicWord; //!< First 16 bits of record. Preliminary check to
+		//!< verify if record is valid.
+	uint8_t version; //!< Bump whenever payload layout changes in a way
+		//!< that invalidates saved values.
+	uint16_t len; //!< Size of payload in bytes.
+} EepromRecordDesc;
+
 void eepromCmdUsage(void);
 int eepromCmdFnc(int argc, const char* argv[]);
 
 int eepromRead(uint32_t offset, void* readData, uint32_t numBytes);
 int eepromWrite(uint32_t offset, const void* writeData, uint32_t numBytes);
 
+int eepromRecordLoad(const EepromRecordDesc* desc, uint8_t instance,
+	void* payload);
+int eepromRecordSave(const EepromRecordDesc* desc, uint8_t instance,
+	const void* payload);
+
 #endif /* _EEPROM_ACCESS_ */
@@ -51,6 +51,17 @@
 	// above and do a clean build of the project to change the behavior of
 	// the Steam Controller.
 
+#define TPAD_ABS_MODE_EN (0) // Set to 1 to let 'trackpad mode' console 
+	// command switch a Trackpad to absolute mode (i.e. Trackpad ASIC does
+	// tracking and reports position). Orientation and scale of absolute
+	// mode positions have not been checked against AnyMeas positions on
+	// real hardware, so it is kept out of the console until they are.
+
+#define TPAD_LAT_HIST_EN (1) // Keep a latency histogram of each stage of the
+	// Trackpad pipeline for 'trackpad latency' console command. Costs 672
+	// bytes of main RAM and a little time per frame. Set to 0 if that RAM
+	// is needed elsewhere.
+
 #endif /* _FIRMWARE_CONFIG_ */
 
 
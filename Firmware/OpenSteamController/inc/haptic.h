@@ -53,6 +53,8 @@ typedef struct Note {
 
 void initHaptics(void);
 int playHaptic(enum Haptic haptic, const struct Note* notes, uint32_t numNotes);
+void stopHaptic(enum Haptic haptic);
+const struct Note* getHapticNotes(enum Haptic haptic);
 
 void usleepHaptic(uint32_t usec);
 uint32_t getUsTickCntHaptic(void);
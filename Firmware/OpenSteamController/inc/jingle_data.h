@@ -38,6 +38,8 @@
 
 uint8_t getNumJingles(void);
 int playJingle(uint8_t idx);
+int jingleDataWrite(uint32_t offset, const void* data, uint32_t numBytes);
+int jingleDataCommit(bool save);
 
 void jingleCmdUsage(void);
 int jingleCmdFnc(int argc, const char* argv[]);
@@ -0,0 +1,44 @@
+/**
+ * \file rpc.h
+ * \brief Encompasses a framed binary command channel that shares the USB CDC
+ *	UART with the console, for host tools that do not want to parse text.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RPC_
+#define _RPC_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RPC_MAGIC (0x02) //!< Byte (ASCII STX) that starts each frame. Console
+	//!< input is treated as a frame from here until next 0x00.
+
+bool rpcRxChar(uint8_t c);
+void rpcPoll(void);
+
+void rpcCmdUsage(void);
+int rpcCmdFnc(int argc, const char* argv[]);
+
+#endif /* _RPC_ */
@@ -32,10 +32,14 @@
 
 #include <stdint.h>
 
+#define CYCLE_CNT_MASK (0x00FFFFFF) //!< Width of getCycleCnt() counter.
+
 void initTime(void);
 
 void usleep(uint32_t usec);
 
 uint32_t getUsTickCnt(void);
+uint32_t getCycleCnt(void);
+uint32_t cyclesSince(uint32_t start);
 
 #endif /* _TIME_ */
@@ -30,6 +30,7 @@
 #define _TRACKPAD_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * Defines which Trackpad is being communicated with.
@@ -39,13 +40,118 @@ typedef enum Trackpad_t {
 	L_TRACKPAD = 1
 } Trackpad;
 
+/**
+ * Defines how positions are worked out by a Trackpad ASIC.
+ */
+typedef enum TrackpadMode_t {
+	TPAD_MODE_ANYMEAS = 0, //!< Raw AnyMeas ADC frames are captured and 
+		//!< decoded by this firmware.
+	TPAD_MODE_ABS = 1 //!< Trackpad ASIC built-in tracking reports absolute
+		//!< positions.
+} TrackpadMode;
+
 #define TPAD_MAX_X (1200) //!< Defines range for Trackpad X Location.
 #define TPAD_MAX_Y (700) //!< Defines range for Trackpad Y Location.
+#define TPAD_POS_FRAC_BITS (4) //!< Number of fractional bits in fixed point
+	//!< positions (i.e. 1/16 unit resolution).
+
+/**
+ * Position of finger on a Trackpad. All locations are fixed point with
+ *  TPAD_POS_FRAC_BITS fractional bits.
+ */
+typedef struct TrackpadPos {
+	bool touch; //!< True if a finger is down. Locations are center of 
+		//!< Trackpad otherwise.
+	int32_t xRaw; //!< X location as decoded from frame.
+	int32_t yRaw; //!< Y location as decoded from frame.
+	int32_t x; //!< X location after geometric correction and speed 
+		//!< adaptive filter.
+	int32_t y; //!< Y location after geometric correction and speed 
+		//!< adaptive filter.
+	uint32_t timestampUs; //!< When frame position is from was captured.
+} TrackpadPos;
+
+#define TPAD_MAX_CONTACTS (2) //!< Most fingers tracked on a Trackpad.
+
+/**
+ * A single finger on a Trackpad. Locations are fixed point with 
+ *  TPAD_POS_FRAC_BITS fractional bits.
+ */
+typedef struct TrackpadContact {
+	uint8_t id; //!< Stays the same from frame to frame while finger stays
+		//!< down. Never 0.
+	int32_t x; //!< X location (after geometric correction).
+	int32_t y; //!< Y location (after geometric correction).
+	int32_t strength; //!< Sum of profile values for contact (i.e. how much
+		//!< of finger is on Trackpad).
+} TrackpadContact;
+
+/**
+ * All fingers found on a Trackpad in a frame.
+ */
+typedef struct TrackpadContacts {
+	uint32_t timestampUs; //!< When frame contacts are from was captured.
+	uint8_t num; //!< Number of valid entries in contacts.
+	TrackpadContact contacts[TPAD_MAX_CONTACTS]; //!< Fingers found.
+} TrackpadContacts;
+
+#define TPAD_GESTURE_FLICK (1 << 0) //!< Finger lifted while moving fast 
+	//!< enough. Inertia starts from lift off velocity.
+#define TPAD_GESTURE_INERTIA_END (1 << 1) //!< Inertia decayed away or was 
+	//!< stopped by finger touching down again.
+#define TPAD_GESTURE_CIRCLE_START (1 << 2) //!< Finger started circling around 
+	//!< center of Trackpad.
+#define TPAD_GESTURE_CIRCLE_STEP (1 << 3) //!< At least one circular scroll 
+	//!< step was taken.
+#define TPAD_GESTURE_CIRCLE_END (1 << 4) //!< Finger lifted or left ring used 
+	//!< for circular scroll.
+
+/**
+ * Gesture state and output accumulated for a Trackpad since last time it was
+ *  read. Motion is fixed point with TPAD_POS_FRAC_BITS fractional bits.
+ */
+typedef struct TrackpadGesture {
+	uint32_t events; //!< TPAD_GESTURE_* events since last read.
+	int32_t dx; //!< X motion since last read (finger or inertia).
+	int32_t dy; //!< Y motion since last read (finger or inertia).
+	int32_t scrollSteps; //!< Circular scroll steps since last read. 
+		//!< Positive is clockwise.
+	int32_t vx; //!< Current X velocity in units/second.
+	int32_t vy; //!< Current Y velocity in units/second.
+	bool coasting; //!< True while inertia is moving things.
+	bool circling; //!< True while circular scroll is active.
+} TrackpadGesture;
+
+/**
+ * Function called (from PendSV context) with position worked out from each
+ *  new frame, so reacting to it does not wait on a poll. drUs is when DR was
+ *  seen for last sample of frame.
+ */
+typedef void (*TrackpadPosCallback)(Trackpad trackpad, const TrackpadPos* pos,
+	uint32_t drUs);
 
 void initTrackpad(void);
 
+int trackpadSetMode(Trackpad trackpad, TrackpadMode mode);
+TrackpadMode trackpadGetMode(Trackpad trackpad);
+
 void trackpadLocUpdate(Trackpad trackpad);
 void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc);
+uint32_t trackpadGetFrameSeq(Trackpad trackpad);
+bool trackpadGetFrameXY(Trackpad trackpad, uint32_t* seq, uint16_t* xLoc, 
+	uint16_t* yLoc, uint32_t* timestampUs);
+bool trackpadGetFramePos(Trackpad trackpad, uint32_t* seq, 
+	TrackpadPos* pos);
+bool trackpadGetFrameContacts(Trackpad trackpad, uint32_t* seq, 
+	TrackpadContacts* contacts);
+void trackpadSetPosCallback(TrackpadPosCallback callback);
+void trackpadGetGesture(Trackpad trackpad, TrackpadGesture* gesture);
+void trackpadGetBaseline(Trackpad trackpad, uint32_t* ageUs, int32_t* dev);
+
+void trackpadSchedStart(uint32_t targetFps);
+int trackpadSchedStop(void);
+
+void trackpadPrintInitStats(void);
 
 void trackpadCmdUsage(void);
 int trackpadCmdFnc(int argc, const char* argv[]);
@@ -0,0 +1,70 @@
+/**
+ * \file trackpad_comp.h
+ * \brief Encompasses storing and retrieving AnyMeas ADC compensation values
+ *	for the Trackpads in EEPROM.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_COMP_
+#define _TRACKPAD_COMP_
+
+#include <stdint.h>
+
+#include "trackpad.h"
+#include "trackpad_decode.h"
+
+#define NUM_TPAD_HOP_ALT_FREQS (2) //!< Number of toggle frequencies (other
+	//!< than tuned one) Trackpad can hop to when noisy. Each needs its own
+	//!< compensation values.
+
+/**
+ * Defines where compensation values in use for a Trackpad came from.
+ */
+typedef enum TpadCompSrc_t {
+	TPAD_COMP_SRC_NONE = 0, //!< Trackpad not setup.
+	TPAD_COMP_SRC_SAVED = 1, //!< Record previously saved by this firmware.
+	TPAD_COMP_SRC_FACTORY = 2, //!< Factory tables left by Valve firmware.
+	TPAD_COMP_SRC_CALIBRATED = 3 //!< Full recalibration.
+} TpadCompSrc;
+
+/**
+ * Compensation values for toggle frequencies Trackpad can hop to (i.e. all
+ *  but tuned one, which tpadCompSave() covers).
+ */
+typedef struct TpadHopComps {
+	uint8_t freqs[NUM_TPAD_HOP_ALT_FREQS]; //!< Toggle frequency bits (of
+		//!< ADCCFG1 register) each set of values is for.
+	int16_t comps[NUM_TPAD_HOP_ALT_FREQS][NUM_ANYMEAS_ADCS]; //!< 
+		//!< Compensation values for each frequency.
+} TpadHopComps;
+
+int tpadCompLoadSaved(Trackpad trackpad, int16_t* comps);
+int tpadCompLoadFactory(Trackpad trackpad, int16_t* comps);
+int tpadCompSave(Trackpad trackpad, const int16_t* comps);
+int tpadCompLoadHopSaved(Trackpad trackpad, TpadHopComps* hopComps);
+int tpadCompSaveHop(Trackpad trackpad, const TpadHopComps* hopComps);
+
+const char* tpadCompSrcStr(TpadCompSrc src);
+
+#endif /* _TRACKPAD_COMP_ */
@@ -0,0 +1,80 @@
+/**
+ * \file trackpad_corr.h
+ * \brief Encompasses geometric correction (i.e. skew and edge linearity) of
+ *	Trackpad positions using a small grid of offsets.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_CORR_
+#define _TRACKPAD_CORR_
+
+#include <stdint.h>
+
+#include "trackpad.h"
+
+#define TPAD_CORR_CELLS_X (6) //!< Number of grid cells across X axis.
+#define TPAD_CORR_CELLS_Y (4) //!< Number of grid cells across Y axis.
+#define TPAD_CORR_NODES_X (TPAD_CORR_CELLS_X + 1) //!< Grid nodes across X.
+#define TPAD_CORR_NODES_Y (TPAD_CORR_CELLS_Y + 1) //!< Grid nodes across Y.
+
+#define TPAD_CORR_MAX_OFFSET (128 << TPAD_POS_FRAC_BITS) //!< Largest 
+	//!< correction allowed at any grid node.
+
+#define TPAD_CORR_NUM_CAL_PTS (9) //!< Number of points touched during 
+	//!< calibration (center, then 8 points around edge).
+
+/**
+ * Offsets (TPAD_POS_FRAC_BITS fixed point) to add to positions that fall on
+ *  each grid node. Nodes are evenly spaced over decoded (i.e. uncorrected) 
+ *  positions, with node [0][0] at X/Y 0/0 and node [TPAD_CORR_CELLS_Y]
+ *  [TPAD_CORR_CELLS_X] at TPAD_MAX_X/TPAD_MAX_Y.
+ */
+typedef struct TpadCorrGrid {
+	int16_t dxs[TPAD_CORR_NODES_Y][TPAD_CORR_NODES_X]; //!< X offsets.
+	int16_t dys[TPAD_CORR_NODES_Y][TPAD_CORR_NODES_X]; //!< Y offsets.
+} TpadCorrGrid;
+
+/**
+ * Defines where correction grid in use for a Trackpad came from.
+ */
+typedef enum TpadCorrSrc_t {
+	TPAD_CORR_SRC_NONE = 0, //!< Identity grid (i.e. no correction).
+	TPAD_CORR_SRC_SAVED = 1, //!< Record previously saved by this firmware.
+	TPAD_CORR_SRC_CALIBRATED = 2 //!< Built by calibration since boot.
+} TpadCorrSrc;
+
+void tpadCorrIdentity(TpadCorrGrid* grid);
+void tpadCorrApply(const TpadCorrGrid* grid, int32_t* xPos, int32_t* yPos);
+
+void tpadCorrCalTarget(int idx, int32_t* xPos, int32_t* yPos, 
+	const char** name);
+int tpadCorrBuild(TpadCorrGrid* grid, const int32_t* xPoss, 
+	const int32_t* yPoss);
+
+int tpadCorrLoadSaved(Trackpad trackpad, TpadCorrGrid* grid);
+int tpadCorrSave(Trackpad trackpad, const TpadCorrGrid* grid);
+
+const char* tpadCorrSrcStr(TpadCorrSrc src);
+
+#endif /* _TRACKPAD_CORR_ */
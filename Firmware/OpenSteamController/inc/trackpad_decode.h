@@ -0,0 +1,123 @@
+/**
+ * \file trackpad_decode.h
+ * \brief Encompasses functions for converting AnyMeas ADC readings from a
+ *	Trackpad ASIC into X/Y locations. Nothing here touches hardware, so
+ *	this can also be built and run on a host PC.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_DECODE_
+#define _TRACKPAD_DECODE_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "trackpad.h"
+
+#define NUM_ANYMEAS_X_ADCS (11) //!< The number of ADC reading used for
+	//!< calculating the X axis position.
+#define NUM_ANYMEAS_Y_ADCS (8) //!< The number of ADC reading used for
+	//!< calculating the Y axis position.
+#define NUM_ANYMEAS_ADCS (NUM_ANYMEAS_X_ADCS + NUM_ANYMEAS_Y_ADCS) //!< The
+	//!< total number of AnyMeas ADCs read for computing X/Y position.
+
+#define NUM_TPAD_X_BINS (12) //!< Number of demodulated values (i.e.
+	//!< electrode columns) making up the X axis profile.
+#define NUM_TPAD_Y_BINS (8) //!< Number of demodulated values (i.e.
+	//!< electrode rows) making up the Y axis profile.
+#define NUM_TPAD_MAX_BINS (NUM_TPAD_X_BINS) //!< Size of largest profile.
+
+#define TPAD_POS_INVALID (-1) //!< Returned when no (single) finger is down.
+
+#define TPAD_NOISE_FRAC_BITS (4) //!< Fractional bits of tpadFrameNoise().
+
+/**
+ * Defines which axis of a Trackpad is being decoded.
+ */
+typedef enum TpadAxis_t {
+	TPAD_AXIS_X = 0,
+	TPAD_AXIS_Y = 1
+} TpadAxis;
+
+int32_t tpadDecodeAxis(TpadAxis axis, const volatile int16_t* adcs,
+	const int16_t* comps, int32_t* bins);
+
+#define TPAD_FILT_DFLT_MIN_CUTOFF_MHZ (1000) //!< Default position filter
+	//!< cutoff frequency (in mHz) when finger is not moving.
+#define TPAD_FILT_DFLT_BETA (20) //!< Default increase in position filter 
+	//!< cutoff (in mHz) per unit/second of finger speed.
+#define TPAD_FILT_DFLT_D_CUTOFF_MHZ (1000) //!< Default cutoff frequency (in
+	//!< mHz) for smoothing of finger speed.
+
+/**
+ * Tunable parameters for speed adaptive (i.e. One Euro) position filter.
+ */
+typedef struct TpadFiltParams {
+	uint32_t minCutoffMhz; //!< Cutoff frequency (in mHz) when not moving.
+		//!< Lower means less jitter when finger is still.
+	uint32_t beta; //!< Increase in cutoff frequency (in mHz) per unit/second
+		//!< of speed. Higher means less lag during fast motion.
+	uint32_t dCutoffMhz; //!< Cutoff frequency (in mHz) for smoothing of
+		//!< speed estimate.
+} TpadFiltParams;
+
+/**
+ * State of speed adaptive position filter for one axis.
+ */
+typedef struct TpadFilt {
+	bool valid; //!< False until first position after reset.
+	int32_t pos; //!< Filtered position (more fractional bits than
+		//!< TPAD_POS_FRAC_BITS so small steps are not lost).
+	int32_t speed; //!< Filtered speed in units/second.
+} TpadFilt;
+
+/**
+ * Contacts from last frame, used to pair up contacts across frames so they
+ *  keep the same ID.
+ */
+typedef struct TpadContactTracker {
+	uint8_t num; //!< Number of contacts in last frame.
+	uint8_t nextId; //!< ID given to next new contact.
+	TrackpadContact contacts[TPAD_MAX_CONTACTS]; //!< Last frame contacts.
+} TpadContactTracker;
+
+int32_t tpadDecodeAxisQ(TpadAxis axis, const volatile int16_t* adcs,
+	const int16_t* comps, int32_t* bins);
+bool tpadDecodePos(const volatile int16_t* adcs, const int16_t* comps,
+	int32_t* xPos, int32_t* yPos);
+void tpadDecodeLegacy(const volatile int16_t* adcs, const int16_t* comps,
+	int32_t* xPos, int32_t* yPos);
+void tpadContactTrackerReset(TpadContactTracker* tracker);
+int tpadDecodeContacts(const volatile int16_t* adcs, const int16_t* comps,
+	TpadContactTracker* tracker, TrackpadContact* contacts);
+int tpadDemodAxis(TpadAxis axis, const volatile int16_t* adcs,
+	const int16_t* comps, int32_t* bins);
+int32_t tpadFrameNoise(const volatile int16_t* adcs, const int16_t* prev,
+	const int16_t* prevPrev);
+
+void tpadFiltReset(TpadFilt* filt);
+int32_t tpadFilt(TpadFilt* filt, const TpadFiltParams* params, int32_t posQ,
+	uint32_t dtUs);
+
+#endif /* _TRACKPAD_DECODE_ */
@@ -0,0 +1,114 @@
+/**
+ * \file trackpad_gesture.h
+ * \brief Encompasses recognizing gestures (flicks with inertia and circular
+ *	scroll) from filtered Trackpad positions. Integer only and nothing here
+ *	touches hardware, so this can also be built and run on a host PC.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_GESTURE_
+#define _TRACKPAD_GESTURE_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "trackpad.h"
+
+#define TPAD_GESTURE_DFLT_FLICK_SPEED (2000) //!< Default speed (units/second)
+	//!< finger must be moving at on lift off to start inertia.
+#define TPAD_GESTURE_DFLT_INERTIA_TAU_MS (325) //!< Default time constant of
+	//!< inertia decay.
+#define TPAD_GESTURE_DFLT_STOP_SPEED (100) //!< Default speed (units/second)
+	//!< below which inertia ends.
+#define TPAD_GESTURE_DFLT_CIRCLE_RADIUS (400) //!< Default distance (X units)
+	//!< from center finger must touch down at for circular scroll.
+#define TPAD_GESTURE_DFLT_CIRCLE_STEP (2731) //!< Default angle (1/65536 
+	//!< turn) per circular scroll step (i.e. 15 degrees).
+
+#define TPAD_GESTURE_MAX_SPEED (20000) //!< Velocities are clamped to this
+	//!< (units/second) so inertia math cannot overflow.
+
+/**
+ * Tunable parameters for gesture recognition.
+ */
+typedef struct TpadGestureParams {
+	uint32_t flickSpeed; //!< Speed (units/second) at lift off needed to 
+		//!< start inertia.
+	uint32_t inertiaTauMs; //!< Time for inertia to decay to 1/e of speed.
+	uint32_t stopSpeed; //!< Inertia ends when speed on both axes drops 
+		//!< to this (units/second) or lower.
+	uint32_t circleRadius; //!< Touch down must be at least this far (in X 
+		//!< units, Y is scaled to match) from center to start circular
+		//!< scroll. Finger leaving ring at 3/4 of this ends it.
+	uint32_t circleStep; //!< Angle (1/65536 turn) per scroll step. Circular
+		//!< scroll engages after finger goes around two steps.
+} TpadGestureParams;
+
+/**
+ * Defines how far along circular scroll recognition is.
+ */
+typedef enum TpadCircleState_t {
+	TPAD_CIRCLE_NONE = 0, //!< Finger is up or did not touch down on ring.
+	TPAD_CIRCLE_ARMED = 1, //!< Finger touched down on ring, but has not 
+		//!< gone around far enough yet.
+	TPAD_CIRCLE_ACTIVE = 2 //!< Circular scroll is producing steps.
+} TpadCircleState;
+
+/**
+ * State of gesture recognition for one Trackpad.
+ */
+typedef struct TpadGesture {
+	bool touch; //!< Finger was down for last update.
+	bool coasting; //!< Inertia is active.
+	TpadCircleState circle; //!< Circular scroll state.
+	uint32_t lastUs; //!< Timestamp of last update.
+	int32_t x; //!< Last X position (TPAD_POS_FRAC_BITS fixed point).
+	int32_t y; //!< Last Y position (TPAD_POS_FRAC_BITS fixed point).
+	int32_t vx; //!< Smoothed X velocity (units/second).
+	int32_t vy; //!< Smoothed Y velocity (units/second).
+	int32_t remX; //!< Inertia X motion too small to output yet (in 
+		//!< units/second times microseconds).
+	int32_t remY; //!< Inertia Y motion too small to output yet.
+	uint16_t angle; //!< Angle (1/65536 turn) of finger around center at 
+		//!< last update.
+	int32_t angleSum; //!< Angle gone around not turned into steps yet.
+} TpadGesture;
+
+/**
+ * What one update of gesture recognition produced.
+ */
+typedef struct TpadGestureOut {
+	uint32_t events; //!< TPAD_GESTURE_* events.
+	int32_t dx; //!< X motion (TPAD_POS_FRAC_BITS fixed point).
+	int32_t dy; //!< Y motion (TPAD_POS_FRAC_BITS fixed point).
+	int32_t steps; //!< Circular scroll steps (positive is clockwise).
+} TpadGestureOut;
+
+void tpadGestureReset(TpadGesture* gesture);
+void tpadGestureUpdate(TpadGesture* gesture, const TpadGestureParams* params,
+	bool touch, int32_t xPos, int32_t yPos, uint32_t timestampUs, 
+	TpadGestureOut* out);
+uint16_t tpadGestureAngle(int32_t x, int32_t y, int32_t* mag);
+
+#endif /* _TRACKPAD_GESTURE_ */
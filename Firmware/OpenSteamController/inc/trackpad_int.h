@@ -0,0 +1,551 @@
+/**
+ * \file trackpad_int.h
+ * \brief Definitions shared between the source files making up the Trackpad
+ *	driver (trackpad.c, trackpad_sched.c, trackpad_cal.c, trackpad_diag.c
+ *	and trackpad_cmd.c). Not meant to be included anywhere else.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_INT_
+#define _TRACKPAD_INT_
+
+#include "trackpad.h"
+#include "trackpad_decode.h"
+#include "trackpad_spi.h"
+#include "trackpad_comp.h"
+#include "trackpad_corr.h"
+#include "trackpad_gesture.h"
+#include "trackpad_tune.h"
+
+#include "lpc_types.h"
+#include "chip.h"
+#include "fw_cfg.h"
+#include "time.h"
+#include "usb.h"
+#include "util.h"
+
+#define PINT_R_TRACKPAD 3 //!< GPIO Pin Interrupt configured for Right Trackpad.
+#define PINT_L_TRACKPAD 4 //!< GPIO Pin Interrupt configured for Left Trackpad.
+
+/**
+ * How long single AnyMeas measurements (i.e. takeTpadAdcMeas()) took for a
+ *  Trackpad.
+ */
+typedef struct TpadMeasStats {
+	uint32_t meas; //!< Number of measurements taken.
+	uint32_t usSum; //!< Sum of time from start of measurement to DR.
+	uint32_t usMax; //!< Longest single measurement.
+	uint32_t timeouts; //!< Measurements that never saw DR.
+} TpadMeasStats;
+
+/**
+ * Absolute mode packet (i.e. position worked out by Trackpad ASIC).
+ */
+typedef struct TrackpadAbsData {
+	uint16_t xPos; //!< X position. 0 when no finger is down.
+	uint16_t yPos; //!< Y position. 0 when no finger is down.
+	uint16_t zPos; //!< Z (i.e. finger pressure/size). 0 when no finger down.
+} TrackpadAbsData;
+
+/**
+ * Instrumentation for comparing the cost of each Trackpad mode.
+ */
+typedef struct TpadModeStats {
+	uint32_t frames; //!< Number of frames published.
+	uint32_t activeUs; //!< Time spent in mode (not counting time since 
+		//!< tpadModeSinceUs if mode is current mode).
+	uint32_t latencies; //!< Number of frames latency was measured for.
+	uint32_t latencyUsSum; //!< Sum of time from DR of last sample in a
+		//!< frame until position was worked out from frame.
+	uint32_t latencyUsMax; //!< Longest latency.
+	uint32_t captureUsSum; //!< Sum of time from frame start (measurement 
+		//!< request or DR) until frame was published.
+	uint32_t captureUsMax; //!< Longest capture time.
+	uint32_t isrCycles; //!< Core clock cycles spent in DR ISR and SPI 
+		//!< completion callbacks.
+	uint32_t decodeCycles; //!< Core clock cycles spent working out 
+		//!< positions and contacts from frames.
+	uint32_t deferCycles; //!< Core clock cycles spent (in PendSV) on 
+		//!< presence, baseline and noise tracking of frames.
+	uint32_t abandoned; //!< Frames given up on by trackpadSchedStop()
+		//!< after waiting too long for them to complete.
+} TpadModeStats;
+
+/**
+ * Stages of getting from a finger on a Trackpad to a position handed to the
+ *  USB report. Each gets its own latency histogram.
+ */
+typedef enum TpadLatStage_t {
+	TPAD_LAT_DR_WAIT = 0, //!< Measurement start (or previous ADC read) to DR.
+	TPAD_LAT_SPI_READ = 1, //!< DR to ADC value (or packet) read over SPI.
+	TPAD_LAT_CAPTURE = 2, //!< Frame start to last ADC read (i.e. publish).
+	TPAD_LAT_DECODE_WAIT = 3, //!< Publish to decode start.
+	TPAD_LAT_DECODE = 4, //!< Decode start to end (incl. correction and
+		//!< filter).
+	TPAD_LAT_TOTAL = 5, //!< DR of last sample in frame to position handed
+		//!< to consumer (i.e. USB report).
+	NUM_TPAD_LAT_STAGES = 6
+} TpadLatStage;
+
+#define NUM_TPAD_LAT_BUCKETS (12) //!< Number of buckets in each latency
+	//!< histogram.
+#define TPAD_LAT_BUCKET0_US (16) //!< Upper edge of first histogram bucket.
+	//!< Each bucket after is twice as wide, and last bucket catches
+	//!< everything else (i.e. >= 16.4 ms).
+
+/**
+ * Latency histogram for one stage of Trackpad pipeline.
+ */
+typedef struct TpadLatHist {
+	uint32_t counts[NUM_TPAD_LAT_BUCKETS]; //!< Samples in each bucket.
+	uint32_t usSum; //!< Sum of all samples.
+	uint32_t usMax; //!< Largest sample.
+} TpadLatHist;
+
+#define ANYMEAS_X_ADC_ADDR (0x01df) //!< Start address for AnyMeas ADCs
+	//!< relating to X position
+#define ANYMEAS_Y_ADC_ADDR (0x015b) //!< Start address for AnyMeas ADCs
+	//!< relating to Y position
+#define ANYMEAS_ADC_ADDR_STEP (8) //!< Number of Extended Register bytes
+	//!< describing each AnyMeas ADC.
+
+#define TPAD_BASELINE_FRAC_BITS (8) //!< Fractional bits in tpadBaselines.
+
+/**
+ * Counts of what baseline tracker did with frames for a Trackpad.
+ */
+typedef struct TpadBaselineStats {
+	uint32_t updates; //!< Slow (i.e. drift) updates.
+	uint32_t fastUpdates; //!< Fast updates due to stale baseline.
+	uint32_t frozen; //!< Frames skipped because of touch.
+	uint32_t reseeds; //!< Restarts from frame due to unchanging touch
+		//!< (i.e. drift).
+} TpadBaselineStats;
+
+/**
+ * Details of a frame copied out by readTpadFrame() (other than ADC values).
+ */
+typedef struct TpadFrameInfo {
+	uint32_t timestampUs; //!< When frame was published.
+	uint32_t drUs; //!< When DR was seen for last sample of frame.
+	TrackpadMode mode; //!< Mode Trackpad was in for frame.
+	bool idle; //!< True if only presence probe was run for frame.
+	TrackpadAbsData abs; //!< Absolute mode packet.
+	int16_t comps[NUM_ANYMEAS_ADCS]; //!< Compensation values for frame.
+	uint8_t hopSlot; //!< Toggle frequency adcs were measured with.
+} TpadFrameInfo;
+
+/**
+ * Cost of running gesture recognition on a frame.
+ */
+typedef struct TpadGestureStats {
+	uint32_t frames; //!< Frames gesture recognition was run on.
+	uint32_t cyclesSum; //!< Total cycles spent on gesture recognition.
+	uint32_t cyclesMax; //!< Most cycles spent on a single frame.
+} TpadGestureStats;
+
+/**
+ * Details on how well presence probing is working for a Trackpad.
+ */
+typedef struct TpadPresenceStats {
+	uint32_t probeFrames; //!< Frames where only presence probe was run.
+	uint32_t fullFrames; //!< Frames where all AnyMeas ADCs were read.
+	uint32_t wakes; //!< Number of times probe detected touch.
+	uint32_t detectUsSum; //!< Sum of time from last probe that saw no touch
+		//!< to probe that saw touch (i.e. bound on contact to detection).
+	uint32_t detectUsMax; //!< Largest single contribution to detectUsSum.
+	uint32_t fullUsSum; //!< Sum of time from probe that saw touch to full
+		//!< frame being published.
+	uint32_t fullUsMax; //!< Largest single contribution to fullUsSum.
+} TpadPresenceStats;
+
+// Trackpad ASIC Registers. See https://github.com/cirque-corp/Cirque_Pinnacle_1CA027/blob/master/Additional_Examples/AnyMeas_Example
+//  for reference regarding usage (especially AnyMeas specific registers):
+#define TPAD_FW_ID_ADDR (0x00)
+#define TPAD_FW_VER_ADDR (0x01)
+#define TPAD_STATUS1_ADDR (0x02)
+	#define TPAD_STATUS1_SW_DR_BIT (0x04) // Software Data Ready
+	#define TPAD_STATUS1_CC_BIT (0x08) // Command Complete
+#define TPAD_SYSCFG1_ADDR (0x03)
+	#define TPAD_SYSCFG1_RESET_BIT (0x01)
+	#define TPAD_SYSCFG1_SHUTDOWN_BIT (0x02)
+	#define TPAD_SYSCFG1_SLEEP_BIT (0x04)
+	#define TPAD_SYSCFG1_TRACKDIS_BIT (0x08) // Disable internal tracking
+		// calculations
+	#define TPAD_SYSCFG1_ANYMEASEN_BIT (0x10) // Enables low level Any 
+		// Measure mode (i.e. raw mode). Changes registers 0x05 and on.
+	#define TPAD_SYSCFG1_GPIOCTRLEN_BIT (0x20)
+
+// Registers in absolute mode (i.e. TPAD_SYSCFG1_ANYMEASEN_BIT clear):
+#define TPAD_FEEDCFG1_ADDR (0x04)
+	#define TPAD_FEEDCFG1_FEEDEN_BIT (0x01) // Enable data flow
+	#define TPAD_FEEDCFG1_ABSEN_BIT (0x02) // Absolute mode enable (relative
+		// mode disable)
+	#define TPAD_FEEDCFG1_FILTDIS_BIT (0x04) // Filter disable
+	#define TPAD_FEEDCFG1_XDIS_BIT (0x08) // X disable
+	#define TPAD_FEEDCFG1_YDIS_BIT (0x10) // Y disable
+	#define TPAD_FEEDCFG1_XINVERT_BIT (0x40) // X data invert
+	#define TPAD_FEEDCFG1_YINVERT_BIT (0x80) // Y data disable
+#define TPAD_FEEDCFG2_ADDR (0x05)
+	#define TPAD_FEEDCFG2_INTMOUSE_BIT (0x01) // Intellimouse Enable
+	#define TPAD_FEEDCFG2_SWAPXY_BIT (0x80) // Swap X & Y (i.e. 90 degree
+		// rotation)
+#define TPAD_FEEDCFG3_ADDR (0x06)
+#define TPAD_CALCFG_ADDR (0x07)
+	#define TPAD_CALCFG_CALIBRATE (0x01) //
+#define TPAD_PS2AUXCTRL_ADDR (0x08)
+#define TPAD_SAMPLERATE_ADDR (0x09)
+	#define TPAD_SAMPLERATE_100 (0x64) // 100 Samples/Second
+#define TPAD_ZIDLE_ADDR (0x0A)
+#define TPAD_ZSCALER_ADDR (0x0B)
+#define TPAD_SLEEPINTERVAL_ADDR (0x0C)
+#define TPAD_SLEEPTIMER_ADDR (0x0D)
+#define TPAD_DYNEMI_ADDR (0x0E)
+#define TPAD_PACKETBTE0_ADDR (0x12)
+#define TPAD_PACKETBTE1_ADDR (0x13)
+#define TPAD_PACKETBTE2_ADDR (0x14)
+#define TPAD_PACKETBTE3_ADDR (0x15)
+#define TPAD_PACKETBTE4_ADDR (0x16)
+#define TPAD_PACKETBTE5_ADDR (0x17)
+
+// Registers in AnyMeas mode:
+#define TPAD_ADCCFG1_ADDR (0x05) 
+	typedef enum TpadAdcGain_t {
+		TPAD_ADC_GAIN0 = 0xC0, // Lowest gain
+		TPAD_ADC_GAIN1 = 0x80, // ~1.3x gain
+		TPAD_ADC_GAIN2 = 0x40, // ~1.6x gain
+		TPAD_ADC_GAIN3 = 0x00 // ~2x gain
+	} TpadAdcGain; 
+	typedef enum TpadAdcToggleFreq_t {
+		TPAD_ADC_TOGGLE_FREQ_0 = 0x02, // 500,000 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_1 = 0x03, // 444,444 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_2 = 0x04, // 400,000 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_3 = 0x05, // 363,636 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_4 = 0x06, // 333,333 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_5 = 0x07, // 307,692 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_6 = 0x09, // 267,000 Hz (based on default aperture of 500ns)
+		TPAD_ADC_TOGGLE_FREQ_7 = 0x0B, // 235,000 Hz (based on default aperture of 500ns)
+	} TpadAdcToggleFreq; 
+#define TPAD_ADCCTRL_ADDR (0x06)
+	#define TPAD_ADCCTRL_STARTBUSY_BIT (0x80) 
+	#define TPAD_ADCCTRL_INTFLAG_BIT (0x40) 
+	#define TPAD_ADCCTRL_EN_BIT (0x20) 
+	typedef enum TpadAdcSampleLen_t {
+		TPAD_ADC_SAMPLEN_128 = 0x01,
+		TPAD_ADC_SAMPLEN_256 = 0x02,
+		TPAD_ADC_SAMPLEN_512 = 0x03
+	} TpadAdcSampleLen;
+#define TPAD_ADCMUXCTRL_ADDR (0x07)
+	typedef enum TpadAdcMuxSel_t {
+		TPAD_ADC_MUXSEL_SENSEP1GATE = 0x01 //!< Enables Sense P1.
+	} TpadAdcMuxSel;
+#define TPAD_ADCCFG2_ADDR (0x08) 
+	// Contains various configuration settings not likely to be used...
+#define TPAD_ADCWIDTH_ADDR (0x09) 
+	typedef enum TpadAdcAperture_t {
+		TPAD_ADC_APETURE_250NS = 0x02,
+		TPAD_ADC_APETURE_375NS = 0x03,
+		TPAD_ADC_APETURE_500NS = 0x04,
+		TPAD_ADC_APETURE_625NS = 0x05,
+		TPAD_ADC_APETURE_750NS = 0x06,
+		TPAD_ADC_APETURE_875NS = 0x07,
+		TPAD_ADC_APETURE_1000NS = 0x08,
+		TPAD_ADC_APETURE_1125NS = 0x09,
+		TPAD_ADC_APETURE_1250NS = 0x0A,
+		TPAD_ADC_APETURE_1375NS = 0x0B,
+		TPAD_ADC_APETURE_1500NS = 0x0C,
+		TPAD_ADC_APETURE_1625NS = 0x0D,
+		TPAD_ADC_APETURE_1750NS = 0x0E,
+		TPAD_ADC_APETURE_1875NS = 0x0F
+	} TpadAdcAperture;
+#define TPAD_ADC_START_ADDR_HI_ADDR (0x0A) 
+#define TPAD_ADC_START_ADDR_LO_ADDR (0x0B) 
+#define TPAD_MEASINDEX_ADDR (0x0C) 
+	#define TPAD_MEASINDEX_RSTSTART_BITS (0x00) 
+	#define TPAD_MEASINDEX_STARTMEAS_BITS (0x01) 
+	#define TPAD_MEASINDEX_WAIT_BITS (0x02) 
+#define TPAD_ANYMEASSTATE_ADDR (0x0D)
+#define TPAD_MEASCTRL_ADDR (0x0E) 
+	#define TPAD_MEASCTRL_REPEAT_BIT (0x80) 
+	#define TPAD_MEASCTRL_POSTMEASPWR_BIT (0x40) //!< Turn ADC off after
+		//!< measurements. Longer startup between measuremnts, but
+		//!< lower power usage.
+	#define TPAD_MEASCTRL_NUMMEAS_MASK (0x3F)
+#define TPAD_MEASRESULT_HI_ADDR (0x11) 
+#define TPAD_MEASRESULT_LO_ADDR (0x12) 
+// Toggle is part of taking ADC measurement... but don't fully understand it
+#define TPAD_TOGGLE_HIHI_ADDR (0x13) //!< Toggle(31:24)
+#define TPAD_TOGGLE_HILO_ADDR (0x14) //!< Toggle(23:16)
+#define TPAD_TOGGLE_LOHI_ADDR (0x15) //!< Toggle(15:8)
+#define TPAD_TOGGLE_LOLO_ADDR (0x16) //!< Toggle(7:0)
+// Polarity is part of taking ADC measurement... but don't fully understand it
+#define TPAD_POLARITY_HIHI_ADDR (0x17) //!< Polarity(31:24)
+#define TPAD_POLARITY_HILO_ADDR (0x18) //!< Polarity(23:16)
+#define TPAD_POLARITY_LOHI_ADDR (0x19) //!< Polarity(15:8)
+#define TPAD_POLARITY_LOLO_ADDR (0x1A) //!< Polarity(7:0)
+
+// These registers do not change based on AnyMeas settings:
+#define TPAD_ERA_VAL_ADDR 0x1B
+#define TPAD_ERA_HIADDR_ADDR 0x1C
+#define TPAD_ERA_LOADDR_ADDR 0x1D
+#define TPAD_ERA_CTRL_ADDR 0x1E
+
+#define TPAD_PRODID_ADDR 0x1F
+
+#define NUM_TPAD_REGS (0x20) //!< Number of registers directly accessible on
+	//!< Trackpad ASIC.
+
+#define TPAD_REG_VOLATILE_MASK ( \
+	(1 << TPAD_FW_ID_ADDR) | \
+	(1 << TPAD_FW_VER_ADDR) | \
+	(1 << TPAD_STATUS1_ADDR) | \
+	(1 << TPAD_SYSCFG1_ADDR) | \
+	(1 << TPAD_MEASINDEX_ADDR) | \
+	(1 << TPAD_ANYMEASSTATE_ADDR) | \
+	(1 << 0x10) | \
+	(1 << TPAD_MEASRESULT_HI_ADDR) | \
+	(1 << TPAD_MEASRESULT_LO_ADDR) | \
+	(1 << TPAD_ERA_VAL_ADDR) | \
+	(1 << TPAD_ERA_HIADDR_ADDR) | \
+	(1 << TPAD_ERA_LOADDR_ADDR) | \
+	(1 << TPAD_ERA_CTRL_ADDR) | \
+	(1 << TPAD_PRODID_ADDR)) //!< Registers that are read only, are changed
+	//!< by the Trackpad ASIC itself, or where writes have side effects 
+	//!< (i.e. start measurements). Writes to these are never skipped.
+
+#define MEAS_START_MAX_LEN (10) //!< Most bytes in SPI transaction to setup
+	//!< and start AnyMeas measurements.
+
+#define NUM_TPAD_HOP_FREQS (NUM_TPAD_HOP_ALT_FREQS + 1) //!< Number of toggle
+	//!< frequencies (including tuned one) hopped between.
+
+/**
+ * Counts of what frequency hopping did for a Trackpad.
+ */
+typedef struct TpadHopStats {
+	uint32_t frames; //!< Full frames noise was measured for.
+	uint32_t noisyFrames; //!< Frames Trackpad was considered noisy for.
+	uint32_t hops; //!< Number of times frequency was changed.
+} TpadHopStats;
+
+// Defined in trackpad.c
+extern int tpadInitRets[2];
+extern uint32_t tpadInitUs[2];
+extern uint32_t tpadEraUs[2];
+extern TpadMeasStats tpadMeasStats[2];
+extern volatile TrackpadMode tpadModes[2];
+extern volatile TpadModeStats tpadModeStats[2][2];
+extern volatile uint32_t tpadModeSinceUs[2];
+#if TPAD_LAT_HIST_EN
+extern volatile TpadLatHist tpadLatHists[2][NUM_TPAD_LAT_STAGES];
+#endif
+extern volatile int16_t tpadAdcDatas[2][NUM_ANYMEAS_ADCS];
+extern volatile int tpadAdcIdxs[2];
+extern volatile bool tpadFiltEn;
+extern TpadFiltParams tpadFiltParams;
+extern volatile bool tpadGestureEn;
+extern TpadGestureParams tpadGestureParams;
+extern volatile TpadGestureStats tpadGestureStats[2];
+extern TpadCorrGrid tpadCorrGrids[2];
+extern TpadCorrSrc tpadCorrSrcs[2];
+extern volatile bool tpadCorrEn;
+extern uint8_t tpadRegShadows[2][NUM_TPAD_REGS];
+extern uint32_t tpadRegValids[2];
+extern volatile uint32_t tpadRegWrites[2];
+extern volatile uint32_t tpadRegElided[2];
+extern TpadSpiXfer tpadAbsXfers[2];
+extern TpadSpiXfer tpadAdcXfers[2];
+extern uint8_t tpadMeasStartTxDatas[2][MEAS_START_MAX_LEN];
+extern TpadSpiXfer tpadMeasStartXfers[2];
+
+// Defined in trackpad_sched.c
+extern volatile uint32_t tpadDrUs[2];
+extern volatile uint32_t tpadFrameStartUs[2];
+extern volatile bool tpadBaselineEn;
+extern int32_t tpadBaselines[2][NUM_ANYMEAS_ADCS];
+extern int16_t tpadBaselineRefs[2][NUM_ANYMEAS_ADCS];
+extern uint32_t tpadBaselineUs[2];
+extern uint32_t tpadBaselineCheckUs[2];
+extern bool tpadBaselineFrozens[2];
+extern volatile int32_t tpadBaselineDevs[2];
+extern volatile TpadBaselineStats tpadBaselineStats[2];
+extern volatile bool tpadBaselineSeedReqs[2];
+extern LPC_TIMER_T* const tpadSchedTimer;
+extern volatile bool tpadSchedEn;
+extern uint32_t tpadSchedFps;
+extern volatile uint8_t tpadDefers[2];
+extern volatile bool tpadPresenceEn;
+extern volatile int32_t tpadPresenceThresh;
+extern volatile bool tpadTouchs[2];
+extern volatile bool tpadProbings[2];
+extern volatile int32_t tpadPresenceDevs[2];
+extern volatile TpadPresenceStats tpadPresenceStats[2];
+extern volatile bool tpadHopEn;
+extern volatile int32_t tpadHopHighThresh;
+extern volatile int32_t tpadHopLowThresh;
+extern volatile uint8_t tpadHopSlots[2];
+extern volatile uint8_t tpadHopNextSlots[2];
+extern volatile bool tpadHopNoisys[2];
+extern volatile int32_t tpadHopNoises[2];
+extern int32_t tpadHopSlotNoises[2][NUM_TPAD_HOP_FREQS];
+extern uint32_t tpadHopFrames[2];
+extern volatile TpadHopStats tpadHopStats[2];
+
+// Defined in trackpad_cal.c
+extern int16_t tpadAdcComps[2][NUM_ANYMEAS_ADCS];
+extern TpadCompSrc tpadCompSrcs[2];
+extern uint32_t tpadCompUs[2];
+extern const TpadAdcTune TPAD_ADC_TUNE_DFLT;
+extern TpadAdcTune tpadAdcTunes[2];
+extern TpadTuneSrc tpadTuneSrcs[2];
+extern uint8_t tpadHopFreqs[2][NUM_TPAD_HOP_FREQS];
+
+// Defined in trackpad_diag.c
+extern uint32_t tpadRegStatsSeqs[2];
+
+/**
+ * Check if Trackpad ASIC register is known to already have a value.
+ *
+ * \param trackpad Specifies which trackpad to check.
+ * \param addr Register address to check.
+ * \param val Value to check for.
+ *
+ * \return True if writing val to register would have no effect.
+ */
+static inline bool tpadRegHasVal(Trackpad trackpad, uint8_t addr, 
+	uint8_t val) {
+	return (tpadRegValids[trackpad] & (1 << addr)) && 
+		tpadRegShadows[trackpad][addr] == val;
+}
+
+/**
+ * Pull position out of received ABS_READ_AND_CLR_TX transaction.
+ *
+ * \param[in] rxData Bytes received during ABS_READ_AND_CLR_TX transaction.
+ * \param[out] absData Location of where to store absolute packet data.
+ *
+ * \return None.
+ */
+static inline void parseTpadAbs(const uint8_t* rxData, 
+	TrackpadAbsData* absData) {
+	absData->xPos = ((0x0F & rxData[7]) << 8) | rxData[5];
+	absData->yPos = ((0xF0 & rxData[7]) << 4) | rxData[6];
+	absData->zPos = 0x3F & rxData[8];
+}
+
+/**
+ * Concatenate TPAD_MEASRESULT_HI_ADDR and TPAD_MEASRESULT_HI_ADDR from
+ *  received ADC_READ_AND_CLR_TX transaction into a single 16-bit word.
+ *
+ * \param[in] rxData Bytes received during ADC_READ_AND_CLR_TX transaction.
+ *
+ * \return The ADC value.
+ */
+static inline int16_t parseTpadAdc(const uint8_t* rxData) {
+	return (rxData[3] << 8) | rxData[4];
+}
+
+/**
+ * Scale a threshold given for default ADC settings to match how strong touch
+ *  signal is with ADC settings Trackpad is tuned to.
+ * 
+ * \param trackpad Specifies which Trackpad threshold is for. 
+ * \param thresh Threshold in default ADC settings units.
+ * 
+ * \return Scaled threshold.
+ */
+static inline int32_t scaleTpadThresh(Trackpad trackpad, int32_t thresh) {
+	return thresh * tpadAdcTunes[trackpad].sigScale / 
+		TPAD_TUNE_SIG_SCALE_ONE;
+}
+
+/**
+ * Have work on frame that was just published done (from PendSV) once SSP0
+ *  IRQ returns, so ISR is only about capturing frames. Only to be called 
+ *  from SSP0 IRQ context.
+ * 
+ * \param trackpad Specifies which Trackpad frame is from. 
+ * \param flags TPAD_DEFER_* flags for work to be done.
+ *
+ * \return None.
+ */
+static inline void deferTpadWork(Trackpad trackpad, uint8_t flags) {
+	tpadDefers[trackpad] |= flags;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+// Defined in trackpad.c
+void noteTpadRegWrite(Trackpad trackpad, uint8_t addr, uint8_t val);
+void writeTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val);
+void setTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val);
+uint8_t readTpadReg(Trackpad trackpad, uint8_t addr);
+void applyTpadAdcTune(Trackpad trackpad, const TpadAdcTune* tune);
+uint32_t readTpadFrame(Trackpad trackpad, int16_t* adcs,
+	TpadFrameInfo* info);
+void addTpadLat(Trackpad trackpad, TpadLatStage stage, uint32_t us);
+void publishTpadFrame(Trackpad trackpad, bool idle,
+	const TrackpadAbsData* absData);
+void notifyTpadPos(Trackpad trackpad);
+
+// Defined in trackpad_sched.c
+void tpadAdcReadDone(TpadSpiXfer* xfer);
+void tpadAbsReadDone(TpadSpiXfer* xfer);
+
+// Defined in trackpad_cal.c
+void seedTpadBaseline(Trackpad trackpad);
+void applyTpadHopComps(Trackpad trackpad);
+void restoreTpadHopFreq(Trackpad trackpad);
+void loadTpadComps(Trackpad trackpad);
+int recalTpad(Trackpad trackpad);
+void printTpadAdcTune(const TpadAdcTune* tune);
+int setTpadAdcTune(Trackpad trackpad, const TpadAdcTune* tune,
+	TpadTuneSrc src);
+int tuneTpad(Trackpad trackpad, uint32_t minSnr);
+int tpadCorrCal(Trackpad trackpad);
+
+// Defined in trackpad_diag.c
+void tpadMonitor(void);
+int tpadStream(void);
+void tpadGetRaw(void);
+int tpadBench(Trackpad trackpad, uint32_t numFrames);
+void tpadPrintFps(void);
+void tpadPrintRegStats(void);
+void tpadPrintModeStats(void);
+#if TPAD_LAT_HIST_EN
+void tpadPrintLatency(void);
+#endif
+void tpadPrintTune(void);
+void tpadPrintHop(void);
+void tpadPrintPresence(void);
+void tpadPosMonitor(void);
+void tpadContactsMonitor(void);
+void tpadPrintFilt(void);
+void tpadPrintGesture(void);
+void tpadGestureMonitor(void);
+void tpadPrintBaseline(void);
+void tpadPrintCorr(void);
+int tpadSetCorr(Trackpad trackpad, const TpadCorrGrid* grid,
+	TpadCorrSrc src);
+
+#endif /* _TRACKPAD_INT_ */
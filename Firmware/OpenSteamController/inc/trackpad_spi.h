@@ -0,0 +1,67 @@
+/**
+ * \file trackpad_spi.h
+ * \brief Encompasses queued, interrupt driven SPI (SSP0) transactions with the
+ *	Trackpad ASICs.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_SPI_
+#define _TRACKPAD_SPI_
+
+#include <stdint.h>
+
+#include "trackpad.h"
+
+struct TpadSpiXfer;
+
+typedef void (*TpadSpiCallback)(struct TpadSpiXfer* xfer);
+
+/**
+ * Describes a single SPI transaction (i.e. chip select is held low for all
+ *  bytes) with a Trackpad ASIC. Descriptor and buffers must persist until
+ *  the transaction is done (i.e. don't put these on the stack unless waiting
+ *  for completion before returning).
+ */
+typedef struct TpadSpiXfer {
+	Trackpad trackpad; //!< Which Trackpad ASIC to select.
+	const uint8_t* txData; //!< Bytes to send. Must contain len bytes.
+	uint8_t* rxData; //!< Where to store received bytes. May be NULL.
+	uint8_t len; //!< Number of bytes in transaction.
+	TpadSpiCallback callback; //!< Called (from ISR) once transaction is
+		//!< complete. May be NULL.
+	void* arg; //!< For use by callback.
+
+	volatile uint8_t done; //!< Set once transaction is complete.
+	uint8_t txCnt; //!< Number of bytes pushed into TX FIFO so far.
+	uint8_t rxCnt; //!< Number of bytes pulled from RX FIFO so far.
+	struct TpadSpiXfer* next; //!< Next transaction in queue.
+} TpadSpiXfer;
+
+void initTpadSpi(void);
+
+void tpadSpiSubmit(TpadSpiXfer* xfer);
+void tpadSpiXferBlocking(Trackpad trackpad, const uint8_t* txData,
+	uint8_t* rxData, uint8_t len);
+
+#endif /* _TRACKPAD_SPI_ */
@@ -0,0 +1,104 @@
+/**
+ * \file trackpad_tune.h
+ * \brief Encompasses picking AnyMeas ADC settings (i.e. gain, toggle
+ *	frequency, sample length and aperture) for each Trackpad based on
+ *	measured noise, signal and scan time.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACKPAD_TUNE_
+#define _TRACKPAD_TUNE_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "trackpad.h"
+#include "trackpad_decode.h"
+
+#define TPAD_TUNE_DFLT_MIN_SNR (20) //!< Default signal to noise ratio (finger
+	//!< at center vs. RMS noise of demodulated profile) settings must meet.
+#define TPAD_TUNE_SIG_SCALE_ONE (256) //!< TpadAdcTune.sigScale when signal
+	//!< matches default settings.
+
+/**
+ * AnyMeas ADC settings for a Trackpad. Values are what is written to the
+ *  Trackpad ASIC registers.
+ */
+typedef struct TpadAdcTune {
+	uint8_t gain; //!< Gain bits of ADCCFG1 register.
+	uint8_t toggleFreq; //!< Toggle frequency bits of ADCCFG1 register.
+	uint8_t sampleLen; //!< Sample length bits of ADCCTRL register.
+	uint8_t aperture; //!< ADCWIDTH register.
+	uint16_t sigScale; //!< Touch signal with these settings relative to
+		//!< default settings (TPAD_TUNE_SIG_SCALE_ONE means the same).
+		//!< Used to scale thresholds given in default settings units.
+} TpadAdcTune;
+
+/**
+ * What was measured for one set of ADC settings during tuning.
+ */
+typedef struct TpadTuneResult {
+	uint16_t scanUs; //!< Average time to capture a full frame.
+	uint16_t noiseQ4; //!< RMS noise of demodulated profile with nothing on
+		//!< Trackpad (4 fractional bits).
+	uint16_t signal; //!< Peak of demodulated profile with finger at center.
+	bool clipped; //!< True if an ADC value came close to its limits.
+} TpadTuneResult;
+
+/**
+ * Running sums of demodulated profiles over a number of frames.
+ */
+typedef struct TpadTuneAccum {
+	uint32_t frames; //!< Number of frames added.
+	int32_t sums[NUM_TPAD_X_BINS + NUM_TPAD_Y_BINS]; //!< Sum of each
+		//!< profile value (X bins followed by Y bins).
+	uint64_t sqSums[NUM_TPAD_X_BINS + NUM_TPAD_Y_BINS]; //!< Sum of
+		//!< squares of each profile value.
+} TpadTuneAccum;
+
+/**
+ * Defines where ADC settings in use for a Trackpad came from.
+ */
+typedef enum TpadTuneSrc_t {
+	TPAD_TUNE_SRC_NONE = 0, //!< Default settings.
+	TPAD_TUNE_SRC_SAVED = 1, //!< Record previously saved by this firmware.
+	TPAD_TUNE_SRC_TUNED = 2 //!< Picked by tuning since boot.
+} TpadTuneSrc;
+
+void tpadTuneAccumReset(TpadTuneAccum* accum);
+bool tpadTuneAccumAdd(TpadTuneAccum* accum, const volatile int16_t* adcs,
+	const int16_t* comps);
+uint16_t tpadTuneNoiseQ4(const TpadTuneAccum* accum);
+uint16_t tpadTuneSignal(const TpadTuneAccum* accum);
+
+uint32_t tpadTuneSnr(const TpadTuneResult* result);
+int tpadTuneSelect(const TpadTuneResult* results, int numResults,
+	uint32_t minSnr, bool* metTarget);
+
+int tpadTuneLoadSaved(Trackpad trackpad, TpadAdcTune* tune);
+int tpadTuneSave(Trackpad trackpad, const TpadAdcTune* tune);
+
+const char* tpadTuneSrcStr(TpadTuneSrc src);
+
+#endif /* _TRACKPAD_TUNE_ */
@@ -31,13 +31,50 @@
 #ifndef _STEAM_CONTROLLER_USB_
 #define _STEAM_CONTROLLER_USB_
 
+/**
+ * Counters for USB CDC UART transmit path.
+ */
+typedef struct UsbTxStats {
+	uint32_t bytes; //!< Bytes sent.
+	uint32_t packets; //!< Packets sent.
+	uint32_t shortPackets; //!< Packets sent with less than max packet size
+		//!< (i.e. less data than that was queued when packet was sent).
+	uint32_t stallCycles; //!< Cycles spent waiting for room in transmit
+		//!< FIFO.
+	uint32_t flushPoints; //!< Newlines printed and usb_flush() calls (with
+		//!< new data queued). Each used to force out its own packet.
+	uint32_t sofFlushes; //!< Transmissions started at SOF because flush 
+		//!< was requested.
+	uint32_t lingerFlushes; //!< Transmissions started at SOF because data
+		//!< waited long enough for a full packet.
+} UsbTxStats;
+
+/**
+ * Counters for USB CDC UART receive path.
+ */
+typedef struct UsbRxStats {
+	uint32_t bytes; //!< Bytes received.
+	uint32_t packets; //!< Packets received.
+	uint32_t stalls; //!< Times OUT endpoint was left un-armed (i.e. host
+		//!< was NAKed) as receive FIFO had no room for a full packet.
+} UsbRxStats;
+
 int usbConfig(void);
 
 int usb_flush(void);
+int usb_drain(void);
+void usb_setTxLinger(uint32_t frames);
+uint32_t usb_getTxLinger(void);
 int usb_putc(int character);
 void usb_putb(const char* buff, uint32_t len);
+int usb_tryPutb(const char* buff, uint32_t len);
+int usb_write(const void* buff, uint32_t len);
+void usb_getTxStats(UsbTxStats* stats);
+void usb_resetTxStats(void);
 int usb_tstc(void);
 int usb_getc(void);
+void usb_getRxStats(UsbRxStats* stats);
+void usb_resetRxStats(void);
 
 #if (FIRMWARE_BEHAVIOR == SWITCH_WIRED_POWERA_FW)
 void updateControllerStatusPacket(void);
@@ -0,0 +1,42 @@
+/**
+ * \file util.h
+ * \brief Small helpers shared by modules that have no better home.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _UTIL_
+#define _UTIL_
+
+#include <cr_section_macros.h>
+
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof(array[0])) //!< Number of
+	//!< elements in a statically sized array.
+
+#define SRAM1_BSS __BSS(RAM3) //!< Place zero initialised variable in 2KB 
+	//!< SRAM1 block (0x20000000, third RAM bank in project memory 
+	//!< configuration) instead of main 8KB RAM. Meant for large buffers
+	//!< and tables that are not on the frame capture path. ResetISR()
+	//!< turns on the clock for SRAM1 before zero filling it.
+
+#endif /* _UTIL_ */
@@ -215,6 +215,43 @@ uint16_t getAdcVal(AdcChan chan) {
 	return adcData[chan];
 }
 
+/**
+ * Return the raw ADC values for several channels, all taken from the same
+ *  averaging cycle. Waits for the conversion started by the most recent call to
+ *  updateAdcVals() to complete. If another updateAdcVals() (e.g. from USB
+ *  report handling) restarts the conversions before the values are copied,
+ *  this waits for that cycle instead, so channels are never mixed across
+ *  cycles or read mid-accumulation.
+ *
+ * \param chans ADC channels to retrieve data from.
+ * \param vals Filled with the raw ADC value for each entry in chans.
+ * \param num Number of entries in chans and vals.
+ *
+ * \return None.
+ */
+void getAdcVals(const AdcChan* chans, uint16_t* vals, int num) {
+	while (1) {
+		// Wait for ADC samples to be accumulated and averaged
+		while (adcUpdateCnt < ADC_UPDATE_CNT_DONE) {
+		}
+
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		if (adcUpdateCnt >= ADC_UPDATE_CNT_DONE) {
+			for (int idx = 0; idx < num; idx++) {
+				vals[idx] = adcData[chans[idx]];
+			}
+			if (!primask) {
+				__enable_irq();
+			}
+			return;
+		}
+		if (!primask) {
+			__enable_irq();
+		}
+	}
+}
+
 /**
  * Print command usage details to console.
  *
@@ -42,14 +42,14 @@
 #include "usb.h"
 #include "buttons.h"
 #include "test.h"
+#include "rpc.h"
 #include "time.h"
+#include "util.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-#define ARRAY_SIZE(array) (sizeof(array) / sizeof(array[0]))
-
 typedef struct {
 	const char* cmdName;
 	int (*cmdFnc)(int argc, const char* argv[]);
@@ -95,6 +95,7 @@ static Cmd cmds[] = {
 	{.cmdName = "led", .cmdFnc = ledCmdFnc, .cmdUsg = ledCmdUsage},
 	{.cmdName = "mem", .cmdFnc = memCmdFnc, .cmdUsg = memCmdUsage},
 	{.cmdName = "monitor", .cmdFnc = monitorCmdFnc, .cmdUsg = monitorCmdUsage},
+	{.cmdName = "rpc", .cmdFnc = rpcCmdFnc, .cmdUsg = rpcCmdUsage},
 	{.cmdName = "trackpad", .cmdFnc = trackpadCmdFnc, .cmdUsg = trackpadCmdUsage},
 	{.cmdName = "test", .cmdFnc = testCmdFnc, .cmdUsg = testCmdUsage},
 	{.cmdName = "version", .cmdFnc = versionCmdFnc, .cmdUsg = versionCmdUsage},
@@ -31,6 +31,7 @@
 #include "usb.h"
 #include "command.h"
 #include "led_ctrl.h"
+#include "rpc.h"
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -447,6 +448,12 @@ static void handleSerialChar(char c) {
  */
 void handleConsoleInput(void) {
 	while (usb_tstc()) {
-		handleSerialChar(usb_getc());
+		char c = usb_getc();
+		// Binary RPC frames share serial input device with console
+		if (!rpcRxChar(c)) {
+			handleSerialChar(c);
+		}
 	}
+
+	rpcPoll();
 }
@@ -37,6 +37,10 @@
 
 #define EEPROM_SIZE (4 * 1024)
 
+#define EEPROM_RECORD_HDR_LEN (4) //!< Magic word, version and instance.
+#define EEPROM_RECORD_CHUNK_LEN (16) //!< Bytes read back at once when 
+	//!< verifying a saved record.
+
 /**
  * Print command usage details to console.
  *
@@ -235,3 +239,142 @@ int eepromWrite(uint32_t offset, const void* writeData, uint32_t numBytes){
 
 	return status_result[0];
 }
+
+/**
+ * Fill in header for a record.
+ *
+ * \param[in] desc Record type.
+ * \param instance Which instance record is for.
+ * \param[out] hdr Where to store EEPROM_RECORD_HDR_LEN bytes.
+ *
+ * \return None.
+ */
+static void fillRecordHdr(const EepromRecordDesc* desc, uint8_t instance,
+	uint8_t* hdr) {
+	hdr[0] = desc->magicWord & 0xFF;
+	hdr[1] = desc->magicWord >> 8;
+	hdr[2] = desc->version;
+	hdr[3] = instance;
+}
+
+/**
+ * Compute record checksum.
+ *
+ * \param[in] hdr Record header.
+ * \param[in] payload Record payload.
+ * \param len Size of payload in bytes.
+ *
+ * \return Ones complement of 16-bit sum of header and payload bytes.
+ */
+static uint16_t calcRecordChecksum(const uint8_t* hdr, const uint8_t* payload,
+	uint32_t len) {
+	uint16_t sum = 0;
+
+	for (int idx = 0; idx < EEPROM_RECORD_HDR_LEN; idx++) {
+		sum += hdr[idx];
+	}
+	for (int idx = 0; idx < len; idx++) {
+		sum += payload[idx];
+	}
+
+	return ~sum;
+}
+
+/**
+ * Load a record previously saved with eepromRecordSave().
+ *
+ * \param[in] desc Record type.
+ * \param instance Which instance (i.e. Trackpad) to load record for.
+ * \param[out] payload Where to store desc->len bytes. May be modified even
+ *	if load fails, so callers that need to keep old values should load into
+ *	a copy.
+ *
+ * \return 0 on success. Negative value if no valid record is saved.
+ */
+int eepromRecordLoad(const EepromRecordDesc* desc, uint8_t instance,
+	void* payload) {
+	uint32_t offset = desc->offset + instance * desc->stride;
+	uint8_t hdr[EEPROM_RECORD_HDR_LEN];
+	uint8_t expected_hdr[EEPROM_RECORD_HDR_LEN];
+	uint16_t checksum = 0;
+
+	if (eepromRead(offset, hdr, sizeof(hdr)) || 
+		eepromRead(offset + sizeof(hdr), payload, desc->len) ||
+		eepromRead(offset + sizeof(hdr) + desc->len, &checksum, 
+		sizeof(checksum))) {
+		return -1;
+	}
+
+	fillRecordHdr(desc, instance, expected_hdr);
+	if (memcmp(hdr, expected_hdr, 2)) {
+		return -2;
+	}
+
+	if (memcmp(hdr, expected_hdr, sizeof(hdr))) {
+		return -3;
+	}
+
+	if (checksum != calcRecordChecksum(hdr, payload, desc->len)) {
+		return -4;
+	}
+
+	return 0;
+}
+
+/**
+ * Save a record so that it can be loaded (i.e. on next boot) with 
+ *  eepromRecordLoad(). Record is read back to make sure write actually took.
+ *
+ * \param[in] desc Record type.
+ * \param instance Which instance (i.e. Trackpad) record is for.
+ * \param[in] payload desc->len bytes to save.
+ *
+ * \return 0 on success.
+ */
+int eepromRecordSave(const EepromRecordDesc* desc, uint8_t instance,
+	const void* payload) {
+	uint32_t offset = desc->offset + instance * desc->stride;
+	uint8_t hdr[EEPROM_RECORD_HDR_LEN];
+	uint8_t readback[EEPROM_RECORD_CHUNK_LEN];
+
+	fillRecordHdr(desc, instance, hdr);
+	uint16_t checksum = calcRecordChecksum(hdr, payload, desc->len);
+
+	if (eepromWrite(offset, hdr, sizeof(hdr)) || 
+		eepromWrite(offset + sizeof(hdr), payload, desc->len) ||
+		eepromWrite(offset + sizeof(hdr) + desc->len, &checksum, 
+		sizeof(checksum))) {
+		return -1;
+	}
+
+	// Make sure write actually took
+	if (eepromRead(offset, readback, sizeof(hdr))) {
+		return -2;
+	}
+	if (memcmp(hdr, readback, sizeof(hdr))) {
+		return -3;
+	}
+
+	for (uint32_t pos = 0; pos < desc->len; pos += sizeof(readback)) {
+		uint32_t len = desc->len - pos;
+		if (len > sizeof(readback)) {
+			len = sizeof(readback);
+		}
+		if (eepromRead(offset + sizeof(hdr) + pos, readback, len)) {
+			return -2;
+		}
+		if (memcmp((const uint8_t*)payload + pos, readback, len)) {
+			return -3;
+		}
+	}
+
+	if (eepromRead(offset + sizeof(hdr) + desc->len, readback, 
+		sizeof(checksum))) {
+		return -2;
+	}
+	if (memcmp(&checksum, readback, sizeof(checksum))) {
+		return -3;
+	}
+
+	return 0;
+}
@@ -26,6 +26,7 @@
  */
 
 #include "haptic.h"
+#include "haptic_feedback.h"
 
 #include "lpc_types.h"
 #include "chip.h"
@@ -308,21 +309,30 @@ void initHaptics(void) {
  * \param[in] notes Buffer containing a sequence of notes to be played.
  * \param numNotes The number of notes in the notes buffer.
  *
- * \return 0 on sucess.
+ * \return 0 on sucess. -2 if haptic is already playing something.
  */
 int playHaptic(enum Haptic haptic, const struct Note* notes, uint32_t numNotes) {
+	int retval = 0;
+
 	if (!notes) {
 		return -1;
 	}
 
-	if (hapticBusy[haptic]) {
-		return -2;
-	}
-
 	if (!numNotes) {
 		return -3;
 	}
 
+	// Haptic feedback plays from ISR context, so nothing else can be let in
+	//  between checking haptic is free and starting sequence. Caller may
+	//  already have IRQs disabled, so state is restored on exit
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (hapticBusy[haptic]) {
+		retval = -2;
+		goto exit;
+	}
+
 	hapticNotes[haptic] = notes;
 	hapticNotesIdx[haptic] = 0;
 	hapticNotesLen[haptic] = numNotes;
@@ -331,10 +341,57 @@ int playHaptic(enum Haptic haptic, const struct Note* notes, uint32_t numNotes)
 
 	startHapticNote(haptic, notes);
 
-	//TODO: need to protect this with locking mechanism?
 	Chip_TIMER_MatchEnableInt(hapticTimer, getHapticMR(haptic));
 
-	return 0;
+exit:
+	if (!primask) {
+		__enable_irq();
+	}
+
+	return retval;
+}
+
+/**
+ * Stop whatever sequence is playing on a haptic right away.
+ * 
+ * \param haptic Defines which haptic is being referred to.
+ *
+ * \return None.
+ */
+void stopHaptic(enum Haptic haptic) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	Chip_TIMER_MatchDisableInt(hapticTimer, getHapticMR(haptic));
+	Chip_TIMER_ClearMatch(hapticTimer, getHapticMR(haptic));
+	setHapticGpioState(haptic, false);
+	hapticBusy[haptic] = false;
+	hapticNotes[haptic] = NULL;
+
+	if (!primask) {
+		__enable_irq();
+	}
+}
+
+/**
+ * \param haptic Defines which haptic is being referred to.
+ *
+ * \return Sequence of notes (as passed to playHaptic()) currently playing on
+ *	haptic. NULL if haptic is not busy.
+ */
+const struct Note* getHapticNotes(enum Haptic haptic) {
+	const struct Note* notes = NULL;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (hapticBusy[haptic]) {
+		notes = hapticNotes[haptic];
+	}
+	if (!primask) {
+		__enable_irq();
+	}
+
+	return notes;
 }
 
 /**
@@ -376,11 +433,20 @@ uint32_t getUsTickCntHaptic(void) {
 void hapticCmdUsage(void) {
 	printf(
 		"usage: haptic {hapticId} {dutyCycle} {frequency} {duration}\n"
+		"       haptic feedback [on/off/reset]\n"
+		"       haptic feedback tickDist val\n"
+		"       haptic feedback click on/off\n"
 		"\n"
 		"hapticId = \"right\" or \"left\" to specify which haptic\n"
 		"dutyCycle = 0-255 for percentage pulse should be in high state\n"
 		"frequency = Frequency of pulse to generate in Hz\n"
 		"duration = Duration of repeated pulse in ms\n"
+		"\n"
+		"feedback: show settings and input to pulse latency (or enable,\n"
+		"	disable, reset stats) of ticks played each time a finger\n"
+		"	travels tickDist units (0 = no ticks) over a Trackpad and\n"
+		"	clicks played when a Trackpad is pressed. Ticks need\n"
+		"	'trackpad sched start' to be running\n"
 	);
 }
 
@@ -395,6 +461,10 @@ void hapticCmdUsage(void) {
 int hapticCmdFnc(int argc, const char* argv[]) {
 	static struct Note note = {0, 0, 0, 0};
 
+	if (argc >= 2 && !strcmp("feedback", argv[1])) {
+		return hapticFeedbackCmdFnc(argc - 1, &argv[1]);
+	}
+
 	if (argc != 5) {
 		hapticCmdUsage();
 		
@@ -0,0 +1,400 @@
+/**
+ * \file haptic_feedback.c
+ * \brief Encompasses playing haptic ticks as a finger travels over a Trackpad
+ *	and clicks when a Trackpad is pressed, without waiting on the host.
+ *	Ticks are played from the PendSV handler that decodes each Trackpad
+ *	frame as soon as it is published and clicks from pin interrupts on the
+ *	Trackpad click switches, so the time from input to first pulse is only
+ *	interrupt work.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "haptic_feedback.h"
+
+#include "chip.h"
+
+#include "haptic.h"
+#include "trackpad.h"
+#include "time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GPIO_R_TRACKPAD_CLICK 1, 21 //!< Right Trackpad click switch (see 
+	//!< buttons.c). Low while pressed.
+#define GPIO_L_TRACKPAD_CLICK 1, 26 //!< Left Trackpad click switch (see
+	//!< buttons.c). Low while pressed.
+
+#define PINT_R_TRACKPAD_CLICK 5 //!< GPIO Pin Interrupt configured for Right
+	//!< Trackpad click.
+#define PINT_L_TRACKPAD_CLICK 6 //!< GPIO Pin Interrupt configured for Left
+	//!< Trackpad click.
+
+#define FB_CLICK_DEBOUNCE_US (20000) //!< Press is only a click if switch has
+	//!< not changed state for this long (i.e. it is not bouncing).
+#define FB_LATENCY_BUDGET_US (2000) //!< Input to pulse latency above this 
+	//!< is counted as late.
+#define FB_DFLT_TICK_DIST (40) //!< Default finger travel (units) per tick.
+
+/**
+ * Defines what input a pulse was played for.
+ */
+typedef enum FbSrc_t {
+	FB_SRC_TICK = 0, //!< Finger travelled tick distance.
+	FB_SRC_CLICK = 1, //!< Trackpad was pressed.
+	NUM_FB_SRCS = 2
+} FbSrc;
+
+/**
+ * Pulses played for one input source on one Trackpad.
+ */
+typedef struct FbStats {
+	uint32_t pulses; //!< Number of times pulse was started.
+	uint32_t busy; //!< Number of times pulse was skipped because haptic
+		//!< was playing something else.
+	uint32_t late; //!< Pulses started more than FB_LATENCY_BUDGET_US after
+		//!< input.
+	uint32_t usSum; //!< Total input to pulse latency.
+	uint32_t usMax; //!< Largest input to pulse latency.
+} FbStats;
+
+/**
+ * Finger travel since last tick on one Trackpad.
+ */
+typedef struct FbTravel {
+	bool touch; //!< Finger was down in last frame.
+	int32_t x; //!< X position in last frame (TPAD_POS_FRAC_BITS fixed point).
+	int32_t y; //!< Y position in last frame (TPAD_POS_FRAC_BITS fixed point).
+	uint32_t dist; //!< Travel since last tick (TPAD_POS_FRAC_BITS fixed
+		//!< point).
+} FbTravel;
+
+static const Note fbTickNote = {
+	.dutyCycle = 128,
+	.pulseFreq = 2000,
+	.duration = 2
+}; //!< Short, light pulse train played per tick distance.
+static const Note fbClickNote = {
+	.dutyCycle = 255,
+	.pulseFreq = 400,
+	.duration = 10
+}; //!< Longer, stronger pulse train played on press.
+
+static volatile bool fbEn = false; //!< Feedback is being played.
+static volatile bool fbClickEn = true; //!< Clicks are played while fbEn.
+static volatile uint32_t fbTickDist = FB_DFLT_TICK_DIST; //!< Finger travel
+	//!< (units) per tick. 0 means no ticks.
+
+static volatile FbStats fbStats[2][NUM_FB_SRCS]; //!< Stats for each 
+	//!< Trackpad and input source. Only modified from priority 1 ISRs, or
+	//!< with IRQs disabled.
+static FbTravel fbTravels[2]; //!< Only touched from PendSV context.
+static uint32_t fbClickEdgeUs[2]; //!< When click switch of each Trackpad
+	//!< last changed state.
+
+/**
+ * \param trackpad Trackpad input came from.
+ *
+ * \return Haptic on same side as Trackpad.
+ */
+static inline Haptic fbHaptic(Trackpad trackpad) {
+	return trackpad == L_TRACKPAD ? L_HAPTIC : R_HAPTIC;
+}
+
+/**
+ * Start pulse train for input and record how long it took since input.
+ * 
+ * \param trackpad Trackpad input came from.
+ * \param src What kind of input it was.
+ * \param inputUs When input was seen (getUsTickCnt() time).
+ *
+ * \return None.
+ */
+static void playFb(Trackpad trackpad, FbSrc src, uint32_t inputUs) {
+	Haptic haptic = fbHaptic(trackpad);
+	const Note* note = src == FB_SRC_CLICK ? &fbClickNote : &fbTickNote;
+	volatile FbStats* stats = &fbStats[trackpad][src];
+
+	// Click matters more than rest of a tick, but anything else playing 
+	//  (i.e. jingle) is left alone
+	if (src == FB_SRC_CLICK && getHapticNotes(haptic) == &fbTickNote) {
+		stopHaptic(haptic);
+	}
+
+	if (playHaptic(haptic, note, 1)) {
+		stats->busy++;
+		return;
+	}
+
+	// GPIO is driven high inside playHaptic(), so pulse has started
+	uint32_t latency_us = getUsTickCnt() - inputUs;
+	stats->pulses++;
+	stats->usSum += latency_us;
+	if (latency_us > stats->usMax) {
+		stats->usMax = latency_us;
+	}
+	if (latency_us > FB_LATENCY_BUDGET_US) {
+		stats->late++;
+	}
+}
+
+/**
+ * Called (from PendSV context) with position from each new Trackpad frame.
+ *  Plays a tick each time finger has travelled fbTickDist.
+ * 
+ * \param trackpad Trackpad frame is from.
+ * \param[in] pos Position from frame.
+ * \param drUs When DR was seen for last sample of frame.
+ *
+ * \return None.
+ */
+static void fbTpadPos(Trackpad trackpad, const TrackpadPos* pos, 
+	uint32_t drUs) {
+	FbTravel* travel = &fbTravels[trackpad];
+	uint32_t tick_dist = fbTickDist << TPAD_POS_FRAC_BITS;
+
+	if (!pos->touch || !travel->touch) {
+		travel->dist = 0;
+	} else if (tick_dist) {
+		uint32_t dx = abs(pos->x - travel->x);
+		uint32_t dy = abs(pos->y - travel->y);
+
+		// Larger axis plus half of smaller is close enough to distance
+		travel->dist += dx > dy ? dx + dy / 2 : dy + dx / 2;
+		if (travel->dist >= tick_dist) {
+			// At most one tick per frame. Extra travel is dropped
+			travel->dist %= tick_dist;
+			// Click ISRs can preempt and play on same haptic. Haptic
+			//  functions restore IRQ state, so this holds across all
+			//  of playFb()
+			__disable_irq();
+			playFb(trackpad, FB_SRC_TICK, drUs);
+			__enable_irq();
+		}
+	}
+
+	travel->touch = pos->touch;
+	travel->x = pos->x;
+	travel->y = pos->y;
+}
+
+/**
+ * Handle edge on click switch of a Trackpad. Only to be called from pin 
+ *  interrupt ISR.
+ * 
+ * \param trackpad Trackpad whose click switch changed state.
+ *
+ * \return None.
+ */
+static void fbClickIsr(Trackpad trackpad) {
+	uint32_t now = getUsTickCnt();
+	bool pressed = false;
+
+	if (trackpad == R_TRACKPAD) {
+		pressed = !Chip_GPIO_ReadPortBit(LPC_GPIO, GPIO_R_TRACKPAD_CLICK);
+	} else {
+		pressed = !Chip_GPIO_ReadPortBit(LPC_GPIO, GPIO_L_TRACKPAD_CLICK);
+	}
+
+	// Edges soon after another edge are switch bouncing
+	uint32_t quiet_us = now - fbClickEdgeUs[trackpad];
+	fbClickEdgeUs[trackpad] = now;
+
+	if (pressed && quiet_us >= FB_CLICK_DEBOUNCE_US && fbClickEn) {
+		playFb(trackpad, FB_SRC_CLICK, now);
+	}
+}
+
+/**
+ * ISR for 5 - GPIO pin interrupt 5, which occurs on either edge of Right 
+ *  Trackpad click switch.
+ * 
+ * \return None.
+ */
+void FLEX_INT5_IRQHandler(void) {
+	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_R_TRACKPAD_CLICK));
+
+	fbClickIsr(R_TRACKPAD);
+}
+
+/**
+ * ISR for 6 - GPIO pin interrupt 6, which occurs on either edge of Left 
+ *  Trackpad click switch.
+ * 
+ * \return None.
+ */
+void FLEX_INT6_IRQHandler(void) {
+	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_L_TRACKPAD_CLICK));
+
+	fbClickIsr(L_TRACKPAD);
+}
+
+/**
+ * Start or stop reacting to both edges of Trackpad click switches. Priority
+ *  matches SSP0 so clicks are not held up by frame capture, and ticks (from
+ *  PendSV) are played with IRQs disabled so the two never interleave.
+ * 
+ * \param enable True to start reacting to edges.
+ *
+ * \return None.
+ */
+static void setupFbClickIsrs(bool enable) {
+	if (enable) {
+		Chip_SYSCTL_SetPinInterrupt(PINT_R_TRACKPAD_CLICK, 
+			GPIO_R_TRACKPAD_CLICK);
+		Chip_PININT_ClearIntStatus(LPC_PININT, 
+			PININTCH(PINT_R_TRACKPAD_CLICK));
+		Chip_PININT_EnableIntHigh(LPC_PININT, 
+			PININTCH(PINT_R_TRACKPAD_CLICK));
+		Chip_PININT_EnableIntLow(LPC_PININT, 
+			PININTCH(PINT_R_TRACKPAD_CLICK));
+		NVIC_ClearPendingIRQ(PIN_INT5_IRQn);
+		NVIC_SetPriority(PIN_INT5_IRQn, 1);
+		NVIC_EnableIRQ(PIN_INT5_IRQn);
+
+		Chip_SYSCTL_SetPinInterrupt(PINT_L_TRACKPAD_CLICK, 
+			GPIO_L_TRACKPAD_CLICK);
+		Chip_PININT_ClearIntStatus(LPC_PININT, 
+			PININTCH(PINT_L_TRACKPAD_CLICK));
+		Chip_PININT_EnableIntHigh(LPC_PININT, 
+			PININTCH(PINT_L_TRACKPAD_CLICK));
+		Chip_PININT_EnableIntLow(LPC_PININT, 
+			PININTCH(PINT_L_TRACKPAD_CLICK));
+		NVIC_ClearPendingIRQ(PIN_INT6_IRQn);
+		NVIC_SetPriority(PIN_INT6_IRQn, 1);
+		NVIC_EnableIRQ(PIN_INT6_IRQn);
+	} else {
+		NVIC_DisableIRQ(PIN_INT5_IRQn);
+		Chip_PININT_DisableIntHigh(LPC_PININT, 
+			PININTCH(PINT_R_TRACKPAD_CLICK));
+		Chip_PININT_DisableIntLow(LPC_PININT, 
+			PININTCH(PINT_R_TRACKPAD_CLICK));
+		Chip_PININT_ClearIntStatus(LPC_PININT, 
+			PININTCH(PINT_R_TRACKPAD_CLICK));
+		NVIC_ClearPendingIRQ(PIN_INT5_IRQn);
+
+		NVIC_DisableIRQ(PIN_INT6_IRQn);
+		Chip_PININT_DisableIntHigh(LPC_PININT, 
+			PININTCH(PINT_L_TRACKPAD_CLICK));
+		Chip_PININT_DisableIntLow(LPC_PININT, 
+			PININTCH(PINT_L_TRACKPAD_CLICK));
+		Chip_PININT_ClearIntStatus(LPC_PININT, 
+			PININTCH(PINT_L_TRACKPAD_CLICK));
+		NVIC_ClearPendingIRQ(PIN_INT6_IRQn);
+	}
+}
+
+/**
+ * Start or stop playing haptic feedback for Trackpad travel and clicks. 
+ *  Ticks need scan scheduler running (see trackpadSchedStart()).
+ * 
+ * \param enable True to start playing feedback.
+ *
+ * \return None.
+ */
+void hapticFeedbackEnable(bool enable) {
+	if (enable == fbEn) {
+		return;
+	}
+
+	if (enable) {
+		memset(fbTravels, 0, sizeof(fbTravels));
+		trackpadSetPosCallback(fbTpadPos);
+	} else {
+		trackpadSetPosCallback(NULL);
+	}
+	setupFbClickIsrs(enable);
+
+	fbEn = enable;
+}
+
+/**
+ * Print feedback settings and input to pulse latency for each Trackpad.
+ *
+ * \return None.
+ */
+static void fbPrintStats(void) {
+	FbStats stats[2][NUM_FB_SRCS];
+
+	printf("Haptic feedback %s. Tick every %d units of travel, clicks %s. "
+		"Latency budget %d us\n", fbEn ? "enabled" : "disabled", 
+		fbTickDist, fbClickEn ? "enabled" : "disabled", 
+		FB_LATENCY_BUDGET_US);
+
+	__disable_irq();
+	memcpy(stats, (void*)fbStats, sizeof(stats));
+	__enable_irq();
+
+	printf("\n");
+	printf("Trackpad Input Pulses   Busy   Late  Avg us  Max us\n");
+	printf("---------------------------------------------------\n");
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		for (int src = 0; src < NUM_FB_SRCS; src++) {
+			const FbStats* stat = &stats[tpad][src];
+			printf("%-8s %-5s %6d %6d %6d %7d %7d\n", 
+				tpad == L_TRACKPAD ? "Left" : "Right",
+				src == FB_SRC_CLICK ? "click" : "tick", stat->pulses,
+				stat->busy, stat->late, 
+				stat->pulses ? stat->usSum / stat->pulses : 0,
+				stat->usMax);
+		}
+	}
+}
+
+/**
+ * Handle 'haptic feedback' command line function.
+ *
+ * \param argc Number of arguments (i.e. size of argv). argv[0] is 
+ *	"feedback".
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
+ */
+int hapticFeedbackCmdFnc(int argc, const char* argv[]) {
+	if (argc == 1) {
+		fbPrintStats();
+	} else if (argc == 2 && !strcmp("on", argv[1])) {
+		hapticFeedbackEnable(true);
+	} else if (argc == 2 && !strcmp("off", argv[1])) {
+		hapticFeedbackEnable(false);
+	} else if (argc == 2 && !strcmp("reset", argv[1])) {
+		__disable_irq();
+		memset((void*)fbStats, 0, sizeof(fbStats));
+		__enable_irq();
+	} else if (argc == 3 && !strcmp("tickDist", argv[1])) {
+		fbTickDist = strtol(argv[2], NULL, 0);
+	} else if (argc == 3 && !strcmp("click", argv[1]) && 
+		!strcmp("on", argv[2])) {
+		fbClickEn = true;
+	} else if (argc == 3 && !strcmp("click", argv[1]) && 
+		!strcmp("off", argv[2])) {
+		fbClickEn = false;
+	} else {
+		hapticCmdUsage();
+		return -1;
+	}
+
+	return 0;
+}
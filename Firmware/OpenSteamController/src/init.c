@@ -252,6 +252,7 @@ void initStatsCmdUsage(void) {
 		"usage: initStats\n"
 		"\n"
 		"Prints details on GPIO states at startup v.s. upon command call.\n"
+		"Also prints how long Trackpad initialization took.\n"
 	);
 }
 
@@ -268,6 +269,8 @@ int initStatsCmdFnc(int argc, const char* argv[]) {
 	printf("PIO0_2 was %d on startup. Is %d now.\n", 
 		pio0_2_start_val, Chip_GPIO_GetPinState(LPC_GPIO, 0, 2));
 
+	trackpadPrintInitStats();
+
 	return 0;
 
 }
@@ -821,6 +821,66 @@ static int clearJingleEEPROM(void) {
 	return 0;
 }
 
+/**
+ * Write raw bytes into Jingle Data blob (i.e. to upload a blob built on a 
+ *  host PC in pieces). Call jingleDataCommit() once the whole blob has been
+ *  written.
+ *
+ * \param offset Byte offset from start of Jingle Data blob.
+ * \param[in] data Bytes to write.
+ * \param numBytes Number of bytes in data.
+ *
+ * \return 0 on success.
+ */
+int jingleDataWrite(uint32_t offset, const void* data, uint32_t numBytes) {
+	if (offset > JINGLE_DATA_MAX_BYTES || 
+		numBytes > JINGLE_DATA_MAX_BYTES - offset) {
+		return -1;
+	}
+
+	memcpy(&rawJingleData[offset], data, numBytes);
+
+	return 0;
+}
+
+/**
+ * Check Jingle Data blob written via jingleDataWrite() and bring bookkeeping
+ *  (i.e. bytes free for addJingle()) in line with it.
+ *
+ * \param save True to also save Jingle Data to EEPROM (see 
+ *	saveJingleEEPROM()).
+ *
+ * \return 0 on success. Jingle Data is cleared if blob is not valid.
+ */
+int jingleDataCommit(bool save) {
+	uint8_t num_jingles = getNumJingles();
+	if (!jingleDataIsValid() || num_jingles > MAX_NUM_JINGLES) {
+		initJingleData();
+		return -1;
+	}
+
+	// Same layout addJingle() builds: header, offsets and then Jingles
+	uint32_t end = sizeof(JD_MAGIC_WORD) + 2 + 1 + 1 +
+		sizeof(uint16_t) * MAX_NUM_JINGLES;
+	if (num_jingles > 0) {
+		uint16_t offset = getJingleOffset(num_jingles-1);
+		end = offset + 2 * sizeof(uint16_t) + 
+			getNumJingleNotes(L_HAPTIC, num_jingles-1) * sizeof(Note) +
+			getNumJingleNotes(R_HAPTIC, num_jingles-1) * sizeof(Note);
+		if (!offset || end > JINGLE_DATA_MAX_BYTES) {
+			initJingleData();
+			return -2;
+		}
+	}
+	numJingleBytesFree = JINGLE_DATA_MAX_BYTES - end;
+
+	if (save && saveJingleEEPROM()) {
+		return -3;
+	}
+
+	return 0;
+}
+
 /**
  * Prints details to console regarding how to use the haptic command line 
  *  function.
@@ -0,0 +1,723 @@
+/**
+ * \file rpc.c
+ * \brief Encompasses a framed binary command channel that shares the USB CDC
+ *	UART with the console. Host tools get checked, sequence numbered 
+ *	request/response frames (one round trip per operation) instead of 
+ *	typing console commands and matching printed text.
+ *
+ * Each frame on the wire is RPC_MAGIC, then the frame COBS encoded (so it 
+ *  holds no 0x00 bytes), then 0x00. Decoded frames are:
+ *
+ *	Request:  seq, cmd, args..., crc16
+ *	Response: seq, cmd | RPC_RSP_BIT, status, data..., crc16
+ *	Event:    seq, RPC_EVT_TELEM | RPC_RSP_BIT, 0, data..., crc16
+ *
+ *  Multi-byte values are little endian. crc16 is CRC-16/CCITT-FALSE over
+ *  everything before it. Frames that fail the check are dropped without a
+ *  response, so host retries (with same seq) after a timeout. Every command
+ *  is idempotent (i.e. jingle data is written by offset) so retries are safe.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rpc.h"
+
+#include "usb.h"
+#include "time.h"
+#include "eeprom_access.h"
+#include "jingle_data.h"
+#include "buttons.h"
+#include "adc_read.h"
+#include "trackpad.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define RPC_MAX_DATA (128) //!< Most bytes of results (or data to write) a 
+	//!< single frame carries.
+#define RPC_HDR_SZ (3) //!< Bytes before data in a response (seq, cmd, 
+	//!< status).
+#define RPC_CRC_SZ (2) //!< Bytes of CRC at end of each frame.
+#define RPC_MAX_FRAME (RPC_HDR_SZ + 4 + RPC_MAX_DATA + RPC_CRC_SZ) //!< Largest
+	//!< decoded frame (room for arguments that come with data).
+#define RPC_MAX_ENC (1 + RPC_MAX_FRAME + RPC_MAX_FRAME / 254 + 1 + 1) //!< 
+	//!< Largest frame on wire. COBS adds a byte per 254, plus magic and 
+	//!< delimiter.
+
+#define RPC_RSP_BIT (0x80) //!< Set in cmd of frames sent by controller.
+
+#define RPC_RX_TIMEOUT_US (100 * 1000) //!< Partial frame is dropped (and 
+	//!< input goes back to console) if nothing is received for this long.
+
+/**
+ * Identifies operation requested by a frame.
+ */
+typedef enum RpcCmdId_t {
+	RPC_CMD_PING = 0x00, //!< Returns version and RPC_MAX_DATA.
+	RPC_CMD_MEM_READ = 0x01, //!< Read memory mapped region (see 'mem').
+	RPC_CMD_EEPROM_READ = 0x02, //!< Read EEPROM (see 'eeprom').
+	RPC_CMD_JINGLE_WRITE = 0x03, //!< Write to Jingle Data blob.
+	RPC_CMD_JINGLE_COMMIT = 0x04, //!< Validate (and save) Jingle Data.
+	RPC_CMD_TELEM_SUB = 0x05, //!< Start/stop periodic telemetry events.
+	RPC_EVT_TELEM = 0x40, //!< Unsolicited telemetry sample.
+} RpcCmdId;
+
+/**
+ * Status returned in each response.
+ */
+typedef enum RpcStatus_t {
+	RPC_OK = 0,
+	RPC_ERR_ARGS = -1, //!< Arguments are wrong size or out of range.
+	RPC_ERR_CMD = -2, //!< Command is not supported.
+	RPC_ERR_FAILED = -3, //!< Operation was attempted but failed.
+} RpcStatus;
+
+/**
+ * Handler for one RpcCmdId.
+ */
+typedef struct {
+	uint8_t id; //!< Command handled.
+	int (*fnc)(const uint8_t* args, uint32_t argsLen, uint8_t* data, 
+		uint32_t* dataLen); //!< Fills in up to RPC_MAX_DATA bytes of 
+		//!< data and returns a RpcStatus.
+} RpcCmd;
+
+/**
+ * Counters shown by 'rpc stats'.
+ */
+typedef struct {
+	uint32_t frames; //!< Frames that passed checks and were handled.
+	uint32_t errors; //!< Handled frames that returned an error status.
+	uint32_t badFrames; //!< Frames too short or not validly COBS encoded.
+	uint32_t crcErrors; //!< Frames dropped as CRC did not match.
+	uint32_t overflows; //!< Frames dropped as they were too large.
+	uint32_t timeouts; //!< Partial frames dropped after RPC_RX_TIMEOUT_US.
+	uint32_t telemSent; //!< Telemetry events queued for transmit.
+	uint32_t telemDrops; //!< Telemetry events dropped as transmit FIFO was
+		//!< full.
+} RpcStats;
+
+static bool rpcRxActive = false; //!< Input is part of a frame (i.e. 
+	//!< RPC_MAGIC was received and delimiter has not been yet).
+static bool rpcRxOverflow = false; //!< Frame in progress did not fit.
+SRAM1_BSS static uint8_t rpcRxBuf[RPC_MAX_ENC]; //!< Encoded frame being 
+	//!< received. Decoded in place.
+static uint32_t rpcRxLen = 0; //!< Number of valid bytes in rpcRxBuf.
+static uint32_t rpcRxLastUs = 0; //!< When last byte of frame was received.
+
+SRAM1_BSS static uint8_t rpcTxFrame[RPC_MAX_FRAME]; //!< Frame being sent.
+	//!< Command handlers write data straight after header.
+SRAM1_BSS static uint8_t rpcTxEnc[RPC_MAX_ENC]; //!< Encoded frame being sent.
+
+static uint32_t rpcTelemPeriodUs = 0; //!< Time between telemetry events. 0
+	//!< means not subscribed.
+static uint32_t rpcTelemLastUs = 0; //!< When last telemetry event was sent.
+static uint8_t rpcTelemSeq = 0; //!< Sequence number of next telemetry event.
+
+static RpcStats rpcStats; //!< See RpcStats.
+
+/**
+ * CRC-16/CCITT-FALSE remainders for each nibble. Half the work of bitwise
+ *  loop for a 32 byte table.
+ */
+static const uint16_t CRC16_NIBBLE_TABLE[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+/**
+ * Buttons reported in telemetry events. Bit n of buttons field is set if 
+ *  entry n reports button is pressed.
+ */
+static int (* const RPC_BUTTON_FNCS[])(void) = {
+	getSteamButtonState,
+	getFrontLeftButtonState,
+	getFrontRightButtonState,
+	getJoyClickState,
+	getXButtonState,
+	getYButtonState,
+	getBButtonState,
+	getAButtonState,
+	getRightGripState,
+	getLeftGripState,
+	getRightTrackpadClickState,
+	getLeftTrackpadClickState,
+	getRightTriggerState,
+	getLeftTriggerState,
+	getRightBumperState,
+	getLeftBumperState,
+};
+
+/**
+ * \param[in] data Bytes to check.
+ * \param len Number of bytes in data.
+ *
+ * \return CRC-16/CCITT-FALSE of data.
+ */
+static uint16_t rpcCrc16(const uint8_t* data, uint32_t len) {
+	uint16_t crc = 0xFFFF;
+
+	for (uint32_t idx = 0; idx < len; idx++) {
+		crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[(crc >> 12) ^ 
+			(data[idx] >> 4)];
+		crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[(crc >> 12) ^ 
+			(data[idx] & 0x0F)];
+	}
+
+	return crc;
+}
+
+/**
+ * Values in frames are not aligned, and Cortex-M0 cannot do unaligned 
+ *  accesses, so they are always handled a byte at a time.
+ *
+ * \param[in] buff Location of little endian value.
+ *
+ * \return Value.
+ */
+static uint16_t getLe16(const uint8_t* buff) {
+	return buff[0] | (buff[1] << 8);
+}
+
+/**
+ * \param[in] buff Location of little endian value.
+ *
+ * \return Value.
+ */
+static uint32_t getLe32(const uint8_t* buff) {
+	return buff[0] | (buff[1] << 8) | (buff[2] << 16) | 
+		((uint32_t)buff[3] << 24);
+}
+
+/**
+ * \param[out] buff Where to store little endian value.
+ * \param val Value to store.
+ *
+ * \return None.
+ */
+static void putLe16(uint8_t* buff, uint16_t val) {
+	buff[0] = val;
+	buff[1] = val >> 8;
+}
+
+/**
+ * \param[out] buff Where to store little endian value.
+ * \param val Value to store.
+ *
+ * \return None.
+ */
+static void putLe32(uint8_t* buff, uint32_t val) {
+	buff[0] = val;
+	buff[1] = val >> 8;
+	buff[2] = val >> 16;
+	buff[3] = val >> 24;
+}
+
+/**
+ * Consistent Overhead Byte Stuffing encode, so frame holds no 0x00 bytes.
+ *
+ * \param[in] in Bytes to encode.
+ * \param len Number of bytes in in.
+ * \param[out] out Encoded bytes. Must have room for len + len / 254 + 1.
+ *
+ * \return Number of bytes in out.
+ */
+static uint32_t cobsEncode(const uint8_t* in, uint32_t len, uint8_t* out) {
+	uint32_t code_idx = 0;
+	uint32_t out_idx = 1;
+	uint8_t code = 1;
+
+	for (uint32_t idx = 0; idx < len; idx++) {
+		if (in[idx]) {
+			out[out_idx++] = in[idx];
+			code++;
+		}
+		if (!in[idx] || code == 0xFF) {
+			out[code_idx] = code;
+			code = 1;
+			code_idx = out_idx++;
+		}
+	}
+	out[code_idx] = code;
+
+	return out_idx;
+}
+
+/**
+ * Consistent Overhead Byte Stuffing decode. Decoded data is never longer 
+ *  than encoded data, so in and out can be the same buffer.
+ *
+ * \param[in] in Bytes to decode (without 0x00 delimiter).
+ * \param len Number of bytes in in.
+ * \param[out] out Decoded bytes.
+ *
+ * \return Number of bytes in out, or negative if in is not valid.
+ */
+static int cobsDecode(const uint8_t* in, uint32_t len, uint8_t* out) {
+	uint32_t idx = 0;
+	uint32_t out_idx = 0;
+
+	while (idx < len) {
+		uint8_t code = in[idx++];
+		if (!code || idx + code - 1 > len) {
+			return -1;
+		}
+
+		for (int cnt = 1; cnt < code; cnt++) {
+			out[out_idx++] = in[idx++];
+		}
+
+		if (code != 0xFF && idx < len) {
+			out[out_idx++] = 0;
+		}
+	}
+
+	return out_idx;
+}
+
+/**
+ * Send frame in rpcTxFrame (whose data has already been filled in).
+ *
+ * \param seq Sequence number.
+ * \param cmd Command ID (without RPC_RSP_BIT).
+ * \param status RpcStatus.
+ * \param dataLen Number of data bytes in rpcTxFrame after header.
+ * \param tryOnly True to drop frame (instead of waiting) if transmit FIFO
+ *	does not have room.
+ *
+ * \return 0 on success.
+ */
+static int rpcSend(uint8_t seq, uint8_t cmd, int status, uint32_t dataLen,
+	bool tryOnly) {
+	rpcTxFrame[0] = seq;
+	rpcTxFrame[1] = cmd | RPC_RSP_BIT;
+	rpcTxFrame[2] = (uint8_t)status;
+
+	uint32_t len = RPC_HDR_SZ + dataLen;
+	putLe16(&rpcTxFrame[len], rpcCrc16(rpcTxFrame, len));
+	len += RPC_CRC_SZ;
+
+	rpcTxEnc[0] = RPC_MAGIC;
+	uint32_t enc_len = 1 + cobsEncode(rpcTxFrame, len, &rpcTxEnc[1]);
+	rpcTxEnc[enc_len++] = 0;
+
+	if (tryOnly) {
+		return usb_tryPutb((const char*)rpcTxEnc, enc_len);
+	}
+
+	usb_write(rpcTxEnc, enc_len);
+	usb_flush();
+
+	return 0;
+}
+
+/**
+ * Handle RPC_CMD_PING.
+ *
+ * \param[in] args No arguments.
+ * \param argsLen Number of bytes in args.
+ * \param[out] data Major version (u8), minor version (u8) and RPC_MAX_DATA
+ *	(u16).
+ * \param[out] dataLen Number of bytes in data.
+ *
+ * \return RpcStatus.
+ */
+static int rpcPing(const uint8_t* args, uint32_t argsLen, uint8_t* data, 
+	uint32_t* dataLen) {
+	data[0] = DEV_BOARD_FW_VER_MAJOR;
+	data[1] = DEV_BOARD_FW_VER_MINOR;
+	putLe16(&data[2], RPC_MAX_DATA);
+	*dataLen = 4;
+
+	return RPC_OK;
+}
+
+/**
+ * Handle RPC_CMD_MEM_READ. Words are read with accesses of their size, so 
+ *  peripheral registers can be read as with 'mem read'.
+ *
+ * \param[in] args Address (u32), word size in bits (u8) and number of words 
+ *	(u16).
+ * \param argsLen Number of bytes in args.
+ * \param[out] data Words read (little endian).
+ * \param[out] dataLen Number of bytes in data.
+ *
+ * \return RpcStatus.
+ */
+static int rpcMemRead(const uint8_t* args, uint32_t argsLen, uint8_t* data, 
+	uint32_t* dataLen) {
+	if (argsLen != 7) {
+		return RPC_ERR_ARGS;
+	}
+
+	uint32_t addr = getLe32(&args[0]);
+	uint32_t word_size = args[4];
+	uint32_t num_words = getLe16(&args[5]);
+	uint32_t bytes_per_word = word_size / 8;
+
+	if (word_size != 8 && word_size != 16 && word_size != 32) {
+		return RPC_ERR_ARGS;
+	}
+
+	// Unaligned access would fault
+	if (addr % bytes_per_word || 
+		num_words * bytes_per_word > RPC_MAX_DATA) {
+		return RPC_ERR_ARGS;
+	}
+
+	for (uint32_t idx = 0; idx < num_words; idx++) {
+		if (word_size == 8) {
+			data[idx] = ((volatile uint8_t*)addr)[idx];
+		} else if (word_size == 16) {
+			putLe16(&data[idx * 2], ((volatile uint16_t*)addr)[idx]);
+		} else {
+			putLe32(&data[idx * 4], ((volatile uint32_t*)addr)[idx]);
+		}
+	}
+	*dataLen = num_words * bytes_per_word;
+
+	return RPC_OK;
+}
+
+/**
+ * Handle RPC_CMD_EEPROM_READ.
+ *
+ * \param[in] args EEPROM offset (u16) and number of bytes (u16).
+ * \param argsLen Number of bytes in args.
+ * \param[out] data Bytes read.
+ * \param[out] dataLen Number of bytes in data.
+ *
+ * \return RpcStatus.
+ */
+static int rpcEepromRead(const uint8_t* args, uint32_t argsLen, 
+	uint8_t* data, uint32_t* dataLen) {
+	if (argsLen != 4) {
+		return RPC_ERR_ARGS;
+	}
+
+	uint32_t offset = getLe16(&args[0]);
+	uint32_t num_bytes = getLe16(&args[2]);
+	if (num_bytes > RPC_MAX_DATA) {
+		return RPC_ERR_ARGS;
+	}
+
+	if (eepromRead(offset, data, num_bytes) != CMD_SUCCESS) {
+		return RPC_ERR_FAILED;
+	}
+	*dataLen = num_bytes;
+
+	return RPC_OK;
+}
+
+/**
+ * Handle RPC_CMD_JINGLE_WRITE.
+ *
+ * \param[in] args Offset into Jingle Data blob (u16) followed by bytes to
+ *	write there.
+ * \param argsLen Number of bytes in args.
+ * \param[out] data Nothing.
+ * \param[out] dataLen Number of bytes in data.
+ *
+ * \return RpcStatus.
+ */
+static int rpcJingleWrite(const uint8_t* args, uint32_t argsLen, 
+	uint8_t* data, uint32_t* dataLen) {
+	if (argsLen < 2) {
+		return RPC_ERR_ARGS;
+	}
+
+	if (jingleDataWrite(getLe16(&args[0]), &args[2], argsLen - 2)) {
+		return RPC_ERR_ARGS;
+	}
+
+	return RPC_OK;
+}
+
+/**
+ * Handle RPC_CMD_JINGLE_COMMIT.
+ *
+ * \param[in] args Flags (u8). Bit 0 set saves Jingle Data to EEPROM.
+ * \param argsLen Number of bytes in args.
+ * \param[out] data Number of Jingles (u8).
+ * \param[out] dataLen Number of bytes in data.
+ *
+ * \return RpcStatus.
+ */
+static int rpcJingleCommit(const uint8_t* args, uint32_t argsLen, 
+	uint8_t* data, uint32_t* dataLen) {
+	if (argsLen != 1) {
+		return RPC_ERR_ARGS;
+	}
+
+	if (jingleDataCommit(args[0] & 0x1)) {
+		return RPC_ERR_FAILED;
+	}
+
+	data[0] = getNumJingles();
+	*dataLen = 1;
+
+	return RPC_OK;
+}
+
+/**
+ * Handle RPC_CMD_TELEM_SUB.
+ *
+ * \param[in] args Period in ms (u16). 0 stops telemetry events.
+ * \param argsLen Number of bytes in args.
+ * \param[out] data Nothing.
+ * \param[out] dataLen Number of bytes in data.
+ *
+ * \return RpcStatus.
+ */
+static int rpcTelemSub(const uint8_t* args, uint32_t argsLen, uint8_t* data,
+	uint32_t* dataLen) {
+	if (argsLen != 2) {
+		return RPC_ERR_ARGS;
+	}
+
+	rpcTelemPeriodUs = getLe16(&args[0]) * 1000;
+	rpcTelemLastUs = getUsTickCnt() - rpcTelemPeriodUs;
+
+	return RPC_OK;
+}
+
+static const RpcCmd rpcCmds[] = {
+	{.id = RPC_CMD_PING, .fnc = rpcPing},
+	{.id = RPC_CMD_MEM_READ, .fnc = rpcMemRead},
+	{.id = RPC_CMD_EEPROM_READ, .fnc = rpcEepromRead},
+	{.id = RPC_CMD_JINGLE_WRITE, .fnc = rpcJingleWrite},
+	{.id = RPC_CMD_JINGLE_COMMIT, .fnc = rpcJingleCommit},
+	{.id = RPC_CMD_TELEM_SUB, .fnc = rpcTelemSub},
+};
+
+/**
+ * Check, execute and respond to a complete frame in rpcRxBuf.
+ *
+ * \return None.
+ */
+static void rpcHandleFrame(void) {
+	int len = cobsDecode(rpcRxBuf, rpcRxLen, rpcRxBuf);
+	if (len < 2 + RPC_CRC_SZ) {
+		rpcStats.badFrames++;
+		return;
+	}
+
+	len -= RPC_CRC_SZ;
+	if (getLe16(&rpcRxBuf[len]) != rpcCrc16(rpcRxBuf, len)) {
+		rpcStats.crcErrors++;
+		return;
+	}
+	rpcStats.frames++;
+
+	uint8_t seq = rpcRxBuf[0];
+	uint8_t id = rpcRxBuf[1];
+	int status = RPC_ERR_CMD;
+	uint32_t data_len = 0;
+
+	for (int idx = 0; idx < ARRAY_SIZE(rpcCmds); idx++) {
+		if (rpcCmds[idx].id == id) {
+			status = rpcCmds[idx].fnc(&rpcRxBuf[2], len - 2, 
+				&rpcTxFrame[RPC_HDR_SZ], &data_len);
+			break;
+		}
+	}
+
+	if (status != RPC_OK) {
+		rpcStats.errors++;
+		data_len = 0;
+	}
+
+	rpcSend(seq, id, status, data_len, false);
+}
+
+/**
+ * Sample controller state and queue it as a telemetry event. 
+ *
+ * \return None.
+ */
+static void rpcSendTelem(void) {
+	uint8_t* data = &rpcTxFrame[RPC_HDR_SZ];
+
+	// Start conversions so they run while buttons are read
+	updateAdcVals();
+	trackpadLocUpdate(R_TRACKPAD);
+	trackpadLocUpdate(L_TRACKPAD);
+
+	uint16_t buttons = 0;
+	for (int idx = 0; idx < ARRAY_SIZE(RPC_BUTTON_FNCS); idx++) {
+		if (RPC_BUTTON_FNCS[idx]()) {
+			buttons |= 1 << idx;
+		}
+	}
+
+	uint16_t r_x = 0;
+	uint16_t r_y = 0;
+	uint16_t l_x = 0;
+	uint16_t l_y = 0;
+	trackpadGetLastXY(R_TRACKPAD, &r_x, &r_y);
+	trackpadGetLastXY(L_TRACKPAD, &l_x, &l_y);
+
+	// Wait for the conversion started above and take all four values from
+	//  that same cycle, rather than from whichever update happened to
+	//  finish (or restart) between individual reads
+	static const AdcChan TELEM_ADC_CHANS[] = {
+		ADC_R_TRIG, ADC_L_TRIG, ADC_JOYSTICK_X, ADC_JOYSTICK_Y
+	};
+	uint16_t adc_vals[ARRAY_SIZE(TELEM_ADC_CHANS)];
+	getAdcVals(TELEM_ADC_CHANS, adc_vals, ARRAY_SIZE(TELEM_ADC_CHANS));
+
+	putLe32(&data[0], getUsTickCnt());
+	putLe16(&data[4], buttons);
+	putLe16(&data[6], r_x);
+	putLe16(&data[8], r_y);
+	putLe16(&data[10], l_x);
+	putLe16(&data[12], l_y);
+	putLe16(&data[14], adc_vals[0]);
+	putLe16(&data[16], adc_vals[1]);
+	putLe16(&data[18], adc_vals[2]);
+	putLe16(&data[20], adc_vals[3]);
+
+	// Like 'trackpad stream', a dropped sample is better than stalling
+	if (rpcSend(rpcTelemSeq++, RPC_EVT_TELEM, RPC_OK, 22, true)) {
+		rpcStats.telemDrops++;
+	} else {
+		rpcStats.telemSent++;
+	}
+}
+
+/**
+ * Feed a character received on serial input device to RPC framing. 
+ *
+ * \param c Character received from serial input device.
+ *
+ * \return True if character was part of a frame (and should not be handled
+ *	by console).
+ */
+bool rpcRxChar(uint8_t c) {
+	if (!rpcRxActive) {
+		if (c != RPC_MAGIC) {
+			return false;
+		}
+		rpcRxActive = true;
+		rpcRxOverflow = false;
+		rpcRxLen = 0;
+		rpcRxLastUs = getUsTickCnt();
+		return true;
+	}
+	rpcRxLastUs = getUsTickCnt();
+
+	if (!c) {
+		// Delimiter, so frame is complete
+		rpcRxActive = false;
+		if (rpcRxOverflow) {
+			rpcStats.overflows++;
+		} else {
+			rpcHandleFrame();
+		}
+		return true;
+	}
+
+	if (rpcRxLen < sizeof(rpcRxBuf)) {
+		rpcRxBuf[rpcRxLen++] = c;
+	} else {
+		rpcRxOverflow = true;
+	}
+
+	return true;
+}
+
+/**
+ * Take care of RPC work that is not driven by received characters (i.e. 
+ *  partial frame timeouts and telemetry events). Call from main loop.
+ *
+ * \return None.
+ */
+void rpcPoll(void) {
+	uint32_t now = getUsTickCnt();
+
+	if (rpcRxActive && now - rpcRxLastUs > RPC_RX_TIMEOUT_US) {
+		// Most likely a stray RPC_MAGIC (i.e. Ctrl-B typed in console)
+		rpcRxActive = false;
+		rpcStats.timeouts++;
+	}
+
+	if (rpcTelemPeriodUs && now - rpcTelemLastUs >= rpcTelemPeriodUs) {
+		rpcTelemLastUs = now;
+		rpcSendTelem();
+	}
+}
+
+/**
+ * Print command usage details to console.
+ *
+ * \return None.
+ */
+void rpcCmdUsage(void) {
+	printf(
+		"usage: rpc stats [reset]\n"
+		"       rpc telem off\n"
+		"\n"
+		"Binary RPC frames (used by host tools, see rpc.c) share the\n"
+		"console. Each starts with 0x%02x and ends with 0x00.\n"
+		"stats: show (or reset) frames handled, dropped and telemetry\n"
+		"	events sent\n"
+		"telem off: stop telemetry events (i.e. host tool exited\n"
+		"	without unsubscribing)\n",
+		RPC_MAGIC
+	);
+}
+
+/**
+ * Handle RPC command line function.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
+ */
+int rpcCmdFnc(int argc, const char* argv[]) {
+	if (argc >= 2 && !strcmp("stats", argv[1])) {
+		if (argc == 3 && !strcmp("reset", argv[2])) {
+			memset(&rpcStats, 0, sizeof(rpcStats));
+			return 0;
+		}
+
+		printf("%d frames handled (%d returned errors)\n", 
+			rpcStats.frames, rpcStats.errors);
+		printf("Dropped: %d bad encoding, %d CRC, %d too large, %d timed "
+			"out\n", rpcStats.badFrames, rpcStats.crcErrors, 
+			rpcStats.overflows, rpcStats.timeouts);
+		printf("Telemetry every %d us: %d sent, %d dropped\n",
+			rpcTelemPeriodUs, rpcStats.telemSent, rpcStats.telemDrops);
+		return 0;
+	} else if (argc == 3 && !strcmp("telem", argv[1]) && 
+		!strcmp("off", argv[2])) {
+		rpcTelemPeriodUs = 0;
+		return 0;
+	}
+
+	rpcCmdUsage();
+	return -1;
+}
@@ -29,6 +29,7 @@
 #include "test.h"
 
 #include "usb.h"
+#include "time.h"
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -95,14 +96,260 @@ int testPrintCmdFnc(int argc, const char* argv[]) {
 	return 0;
 }
 
-//TODO
+#define TEST_USB_TX_LINE_SZ (64) //!< Bytes per line sent by testUsbTx().
+
+/**
+ * Print USB CDC UART transmit counters.
+ *
+ * \param[in] stats Counters to print.
+ *
+ * \return None.
+ */
+static void testPrintUsbTxStats(const UsbTxStats* stats) {
+	printf("%d bytes in %d packets (%d short, %d bytes/packet avg). %d "
+		"cycles stalled waiting for room in FIFO\n", stats->bytes, 
+		stats->packets, stats->shortPackets, 
+		stats->packets ? stats->bytes / stats->packets : 0, 
+		stats->stallCycles);
+
+	// Each flush point used to force out at least one packet
+	int32_t saved = stats->flushPoints - stats->shortPackets;
+	printf("%d flush points (newlines and flushes). %d sent at SOF on "
+		"request, %d after lingering %d ms. ~%d packets saved\n", 
+		stats->flushPoints, stats->sofFlushes, stats->lingerFlushes,
+		usb_getTxLinger(), saved > 0 ? saved : 0);
+}
+
+/**
+ * Measure USB CDC UART transmit throughput by sending lines of text as fast
+ *  as usb_write() will take them.
+ *
+ * \param numBytes Number of bytes to send.
+ *
+ * \return 0 on success.
+ */
+static int testUsbTx(uint32_t numBytes) {
+	char line[TEST_USB_TX_LINE_SZ];
+	UsbTxStats start_stats;
+	UsbTxStats end_stats;
+	uint32_t sent = 0;
+
+	usb_drain();
+	usb_getTxStats(&start_stats);
+	uint32_t start_us = getUsTickCnt();
+
+	while (sent < numBytes && !usb_tstc()) {
+		uint32_t len = numBytes - sent;
+		if (len > TEST_USB_TX_LINE_SZ) {
+			len = TEST_USB_TX_LINE_SZ;
+		}
+
+		// Change characters each line so dropped data stands out
+		for (int idx = 0; idx < TEST_USB_TX_LINE_SZ - 2; idx++) {
+			line[idx] = ((sent / TEST_USB_TX_LINE_SZ + idx) % 94) + 
+				33;
+		}
+		line[TEST_USB_TX_LINE_SZ - 2] = '\r';
+		line[TEST_USB_TX_LINE_SZ - 1] = '\n';
+
+		usb_write(line, len);
+		sent += len;
+	}
+
+	usb_drain();
+
+	uint32_t elapsed_us = getUsTickCnt() - start_us;
+	usb_getTxStats(&end_stats);
+
+	end_stats.bytes -= start_stats.bytes;
+	end_stats.packets -= start_stats.packets;
+	end_stats.shortPackets -= start_stats.shortPackets;
+	end_stats.stallCycles -= start_stats.stallCycles;
+	end_stats.flushPoints -= start_stats.flushPoints;
+	end_stats.sofFlushes -= start_stats.sofFlushes;
+	end_stats.lingerFlushes -= start_stats.lingerFlushes;
+
+	printf("\n");
+	printf("Sent %d bytes in %d us (%d bytes/s)\n", sent, elapsed_us,
+		elapsed_us ? (uint32_t)((uint64_t)sent * 1000000 / elapsed_us) : 0);
+	testPrintUsbTxStats(&end_stats);
+
+	return 0;
+}
+
+#define TEST_USB_RX_TIMEOUT_US (1000 * 1000) //!< How long testUsbRx() waits
+	//!< for next byte before deciding data was lost.
+
+/**
+ * Print USB CDC UART receive counters.
+ *
+ * \param[in] stats Counters to print.
+ *
+ * \return None.
+ */
+static void testPrintUsbRxStats(const UsbRxStats* stats) {
+	printf("%d bytes in %d packets received. Host held off (NAKed) %d "
+		"times waiting for room in FIFO\n", stats->bytes, stats->packets,
+		stats->stalls);
+}
+
+/**
+ * Check that USB CDC UART receive never drops data, even when host sends
+ *  faster than it is read. Host is expected to send numBytes bytes where 
+ *  byte n has the value n & 0xFF (starting once "Ready" is printed).
+ *
+ * \param numBytes Number of bytes to receive.
+ * \param delayUs Time to wait after every USB_MAX_PACKET_SZ bytes are read, so
+ *	receive FIFO fills and host has to be held off.
+ *
+ * \return 0 if all data was received intact.
+ */
+static int testUsbRx(uint32_t numBytes, uint32_t delayUs) {
+	UsbRxStats start_stats;
+	UsbRxStats end_stats;
+	uint32_t rcvd = 0;
+	uint32_t errors = 0;
+	uint32_t first_error = 0;
+	uint8_t expected = 0;
+
+	// Leftovers from command line (i.e. '\n' of "\r\n") are not test data
+	while (usb_tstc()) {
+		usb_getc();
+	}
+
+	printf("Ready to receive %d bytes\n", numBytes);
+	usb_drain();
+
+	usb_getRxStats(&start_stats);
+	uint32_t start_us = getUsTickCnt();
+	uint32_t last_us = start_us;
+
+	while (rcvd < numBytes) {
+		if (!usb_tstc()) {
+			// Dropped data means we never get numBytes
+			if (getUsTickCnt() - last_us > TEST_USB_RX_TIMEOUT_US) {
+				break;
+			}
+			continue;
+		}
+		last_us = getUsTickCnt();
+
+		uint8_t byte = usb_getc();
+		if (byte != expected) {
+			if (!errors) {
+				first_error = rcvd;
+			}
+			errors++;
+		}
+		// Resync so one gap counts as one error
+		expected = byte + 1;
+		rcvd++;
+
+		if (delayUs && !(rcvd % 64)) {
+			usleep(delayUs);
+		}
+	}
+
+	uint32_t elapsed_us = last_us - start_us;
+	usb_getRxStats(&end_stats);
+
+	end_stats.bytes -= start_stats.bytes;
+	end_stats.packets -= start_stats.packets;
+	end_stats.stalls -= start_stats.stalls;
+
+	printf("Received %d of %d bytes in %d us (%d bytes/s)\n", rcvd, 
+		numBytes, elapsed_us, elapsed_us ? 
+		(uint32_t)((uint64_t)rcvd * 1000000 / elapsed_us) : 0);
+	testPrintUsbRxStats(&end_stats);
+
+	if (rcvd < numBytes) {
+		printf("FAIL: timed out waiting for data (%d bytes lost)\n", 
+			numBytes - rcvd);
+		return -1;
+	} else if (errors) {
+		printf("FAIL: %d gaps/corruptions (first at byte %d)\n", errors,
+			first_error);
+		return -1;
+	}
+
+	printf("PASS: no data lost\n");
+	return 0;
+}
+
+/**
+ * Print test command usage details to console.
+ *
+ * \return None.
+ */
 void testCmdUsage(void) {
 	printf(
-		"usage: test ??? (WIP)\n"
+		"usage: test print\n"
+		"       test usbTx numBytes\n"
+		"       test usbRx numBytes [delayUs]\n"
+		"       test usbStats [reset]\n"
+		"       test usbLinger [frames]\n"
+		"\n"
+		"print: print randomly cut strings until a key is pressed to\n"
+		"	make sure printing never locks up\n"
+		"usbTx: send numBytes of text as fast as possible and report\n"
+		"	USB CDC UART throughput and packet counts\n"
+		"usbRx: receive numBytes where byte n is n & 0xFF and check\n"
+		"	none are lost. Reading pauses delayUs (default 1000)\n"
+		"	every 64 bytes so host must be held off. i.e. on Linux:\n"
+		"	stty -F /dev/ttyACM0 raw -echo; python -c \"import os;\n"
+		"	os.write(1, bytearray(n & 255 for n in range(N)))\"\n"
+		"	> /dev/ttyACM0\n"
+		"usbStats: show (or reset) packets sent, short packets,\n"
+		"	cycles stalled waiting on USB CDC UART transmit FIFO,\n"
+		"	packets saved by coalescing flushes and receive counters\n"
+		"usbLinger: show (or set) how many frames (ms) output waits for\n"
+		"	a full packet before it is sent anyway. Explicit flushes\n"
+		"	(i.e. echo) always go out at next frame\n"
 	);
 }
-//TODO
+
+/**
+ * Handle test command line function.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
+ */
 int testCmdFnc(int argc, const char* argv[]) { 
+	if (argc == 2 && !strcmp("print", argv[1])) {
+		return testPrintCmdFnc(argc, argv);
+	} else if (argc == 3 && !strcmp("usbTx", argv[1])) {
+		return testUsbTx(strtol(argv[2], NULL, 0));
+	} else if ((argc == 3 || argc == 4) && !strcmp("usbRx", argv[1])) {
+		uint32_t delay_us = 1000;
+		if (argc == 4) {
+			delay_us = strtol(argv[3], NULL, 0);
+		}
+		return testUsbRx(strtol(argv[2], NULL, 0), delay_us);
+	} else if (argc >= 2 && !strcmp("usbStats", argv[1])) {
+		if (argc == 3 && !strcmp("reset", argv[2])) {
+			usb_resetTxStats();
+			usb_resetRxStats();
+		} else {
+			UsbTxStats tx_stats;
+			UsbRxStats rx_stats;
+			usb_getTxStats(&tx_stats);
+			usb_getRxStats(&rx_stats);
+			testPrintUsbTxStats(&tx_stats);
+			testPrintUsbRxStats(&rx_stats);
+		}
+		return 0;
+	} else if (argc == 2 && !strcmp("usbLinger", argv[1])) {
+		printf("Output lingers up to %d frames for a full packet\n", 
+			usb_getTxLinger());
+		return 0;
+	} else if (argc == 3 && !strcmp("usbLinger", argv[1])) {
+		usb_setTxLinger(strtol(argv[2], NULL, 0));
+		return 0;
+	}
+
+	testCmdUsage();
 	return -1;
 }
 
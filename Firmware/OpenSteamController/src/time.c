@@ -31,6 +31,9 @@
 
 #include "haptic.h"
 
+#include "lpc_types.h"
+#include "chip.h"
+
 /**
  * Any initialization related to time functions.
  * 
@@ -40,6 +43,12 @@ void initTime(void) {
 	// Make sure haptics are initialized as we are using their time 
 	//  functions (for now at least)
 	initHaptics();
+
+	// SysTick is otherwise unused, so let it free run at core clock for 
+	//  timing short sections of code. No interrupt is needed
+	SysTick->LOAD = CYCLE_CNT_MASK;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
 }
 
 /**
@@ -64,3 +73,28 @@ uint32_t getUsTickCnt(void) {
 	// Share timer used by haptics
 	return getUsTickCntHaptic();
 }
+
+/**
+ * Get the current value of a counter that increments each core clock cycle.
+ *  Counter is only CYCLE_CNT_MASK wide, so is only good for timing short
+ *  sections of code (i.e. less than ~300 ms). Use cyclesSince() to work out
+ *  elapsed cycles.
+ * 
+ * \return Current cycle count.
+ */
+uint32_t getCycleCnt(void) {
+	// SysTick counts down
+	return CYCLE_CNT_MASK - SysTick->VAL;
+}
+
+/**
+ * Work out how many core clock cycles have passed since getCycleCnt() was
+ *  called.
+ * 
+ * \param start Value returned by getCycleCnt().
+ * 
+ * \return Elapsed cycles.
+ */
+uint32_t cyclesSince(uint32_t start) {
+	return (getCycleCnt() - start) & CYCLE_CNT_MASK;
+}
@@ -1,6 +1,9 @@
 /**
  * \file trackpad.c
  * \brief Encompasses functions communicating with trackpad via SPI.
+ *	Scheduling of frames, calibration, diagnostics and the trackpad
+ *	command are in trackpad_sched.c, trackpad_cal.c, trackpad_diag.c
+ *	and trackpad_cmd.c.
  *
  * MIT License
  *
@@ -26,233 +29,217 @@
  */
 
 #include "trackpad.h"
+#include "trackpad_int.h"
 
-#include "lpc_types.h"
-#include "chip.h"
-#include "ssp_11xx.h"
-#include "time.h"
-#include "usb.h"
-#include "eeprom_access.h"
-
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define ANYMEAS_EN (1) //!< This flag controls whether the trackpad ASICs are
-	//!< configured to perform movement tracking calcualtions or whether
-	//!< all access to Trackpad ASICs is in AnyMeas mode (i.e. a raw
-	//!< data access mode). 
+#define TPAD_DFLT_MODE (TPAD_MODE_ANYMEAS) //!< Mode both Trackpads are setup
+	//!< in at boot. Either Trackpad can be switched at runtime (see 
+	//!< trackpadSetMode()) between having the Trackpad ASIC perform
+	//!< movement tracking calculations (i.e. absolute mode) or having all 
+	//!< access to Trackpad ASIC be in AnyMeas mode (i.e. a raw data access
+	//!< mode). 
 	//!< Note: AnyMeas Mode is the way the official firmware uses the 
 	//!<  and either Normal Mode does not work well or I am missing some
 	//!<  setup or configuration steps... Going to focus on AnyMeas Mode
-	//!<  since we at least have official FW as reference. Leaving
-	//!<  Normal Mode option in here just in case anyone wants to try
-	//!<  and work with it in the future.
+	//!<  since we at least have official FW as reference. Absolute
+	//!<  mode is kept as an option as it costs far less CPU time, which
+	//!<  can be enough for some uses (i.e. Trackpad as a D-pad).
 	//!< Note: AnyMeas Mode seems to be poorly documented. Code below
 	//!<  was obtained by replicating official firmware behavior and
 	//!<  using https://github.com/cirque-corp/Cirque_Pinnacle_1CA027/blob/master/Additional_Examples/AnyMeas_Example/Pinnacle.h
 	//!<  as a reference. 
 
-static LPC_SSP_T* const spiRegs = LPC_SSP0;
-
-#define GPIO_SSP0_SCK0 1, 29 //!< SPI Clock Pin
-#define GPIO_SSP0_MISO0 0, 8 //!< SPI Master In Slave Out Pin
-#define GPIO_SSP0_MOSI0 0, 9 //!< SPI Master Out Slave In Pin
-
-#define GPIO_R_TRACKPAD_CS_N 1, 15 //!< Chip select pin for communicating with
-		//!< Right Trackpad.
 #define GPIO_R_TRACKPAD_DR 0, 23 //!< Data Ready pin for Right Trackpad.
 		//!< Indicates Trackpad Data Registers have data to be read.
-#define GPIO_L_TRACKPAD_CS_N 1, 6 //!< Chip select pin for communicating with
-		//!< Left Trackpad.
 #define GPIO_L_TRACKPAD_DR 1, 16 //!< Data Ready pin for Right Trackpad.
 		//!< Indicates Trackpad Data Registers have data to be read.
 
-#define PINT_R_TRACKPAD 3 //!< GPIO Pin Interrupt configured for Right Trackpad.
-#define PINT_L_TRACKPAD 4 //!< GPIO Pin Interrupt configured for Left Trackpad.
-
+int tpadInitRets[2]; //!< Return value of setupTpad() for each Trackpad.
+uint32_t tpadInitUs[2]; //!< How long setupTpad() took for each
+	//!< Trackpad.
+uint32_t tpadEraUs[2]; //!< How long Extended Register programming
+	//!< took during setupTpad() for each Trackpad.
 
-#if (!ANYMEAS_EN)
+#define TPAD_MEAS_TIMEOUT_US (5 * 1000) //!< Longest takeTpadAdcMeas() waits
+	//!< for DR before reading result anyway.
 
-typedef struct TrackpadAbsData {
-	uint16_t xPos;
-	uint16_t yPos;
-	uint16_t zPos;
-} TrackpadAbsData;
+TpadMeasStats tpadMeasStats[2]; //!< Single measurement stats for 
+	//!< each Trackpad.
 
-volatile TrackpadAbsData tpadAbsDatas[2][2]; //!< Two copies of absolute data
-	//!< for each trackpad. This is filled in by ISR and can be read by
-	//!< function(s) requesting most up to date X/Y position.
-volatile int tpadAbsDataIdxs[2]; //!< Defines which copy in tpadAbsData will be 
-	//!< written to on next ISR, and thus defins which copy is most recent.
-volatile bool tpadIsrBusys[2]; //!< Defines if the interrupt is currently being 
-	//!< being handled.
+volatile TrackpadMode tpadModes[2]; //!< Current mode of each Trackpad.
 
+#define TPAD_ABS_MIN_X (127) //!< Smallest X reported in absolute mode.
+#define TPAD_ABS_MAX_X (1919) //!< Largest X reported in absolute mode.
+#define TPAD_ABS_MIN_Y (63) //!< Smallest Y reported in absolute mode.
+#define TPAD_ABS_MAX_Y (1471) //!< Largest Y reported in absolute mode.
 
-#else  // if (ANYMEAS_EN)
+SRAM1_BSS volatile TpadModeStats tpadModeStats[2][2]; //!< Stats for
+	//!< each Trackpad, in each mode.
+volatile uint32_t tpadModeSinceUs[2]; //!< When each Trackpad entered 
+	//!< current mode (or stats were reset).
 
+#if TPAD_LAT_HIST_EN
+volatile TpadLatHist tpadLatHists[2][NUM_TPAD_LAT_STAGES]; //!<
+	//!< Latency histograms for each Trackpad. Each stage is only added to
+	//!< from one IRQ priority (or with IRQs disabled), so no locking.
+#endif
 
-#define NUM_ANYMEAS_X_ADCS (11) //!< The number of ADC reading used for 
-	//!< calculating the X axis position.
-#define NUM_ANYMEAS_Y_ADCS (8) //!< The number of ADC reading used for 
-	//!< calculating the Y axis position. 
-#define NUM_ANYMEAS_ADCS (NUM_ANYMEAS_X_ADCS + NUM_ANYMEAS_Y_ADCS) //!< The
-	//!< total number of AnyMeas ADCs read for computing X/Y position.
-
-#define ANYMEAS_X_ADC_ADDR (0x01df) //!< Start address for AnyMeas ADCs
-	//!< relating to X position
-#define ANYMEAS_Y_ADC_ADDR (0x015b) //!< Start address for AnyMeas ADCs
-	//!< relating to Y position
-
-static int16_t tpadAdcComps[2][NUM_ANYMEAS_ADCS]; //!< Compensation values 
-	//!< for AnyMeas ADC channels used to calculate X/Y position.
-static volatile int16_t tpadAdcDatas[2][NUM_ANYMEAS_ADCS]; //!< The ADC 
+volatile int16_t tpadAdcDatas[2][NUM_ANYMEAS_ADCS]; //!< The ADC 
 	//!< values relating to X/Y position filled in by ISR. Read tpadAdcIdxs
 	//!< to tell if these are currently being updated.
-static volatile int tpadAdcIdxs[2]; //!< Tracks how tpadAdcDatas is being
+volatile int tpadAdcIdxs[2]; //!< Tracks how tpadAdcDatas is being
 	//!< updated. If this is NUM_ANYMEAS_ADCS, it means tpadAdcDatas
 	//!< are all safe to be read.
+/**
+ * Last complete set of AnyMeas ADC values (i.e. frame) captured from a 
+ *  Trackpad. This is published by ISR using a sequence lock: seq is odd while
+ *  frame is being written, so readers copy frame out and try again if seq
+ *  was odd or changed while copying. This means neither side ever blocks.
+ */
+typedef struct TpadFrame {
+	volatile uint32_t seq; //!< Incremented before and after frame is 
+		//!< written.
+	volatile uint32_t timestampUs; //!< When last ADC of frame was read.
+	volatile uint32_t drUs; //!< When DR was seen for last sample of frame.
+	volatile TrackpadMode mode; //!< Mode Trackpad was in for frame.
+	volatile bool idle; //!< True if only presence probe was run for frame
+		//!< (i.e. no touch). adcs are left as they were for last full
+		//!< frame in this case.
+	volatile int16_t adcs[NUM_ANYMEAS_ADCS]; //!< AnyMeas ADC values. Left
+		//!< as they were for last AnyMeas frame in absolute mode.
+	volatile int16_t comps[NUM_ANYMEAS_ADCS]; //!< Compensation values adcs
+		//!< are to be decoded against (i.e. tpadAdcComps when frame was 
+		//!< captured, which baseline tracking and hopping change later).
+	volatile uint8_t hopSlot; //!< Index into tpadHopFreqs of toggle 
+		//!< frequency adcs were measured with.
+	volatile TrackpadAbsData abs; //!< Absolute mode packet.
+} TpadFrame;
+
+static TpadFrame tpadFrames[2]; //!< Latest frame for each Trackpad.
+
+/**
+ * Position computed from latest frame for a Trackpad, along with state of 
+ *  filters used to compute it.
+ */
+typedef struct TpadPosState {
+	uint32_t seq; //!< Sequence number of frame pos was computed from.
+	uint32_t drUs; //!< When DR was seen for last sample of frame.
+	bool consumed; //!< True once pos has been handed to a caller.
+	TrackpadPos pos; //!< Raw and filtered position.
+	TpadFilt filts[2]; //!< Filter state for X and Y.
+	TpadGesture gesture; //!< Gesture recognition state.
+} TpadPosState;
+
+static TpadPosState tpadPosStates[2]; //!< Latest position for each 
+	//!< Trackpad. Only modified with IRQs disabled (see updateTpadPos()).
+volatile bool tpadFiltEn = true; //!< Enables speed adaptive filter.
+TpadFiltParams tpadFiltParams = {
+	.minCutoffMhz = TPAD_FILT_DFLT_MIN_CUTOFF_MHZ,
+	.beta = TPAD_FILT_DFLT_BETA,
+	.dCutoffMhz = TPAD_FILT_DFLT_D_CUTOFF_MHZ
+}; //!< Tuning for speed adaptive filter used on all Trackpad axes.
+
+static volatile TrackpadPosCallback tpadPosCallback = NULL; //!< Called with
+	//!< position from each new frame. NULL if nothing wants it.
+
+volatile bool tpadGestureEn = true; //!< Enables gesture recognition.
+TpadGestureParams tpadGestureParams = {
+	.flickSpeed = TPAD_GESTURE_DFLT_FLICK_SPEED,
+	.inertiaTauMs = TPAD_GESTURE_DFLT_INERTIA_TAU_MS,
+	.stopSpeed = TPAD_GESTURE_DFLT_STOP_SPEED,
+	.circleRadius = TPAD_GESTURE_DFLT_CIRCLE_RADIUS,
+	.circleStep = TPAD_GESTURE_DFLT_CIRCLE_STEP
+}; //!< Tuning for gesture recognition used on both Trackpads.
+static TrackpadGesture tpadGesturePends[2]; //!< Gesture output not read by
+	//!< trackpadGetGesture() yet. Only modified with IRQs disabled.
+
+volatile TpadGestureStats tpadGestureStats[2]; //!< Cost of gesture 
+	//!< recognition for each Trackpad. Only modified with IRQs disabled.
+
+SRAM1_BSS TpadCorrGrid tpadCorrGrids[2]; //!< Geometric correction
+	//!< applied to positions from each Trackpad. Only modified with IRQs
+	//!< disabled.
+TpadCorrSrc tpadCorrSrcs[2]; //!< Where tpadCorrGrids came from.
+volatile bool tpadCorrEn = true; //!< Enables geometric correction.
+
+/**
+ * Contacts (i.e. fingers) found in latest frame for a Trackpad, along with
+ *  state used to keep contact IDs the same across frames.
+ */
+typedef struct TpadContactsState {
+	uint32_t seq; //!< Sequence number of frame contacts were found in.
+	TrackpadContacts contacts; //!< Fingers found.
+	TpadContactTracker tracker; //!< Contacts from last frame.
+} TpadContactsState;
+
+static TpadContactsState tpadContactsStates[2]; //!< Latest contacts for each
+	//!< Trackpad. Only modified with IRQs disabled (see 
+	//!< updateTpadContacts()).
+
+#define TPAD_SCHED_DFLT_FPS (250) //!< Rate scan scheduler is started at 
+	//!< during init. 0 means scan as fast as possible.
+
+uint8_t tpadRegShadows[2][NUM_TPAD_REGS]; //!< Last value written to 
+	//!< (or read from) each register on each Trackpad ASIC.
+uint32_t tpadRegValids[2]; //!< Bit N set means tpadRegShadows[][N]
+	//!< is known to match register N on Trackpad ASIC. Cleared bits are
+	//!< dirty (i.e. never written, or invalidated by reset).
+volatile uint32_t tpadRegWrites[2]; //!< Count of register writes 
+	//!< issued over SPI to each Trackpad ASIC.
+volatile uint32_t tpadRegElided[2]; //!< Count of register writes
+	//!< skipped since Trackpad ASIC register already had value.
+
+#define ERA_TIMEOUT_US (10 * 1000) //!< Longest to wait for an Extended Register
+	//!< Access to complete.
+
+/**
+ * Describes a sequential block of Trackpad ASIC Extended Registers to write.
+ */
+typedef struct TpadEraRec {
+	uint16_t addr; //!< First 16-bit extended register address.
+	uint8_t len; //!< Number of bytes in data to write.
+	uint8_t data[8]; //!< Values to write.
+} TpadEraRec;
+
+/**
+ * Mark all cached registers for Trackpad ASIC as dirty (i.e. next write to
+ *  each will not be skipped).
+ *
+ * \param trackpad Specifies which trackpad to invalidate cache for.
+ *
+ * \return None.
+ */
+static inline void invalidateTpadRegs(Trackpad trackpad) {
+	tpadRegValids[trackpad] = 0;
+}
+
+/**
+ * Record that a register write has been issued to Trackpad ASIC. Must be
+ *  called for every register write, including those batched into bursts.
+ *
+ * \param trackpad Specifies which trackpad was written to.
+ * \param addr Register address written to.
+ * \param val Value written to register.
+ *
+ * \return None.
+ */
+void noteTpadRegWrite(Trackpad trackpad, uint8_t addr, uint8_t val) {
+	addr &= 0x1F;
+
+	tpadRegWrites[trackpad]++;
 
+	// Registers go back to defaults we do not track on reset/shutdown
+	if (addr == TPAD_SYSCFG1_ADDR && (val & (TPAD_SYSCFG1_RESET_BIT | 
+		TPAD_SYSCFG1_SHUTDOWN_BIT))) {
+		invalidateTpadRegs(trackpad);
+		return;
+	}
 
-#endif // ANYMEAS_EN
-
-
-// Trackpad ASIC Registers. See https://github.com/cirque-corp/Cirque_Pinnacle_1CA027/blob/master/Additional_Examples/AnyMeas_Example
-//  for reference regarding usage (especially AnyMeas specific registers):
-#define TPAD_FW_ID_ADDR (0x00)
-#define TPAD_FW_VER_ADDR (0x01)
-#define TPAD_STATUS1_ADDR (0x02)
-	#define TPAD_STATUS1_SW_DR_BIT (0x04) // Software Data Ready
-	#define TPAD_STATUS1_CC_BIT (0x08) // Command Complete
-#define TPAD_SYSCFG1_ADDR (0x03)
-	#define TPAD_SYSCFG1_RESET_BIT (0x01)
-	#define TPAD_SYSCFG1_SHUTDOWN_BIT (0x02)
-	#define TPAD_SYSCFG1_SLEEP_BIT (0x04)
-	#define TPAD_SYSCFG1_TRACKDIS_BIT (0x08) // Disable internal tracking
-		// calculations
-	#define TPAD_SYSCFG1_ANYMEASEN_BIT (0x10) // Enables low level Any 
-		// Measure mode (i.e. raw mode). Changes registers 0x05 and on.
-	#define TPAD_SYSCFG1_GPIOCTRLEN_BIT (0x20)
-
-#if (!ANYMEAS_EN)
-
-#define TPAD_FEEDCFG1_ADDR (0x04)
-	#define TPAD_FEEDCFG1_FEEDEN_BIT (0x01) // Enable data flow
-	#define TPAD_FEEDCFG1_ABSEN_BIT (0x02) // Absolute mode enable (relative
-		// mode disable)
-	#define TPAD_FEEDCFG1_FILTDIS_BIT (0x04) // Filter disable
-	#define TPAD_FEEDCFG1_XDIS_BIT (0x08) // X disable
-	#define TPAD_FEEDCFG1_YDIS_BIT (0x10) // Y disable
-	#define TPAD_FEEDCFG1_XINVERT_BIT (0x40) // X data invert
-	#define TPAD_FEEDCFG1_YINVERT_BIT (0x80) // Y data disable
-#define TPAD_FEEDCFG2_ADDR (0x05)
-	#define TPAD_FEEDCFG2_INTMOUSE_BIT (0x01) // Intellimouse Enable
-	#define TPAD_FEEDCFG2_SWAPXY_BIT (0x80) // Swap X & Y (i.e. 90 degree
-		// rotation)
-#define TPAD_FEEDCFG3_ADDR (0x06)
-#define TPAD_CALCFG_ADDR (0x07)
-	#define TPAD_CALCFG_CALIBRATE (0x01) //
-#define TPAD_PS2AUXCTRL_ADDR (0x08)
-#define TPAD_SAMPLERATE_ADDR (0x09)
-	#define TPAD_SAMPLERATE_100 (0x64) // 100 Samples/Second
-#define TPAD_ZIDLE_ADDR (0x0A)
-#define TPAD_ZSCALER_ADDR (0x0B)
-#define TPAD_SLEEPINTERVAL_ADDR (0x0C)
-#define TPAD_SLEEPTIMER_ADDR (0x0D)
-#define TPAD_DYNEMI_ADDR (0x0E)
-#define TPAD_PACKETBTE0_ADDR (0x12)
-#define TPAD_PACKETBTE1_ADDR (0x13)
-#define TPAD_PACKETBTE2_ADDR (0x14)
-#define TPAD_PACKETBTE3_ADDR (0x15)
-#define TPAD_PACKETBTE4_ADDR (0x16)
-#define TPAD_PACKETBTE5_ADDR (0x17)
-
-#else  // if (ANYMEAS_EN)
-
-#define TPAD_ADCCFG1_ADDR (0x05) 
-	typedef enum TpadAdcGain_t {
-		TPAD_ADC_GAIN0 = 0xC0, // Lowest gain
-		TPAD_ADC_GAIN1 = 0x80, // ~1.3x gain
-		TPAD_ADC_GAIN2 = 0x40, // ~1.6x gain
-		TPAD_ADC_GAIN3 = 0x00 // ~2x gain
-	} TpadAdcGain; 
-	typedef enum TpadAdcToggleFreq_t {
-		TPAD_ADC_TOGGLE_FREQ_0 = 0x02, // 500,000 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_1 = 0x03, // 444,444 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_2 = 0x04, // 400,000 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_3 = 0x05, // 363,636 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_4 = 0x06, // 333,333 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_5 = 0x07, // 307,692 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_6 = 0x09, // 267,000 Hz (based on default aperture of 500ns)
-		TPAD_ADC_TOGGLE_FREQ_7 = 0x0B, // 235,000 Hz (based on default aperture of 500ns)
-	} TpadAdcToggleFreq; 
-#define TPAD_ADCCTRL_ADDR (0x06)
-	#define TPAD_ADCCTRL_STARTBUSY_BIT (0x80) 
-	#define TPAD_ADCCTRL_INTFLAG_BIT (0x40) 
-	#define TPAD_ADCCTRL_EN_BIT (0x20) 
-	typedef enum TpadAdcSampleLen_t {
-		TPAD_ADC_SAMPLEN_128 = 0x01,
-		TPAD_ADC_SAMPLEN_256 = 0x02,
-		TPAD_ADC_SAMPLEN_512 = 0x03
-	} TpadAdcSampleLen;
-#define TPAD_ADCMUXCTRL_ADDR (0x07)
-	typedef enum TpadAdcMuxSel_t {
-		TPAD_ADC_MUXSEL_SENSEP1GATE = 0x01 //!< Enables Sense P1.
-	} TpadAdcMuxSel;
-#define TPAD_ADCCFG2_ADDR (0x08) 
-	// Contains various configuration settings not likely to be used...
-#define TPAD_ADCWIDTH_ADDR (0x09) 
-	typedef enum TpadAdcAperture_t {
-		TPAD_ADC_APETURE_250NS = 0x02,
-		TPAD_ADC_APETURE_375NS = 0x03,
-		TPAD_ADC_APETURE_500NS = 0x04,
-		TPAD_ADC_APETURE_625NS = 0x05,
-		TPAD_ADC_APETURE_750NS = 0x06,
-		TPAD_ADC_APETURE_875NS = 0x07,
-		TPAD_ADC_APETURE_1000NS = 0x08,
-		TPAD_ADC_APETURE_1125NS = 0x09,
-		TPAD_ADC_APETURE_1250NS = 0x0A,
-		TPAD_ADC_APETURE_1375NS = 0x0B,
-		TPAD_ADC_APETURE_1500NS = 0x0C,
-		TPAD_ADC_APETURE_1625NS = 0x0D,
-		TPAD_ADC_APETURE_1750NS = 0x0E,
-		TPAD_ADC_APETURE_1875NS = 0x0F
-	} TpadAdcAperture;
-#define TPAD_ADC_START_ADDR_HI_ADDR (0x0A) 
-#define TPAD_ADC_START_ADDR_LO_ADDR (0x0B) 
-#define TPAD_MEASINDEX_ADDR (0x0C) 
-	#define TPAD_MEASINDEX_RSTSTART_BITS (0x00) 
-	#define TPAD_MEASINDEX_STARTMEAS_BITS (0x01) 
-	#define TPAD_MEASINDEX_WAIT_BITS (0x02) 
-#define TPAD_ANYMEASSTATE_ADDR (0x0D)
-#define TPAD_MEASCTRL_ADDR (0x0E) 
-	#define TPAD_MEASCTRL_REPEAT_BIT (0x80) 
-	#define TPAD_MEASCTRL_POSTMEASPWR_BIT (0x40) //!< Turn ADC off after
-		//!< measurements. Longer startup between measuremnts, but
-		//!< lower power usage.
-	#define TPAD_MEASCTRL_NUMMEAS_MASK (0x3F)
-#define TPAD_MEASRESULT_HI_ADDR (0x11) 
-#define TPAD_MEASRESULT_LO_ADDR (0x12) 
-// Toggle is part of taking ADC measurement... but don't fully understand it
-#define TPAD_TOGGLE_HIHI_ADDR (0x13) //!< Toggle(31:24)
-#define TPAD_TOGGLE_HILO_ADDR (0x14) //!< Toggle(23:16)
-#define TPAD_TOGGLE_LOHI_ADDR (0x15) //!< Toggle(15:8)
-#define TPAD_TOGGLE_LOLO_ADDR (0x16) //!< Toggle(7:0)
-// Polarity is part of taking ADC measurement... but don't fully understand it
-#define TPAD_POLARITY_HIHI_ADDR (0x17) //!< Polarity(31:24)
-#define TPAD_POLARITY_HILO_ADDR (0x18) //!< Polarity(23:16)
-#define TPAD_POLARITY_LOHI_ADDR (0x19) //!< Polarity(15:8)
-#define TPAD_POLARITY_LOLO_ADDR (0x1A) //!< Polarity(7:0)
-
-#endif // ANYMEAS_EN
-
-// These registers do not change based on AnyMeas settings:
-#define TPAD_ERA_VAL_ADDR 0x1B
-#define TPAD_ERA_HIADDR_ADDR 0x1C
-#define TPAD_ERA_LOADDR_ADDR 0x1D
-#define TPAD_ERA_CTRL_ADDR 0x1E
-
-#define TPAD_PRODID_ADDR 0x1F
+	tpadRegShadows[trackpad][addr] = val;
+	tpadRegValids[trackpad] |= (1 << addr) & ~TPAD_REG_VOLATILE_MASK;
+}
 
 /**
  * Write to a register on the Pinnacle ASIC (i.e. the Trackpad controller).
@@ -263,44 +250,35 @@ static volatile int tpadAdcIdxs[2]; //!< Tracks how tpadAdcDatas is being
  *
  * \return None.
  */
-static void writeTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val) {
-	Chip_SSP_DATA_SETUP_T xf_setup;
+void writeTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val) {
 	uint8_t tx_data[2];
-	uint8_t rx_data[2];
-
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
-
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, false);
-	}
-
-	// Number of words to transfer
-	xf_setup.length = 2;
-	// Used to count how many words have been transmitted
-	xf_setup.tx_cnt = 0;
-	xf_setup.tx_data = tx_data;
-	// Used to count how many words have been received
-	xf_setup.rx_cnt = 0;
-	xf_setup.rx_data = rx_data;
 
 	// Register write indicated by setting bit 7
 	tx_data[0] = 0x80 | (0x1F & addr);
 	tx_data[1] = val;
 
-	Chip_SSP_RWFrames_Blocking(spiRegs, &xf_setup);
+	tpadSpiXferBlocking(trackpad, tx_data, NULL, sizeof(tx_data));
 
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, true);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
+	noteTpadRegWrite(trackpad, addr, val);
+}
+
+/**
+ * Write to a register on the Pinnacle ASIC, unless register is known to 
+ *  already have value.
+ *
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param addr Register address to write to.
+ * \param val Value to write to register.
+ *
+ * \return None.
+ */
+void setTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val) {
+	if (tpadRegHasVal(trackpad, addr, val)) {
+		tpadRegElided[trackpad]++;
+		return;
 	}
 
-	__enable_irq();
+	writeTpadReg(trackpad, addr, val);
 }
 
 /**
@@ -311,31 +289,10 @@ static void writeTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val) {
  *
  * \return The value read from the register.
  */
-static uint8_t readTpadReg(Trackpad trackpad, uint8_t addr) {
-	Chip_SSP_DATA_SETUP_T xf_setup;
+uint8_t readTpadReg(Trackpad trackpad, uint8_t addr) {
 	uint8_t tx_data[4];
 	uint8_t rx_data[4];
 
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
-
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, false);
-	}
-
-	// Number of words to transfer
-	xf_setup.length = 4;
-	// Used to count how many words have been transmitted
-	xf_setup.tx_cnt = 0;
-	xf_setup.tx_data = tx_data;
-	// Used to count how many words have been received
-	xf_setup.rx_cnt = 0;
-	xf_setup.rx_data = rx_data;
-
 	// Register read indicated by setting bits 7 and 5
 	tx_data[0] = 0xA0 | (0x1F & addr);
 	// Filler bytes
@@ -343,17 +300,101 @@ static uint8_t readTpadReg(Trackpad trackpad, uint8_t addr) {
 	tx_data[2] = 0xFB;
 	tx_data[3] = 0xFB;
 
-	Chip_SSP_RWFrames_Blocking(spiRegs, &xf_setup);
+	tpadSpiXferBlocking(trackpad, tx_data, rx_data, sizeof(tx_data));
+
+	addr &= 0x1F;
+	tpadRegShadows[trackpad][addr] = rx_data[3];
+	tpadRegValids[trackpad] |= (1 << addr) & ~TPAD_REG_VOLATILE_MASK;
+
+	return rx_data[3];
+}
+
+/**
+ * Wait for Trackpad ASIC to finish Extended Register Access (ERA).
+ *
+ * \param trackpad Specifies which trackpad to communicate with. 
+ *
+ * \return 0 on success. -1 on timeout.
+ */
+static int waitTpadEra(Trackpad trackpad) {
+	uint32_t start = getUsTickCnt();
 
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, true);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
+	// Read ERA Control until it contains 0x00
+	while (readTpadReg(trackpad, TPAD_ERA_CTRL_ADDR)) {
+		if (getUsTickCnt() - start > ERA_TIMEOUT_US) {
+			return -1;
+		}
 	}
 
-	__enable_irq();
+	return 0;
+}
 
-	return rx_data[3];
+/**
+ * Set address for next Trackpad ASIC Extended Register Access (ERA).
+ *
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param addr 16-bit extended register address.
+ *
+ * \return None.
+ */
+static void setTpadEraAddr(Trackpad trackpad, uint16_t addr) {
+	// Both address registers written in a single burst
+	const uint8_t tx_data[4] = {
+		0x80 | TPAD_ERA_HIADDR_ADDR, 0xFF & (addr >> 8),
+		0x80 | TPAD_ERA_LOADDR_ADDR, 0xFF & addr
+	};
+
+	tpadSpiXferBlocking(trackpad, tx_data, NULL, sizeof(tx_data));
+
+	noteTpadRegWrite(trackpad, TPAD_ERA_HIADDR_ADDR, tx_data[1]);
+	noteTpadRegWrite(trackpad, TPAD_ERA_LOADDR_ADDR, tx_data[3]);
+}
+
+/**
+ * Trackpad ASIC Extended Register Access (ERA) Write with Address Increment
+ *  starting from address last set with setTpadEraAddr() (or where last 
+ *  write left off).
+ *
+ *  Each byte is written with a single SPI transaction that writes value,
+ *  kicks off auto-increment write and reads back ERA Control. Separate polls
+ *  of ERA Control only happen if write has not already finished by then.
+ *
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param len Number of bytes to be sequentially written.
+ * \param[in] data Pointer to data to be written.
+ *
+ * \return 0 on success. -1 on timeout.
+ */
+static int writeTpadEraBytes(Trackpad trackpad, uint8_t len, 
+	const uint8_t* data) {
+	uint8_t tx_data[8];
+	uint8_t rx_data[8];
+
+	// Write value
+	tx_data[0] = 0x80 | TPAD_ERA_VAL_ADDR;
+	// Write ERA auto-increment write to ERA Control
+	tx_data[2] = 0x80 | TPAD_ERA_CTRL_ADDR;
+	tx_data[3] = 0x0A;
+	// Read back ERA Control
+	tx_data[4] = 0xA0 | TPAD_ERA_CTRL_ADDR;
+	tx_data[5] = 0xFB;
+	tx_data[6] = 0xFB;
+	tx_data[7] = 0xFB;
+
+	for (int idx = 0; idx < len; idx++) {
+		tx_data[1] = data[idx];
+
+		tpadSpiXferBlocking(trackpad, tx_data, rx_data, sizeof(tx_data));
+
+		noteTpadRegWrite(trackpad, TPAD_ERA_VAL_ADDR, tx_data[1]);
+		noteTpadRegWrite(trackpad, TPAD_ERA_CTRL_ADDR, tx_data[3]);
+
+		if (rx_data[7] && waitTpadEra(trackpad)) {
+			return -1;
+		}
+	}
+
+	return 0;
 }
 
 /**
@@ -364,26 +405,45 @@ static uint8_t readTpadReg(Trackpad trackpad, uint8_t addr) {
  * \param len Number of bytes to be sequentially written.
  * \param[in] data Pointer to data to be written.
  *
- * \return None.
+ * \return 0 on success. -1 on timeout.
  */
-static void writeTpadExtRegs(Trackpad trackpad, uint16_t addr, uint8_t len, 
+static int writeTpadExtRegs(Trackpad trackpad, uint16_t addr, uint8_t len, 
 	const uint8_t* data) {
+	setTpadEraAddr(trackpad, addr);
 
-	// Write address 
-	writeTpadReg(trackpad, TPAD_ERA_HIADDR_ADDR, 0xFF & (addr >> 8));
-	writeTpadReg(trackpad, TPAD_ERA_LOADDR_ADDR, 0xFF & addr);
+	return writeTpadEraBytes(trackpad, len, data);
+}
 
-	for (int idx = 0; idx < len; idx++) {
-		// Write value
-		writeTpadReg(trackpad, TPAD_ERA_VAL_ADDR, data[idx]);
+/**
+ * Program table of Extended Register Access (ERA) records. The address is 
+ *  only written when a record does not pick up where auto-increment from the
+ *  previous record left off.
+ *
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param[in] recs Records to program in order.
+ * \param numRecs Number of records in recs.
+ *
+ * \return 0 on success. -1 on timeout.
+ */
+static int writeTpadEraTable(Trackpad trackpad, const TpadEraRec* recs,
+	int numRecs) {
+	uint32_t next_addr = 0xFFFFFFFF;
+
+	for (int idx = 0; idx < numRecs; idx++) {
+		const TpadEraRec* rec = &recs[idx];
 
-		// Write ERA auto-increment write to ERA Control
-		writeTpadReg(trackpad, TPAD_ERA_CTRL_ADDR, 0x0A);
+		if (rec->addr != next_addr) {
+			setTpadEraAddr(trackpad, rec->addr);
+		}
 
-		// Read ERA Control until it contains 0x00
-		while (readTpadReg(trackpad, TPAD_ERA_CTRL_ADDR)){
+		if (writeTpadEraBytes(trackpad, rec->len, rec->data)) {
+			return -1;
 		}
+
+		next_addr = rec->addr + rec->len;
 	}
+
+	return 0;
 }
 
 /**
@@ -398,8 +458,24 @@ static inline void clearTpadFlags(Trackpad trackpad) {
 	writeTpadReg(trackpad, TPAD_STATUS1_ADDR, 0x00);
 }
 
+/**
+ * Read level of DR pin for a Trackpad.
+ * 
+ * \param trackpad Specifies which trackpad to check. 
+ * 
+ * \return True if Trackpad ASIC has data ready.
+ */
+static inline bool getTpadDr(Trackpad trackpad) {
+	if (trackpad == R_TRACKPAD) {
+		return Chip_GPIO_ReadPortBit(LPC_GPIO, GPIO_R_TRACKPAD_DR);
+	}
+	return Chip_GPIO_ReadPortBit(LPC_GPIO, GPIO_L_TRACKPAD_DR);
+}
+
 /**
  * Setup interrupt handling for rising edge of DR event from specified trackpad.
+ *  Priority is above PendSV so work on last frame never delays reading out
+ *  the next one.
  * 
  * \param trackpad Specifies which trackpad to communicate with. 
  * 
@@ -413,29 +489,74 @@ static void setupTpadISR(Trackpad trackpad) {
 		Chip_PININT_EnableIntHigh(LPC_PININT, PININTCH(PINT_R_TRACKPAD));
 		NVIC_ClearPendingIRQ(PIN_INT3_IRQn);
 		NVIC_EnableIRQ(PIN_INT3_IRQn);
-		NVIC_SetPriority(PIN_INT3_IRQn, 3);
+		NVIC_SetPriority(PIN_INT3_IRQn, 2);
 	} else if (trackpad == L_TRACKPAD) {
 		Chip_SYSCTL_SetPinInterrupt(PINT_L_TRACKPAD, GPIO_L_TRACKPAD_DR);
 		Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_L_TRACKPAD));
 		Chip_PININT_EnableIntHigh(LPC_PININT, PININTCH(PINT_L_TRACKPAD));
 		NVIC_ClearPendingIRQ(PIN_INT4_IRQn);
 		NVIC_EnableIRQ(PIN_INT4_IRQn);
-		NVIC_SetPriority(PIN_INT4_IRQn, 3);
+		NVIC_SetPriority(PIN_INT4_IRQn, 2);
+	}
+}
+
+/**
+ * Stop reacting to DR events from specified trackpad.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return None.
+ */
+static void disableTpadISR(Trackpad trackpad) {
+	if (trackpad == R_TRACKPAD) {
+		NVIC_DisableIRQ(PIN_INT3_IRQn);
+		Chip_PININT_DisableIntHigh(LPC_PININT, PININTCH(PINT_R_TRACKPAD));
+		Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_R_TRACKPAD));
+		NVIC_ClearPendingIRQ(PIN_INT3_IRQn);
+	} else if (trackpad == L_TRACKPAD) {
+		NVIC_DisableIRQ(PIN_INT4_IRQn);
+		Chip_PININT_DisableIntHigh(LPC_PININT, PININTCH(PINT_L_TRACKPAD));
+		Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_L_TRACKPAD));
+		NVIC_ClearPendingIRQ(PIN_INT4_IRQn);
 	}
 }
 
+#define ABS_READ_AND_CLR_LEN (11) //!< Number of bytes in SPI transaction to
+	//!< read absolute mode packet and clear flags.
 
-#if (!ANYMEAS_EN)
+/**
+ * SPI transaction to read the latest absolute mode packet and Clear Flags, 
+ *  all in a single burst of SPI data.
+ */
+static const uint8_t ABS_READ_AND_CLR_TX[ABS_READ_AND_CLR_LEN] = {
+	// Auto-incremented read starting at register TPAD_PACKETBTE0_ADDR
+	0xA0 | TPAD_PACKETBTE0_ADDR, // Command Byte
+	0xFC, // Filler Byte
+	0xFC, // Filler Byte
+	0xFC, // PacketByte_0
+	0xFC, // PacketByte_1
+	0xFC, // PacketByte_2
+	0xFC, // PacketByte_3
+	0xFC, // PacketByte_4
+	0xFC, // PacketByte_5
+	// Clear flags
+	0x80 | TPAD_STATUS1_ADDR,
+	0x00
+};
 
+static uint8_t tpadAbsRxDatas[2][ABS_READ_AND_CLR_LEN]; //!< Where ISR driven
+	//!< absolute mode packet reads are received.
+TpadSpiXfer tpadAbsXfers[2]; //!< ISR driven absolute packet reads.
 
 /**
- * Setup Trackpad ASIC (i.e. configure registers, calibration, setup ISR).
+ * Setup Trackpad ASIC for absolute mode (i.e. configure registers, setup 
+ *  ISR).
  * 
  * \param trackpad Specifies which trackpad to communicate with. 
  * 
- * \return None.
+ * \return 0 on success.
  */
-static void setupTpad(Trackpad trackpad) {
+static int setupTpadAbs(Trackpad trackpad) {
 	// Reset the TrackpadASIC:
 	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, TPAD_SYSCFG1_RESET_BIT);
 
@@ -452,12 +573,12 @@ static void setupTpad(Trackpad trackpad) {
 	// Check Firmware ID
 	uint8_t fw_id = readTpadReg(trackpad, TPAD_FW_ID_ADDR);
 	if (fw_id != 0x07)
-		return;
+		return -1;
 
 	// Check Firmware Version
 	uint8_t fw_ver = readTpadReg(trackpad, TPAD_FW_VER_ADDR);
 	if (fw_ver != 0x3a) 
-		return;
+		return -2;
 
 	// Set ASIC to normal mode and active
 	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 0);
@@ -474,88 +595,36 @@ static void setupTpad(Trackpad trackpad) {
 	writeTpadReg(trackpad, TPAD_ZSCALER_ADDR, 16);
 
 	setupTpadISR(trackpad);
+
+	return 0;
 }
 
+#define ADC_READ_AND_CLR_LEN (7) //!< Number of bytes in SPI transaction to
+	//!< read AnyMeas ADC result and clear flags.
+
 /**
- * Get the latest Absolute Packet DAta and Clear Flags, all in a single burst
- *  of SPI data.
- *
- * \param trackpad Specifies which trackpad to communicate with. 
- * \param[out] absData Location of where to store absolute packet data.
- * 
- * \return None.
+ * SPI transaction to read the latest AnyMeas ADC reading and Clear Flags, all
+ *  in a single burst of SPI data.
  */
-void getAbsDataAndClr(Trackpad trackpad, volatile TrackpadAbsData* absData) {
-	Chip_SSP_DATA_SETUP_T xf_setup;
-	uint8_t tx_data[11];
-	uint8_t rx_data[11];
-
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
-
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, false);
-	}
-
-	// Number of words to transfer
-	xf_setup.length = 11;
-	// Used to count how many words have been transmitted
-	xf_setup.tx_cnt = 0;
-	xf_setup.tx_data = tx_data;
-	// Used to count how many words have been received
-	xf_setup.rx_cnt = 0;
-	xf_setup.rx_data = rx_data;
-
+static const uint8_t ADC_READ_AND_CLR_TX[ADC_READ_AND_CLR_LEN] = {
 	// Auto-incremented read starting at register TPAD_MEASRESULT_HI_ADDR
-	tx_data[0] = 0xA0 | TPAD_PACKETBTE0_ADDR; // Command Byte
-	tx_data[1] = 0xFC; // Filler Byte
-	tx_data[2] = 0xFC; // Filler Byte
-	tx_data[3] = 0xFC; // PacketByte_0
-	tx_data[4] = 0xFC; // PacketByte_1
-	tx_data[5] = 0xFC; // PacketByte_2
-	tx_data[6] = 0xFC; // PacketByte_3
-	tx_data[7] = 0xFC; // PacketByte_4
-	tx_data[8] = 0xFC; // PacketByte_5
+	0xA0 | TPAD_MEASRESULT_HI_ADDR,
+	0xFC, // Filler Byte
+	0xFC, // Filler Byte
+	0xFC, // TPAD_MEASRESULT_HI_ADDR
+	0xFB, // TPAD_MEASRESULT_LO_ADDR
 	// Clear flags
-	tx_data[9] = 0x80 | TPAD_STATUS1_ADDR;
-	tx_data[10] = 0x00;
-
-	Chip_SSP_RWFrames_Blocking(spiRegs, &xf_setup);
-
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, true);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
-	}
-
-	__enable_irq();
-
-	absData->xPos = ((0x0F & rx_data[7]) << 8) | rx_data[5];
-	absData->yPos = ((0xF0 & rx_data[7]) << 4) | rx_data[6];
-	absData->zPos = 0x3F & rx_data[8];
-}
-
-/**
- * Get the latest data from the Pinnacle ASIC and update global variables, etc.
- *
- * \param trackpad Specifies which trackpad to communicate with. 
- *
- * \return The ADC value.
- */
-static void getLatestTpadData(Trackpad trackpad) {
-	getAbsDataAndClr(trackpad, tpadAbsDataIdxs[trackpad]);
-
-	tpadAbsDataIdxs[trackpad]++;
-	tpadAbsDataIdxs[trackpad] %= 2;
-}
-
-
-#else  // if (ANYMEAS_EN)
-
+	0x80 | TPAD_STATUS1_ADDR,
+	0x00
+};
+
+static uint8_t tpadAdcRxDatas[2][ADC_READ_AND_CLR_LEN]; //!< Where ISR driven
+	//!< AnyMeas ADC reads are received.
+TpadSpiXfer tpadAdcXfers[2]; //!< ISR driven AnyMeas ADC reads.
+uint8_t tpadMeasStartTxDatas[2][MEAS_START_MAX_LEN]; //!< Register 
+	//!< writes sent by tpadMeasStartXfers.
+TpadSpiXfer tpadMeasStartXfers[2]; //!< ISR driven setup and start of
+	//!< X or Y axis measurements.
 
 /**
  * Get the latest AnyMeas ADC reading and Clear Flags, all in a single burst
@@ -566,53 +635,14 @@ static void getLatestTpadData(Trackpad trackpad) {
  * \return The ADC value.
  */
 static int16_t getTpadAdcAndClr(Trackpad trackpad) {
-	Chip_SSP_DATA_SETUP_T xf_setup;
-	uint8_t tx_data[7];
-	uint8_t rx_data[7];
-
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
+	uint8_t rx_data[ADC_READ_AND_CLR_LEN];
 
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, false);
-	}
-
-	// Number of words to transfer
-	xf_setup.length = 7;
-	// Used to count how many words have been transmitted
-	xf_setup.tx_cnt = 0;
-	xf_setup.tx_data = tx_data;
-	// Used to count how many words have been received
-	xf_setup.rx_cnt = 0;
-	xf_setup.rx_data = rx_data;
-
-	// Auto-incremented read starting at register TPAD_MEASRESULT_HI_ADDR
-	tx_data[0] = 0xA0 | TPAD_MEASRESULT_HI_ADDR;
-	tx_data[1] = 0xFC; // Filler Byte
-	tx_data[2] = 0xFC; // Filler Byte
-	tx_data[3] = 0xFC; // TPAD_MEASRESULT_HI_ADDR
-	tx_data[4] = 0xFB; // TPAD_MEASRESULT_LO_ADDR
-	// Clear flags
-	tx_data[5] = 0x80 | TPAD_STATUS1_ADDR;
-	tx_data[6] = 0x00;
-
-	Chip_SSP_RWFrames_Blocking(spiRegs, &xf_setup);
-
-	if (R_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, true);
-	} else if (L_TRACKPAD == trackpad) {
-		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
-	}
+	tpadSpiXferBlocking(trackpad, ADC_READ_AND_CLR_TX, rx_data, 
+		ADC_READ_AND_CLR_LEN);
 
-	__enable_irq();
+	noteTpadRegWrite(trackpad, TPAD_STATUS1_ADDR, 0x00);
 
-	// Concatenate TPAD_MEASRESULT_HI_ADDR and TPAD_MEASRESULT_HI_ADDR into 
-	//  a single 16-bit word
-	return (rx_data[3] << 8) | rx_data[4];
+	return parseTpadAdc(rx_data);
 }
 
 /**
@@ -634,39 +664,24 @@ static void setTpadAdcCfg(Trackpad trackpad, TpadAdcGain gain,
 	TpadAdcToggleFreq toggleFreq, TpadAdcSampleLen sampleLength, 
 	TpadAdcMuxSel muxSel , uint8_t cfg2, 
 	TpadAdcAperture aperture) {
-	// Shadow registers to reduce unnecessary SPI transactions
-	static uint8_t cfg1_shadow[2] = {0, 0};
-	static uint8_t ctrl_shadow[2] = {0, 0};
-	static uint8_t mux_ctrl_shadow[2] = {0, 0};
-	static uint8_t cfg2_shadow[2] = {0, 0};
-	static uint8_t width_shadow[2] = {0, 0};
-
-	uint8_t cfg1_update = gain | toggleFreq;
-	uint8_t ctrl_update = sampleLength;
-	uint8_t mux_ctrl_update = muxSel;
-	uint8_t cfg2_update = cfg2;
-	uint8_t width_update = aperture;
-	
-	if (cfg1_shadow[trackpad] != cfg1_update) {
-		writeTpadReg(trackpad, TPAD_ADCCFG1_ADDR, cfg1_update);
-		cfg1_shadow[trackpad] = cfg1_update;
-	}
-	if (ctrl_shadow[trackpad] != ctrl_update) {
-		writeTpadReg(trackpad, TPAD_ADCCTRL_ADDR, ctrl_update);
-		ctrl_shadow[trackpad] = ctrl_update;
-	}
-	if (mux_ctrl_shadow[trackpad] != mux_ctrl_update) {
-		writeTpadReg(trackpad, TPAD_ADCMUXCTRL_ADDR, mux_ctrl_update);
-		mux_ctrl_shadow[trackpad] = mux_ctrl_update;
-	}
-	if (cfg2_shadow[trackpad] != cfg2_update) {
-		writeTpadReg(trackpad, TPAD_ADCCFG2_ADDR, cfg2_update);
-		cfg2_shadow[trackpad] = cfg2_update;
-	}
-	if (width_shadow[trackpad] != width_update) {
-		writeTpadReg(trackpad, TPAD_ADCWIDTH_ADDR, width_update);
-		width_shadow[trackpad] = width_update;
-	}
+	setTpadReg(trackpad, TPAD_ADCCFG1_ADDR, gain | toggleFreq);
+	setTpadReg(trackpad, TPAD_ADCCTRL_ADDR, sampleLength);
+	setTpadReg(trackpad, TPAD_ADCMUXCTRL_ADDR, muxSel);
+	setTpadReg(trackpad, TPAD_ADCCFG2_ADDR, cfg2);
+	setTpadReg(trackpad, TPAD_ADCWIDTH_ADDR, aperture);
+}
+
+/**
+ * Apply tuned ADC settings to Trackpad ASIC.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param[in] tune Settings to apply.
+ * 
+ * \return None.
+ */
+void applyTpadAdcTune(Trackpad trackpad, const TpadAdcTune* tune) {
+	setTpadAdcCfg(trackpad, tune->gain, tune->toggleFreq, tune->sampleLen,
+		TPAD_ADC_MUXSEL_SENSEP1GATE, 0, tune->aperture);
 }
 
 /**
@@ -679,33 +694,10 @@ static void setTpadAdcCfg(Trackpad trackpad, TpadAdcGain gain,
  * \return None.
  */
 static void setTpadToggle(Trackpad trackpad, uint32_t toggle) {
-	// Shadow copies of Trackpad ASIC registers to minimize SPI transactions
-	static uint8_t toggle_hihi_shadow[2] = {0, 0};
-	static uint8_t toggle_hilo_shadow[2] = {0, 0};
-	static uint8_t toggle_lohi_shadow[2] = {0, 0};
-	static uint8_t toggle_lolo_shadow[2] = {0, 0};
-
-	uint8_t toggle_hihi = 0xFF & (toggle >> 24);
-	uint8_t toggle_hilo = 0xFF & (toggle >> 16);
-	uint8_t toggle_lohi = 0xFF & (toggle >> 8);
-	uint8_t toggle_lolo = 0xFF & (toggle >> 0);
-
-	if (toggle_hihi_shadow[trackpad] != toggle_hihi) {
-		writeTpadReg(trackpad, TPAD_TOGGLE_HIHI_ADDR, toggle_hihi);
-		toggle_hihi_shadow[trackpad] = toggle_hihi;
-	}	
-	if (toggle_hilo_shadow[trackpad] != toggle_hilo) {
-		writeTpadReg(trackpad, TPAD_TOGGLE_HILO_ADDR, toggle_hilo);
-		toggle_hilo_shadow[trackpad] = toggle_hilo;
-	}	
-	if (toggle_lohi_shadow[trackpad] != toggle_lohi) {
-		writeTpadReg(trackpad, TPAD_TOGGLE_LOHI_ADDR, toggle_lohi);
-		toggle_lohi_shadow[trackpad] = toggle_lohi;
-	}	
-	if (toggle_lolo_shadow[trackpad] != toggle_lolo) {
-		writeTpadReg(trackpad, TPAD_TOGGLE_LOLO_ADDR, toggle_lolo);
-		toggle_lolo_shadow[trackpad] = toggle_lolo;
-	}	
+	setTpadReg(trackpad, TPAD_TOGGLE_HIHI_ADDR, 0xFF & (toggle >> 24));
+	setTpadReg(trackpad, TPAD_TOGGLE_HILO_ADDR, 0xFF & (toggle >> 16));
+	setTpadReg(trackpad, TPAD_TOGGLE_LOHI_ADDR, 0xFF & (toggle >> 8));
+	setTpadReg(trackpad, TPAD_TOGGLE_LOLO_ADDR, 0xFF & (toggle >> 0));
 }
 
 /**
@@ -718,33 +710,10 @@ static void setTpadToggle(Trackpad trackpad, uint32_t toggle) {
  * \return None.
  */
 static void setTpadPolarity(Trackpad trackpad, uint32_t polarity) {
-	// Shadow copies of Trackpad ASIC registers to minimize SPI transactions
-	static uint8_t polarity_hihi_shadow[2] = {0, 0};
-	static uint8_t polarity_hilo_shadow[2] = {0, 0};
-	static uint8_t polarity_lohi_shadow[2] = {0, 0};
-	static uint8_t polarity_lolo_shadow[2] = {0, 0};
-
-	uint8_t polarity_hihi = 0xFF & (polarity >> 24);
-	uint8_t polarity_hilo = 0xFF & (polarity >> 16);
-	uint8_t polarity_lohi = 0xFF & (polarity >> 8);
-	uint8_t polarity_lolo = 0xFF & (polarity >> 0);
-
-	if (polarity_hihi_shadow[trackpad] != polarity_hihi) {
-		writeTpadReg(trackpad, TPAD_POLARITY_HIHI_ADDR, polarity_hihi);
-		polarity_hihi_shadow[trackpad] = polarity_hihi;
-	}	
-	if (polarity_hilo_shadow[trackpad] != polarity_hilo) {
-		writeTpadReg(trackpad, TPAD_POLARITY_HILO_ADDR, polarity_hilo);
-		polarity_hilo_shadow[trackpad] = polarity_hilo;
-	}	
-	if (polarity_lohi_shadow[trackpad] != polarity_lohi) {
-		writeTpadReg(trackpad, TPAD_POLARITY_LOHI_ADDR, polarity_lohi);
-		polarity_lohi_shadow[trackpad] = polarity_lohi;
-	}	
-	if (polarity_lolo_shadow[trackpad] != polarity_lolo) {
-		writeTpadReg(trackpad, TPAD_POLARITY_LOLO_ADDR, polarity_lolo);
-		polarity_lolo_shadow[trackpad] = polarity_lolo;
-	}	
+	setTpadReg(trackpad, TPAD_POLARITY_HIHI_ADDR, 0xFF & (polarity >> 24));
+	setTpadReg(trackpad, TPAD_POLARITY_HILO_ADDR, 0xFF & (polarity >> 16));
+	setTpadReg(trackpad, TPAD_POLARITY_LOHI_ADDR, 0xFF & (polarity >> 8));
+	setTpadReg(trackpad, TPAD_POLARITY_LOLO_ADDR, 0xFF & (polarity >> 0));
 }
 
 /**
@@ -756,21 +725,8 @@ static void setTpadPolarity(Trackpad trackpad, uint32_t polarity) {
  * \return None.
  */
 static void setTpadAdcStartAddr(Trackpad trackpad, uint16_t addr) {
-	// Shadow copies to minimize SPI transactions
-	uint8_t addr_hi_shadow[2] = {0, 0};
-	uint8_t addr_lo_shadow[2] = {0, 0};
-
-	uint8_t addr_hi = 0xFF & (addr >> 8);
-	uint8_t addr_lo = 0xFF & addr;
-
-	if (addr_hi_shadow[trackpad] != addr_hi) {
-		writeTpadReg(trackpad, TPAD_ADC_START_ADDR_HI_ADDR, addr_hi);
-		addr_hi_shadow[trackpad] = addr_hi;
-	}
-	if (addr_lo_shadow[trackpad] != addr_lo) {
-		writeTpadReg(trackpad, TPAD_ADC_START_ADDR_LO_ADDR, addr_lo);
-		addr_lo_shadow[trackpad] = addr_lo;
-	}
+	setTpadReg(trackpad, TPAD_ADC_START_ADDR_HI_ADDR, 0xFF & (addr >> 8));
+	setTpadReg(trackpad, TPAD_ADC_START_ADDR_LO_ADDR, 0xFF & addr);
 }
 
 /**
@@ -782,20 +738,16 @@ static void setTpadAdcStartAddr(Trackpad trackpad, uint16_t addr) {
  * \return None.
  */
 static void setTpadNumMeas(Trackpad trackpad, uint8_t numMeas) {
-	static uint8_t meas_ctrl_shadow[2] = {0, 0};
-
 	// TODO: add flag for enabling low power mode via TPAD_MEASCTRL_POSTMEASPWR_BIT?
 	//  For now always run fast as possible and do not worry about power
-	uint8_t meas_ctrl = (TPAD_MEASCTRL_NUMMEAS_MASK & numMeas);
-
-	if (meas_ctrl_shadow[trackpad] != meas_ctrl) {
-		writeTpadReg(trackpad, TPAD_MEASCTRL_ADDR, meas_ctrl);
-		meas_ctrl_shadow[trackpad] = meas_ctrl;
-	}
+	setTpadReg(trackpad, TPAD_MEASCTRL_ADDR, 
+		TPAD_MEASCTRL_NUMMEAS_MASK & numMeas);
 }
 
 /**
- * Take an ADC Measurement with Trackpad ASIC in AnyMeas mode.
+ * Take an ADC Measurement with Trackpad ASIC in AnyMeas mode. Returns as soon
+ *  as DR pin shows result is ready (up to TPAD_MEAS_TIMEOUT_US). DR 
+ *  interrupt must not be enabled (i.e. ISR would read result first).
  * 
  * \param trackpad Specifies which trackpad to communicate with. 
  * \param toggle Not entirely sure on its purpose. Somehow related to ADC
@@ -819,7 +771,23 @@ static int32_t takeTpadAdcMeas(Trackpad trackpad, uint32_t toggle,
 	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 
 		TPAD_SYSCFG1_ANYMEASEN_BIT | TPAD_SYSCFG1_TRACKDIS_BIT);
 
-	usleep(2 * 1000);
+	TpadMeasStats* stats = &tpadMeasStats[trackpad];
+	uint32_t start = getUsTickCnt();
+	uint32_t meas_us = 0;
+
+	while (!getTpadDr(trackpad)) {
+		meas_us = getUsTickCnt() - start;
+		if (meas_us >= TPAD_MEAS_TIMEOUT_US) {
+			stats->timeouts++;
+			break;
+		}
+	}
+
+	stats->meas++;
+	stats->usSum += meas_us;
+	if (meas_us > stats->usMax) {
+		stats->usMax = meas_us;
+	}
 
 	int16_t retval = getTpadAdcAndClr(trackpad);
 
@@ -827,304 +795,472 @@ static int32_t takeTpadAdcMeas(Trackpad trackpad, uint32_t toggle,
 }
 
 /**
- * Request AnyMeas ADC results start being captured so that X/Y locations can
- *  be calculated. This function starts conversion process (which continues
- *  via ISR) and then returns. See trackpadGetLastXY() for waitinging for
- *  ADC results to be gathered and then converted to X/Y position. 
- *  
- * \param trackpad Specifies which trackpad to communicate with. 
+ * Get copy of latest frame published by ISR. Must not be called from an ISR
+ *  that can preempt SSP0 IRQ (i.e. the frame publisher).
+ * 
+ * \param trackpad Specifies which Trackpad to get frame for. 
+ * \param[out] adcs Where to copy AnyMeas ADC values (NUM_ANYMEAS_ADCS).
+ * \param[out] info Frame details (i.e. when it was captured, mode, 
+ *	compensation values, etc.). May be NULL.
  *
- * \return None.
+ * \return Sequence number of frame. 0 means no frame published yet.
  */
-void trackpadLocUpdate(Trackpad trackpad) {
-	tpadAdcIdxs[trackpad] = 0;
-
-	// Start by requesting measurements for X axis location
-	setTpadAdcStartAddr(trackpad, ANYMEAS_X_ADC_ADDR);
-	setTpadNumMeas(trackpad, NUM_ANYMEAS_X_ADCS);
+uint32_t readTpadFrame(Trackpad trackpad, int16_t* adcs, 
+	TpadFrameInfo* info) {
+	const TpadFrame* frame = &tpadFrames[trackpad];
+	uint32_t seq = 0;
+	TpadFrameInfo frame_info;
+
+	do {
+		seq = frame->seq;
+		for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+			adcs[idx] = frame->adcs[idx];
+			frame_info.comps[idx] = frame->comps[idx];
+		}
+		frame_info.hopSlot = frame->hopSlot;
+		frame_info.timestampUs = frame->timestampUs;
+		frame_info.drUs = frame->drUs;
+		frame_info.mode = frame->mode;
+		frame_info.idle = frame->idle;
+		frame_info.abs.xPos = frame->abs.xPos;
+		frame_info.abs.yPos = frame->abs.yPos;
+		frame_info.abs.zPos = frame->abs.zPos;
+	} while ((seq & 1) || seq != frame->seq);
+
+	if (info) {
+		*info = frame_info;
+	}
 
-	// Start the measurements
-	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 
-		TPAD_SYSCFG1_ANYMEASEN_BIT | TPAD_SYSCFG1_TRACKDIS_BIT);
+	return seq >> 1;
 }
 
 /**
- * Convert the last updated AnyMeas ADC values to X/Y location. If update to
- *  AnyMeas ADC values has been requested (i.e. via trackpadLocUpdate()), this
- *  function will wait until data has been updated.
- * 
- * \param trackpad Specifies which Trackpad to communicate with. 
- * \param[out] xLoc X location. 0-1200. 0 is left side of Trackpad. 1200/2 will
- *	be returned if finger is not down.
- * \param[out] yLoc y location. 0-700. 0 is bottom side of Trackpad. 700/2 will
- *	be returned if finger is not down.
+ * Add a sample to latency histogram for a stage of the Trackpad pipeline. 
+ *  Does nothing unless TPAD_LAT_HIST_EN build option is set.
+ *
+ * \param trackpad Specifies which Trackpad sample is for.
+ * \param stage Pipeline stage sample is for.
+ * \param us Time stage took.
  *
  * \return None.
  */
-void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
-
-	// Set defaults in case finger is not down
-	*xLoc = 1200/2;
-	*yLoc = 700/2;
-
-	// Wait for AnyMeas ADCs related to X position to be updated
-	while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_X_ADCS) {
+void addTpadLat(Trackpad trackpad, TpadLatStage stage, uint32_t us) {
+#if TPAD_LAT_HIST_EN
+	volatile TpadLatHist* hist = &tpadLatHists[trackpad][stage];
+	int bucket = 0;
+
+	while (bucket < NUM_TPAD_LAT_BUCKETS - 1 &&
+		us >= (TPAD_LAT_BUCKET0_US << bucket)) {
+		bucket++;
 	}
 
-	// Calculate xLoc
-	int32_t adc_vals_x[12];
-
-	// This is based on simulation of official firmware. Cannot say I
-	//  understand it...
-	int32_t compensated_val = tpadAdcDatas[trackpad][0] - tpadAdcComps[trackpad][0];
-	adc_vals_x[0] = compensated_val;
-	adc_vals_x[1] = compensated_val;
-	adc_vals_x[2] = -compensated_val;
-	adc_vals_x[3] = compensated_val;
-	adc_vals_x[4] = compensated_val;
-	adc_vals_x[5] = compensated_val;
-	adc_vals_x[6] = -compensated_val;
-	adc_vals_x[7] = -compensated_val;
-	adc_vals_x[8] = -compensated_val;
-	adc_vals_x[9] = compensated_val;
-	adc_vals_x[10] = -compensated_val;
-	adc_vals_x[11] = -compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][1] - tpadAdcComps[trackpad][1];
-	adc_vals_x[0] -= compensated_val;
-	adc_vals_x[1] += compensated_val;
-	adc_vals_x[2] += compensated_val;
-	adc_vals_x[3] -= compensated_val;
-	adc_vals_x[4] += compensated_val;
-	adc_vals_x[5] += compensated_val;
-	adc_vals_x[6] += compensated_val;
-	adc_vals_x[7] -= compensated_val;
-	adc_vals_x[8] -= compensated_val;
-	adc_vals_x[9] -= compensated_val;
-	adc_vals_x[10] += compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][2] - tpadAdcComps[trackpad][2];
-	adc_vals_x[0] += compensated_val;
-	adc_vals_x[1] -= compensated_val;
-	adc_vals_x[2] += compensated_val;
-	adc_vals_x[3] += compensated_val;
-	adc_vals_x[4] -= compensated_val;
-	adc_vals_x[5] += compensated_val;
-	adc_vals_x[6] += compensated_val;
-	adc_vals_x[7] += compensated_val;
-	adc_vals_x[8] -= compensated_val;
-	adc_vals_x[9] -= compensated_val;
-	adc_vals_x[10] -= compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][3] - tpadAdcComps[trackpad][3];
-	adc_vals_x[0] -= compensated_val;
-	adc_vals_x[1] += compensated_val;
-	adc_vals_x[2] -= compensated_val;
-	adc_vals_x[3] += compensated_val;
-	adc_vals_x[4] += compensated_val;
-	adc_vals_x[5] -= compensated_val;
-	adc_vals_x[6] += compensated_val;
-	adc_vals_x[7] += compensated_val;
-	adc_vals_x[8] += compensated_val;
-	adc_vals_x[9] -= compensated_val;
-	adc_vals_x[10] -= compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][4] - tpadAdcComps[trackpad][4];
-	adc_vals_x[0] -= compensated_val;
-	adc_vals_x[1] -= compensated_val;
-	adc_vals_x[2] += compensated_val;
-	adc_vals_x[3] -= compensated_val;
-	adc_vals_x[4] += compensated_val;
-	adc_vals_x[5] += compensated_val;
-	adc_vals_x[6] -= compensated_val;
-	adc_vals_x[7] += compensated_val;
-	adc_vals_x[8] += compensated_val;
-	adc_vals_x[9] += compensated_val;
-	adc_vals_x[10] -= compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][5] - tpadAdcComps[trackpad][5];
-	adc_vals_x[0] -= compensated_val;
-	adc_vals_x[1] -= compensated_val;
-	adc_vals_x[2] -= compensated_val;
-	adc_vals_x[3] += compensated_val;
-	adc_vals_x[4] -= compensated_val;
-	adc_vals_x[5] += compensated_val;
-	adc_vals_x[6] += compensated_val;
-	adc_vals_x[7] -= compensated_val;
-	adc_vals_x[8] += compensated_val;
-	adc_vals_x[9] += compensated_val;
-	adc_vals_x[10] += compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][6] - tpadAdcComps[trackpad][6];
-	adc_vals_x[0] += compensated_val;
-	adc_vals_x[1] -= compensated_val;
-	adc_vals_x[2] -= compensated_val;
-	adc_vals_x[3] -= compensated_val;
-	adc_vals_x[4] += compensated_val;
-	adc_vals_x[5] -= compensated_val;
-	adc_vals_x[6] += compensated_val;
-	adc_vals_x[7] += compensated_val;
-	adc_vals_x[8] -= compensated_val;
-	adc_vals_x[9] += compensated_val;
-	adc_vals_x[10] += compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][7] - tpadAdcComps[trackpad][7];
-	adc_vals_x[0] += compensated_val;
-	adc_vals_x[1] += compensated_val;
-	adc_vals_x[2] -= compensated_val;
-	adc_vals_x[3] -= compensated_val;
-	adc_vals_x[4] -= compensated_val;
-	adc_vals_x[5] += compensated_val;
-	adc_vals_x[6] -= compensated_val;
-	adc_vals_x[7] += compensated_val;
-	adc_vals_x[8] += compensated_val;
-	adc_vals_x[9] -= compensated_val;
-	adc_vals_x[10] += compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][8] - tpadAdcComps[trackpad][8];
-	adc_vals_x[0] += compensated_val;
-	adc_vals_x[1] += compensated_val;
-	adc_vals_x[2] += compensated_val;
-	adc_vals_x[3] -= compensated_val;
-	adc_vals_x[4] -= compensated_val;
-	adc_vals_x[5] -= compensated_val;
-	adc_vals_x[6] += compensated_val;
-	adc_vals_x[7] -= compensated_val;
-	adc_vals_x[8] += compensated_val;
-	adc_vals_x[9] += compensated_val;
-	adc_vals_x[10] -= compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][9] - tpadAdcComps[trackpad][9];
-	adc_vals_x[0] -= compensated_val;
-	adc_vals_x[1] += compensated_val;
-	adc_vals_x[2] += compensated_val;
-	adc_vals_x[3] += compensated_val;
-	adc_vals_x[4] -= compensated_val;
-	adc_vals_x[5] -= compensated_val;
-	adc_vals_x[6] -= compensated_val;
-	adc_vals_x[7] += compensated_val;
-	adc_vals_x[8] -= compensated_val;
-	adc_vals_x[9] += compensated_val;
-	adc_vals_x[10] += compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][10] - tpadAdcComps[trackpad][10];
-	adc_vals_x[0] += compensated_val;
-	adc_vals_x[1] -= compensated_val;
-	adc_vals_x[2] += compensated_val;
-	adc_vals_x[3] += compensated_val;
-	adc_vals_x[4] += compensated_val;
-	adc_vals_x[5] -= compensated_val;
-	adc_vals_x[6] -= compensated_val;
-	adc_vals_x[7] -= compensated_val;
-	adc_vals_x[8] += compensated_val;
-	adc_vals_x[9] -= compensated_val;
-	adc_vals_x[10] += compensated_val;
-	adc_vals_x[11] -= compensated_val;
-
-	for (int idx = 0; idx < 12; idx++) {
-		if (adc_vals_x[idx] < 0)
-			adc_vals_x[idx] = 0;
+	hist->counts[bucket]++;
+	hist->usSum += us;
+	if (us > hist->usMax) {
+		hist->usMax = us;
 	}
+#endif
+}
 
-	// At this point the difference in ajacent samples of adc_vals_x 
-	//  shows has one period of a sine wave for each detected finger
-	//  (but maybe can only distinguish between two fingers). All other
-	//  differences are 0. For now if we see anything other than a 
-	//  single finger down, we treat it as though no fingers are down
-	// TODO: revisit this and look into better way of checking for finger
-	//  down and how we could make detect multi-touch??
-
-	/*
-	// Debug print to illustrate how difference in adjacent samples
-	//  can show where finger(s) are on trackpad
-	printf("%4d\n", adc_vals_x[0]);
-	for (int idx = 0; idx < 11; idx++) {
-		printf("%4d\n", adc_vals_x[idx+1] - adc_vals_x[idx]);
+/**
+ * Publish latest frame for a Trackpad (i.e. tpadAdcDatas in AnyMeas mode, or
+ *  absolute mode packet). Only to be called from SSP0 IRQ context.
+ * 
+ * \param trackpad Specifies which Trackpad frame is from. 
+ * \param idle True if only presence probe was run (and saw no touch). ADC
+ *	values of last full frame are left in place.
+ * \param[in] absData Absolute mode packet. NULL for AnyMeas frames.
+ *
+ * \return None.
+ */
+void publishTpadFrame(Trackpad trackpad, bool idle, 
+	const TrackpadAbsData* absData) {
+	TpadFrame* frame = &tpadFrames[trackpad];
+	TrackpadMode mode = absData ? TPAD_MODE_ABS : TPAD_MODE_ANYMEAS;
+	uint32_t now = getUsTickCnt();
+
+	frame->seq++;
+	if (absData) {
+		frame->abs.xPos = absData->xPos;
+		frame->abs.yPos = absData->yPos;
+		frame->abs.zPos = absData->zPos;
+	} else if (!idle) {
+		for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+			frame->adcs[idx] = tpadAdcDatas[trackpad][idx];
+			frame->comps[idx] = tpadAdcComps[trackpad][idx];
+		}
+		frame->hopSlot = tpadHopSlots[trackpad];
 	}
-	printf("\n");
-	*/
-
-	// This has to do with searching across adjacent adc_vals_* in
-	//  search of sine wave(s) representing down fingers
-	enum TransitionState {
-		WAIT_FOR_0_TO_P, // Searching for start of sine wave 
-			// representing down finger
-		WAIT_FOR_P_TO_N, // Searching for zero crossing in sine wave
-			// representing donw finger
-		WAIT_FOR_N_TO_0, // Searching for end of sine wave 
-			// representing down finger
-		WAIT_FOR_END, // Waiting for end of data (i.e. expecting nothing
-			// but 0's from this point out).
-		POS_INVALID // Something went "wrong" (i.e. no finger down or
-			// multiple down). 
-	};
+	frame->mode = mode;
+	frame->idle = idle;
+	frame->drUs = tpadDrUs[trackpad];
+	frame->timestampUs = now;
+	frame->seq++;
+
+	volatile TpadModeStats* stats = &tpadModeStats[trackpad][mode];
+	uint32_t capture_us = now - tpadFrameStartUs[trackpad];
+	stats->frames++;
+	stats->captureUsSum += capture_us;
+	if (capture_us > stats->captureUsMax) {
+		stats->captureUsMax = capture_us;
+	}
+	addTpadLat(trackpad, TPAD_LAT_CAPTURE, capture_us);
+}
+
+/**
+ * Convert absolute mode packet to fixed point location.
+ * 
+ * \param val Position from packet.
+ * \param min Smallest position Trackpad ASIC reports.
+ * \param max Largest position Trackpad ASIC reports.
+ * \param range Range of output location.
+ *
+ * \return Location (TPAD_POS_FRAC_BITS fixed point, 0 to range).
+ */
+static inline int32_t tpadAbsToPos(int32_t val, int32_t min, int32_t max,
+	int32_t range) {
+	if (val < min) {
+		val = min;
+	} else if (val > max) {
+		val = max;
+	}
+
+	return (val - min) * (range << TPAD_POS_FRAC_BITS) / (max - min);
+}
 
-	enum TransitionState transition_state = WAIT_FOR_0_TO_P;
+/**
+ * Convert a frame (AnyMeas ADC values or absolute packet) to fixed point X/Y
+ *  location.
+ * 
+ * \param[in] adcs AnyMeas ADC values.
+ * \param[in] info Frame details (including compensation values adcs are
+ *	decoded against).
+ * \param[out] xPos X location (TPAD_POS_FRAC_BITS fixed point). Center if 
+ *	finger is not down.
+ * \param[out] yPos Y location (TPAD_POS_FRAC_BITS fixed point). Center if 
+ *	finger is not down.
+ *
+ * \return True if finger is down.
+ */
+static bool tpadFrameToPos(const int16_t* adcs, const TpadFrameInfo* info,
+	int32_t* xPos, int32_t* yPos) {
+	// Set defaults in case finger is not down
+	*xPos = (TPAD_MAX_X/2) << TPAD_POS_FRAC_BITS;
+	*yPos = (TPAD_MAX_Y/2) << TPAD_POS_FRAC_BITS;
 
-	// Checking for finger down based on logic detailed above
-	if (adc_vals_x[0] > 0) {
-		transition_state = WAIT_FOR_P_TO_N;
-	} else if (adc_vals_x[0] < 0) {
-		transition_state = POS_INVALID;
+	if (info->mode == TPAD_MODE_ABS) {
+		if (!info->abs.zPos || !info->abs.xPos) {
+			return false;
+		}
+		// TODO: confirm orientation matches AnyMeas decode (i.e. Y 0 is
+		//  bottom) on real hardware, then turn on TPAD_ABS_MODE_EN
+		*xPos = tpadAbsToPos(info->abs.xPos, TPAD_ABS_MIN_X, 
+			TPAD_ABS_MAX_X, TPAD_MAX_X);
+		*yPos = tpadAbsToPos(info->abs.yPos, TPAD_ABS_MIN_Y, 
+			TPAD_ABS_MAX_Y, TPAD_MAX_Y);
+		return true;
 	}
 
-	for (int idx = 0; idx < 11; idx++) {
-		int32_t diff = adc_vals_x[idx+1] - adc_vals_x[idx];
-		if (transition_state == WAIT_FOR_0_TO_P) {
-			if (diff > 0) {
-				transition_state = WAIT_FOR_P_TO_N;
-			} else if (diff < 0) {
-				transition_state = POS_INVALID;
-			}
-		} else if (transition_state == WAIT_FOR_P_TO_N) {
-			if (diff < 0) {
-				transition_state = WAIT_FOR_N_TO_0;
-			} else if (diff == 0) {
-				transition_state = POS_INVALID;
-			}
-		} else if (transition_state == WAIT_FOR_N_TO_0) {
-			if (diff == 0) {
-				transition_state = WAIT_FOR_END;
-			} else if (diff > 0) {
-				transition_state = POS_INVALID;
-			}
-		} else if (transition_state == WAIT_FOR_END) {
-			// Should only get 0 differences if waiting for end
-			if (diff != 0) {
-				transition_state = POS_INVALID;
+	if (info->idle) {
+		return false;
+	}
+
+	return tpadDecodePos(adcs, info->comps, xPos, yPos);
+}
+
+/**
+ * Round fixed point position to integer location.
+ * 
+ * \param pos Position with TPAD_POS_FRAC_BITS fractional bits.
+ *
+ * \return Integer location.
+ */
+static inline uint16_t tpadPosToLoc(int32_t pos) {
+	return (pos + (1 << (TPAD_POS_FRAC_BITS - 1))) >> TPAD_POS_FRAC_BITS;
+}
+
+/**
+ * Decode and filter latest frame for a Trackpad if it has not been already.
+ *  Safe to be called from both thread and ISR context: work is done on local
+ *  copies, which are only stored (with IRQs disabled) if no newer frame has
+ *  been stored in the meantime.
+ * 
+ * \param trackpad Specifies which Trackpad to update position for. 
+ *
+ * \return None.
+ */
+static void updateTpadPos(Trackpad trackpad) {
+	TpadPosState* state = &tpadPosStates[trackpad];
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	TpadFrameInfo info;
+
+	// Cheap check so decode is skipped when nothing is new
+	if (trackpadGetFrameSeq(trackpad) == state->seq) {
+		return;
+	}
+
+	__disable_irq();
+	uint32_t last_seq = state->seq;
+	uint32_t last_timestamp = state->pos.timestampUs;
+	TpadFilt filts[2] = {state->filts[0], state->filts[1]};
+	TpadGesture gesture = state->gesture;
+	__enable_irq();
+
+	uint32_t start = getCycleCnt();
+	uint32_t start_us = getUsTickCnt();
+	uint32_t seq = readTpadFrame(trackpad, adcs, &info);
+	if (!seq || seq == last_seq) {
+		return;
+	}
+
+	TrackpadPos pos;
+	pos.timestampUs = info.timestampUs;
+	pos.touch = tpadFrameToPos(adcs, &info, &pos.xRaw, &pos.yRaw);
+
+	int32_t x = pos.xRaw;
+	int32_t y = pos.yRaw;
+	if (pos.touch && tpadCorrEn) {
+		tpadCorrApply(&tpadCorrGrids[trackpad], &x, &y);
+	}
+
+	if (pos.touch && tpadFiltEn) {
+		uint32_t dt_us = info.timestampUs - last_timestamp;
+		pos.x = tpadFilt(&filts[0], &tpadFiltParams, x, dt_us);
+		pos.y = tpadFilt(&filts[1], &tpadFiltParams, y, dt_us);
+	} else {
+		tpadFiltReset(&filts[0]);
+		tpadFiltReset(&filts[1]);
+		pos.x = x;
+		pos.y = y;
+	}
+
+	TpadGestureOut gesture_out;
+	uint32_t gesture_start = getCycleCnt();
+	if (tpadGestureEn) {
+		tpadGestureUpdate(&gesture, &tpadGestureParams, pos.touch, pos.x,
+			pos.y, info.timestampUs, &gesture_out);
+	} else {
+		tpadGestureReset(&gesture);
+		memset(&gesture_out, 0, sizeof(gesture_out));
+	}
+	uint32_t gesture_cycles = cyclesSince(gesture_start);
+
+	uint32_t cycles = cyclesSince(start);
+	uint32_t end_us = getUsTickCnt();
+	uint32_t latency_us = end_us - info.drUs;
+
+	__disable_irq();
+	volatile TpadModeStats* stats = &tpadModeStats[trackpad][info.mode];
+	stats->decodeCycles += cycles;
+	if ((int32_t)(seq - state->seq) > 0) {
+		state->seq = seq;
+		state->drUs = info.drUs;
+		state->consumed = false;
+		state->pos = pos;
+		state->filts[0] = filts[0];
+		state->filts[1] = filts[1];
+		state->gesture = gesture;
+
+		TrackpadGesture* pend = &tpadGesturePends[trackpad];
+		pend->events |= gesture_out.events;
+		pend->dx += gesture_out.dx;
+		pend->dy += gesture_out.dy;
+		pend->scrollSteps += gesture_out.steps;
+
+		if (tpadGestureEn) {
+			volatile TpadGestureStats* gesture_stats = 
+				&tpadGestureStats[trackpad];
+			gesture_stats->frames++;
+			gesture_stats->cyclesSum += gesture_cycles;
+			if (gesture_cycles > gesture_stats->cyclesMax) {
+				gesture_stats->cyclesMax = gesture_cycles;
 			}
-		} else {
-			break;
 		}
+
+		// Only first position worked out from frame counts as latency
+		stats->latencies++;
+		stats->latencyUsSum += latency_us;
+		if (latency_us > stats->latencyUsMax) {
+			stats->latencyUsMax = latency_us;
+		}
+		addTpadLat(trackpad, TPAD_LAT_DECODE_WAIT, 
+			start_us - info.timestampUs);
+		addTpadLat(trackpad, TPAD_LAT_DECODE, end_us - start_us);
+	}
+	__enable_irq();
+}
+
+/**
+ * Hand position from frame that was just published to tpadPosCallback (if 
+ *  set). Only to be called from PendSV context.
+ * 
+ * \param trackpad Specifies which Trackpad frame is from. 
+ *
+ * \return None.
+ */
+void notifyTpadPos(Trackpad trackpad) {
+	TpadPosState* state = &tpadPosStates[trackpad];
+	TrackpadPosCallback callback = tpadPosCallback;
+
+	if (!callback) {
+		return;
 	}
 
-	int32_t x_pos = -1;
+	updateTpadPos(trackpad);
+
+	__disable_irq();
+	TrackpadPos pos = state->pos;
+	uint32_t dr_us = state->drUs;
+	__enable_irq();
+
+	callback(trackpad, &pos, dr_us);
+}
+
+/**
+ * Find contacts in latest frame for a Trackpad if it has not been done 
+ *  already. Same approach as updateTpadPos() is used to make this safe to
+ *  call from both thread and ISR context.
+ * 
+ * \param trackpad Specifies which Trackpad to update contacts for. 
+ *
+ * \return None.
+ */
+static void updateTpadContacts(Trackpad trackpad) {
+	TpadContactsState* state = &tpadContactsStates[trackpad];
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	TpadFrameInfo info;
+
+	// Cheap check so decode is skipped when nothing is new
+	if (trackpadGetFrameSeq(trackpad) == state->seq) {
+		return;
+	}
 
-	if (transition_state == WAIT_FOR_N_TO_0 || transition_state == WAIT_FOR_END) {
-		int32_t dividend = 0;
-		int32_t divisor = 0;
-		int32_t factor = 0;
-		for (int idx = 0; idx < 12; idx++) {
-			dividend += factor * adc_vals_x[idx];
-			divisor += adc_vals_x[idx];
-			factor += 100;
+	__disable_irq();
+	uint32_t last_seq = state->seq;
+	TpadContactTracker tracker = state->tracker;
+	__enable_irq();
+
+	uint32_t start = getCycleCnt();
+	uint32_t seq = readTpadFrame(trackpad, adcs, &info);
+	if (!seq || seq == last_seq) {
+		return;
+	}
+
+	TrackpadContacts contacts;
+	contacts.timestampUs = info.timestampUs;
+	if (info.mode == TPAD_MODE_ABS) {
+		// Trackpad ASIC only reports a single finger
+		TrackpadContact* contact = &contacts.contacts[0];
+		contacts.num = tpadFrameToPos(adcs, &info, &contact->x,
+			&contact->y) ? 1 : 0;
+		contact->strength = info.abs.zPos;
+		if (contacts.num && tracker.num) {
+			contact->id = tracker.contacts[0].id;
+		} else if (contacts.num) {
+			// New finger (ID must never be 0)
+			if (!tracker.nextId) {
+				tracker.nextId++;
+			}
+			contact->id = tracker.nextId++;
 		}
+		tracker.num = contacts.num;
+		tracker.contacts[0] = *contact;
+	} else if (info.idle) {
+		contacts.num = 0;
+		tracker.num = 0;
+	} else {
+		contacts.num = tpadDecodeContacts(adcs, info.comps, &tracker,
+			contacts.contacts);
+	}
+
+	// Tracker keeps uncorrected locations, as that is what it matches
+	for (int idx = 0; tpadCorrEn && idx < contacts.num; idx++) {
+		tpadCorrApply(&tpadCorrGrids[trackpad], 
+			&contacts.contacts[idx].x, &contacts.contacts[idx].y);
+	}
+
+	uint32_t cycles = cyclesSince(start);
+
+	__disable_irq();
+	tpadModeStats[trackpad][info.mode].decodeCycles += cycles;
+	if ((int32_t)(seq - state->seq) > 0) {
+		state->seq = seq;
+		state->contacts = contacts;
+		state->tracker = tracker;
+	}
+	__enable_irq();
+}
+
+/**
+ * Request AnyMeas ADC results start being captured so that X/Y locations can
+ *  be calculated. This function starts conversion process (which continues
+ *  via ISR) and then returns. See trackpadGetLastXY() for waitinging for
+ *  ADC results to be gathered and then converted to X/Y position. 
+ *  Does nothing if scan scheduler is running (see trackpadSchedStart()).
+ *  
+ * \param trackpad Specifies which trackpad to communicate with. 
+ *
+ * \return None.
+ */
+void trackpadLocUpdate(Trackpad trackpad) {
+	// Scan scheduler is already taking care of this, or Trackpad ASIC 
+	//  sends positions on its own in absolute mode
+	if (tpadSchedEn || tpadModes[trackpad] != TPAD_MODE_ANYMEAS) {
+		return;
+	}
+
+	tpadAdcIdxs[trackpad] = 0;
+	tpadProbings[trackpad] = false;
+	tpadFrameStartUs[trackpad] = getUsTickCnt();
+
+	// Start by requesting measurements for X axis location
+	setTpadAdcStartAddr(trackpad, ANYMEAS_X_ADC_ADDR);
+	setTpadNumMeas(trackpad, NUM_ANYMEAS_X_ADCS);
+
+	// Start the measurements
+	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 
+		TPAD_SYSCFG1_ANYMEASEN_BIT | TPAD_SYSCFG1_TRACKDIS_BIT);
+}
+
+/**
+ * Convert the last updated AnyMeas ADC values to X/Y location. If update to
+ *  AnyMeas ADC values has been requested (i.e. via trackpadLocUpdate()), this
+ *  function will wait until data has been updated. If scan scheduler is 
+ *  running the last complete frame is used without waiting.
+ * 
+ * \param trackpad Specifies which Trackpad to communicate with. 
+ * \param[out] xLoc X location. 0-1200. 0 is left side of Trackpad. 1200/2 will
+ *	be returned if finger is not down.
+ * \param[out] yLoc y location. 0-700. 0 is bottom side of Trackpad. 700/2 will
+ *	be returned if finger is not down.
+ *
+ * \return None.
+ */
+void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
+	int32_t bins[NUM_TPAD_MAX_BINS];
 
-		if (divisor) {
-			x_pos = dividend / divisor;	
-			x_pos = 1200 - x_pos;
+	// Set defaults in case finger is not down
+	*xLoc = 1200/2;
+	*yLoc = 700/2;
+
+	if (tpadSchedEn || tpadModes[trackpad] != TPAD_MODE_ANYMEAS) {
+		uint32_t seq = 0;
+		TrackpadPos pos;
+
+		if (trackpadGetFramePos(trackpad, &seq, &pos)) {
+			*xLoc = tpadPosToLoc(pos.x);
+			*yLoc = tpadPosToLoc(pos.y);
 		}
+		return;
 	}
 
+	// Wait for AnyMeas ADCs related to X position to be updated
+	while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_X_ADCS) {
+	}
+
+	int32_t x_pos = tpadDecodeAxis(TPAD_AXIS_X, tpadAdcDatas[trackpad],
+		tpadAdcComps[trackpad], bins);
+
 	// Wait for AnyMeas ADCs related to Y position to be updated
 	while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_ADCS) {
 	}
@@ -1134,166 +1270,248 @@ void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
 		return;
 	}
 
-	// Calculate yLoc
-	int32_t adc_vals_y[8];
-
-	compensated_val = tpadAdcDatas[trackpad][11] - tpadAdcComps[trackpad][11];
-	adc_vals_y[0] = -compensated_val;
-	adc_vals_y[1] = compensated_val;
-	adc_vals_y[2] = -compensated_val;
-	adc_vals_y[3] = compensated_val;
-	adc_vals_y[4] = -compensated_val;
-	adc_vals_y[5] = compensated_val;
-	adc_vals_y[6] = -compensated_val;
-	adc_vals_y[7] = compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][12] - tpadAdcComps[trackpad][12];
-	adc_vals_y[0] -= compensated_val;
-	adc_vals_y[1] -= compensated_val;
-	adc_vals_y[2] += compensated_val;
-	adc_vals_y[3] += compensated_val;
-	adc_vals_y[4] -= compensated_val;
-	adc_vals_y[5] -= compensated_val;
-	adc_vals_y[6] += compensated_val;
-	adc_vals_y[7] += compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][13] - tpadAdcComps[trackpad][13];
-	adc_vals_y[0] += compensated_val;
-	adc_vals_y[1] -= compensated_val;
-	adc_vals_y[2] -= compensated_val;
-	adc_vals_y[3] += compensated_val;
-	adc_vals_y[4] += compensated_val;
-	adc_vals_y[5] -= compensated_val;
-	adc_vals_y[6] -= compensated_val;
-	adc_vals_y[7] += compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][14] - tpadAdcComps[trackpad][14];
-	adc_vals_y[0] -= compensated_val;
-	adc_vals_y[1] -= compensated_val;
-	adc_vals_y[2] -= compensated_val;
-	adc_vals_y[3] -= compensated_val;
-	adc_vals_y[4] += compensated_val;
-	adc_vals_y[5] += compensated_val;
-	adc_vals_y[6] += compensated_val;
-	adc_vals_y[7] += compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][15] - tpadAdcComps[trackpad][15];
-	adc_vals_y[0] += compensated_val;
-	adc_vals_y[1] -= compensated_val;
-	adc_vals_y[2] += compensated_val;
-	adc_vals_y[3] -= compensated_val;
-	adc_vals_y[4] -= compensated_val;
-	adc_vals_y[5] += compensated_val;
-	adc_vals_y[6] -= compensated_val;
-	adc_vals_y[7] += compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][16] - tpadAdcComps[trackpad][16];
-	adc_vals_y[0] += compensated_val;
-	adc_vals_y[1] += compensated_val;
-	adc_vals_y[2] -= compensated_val;
-	adc_vals_y[3] -= compensated_val;
-	adc_vals_y[4] -= compensated_val;
-	adc_vals_y[5] -= compensated_val;
-	adc_vals_y[6] += compensated_val;
-	adc_vals_y[7] += compensated_val;
-
-	compensated_val = tpadAdcDatas[trackpad][17] - tpadAdcComps[trackpad][17];
-	adc_vals_y[0] -= compensated_val;
-	adc_vals_y[1] += compensated_val;
-	adc_vals_y[2] += compensated_val;
-	adc_vals_y[3] -= compensated_val;
-	adc_vals_y[4] += compensated_val;
-	adc_vals_y[5] -= compensated_val;
-	adc_vals_y[6] -= compensated_val;
-	adc_vals_y[7] += compensated_val;
-
-	for (int idx = 0; idx < 8; idx++) {
-		if (adc_vals_y[idx] < 0)
-			adc_vals_y[idx] = 0;
-		adc_vals_y[idx] = 1250 * adc_vals_y[idx] / 1000;
+	int32_t y_pos = tpadDecodeAxis(TPAD_AXIS_Y, tpadAdcDatas[trackpad],
+		tpadAdcComps[trackpad], bins);
+
+	// Update outputs if finger was down (i.e. x_pos and y_pos are both valid)
+	if (x_pos > 0 && y_pos > 0)  {
+		x_pos <<= TPAD_POS_FRAC_BITS;
+		y_pos <<= TPAD_POS_FRAC_BITS;
+		if (tpadCorrEn) {
+			tpadCorrApply(&tpadCorrGrids[trackpad], &x_pos, &y_pos);
+		}
+		*xLoc = tpadPosToLoc(x_pos);
+		*yLoc = tpadPosToLoc(y_pos);
+	}
+}
+
+/**
+ * Get sequence number of latest frame captured from a Trackpad. 
+ * 
+ * \param trackpad Specifies which Trackpad to check. 
+ *
+ * \return Sequence number (i.e. count of frames captured). Can be compared
+ *	against a previous return value to see if newer frame has arrived.
+ */
+uint32_t trackpadGetFrameSeq(Trackpad trackpad) {
+	return tpadFrames[trackpad].seq >> 1;
+}
+
+/**
+ * Get position from latest frame captured from Trackpad, but only if it is
+ *  newer than the last frame caller has seen. Never waits on Trackpad. Each
+ *  frame is only decoded and filtered once, no matter how many callers.
+ * 
+ * \param trackpad Specifies which Trackpad to get position for. 
+ * \param[inout] seq Sequence number of last frame caller has seen. Updated
+ *	to sequence number of frame being returned. 
+ * \param[out] pos Raw and filtered position. Only updated if newer frame
+ *	available.
+ *
+ * \return True if newer frame was available and pos was updated.
+ */
+bool trackpadGetFramePos(Trackpad trackpad, uint32_t* seq, 
+	TrackpadPos* pos) {
+	TpadPosState* state = &tpadPosStates[trackpad];
+
+	updateTpadPos(trackpad);
+
+	__disable_irq();
+	uint32_t new_seq = state->seq;
+	if (new_seq && new_seq != *seq) {
+		*pos = state->pos;
+		// Only first caller to get position counts as end to end latency
+		if (!state->consumed) {
+			state->consumed = true;
+			addTpadLat(trackpad, TPAD_LAT_TOTAL, 
+				getUsTickCnt() - state->drUs);
+		}
 	}
+	__enable_irq();
 
-	/*
-	// Debug print to illustrate how difference in adjacent samples
-	//  can show where finger(s) are on trackpad
-	printf("%4d\n", adc_vals_y[0]);
-	for (int idx = 0; idx < 7; idx++) {
-		printf("%4d\n", adc_vals_y[idx+1] - adc_vals_y[idx]);
+	if (!new_seq || new_seq == *seq) {
+		return false;
 	}
-	printf("\n");
-	*/
 
-	transition_state = WAIT_FOR_0_TO_P;
+	*seq = new_seq;
+
+	return true;
+}
+
+/**
+ * Set function to be called (from PendSV context) with position from each
+ *  new frame. Position is decoded as soon as SSP0 IRQ publishes the frame
+ *  while this is set.
+ * 
+ * \param callback Function to call. NULL to stop calling anything.
+ *
+ * \return None.
+ */
+void trackpadSetPosCallback(TrackpadPosCallback callback) {
+	tpadPosCallback = callback;
+}
+
+/**
+ * Get gesture events and motion (finger or inertia) for a Trackpad 
+ *  accumulated since last call, along with current velocity. Accumulated 
+ *  values are cleared, so there should only be one caller per Trackpad 
+ *  (i.e. a report builder). Never waits on Trackpad.
+ * 
+ * \param trackpad Specifies which Trackpad to get gestures for. 
+ * \param[out] gesture Gesture output.
+ *
+ * \return None.
+ */
+void trackpadGetGesture(Trackpad trackpad, TrackpadGesture* gesture) {
+	TpadPosState* state = &tpadPosStates[trackpad];
+	TrackpadGesture* pend = &tpadGesturePends[trackpad];
 
-	// Checking for finger down based on logic detailed above
-	if (adc_vals_y[0] > 0) {
-		transition_state = WAIT_FOR_P_TO_N;
-	} else if (adc_vals_y[0] < 0) {
-		transition_state = POS_INVALID;
+	updateTpadPos(trackpad);
+
+	__disable_irq();
+	*gesture = *pend;
+	gesture->vx = state->gesture.vx;
+	gesture->vy = state->gesture.vy;
+	gesture->coasting = state->gesture.coasting;
+	gesture->circling = state->gesture.circle == TPAD_CIRCLE_ACTIVE;
+	memset(pend, 0, sizeof(*pend));
+	__enable_irq();
+}
+
+/**
+ * Get all contacts (i.e. up to TPAD_MAX_CONTACTS fingers) from latest frame
+ *  captured from Trackpad, but only if it is newer than the last frame caller
+ *  has seen. Never waits on Trackpad. Contacts are not filtered.
+ * 
+ * \param trackpad Specifies which Trackpad to get contacts for. 
+ * \param[inout] seq Sequence number of last frame caller has seen. Updated
+ *	to sequence number of frame being returned. 
+ * \param[out] contacts Fingers found. Only updated if newer frame 
+ *	available.
+ *
+ * \return True if newer frame was available and contacts was updated.
+ */
+bool trackpadGetFrameContacts(Trackpad trackpad, uint32_t* seq, 
+	TrackpadContacts* contacts) {
+	const TpadContactsState* state = &tpadContactsStates[trackpad];
+
+	updateTpadContacts(trackpad);
+
+	__disable_irq();
+	uint32_t new_seq = state->seq;
+	if (new_seq && new_seq != *seq) {
+		*contacts = state->contacts;
 	}
+	__enable_irq();
 
-	for (int idx = 0; idx < 7; idx++) {
-		int32_t diff = adc_vals_y[idx+1] - adc_vals_y[idx];
-		if (transition_state == WAIT_FOR_0_TO_P) {
-			if (diff > 0) {
-				transition_state = WAIT_FOR_P_TO_N;
-			} else if (diff < 0) {
-				transition_state = POS_INVALID;
-			}
-		} else if (transition_state == WAIT_FOR_P_TO_N) {
-			if (diff < 0) {
-				transition_state = WAIT_FOR_N_TO_0;
-			} else if (diff == 0) {
-				transition_state = POS_INVALID;
-			}
-		} else if (transition_state == WAIT_FOR_N_TO_0) {
-			if (diff == 0) {
-				transition_state = WAIT_FOR_END;
-			} else if (diff > 0) {
-				transition_state = POS_INVALID;
-			}
-		} else if (transition_state == WAIT_FOR_END) {
-			// Should only get 0 differences if waiting for end
-			if (diff != 0) {
-				transition_state = POS_INVALID;
-			}
-		} else {
-			break;
-		}
+	if (!new_seq || new_seq == *seq) {
+		return false;
 	}
 
-	int32_t y_pos = -1;
+	*seq = new_seq;
 
-	if (transition_state == WAIT_FOR_N_TO_0 || transition_state == WAIT_FOR_END) {
-		int32_t dividend = 0;
-		int32_t divisor = 0;
-		int32_t factor = 0;
-		for (int idx = 0; idx < 8; idx++) {
-			dividend += factor * adc_vals_y[idx];
-			divisor += adc_vals_y[idx];
-			factor += 100;
-		}
+	return true;
+}
 
-		if (divisor) {
-			y_pos = dividend / divisor;	
-		}
+/**
+ * Get (filtered) X/Y location from latest frame captured from Trackpad, but
+ *  only if it is newer than the last frame caller has seen. Never waits on
+ *  Trackpad.
+ * 
+ * \param trackpad Specifies which Trackpad to get location for. 
+ * \param[inout] seq Sequence number of last frame caller has seen. Updated
+ *	to sequence number of frame being returned. 
+ * \param[out] xLoc X location. Only updated if newer frame available.
+ * \param[out] yLoc Y location. Only updated if newer frame available.
+ * \param[out] timestampUs When frame was captured. May be NULL. Only
+ *	updated if newer frame available.
+ *
+ * \return True if newer frame was available and outputs were updated.
+ */
+bool trackpadGetFrameXY(Trackpad trackpad, uint32_t* seq, uint16_t* xLoc, 
+	uint16_t* yLoc, uint32_t* timestampUs) {
+	TrackpadPos pos;
+
+	if (!trackpadGetFramePos(trackpad, seq, &pos)) {
+		return false;
 	}
 
-	// Update outputs if finger was down (i.e. x_pos and y_pos are both valid)
-	if (x_pos > 0 && y_pos > 0)  {
-		*xLoc = x_pos;
-		*yLoc = y_pos;
+	*xLoc = tpadPosToLoc(pos.x);
+	*yLoc = tpadPosToLoc(pos.y);
+	if (timestampUs) {
+		*timestampUs = pos.timestampUs;
 	}
+
+	return true;
 }
 
 /**
- * Setup Trackpad ASIC (i.e. configure registers, calibration, setup ISR).
+ * Get details on how background baseline (i.e. compensation value) tracking
+ *  is going for a Trackpad.
+ * 
+ * \param trackpad Specifies which Trackpad to get details for. 
+ * \param[out] ageUs How long ago baseline was last updated. May be NULL.
+ * \param[out] dev Raw demodulated profile value furthest from zero in last
+ *	frame checked against baseline (positive for touch, negative for stale
+ *	baseline). May be NULL.
+ *
+ * \return None.
+ */
+void trackpadGetBaseline(Trackpad trackpad, uint32_t* ageUs, int32_t* dev) {
+	if (ageUs) {
+		*ageUs = getUsTickCnt() - tpadBaselineUs[trackpad];
+	}
+	if (dev) {
+		*dev = tpadBaselineDevs[trackpad];
+	}
+}
+
+/**
+ * Extended Register values written during Trackpad setup for AnyMeas 
+ *  measurements. Each record is 8 bytes for one ADC (which look to be toggle
+ *  and polarity settings, in the same format as takeTpadAdcMeas() uses).
+ */
+static const TpadEraRec TPAD_MEAS_ERA_RECS[] = {
+	// Comensation Matrix Data for AnyMeas ADCs for Y axis location?
+	{0x015b, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x05, 0x50}},
+	{0x0163, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x06, 0x60}},
+	{0x016b, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x04, 0xc8}},
+	{0x0173, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x07, 0x80}},
+	{0x017b, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x05, 0x28}},
+	{0x0183, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x06, 0x18}},
+	{0x018b, 8, {0x00, 0x00, 0x07, 0xf8, 0x00, 0x00, 0x04, 0xb0}},
+	{0x0193, 8, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	// Comensation Matrix Data for AnyMeas ADCs for X axis location?
+	{0x01df, 8, {0x0f, 0xff, 0x00, 0x00, 0x02, 0x3b, 0x00, 0x00}},
+	{0x01e7, 8, {0x0f, 0xff, 0x00, 0x00, 0x04, 0x76, 0x00, 0x00}},
+	{0x01ef, 8, {0x0f, 0xff, 0x00, 0x00, 0x00, 0xed, 0x00, 0x00}},
+	{0x01f7, 8, {0x0f, 0xff, 0x00, 0x00, 0x01, 0xda, 0x00, 0x00}},
+	{0x01ff, 8, {0x0f, 0xff, 0x00, 0x00, 0x03, 0xb4, 0x00, 0x00}},
+	{0x0207, 8, {0x0f, 0xff, 0x00, 0x00, 0x07, 0x68, 0x00, 0x00}},
+	{0x020f, 8, {0x0f, 0xff, 0x00, 0x00, 0x06, 0xd1, 0x00, 0x00}},
+	{0x0217, 8, {0x0f, 0xff, 0x00, 0x00, 0x05, 0xa3, 0x00, 0x00}},
+	{0x021f, 8, {0x0f, 0xff, 0x00, 0x00, 0x03, 0x47, 0x00, 0x00}},
+	{0x0227, 8, {0x0f, 0xff, 0x00, 0x00, 0x06, 0x8e, 0x00, 0x00}},
+	{0x022f, 8, {0x0f, 0xff, 0x00, 0x00, 0x05, 0x1d, 0x00, 0x00}},
+};
+
+/**
+ * Extended Register values written during Trackpad setup after ADC 
+ *  configuration.
+ */
+static const TpadEraRec TPAD_ADC_ERA_RECS[] = {
+	{0x00d8, 2, {0x64, 0x03}}
+};
+
+/**
+ * Setup Trackpad ASIC for AnyMeas mode (i.e. configure registers, 
+ *  calibration, setup ISR).
  * 
  * \param trackpad Specifies which trackpad to communicate with. 
  * 
- * \return None.
+ * \return 0 on success.
  */
-static void setupTpad(Trackpad trackpad) {
+static int setupTpadAnyMeas(Trackpad trackpad) {
 	// Reset the TrackpadASIC:
 	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, TPAD_SYSCFG1_RESET_BIT);
 
@@ -1309,12 +1527,12 @@ static void setupTpad(Trackpad trackpad) {
 	// Check Firmware ID
 	uint8_t fw_id = readTpadReg(trackpad, TPAD_FW_ID_ADDR);
 	if (fw_id != 0x07)
-		return;
+		return -1;
 
 	// Check Firmware Version
 	uint8_t fw_ver = readTpadReg(trackpad, TPAD_FW_VER_ADDR);
 	if (fw_ver != 0x3a) 
-		return;
+		return -2;
 
 	// Stop Trackpad ASIC internal calculations
 	writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 
@@ -1352,207 +1570,19 @@ static void setupTpad(Trackpad trackpad) {
 	//  According to datasheet: A compensation matrix of 92 values (each 
 	//  value is 16 bits signed) is stored sequentially in Pinnacle RAM, 
 	//  with the first value being stored at 0x01DF. 
-	uint8_t era_data[8];
+	uint32_t era_start = getUsTickCnt();
+	if (writeTpadEraTable(trackpad, TPAD_MEAS_ERA_RECS, 
+		sizeof(TPAD_MEAS_ERA_RECS) / sizeof(TPAD_MEAS_ERA_RECS[0]))) {
+		return -3;
+	}
 
-	// Comensation Matrix Data for AnyMeas ADCs for Y axis location?
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x05;
-	era_data[7] = 0x50;
-	writeTpadExtRegs(trackpad, 0x015b, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x06;
-	era_data[7] = 0x60;
-	writeTpadExtRegs(trackpad, 0x0163, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x04;
-	era_data[7] = 0xc8;
-	writeTpadExtRegs(trackpad, 0x016b, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x07;
-	era_data[7] = 0x80;
-	writeTpadExtRegs(trackpad, 0x0173, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x05;
-	era_data[7] = 0x28;
-	writeTpadExtRegs(trackpad, 0x017b, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x06;
-	era_data[7] = 0x18;
-	writeTpadExtRegs(trackpad, 0x0183, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x07;
-	era_data[3] = 0xf8;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x04;
-	era_data[7] = 0xb0;
-	writeTpadExtRegs(trackpad, 0x018b, 8, era_data);
-
-	era_data[0] = 0x00;
-	era_data[1] = 0x00;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x00;
-	era_data[5] = 0x00;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x0193, 8, era_data);
+	applyTpadAdcTune(trackpad, &tpadAdcTunes[trackpad]);
 
-	// Comensation Matrix Data for AnyMeas ADCs for X axis location?
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x02;
-	era_data[5] = 0x3b;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x01df, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x04;
-	era_data[5] = 0x76;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x01e7, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x00;
-	era_data[5] = 0xed;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x01ef, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x01;
-	era_data[5] = 0xda;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x01f7, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x03;
-	era_data[5] = 0xb4;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x01ff, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x07;
-	era_data[5] = 0x68;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x0207, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x06;
-	era_data[5] = 0xd1;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x020f, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x05;
-	era_data[5] = 0xa3;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x0217, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x03;
-	era_data[5] = 0x47;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x021f, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x06;
-	era_data[5] = 0x8e;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x0227, 8, era_data);
-
-	era_data[0] = 0x0f;
-	era_data[1] = 0xff;
-	era_data[2] = 0x00;
-	era_data[3] = 0x00;
-	era_data[4] = 0x05;
-	era_data[5] = 0x1d;
-	era_data[6] = 0x00;
-	era_data[7] = 0x00;
-	writeTpadExtRegs(trackpad, 0x022f, 8, era_data);
-
-	setTpadAdcCfg(trackpad, TPAD_ADC_GAIN0, TPAD_ADC_TOGGLE_FREQ_0,
-		TPAD_ADC_SAMPLEN_256, TPAD_ADC_MUXSEL_SENSEP1GATE, 0, 
-		TPAD_ADC_APETURE_500NS);
-
-	era_data[0] = 0x64;
-	era_data[1] = 0x03;
-	writeTpadExtRegs(trackpad, 0x00d8, 2, era_data);
+	if (writeTpadEraTable(trackpad, TPAD_ADC_ERA_RECS, 
+		sizeof(TPAD_ADC_ERA_RECS) / sizeof(TPAD_ADC_ERA_RECS[0]))) {
+		return -4;
+	}
+	tpadEraUs[trackpad] = getUsTickCnt() - era_start;
 
 	clearTpadFlags(trackpad);
 
@@ -1565,365 +1595,159 @@ static void setupTpad(Trackpad trackpad) {
 	// Setting PINT so we can react to PINT rising edge
 	setupTpadISR(trackpad);
 
-	// Compute compensation values (i.e. average value of ADCs, assuming
-	//  no input during initialization).
-	int comp_accums[NUM_ANYMEAS_ADCS];
-	memset(comp_accums, 0, sizeof(int) * NUM_ANYMEAS_ADCS);
-
-	static int NUM_COMP_AVGS = 16;
-	for (int comp_cnt = 0; comp_cnt < NUM_COMP_AVGS; comp_cnt++) {
-		// Request X and Y AnyMeas ADC measurements
-		trackpadLocUpdate(trackpad);
+	loadTpadComps(trackpad);
 
-		// Wait for AnyMeas ADCs related to X position to be updated
-		while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_ADCS) {
-			__WFI();
-		}
-
-		for (int comp_idx = 0; comp_idx < NUM_ANYMEAS_ADCS; comp_idx++) {
-			comp_accums[comp_idx] += tpadAdcDatas[trackpad][comp_idx];
-		}
-	}
-
-	for (int comp_idx = 0; comp_idx < NUM_ANYMEAS_ADCS; comp_idx++) {
-		tpadAdcComps[trackpad][comp_idx] = comp_accums[comp_idx] 
-			/ NUM_COMP_AVGS;
-	}
+	return 0;
 }
 
-
-#endif // ANYMEAS_EN
-
-
 /**
- * Setup all clocks, peripherals, etc. so the ADC chnanels can be read.
- *
+ * Setup Trackpad ASIC for mode set in tpadModes.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
  * \return 0 on success.
  */
-void initTrackpad(void) {
-	// Set Interrupt Priority for SSP0 to one below highest (even though
-	//  we don't use SSP0 interrupts...)
-	NVIC_SetPriority(SSP0_IRQn, 1);
-
-	// Setup SSP0 pins
-	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_SCK0, IOCON_FUNC1);
-	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_MISO0, IOCON_FUNC1);
-	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_MOSI0, IOCON_FUNC1);
-
-	// Configure SPI
-	Chip_SSP_Init(spiRegs);
-	Chip_SSP_SetFormat(spiRegs, SSP_BITS_8, SSP_FRAMEFORMAT_SPI, 
-		SSP_CLOCK_CPHA1_CPOL0);
-	Chip_SSP_Set_Mode(spiRegs, SSP_MODE_MASTER);
-	Chip_SSP_SetBitRate(spiRegs, 6000000);
-	Chip_SSP_Enable(spiRegs);
-
-	// Right Trackpad comms setup
-	Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, true);
-	Chip_GPIO_SetPinDIROutput(LPC_GPIO, GPIO_R_TRACKPAD_CS_N);
-	Chip_IOCON_PinMux(LPC_IOCON, GPIO_R_TRACKPAD_CS_N, IOCON_DIGMODE_EN |
-		IOCON_MODE_INACT, IOCON_FUNC0);
-	Chip_IOCON_PinMux(LPC_IOCON, GPIO_R_TRACKPAD_DR, IOCON_DIGMODE_EN | 
-		IOCON_MODE_PULLDOWN, IOCON_FUNC0);
-
-	// Place Right Trackpad in shutdown mode
-	writeTpadReg(R_TRACKPAD, TPAD_SYSCFG1_ADDR, 
-		TPAD_SYSCFG1_SHUTDOWN_BIT);
-
-	// Left Trackpad comms setup
-	Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
-	Chip_GPIO_SetPinDIROutput(LPC_GPIO, GPIO_L_TRACKPAD_CS_N);
-	Chip_IOCON_PinMux(LPC_IOCON, GPIO_L_TRACKPAD_CS_N, IOCON_DIGMODE_EN |
-		IOCON_MODE_INACT, IOCON_FUNC0);
-	Chip_IOCON_PinMux(LPC_IOCON, GPIO_L_TRACKPAD_DR, IOCON_DIGMODE_EN | 
-		IOCON_MODE_PULLDOWN, IOCON_FUNC0);
-
-	// Place Left Trackpad in shutdown mode
-	writeTpadReg(L_TRACKPAD, TPAD_SYSCFG1_ADDR, 
-		TPAD_SYSCFG1_SHUTDOWN_BIT);
+static int setupTpad(Trackpad trackpad) {
+	if (tpadModes[trackpad] == TPAD_MODE_ABS) {
+		// No AnyMeas frame in progress for anything to wait on
+		tpadAdcIdxs[trackpad] = NUM_ANYMEAS_ADCS;
+		return setupTpadAbs(trackpad);
+	}
 
-	setupTpad(R_TRACKPAD);
-	setupTpad(L_TRACKPAD);
+	return setupTpadAnyMeas(trackpad);
 }
 
-
-#if (ANYMEAS_EN)
-
-
 /**
- * Function to be called by ISR to handle next ADC value.
+ * Switch Trackpad between AnyMeas and absolute mode. Scan scheduler is stopped
+ *  while Trackpad ASIC is reconfigured and restarted afterwards if it was
+ *  running.
  * 
- * \param trackpad Specifies which trackpad to communicate with. 
+ * \param trackpad Specifies which Trackpad to switch.
+ * \param mode Mode to switch to.
  * 
- * \return None.
+ * \return 0 on success. Otherwise return value of failed setup.
  */
-void getNextTpadAdcValIsr(Trackpad trackpad) {
-	volatile int16_t* tpad_adc_datas = tpadAdcDatas[trackpad];
-	int tpad_adc_idx = tpadAdcIdxs[trackpad];
-
-	tpad_adc_datas[tpad_adc_idx] = getTpadAdcAndClr(trackpad);
-	tpad_adc_idx++;
+int trackpadSetMode(Trackpad trackpad, TrackpadMode mode) {
+	if (mode == tpadModes[trackpad]) {
+		return 0;
+	}
 
-	if (tpad_adc_idx == NUM_ANYMEAS_X_ADCS) {
-		// Request measurements used for position on Y axis
-		setTpadAdcStartAddr(trackpad, ANYMEAS_Y_ADC_ADDR);
-		setTpadNumMeas(trackpad, NUM_ANYMEAS_Y_ADCS);
+	bool sched_en = tpadSchedEn;
+	trackpadSchedStop();
 
-		// Start the measurement
-		writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 
-			TPAD_SYSCFG1_ANYMEASEN_BIT | TPAD_SYSCFG1_TRACKDIS_BIT);
+	disableTpadISR(trackpad);
+	while (!tpadAbsXfers[trackpad].done) {
+		__WFI();
 	}
 
-	tpadAdcIdxs[trackpad] = tpad_adc_idx;
-}
+	uint32_t now = getUsTickCnt();
+	TrackpadMode old_mode = tpadModes[trackpad];
+	tpadModeStats[trackpad][old_mode].activeUs += 
+		now - tpadModeSinceUs[trackpad];
 
+	tpadModes[trackpad] = mode;
+	tpadModeSinceUs[trackpad] = now;
 
-#endif // ANYMEAS_EN
+	int retval = setupTpad(trackpad);
+	tpadInitRets[trackpad] = retval;
 
+	if (sched_en) {
+		trackpadSchedStart(tpadSchedFps);
+	}
 
-/**
- * ISR for 3 - GPIO pin interrupt 3, which occurs on rising edge of Right 
- *  Haptic DR.
- * 
- * \return None.
- */
-void FLEX_INT3_IRQHandler(void) {
-	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_R_TRACKPAD));
-
-#if (!ANYMEAS_EN)
-	getLatestTpadData(R_TRACKPAD);
-#else  // if (ANYMEAS_EN)
-	getNextTpadAdcValIsr(R_TRACKPAD);
-#endif // ANYMEAS_EN
-}
-
-/**
- * ISR for 4 - GPIO pin interrupt 4, which occurs on rising edge of Left 
- *  Haptic DR.
- * 
- * \return None.
- */
-void FLEX_INT4_IRQHandler(void) {
-	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_L_TRACKPAD));
-
-#if (!ANYMEAS_EN)
-	getLatestTpadData(L_TRACKPAD);
-#else  // if (ANYMEAS_EN)
-	getNextTpadAdcValIsr(L_TRACKPAD);
-#endif // ANYMEAS_EN
+	return retval;
 }
 
 /**
- * Print command usage details to console.
+ * \param trackpad Specifies which Trackpad to query.
  *
- * \return None.
+ * \return Mode Trackpad is currently running in.
  */
-void trackpadCmdUsage(void) {
-	printf(
-
-#if (!ANYMEAS_EN)
-
-		"usage: trackpad ??? (WIP)\n"
-
-#else // if (ANYMEAS_EN)
-
-		"usage: trackpad monitor\n"
-		"       trackpad getRaw\n"
-		"       trackpad readReg left/right addr\n"
-		"       trackpad writeReg left/right addr val\n"
-		"\n"
-		"monitor: Monitor X/Y position calculated for each Trackpad\n"
-		"getRaw: print single set of raw ADC readings and compensation\n" 
-		"	data (ideal for inserting into simulations)\n"
-		"readReg/writeReg: Access Trackpad ASIC Regiters\n"
-#endif
-	);
+TrackpadMode trackpadGetMode(Trackpad trackpad) {
+	return tpadModes[trackpad];
 }
 
 /**
- * Function that will entire loop which prints out X/Y position for each 
- *  Trackpad until a key is pressed to exit.
+ * Setup all clocks, peripherals, etc. so the ADC chnanels can be read.
  *
- * \return None.
+ * \return 0 on success.
  */
-void tpadMonitor(void) {
-	printf("Trackpad X/Y Location (Press any key to exit):\n");
-	printf("\n");
-	printf("Time             Left X Left Y Right X Right Y\n");
-	printf("----------------------------------------------\n");
-
-	while (!usb_tstc()) {
-		uint16_t x_loc = 0;
-		uint16_t y_loc = 0;
-
-		trackpadLocUpdate(L_TRACKPAD);
-		trackpadLocUpdate(R_TRACKPAD);
-
-		printf("0x%08x       ", getUsTickCnt());
-
-		trackpadGetLastXY(L_TRACKPAD, &x_loc, &y_loc);
-
-		printf("  %4d ", x_loc);
-		printf("  %4d ", y_loc);
-
-		trackpadGetLastXY(R_TRACKPAD, &x_loc, &y_loc);
-
-		printf("   %4d ", x_loc);
-		printf("   %4d ", y_loc);
+void initTrackpad(void) {
+	initTpadSpi();
 
-		printf(" %4d %4d", tpadAdcDatas[R_TRACKPAD][18], tpadAdcDatas[L_TRACKPAD][18]);
+	// Right Trackpad comms setup
+	Chip_IOCON_PinMux(LPC_IOCON, GPIO_R_TRACKPAD_DR, IOCON_DIGMODE_EN | 
+		IOCON_MODE_PULLDOWN, IOCON_FUNC0);
 
-		printf("\r");
-		usb_flush();
+	// Place Right Trackpad in shutdown mode
+	writeTpadReg(R_TRACKPAD, TPAD_SYSCFG1_ADDR, 
+		TPAD_SYSCFG1_SHUTDOWN_BIT);
 
-		usleep(10 * 1000);
-	}
-}
+	// Left Trackpad comms setup
+	Chip_IOCON_PinMux(LPC_IOCON, GPIO_L_TRACKPAD_DR, IOCON_DIGMODE_EN | 
+		IOCON_MODE_PULLDOWN, IOCON_FUNC0);
 
-/**
- * Print single set of raw ADC readings and compensation data (ideal for 
- *  inserting into simulations)"
- *
- * \return None.
- */
-void tpadGetRaw(void) {
-	int16_t eeprom_comps[NUM_ANYMEAS_ADCS];
-	eepromRead(0x628, eeprom_comps, sizeof(eeprom_comps));
-	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
-		printf("Left Compensation Vals[%d] = %d %d\n", idx, 
-			tpadAdcComps[L_TRACKPAD][idx], eeprom_comps[idx]);
-	}
-	printf("\n");
+	// Place Left Trackpad in shutdown mode
+	writeTpadReg(L_TRACKPAD, TPAD_SYSCFG1_ADDR, 
+		TPAD_SYSCFG1_SHUTDOWN_BIT);
 
-	eepromRead(0x602, eeprom_comps, sizeof(eeprom_comps));
-	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
-		printf("Right Compensation Vals[%d] = %d %d\n", idx, 
-			tpadAdcComps[R_TRACKPAD][idx], eeprom_comps[idx]);
-	}
-	printf("\n");
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		if (!tpadCorrLoadSaved(tpad, &tpadCorrGrids[tpad])) {
+			tpadCorrSrcs[tpad] = TPAD_CORR_SRC_SAVED;
+		} else {
+			tpadCorrIdentity(&tpadCorrGrids[tpad]);
+			tpadCorrSrcs[tpad] = TPAD_CORR_SRC_NONE;
+		}
 
-	uint16_t x_loc = 0;
-	uint16_t y_loc = 0;
+		tpadAdcXfers[tpad].trackpad = tpad;
+		tpadAdcXfers[tpad].txData = ADC_READ_AND_CLR_TX;
+		tpadAdcXfers[tpad].rxData = tpadAdcRxDatas[tpad];
+		tpadAdcXfers[tpad].len = ADC_READ_AND_CLR_LEN;
+		tpadAdcXfers[tpad].callback = tpadAdcReadDone;
 
-	trackpadLocUpdate(L_TRACKPAD);
-	trackpadLocUpdate(R_TRACKPAD);
+		tpadMeasStartXfers[tpad].trackpad = tpad;
+		tpadMeasStartXfers[tpad].txData = tpadMeasStartTxDatas[tpad];
 
-	printf("# Left Trackpad AnyMeas ADC Vals:\n");
+		tpadAbsXfers[tpad].trackpad = tpad;
+		tpadAbsXfers[tpad].txData = ABS_READ_AND_CLR_TX;
+		tpadAbsXfers[tpad].rxData = tpadAbsRxDatas[tpad];
+		tpadAbsXfers[tpad].len = ABS_READ_AND_CLR_LEN;
+		tpadAbsXfers[tpad].callback = tpadAbsReadDone;
+		tpadAbsXfers[tpad].done = 1;
 
-	trackpadGetLastXY(L_TRACKPAD, &x_loc, &y_loc);
+		tpadModes[tpad] = TPAD_DFLT_MODE;
 
-	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
-		uint32_t base_addr = 0x10000a5e;
-		printf("set {short}0x%08x = %d\n", base_addr + 2 * idx, 
-			tpadAdcDatas[L_TRACKPAD][idx]);
-		printf("set {short}0x%08x = %d\n", 0x4c + base_addr + 2 * idx, 
-			tpadAdcDatas[L_TRACKPAD][idx]);
+		if (!tpadTuneLoadSaved(tpad, &tpadAdcTunes[tpad])) {
+			tpadTuneSrcs[tpad] = TPAD_TUNE_SRC_SAVED;
+		} else {
+			tpadAdcTunes[tpad] = TPAD_ADC_TUNE_DFLT;
+			tpadTuneSrcs[tpad] = TPAD_TUNE_SRC_NONE;
+		}
 	}
-	printf("\n");
 
-	printf("# Right Trackpad AnyMeas ADC Vals:\n");
+	// Free running timer for scan scheduler
+	Chip_TIMER_Init(tpadSchedTimer);
 
-	trackpadGetLastXY(R_TRACKPAD, &x_loc, &y_loc);
+	// Set the timer to increment every microsecond
+	Chip_TIMER_PrescaleSet(tpadSchedTimer, SystemCoreClock/1000000-1);
 
-	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
-		uint32_t base_addr = 0x10000a38;
-		printf("set {short}0x%08x = %d\n", base_addr + 2 * idx, 
-			tpadAdcDatas[R_TRACKPAD][idx]);
-		printf("set {short}0x%08x = %d\n", 0x4c + base_addr + 2 * idx, 
-			tpadAdcDatas[R_TRACKPAD][idx]);
-	}
-	printf("\n");
-}
+	// Same priority as SSP0 so that scheduler state is never modified by
+	//  scheduler timer and SPI completion callbacks at the same time
+	NVIC_SetPriority(TIMER_32_1_IRQn, 1);
+	NVIC_ClearPendingIRQ(TIMER_32_1_IRQn);
+	NVIC_EnableIRQ(TIMER_32_1_IRQn);
 
-/**
- * Handle trackpad query/control command line function.
- *
- * \param argc Number of arguments (i.e. size of argv)
- * \param argv Command line entry broken into array argument strings.
- *
- * \return 0 on success.
- */
-int trackpadCmdFnc(int argc, const char* argv[]) {
-
-#if (!ANYMEAS_EN)
-
-	Trackpad trackpad = R_TRACKPAD;
-
-	printf("Firmware ID = 0x%02x\n", readTpadReg(trackpad, TPAD_FW_ID_ADDR));
-	printf("Firmware Version = 0x%02x\n", readTpadReg(trackpad, TPAD_FW_VER_ADDR));
-
-	printf("Status 1 = 0x%02x\n", readTpadReg(trackpad, 0x02));
-	printf("Sys Config 1 = 0x%02x\n", readTpadReg(trackpad, 0x03));
-	printf("Feed Config 1 = 0x%02x\n", readTpadReg(trackpad, 0x04));
-	printf("Feed Config 2 = 0x%02x\n", readTpadReg(trackpad, 0x05));
-	printf("Feed Config 3 = 0x%02x\n", readTpadReg(trackpad, 0x06));
-	printf("Cal Config 1 = 0x%02x\n", readTpadReg(trackpad, 0x07));
-	printf("PS/2 Aux Control = 0x%02x\n", readTpadReg(trackpad, 0x08));
-	printf("Sample Rate = 0x%02x\n", readTpadReg(trackpad, 0x09));
-	printf("Z Idle = 0x%02x\n", readTpadReg(trackpad, TPAD_ZIDLE_ADDR));
-	printf("Z Scaler = 0x%02x\n", readTpadReg(trackpad, TPAD_ZSCALER_ADDR));
-	printf("Sleep Interval = 0x%02x\n", readTpadReg(trackpad, TPAD_SLEEPINTERVAL_ADDR));
-	printf("Sleep Timer = 0x%02x\n", readTpadReg(trackpad, TPAD_SLEEPTIMER_ADDR));
-	printf("Dynamic EMI Adjust = 0x%02x\n", readTpadReg(trackpad, 0x0E));
-
-	while (!usb_tstc()) {
-
-		int idx = 0;//tpadAbsDataIdxs[trackpad];
-		printf("[%d]: X = %4d, Y = %4d, Z = %4d\r", idx, 
-			tpadAbsDatas[trackpad][idx].xPos, 
-			tpadAbsDatas[trackpad][idx].yPos, 
-			tpadAbsDatas[trackpad][idx].zPos);
-
-		usleep(10 * 1000);
-	}
+	// Work on frames once they are captured is lowest priority of all
+	NVIC_SetPriority(PendSV_IRQn, 3);
 
-#else // if (ANYMEAS_EN)
+	Chip_TIMER_Enable(tpadSchedTimer);
 
-	if (argc < 2) {
-		trackpadCmdUsage();
-		return -1;
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		uint32_t start = getUsTickCnt();
+		tpadInitRets[tpad] = setupTpad(tpad);
+		tpadInitUs[tpad] = getUsTickCnt() - start;
+		tpadModeSinceUs[tpad] = getUsTickCnt();
 	}
 
-	if (!strcmp("monitor", argv[1])) {
-		tpadMonitor();
-	} else if (!strcmp("getRaw", argv[1])) {
-		tpadGetRaw();
-	} else if (!strcmp("readReg", argv[1])) {
-		if (argc != 4) {
-			trackpadCmdUsage();
-			return -1;
-		}
-		Trackpad trackpad = R_TRACKPAD;
-		if (!strcmp("left", argv[2])) {
-			trackpad = L_TRACKPAD;
-		}
-		uint32_t addr = strtol(argv[3], NULL, 0);
-
-		printf("Read 0x%02x from register 0x%02x of %s Trackpad.\n",
-			readTpadReg(trackpad, addr), addr, 
-			trackpad == R_TRACKPAD ? "right":"left");
-	} else if (!strcmp("writeReg", argv[1])) {
-		if (argc != 5) {
-			trackpadCmdUsage();
-			return -1;
-		}
-		Trackpad trackpad = R_TRACKPAD;
-		if (!strcmp("left", argv[2])) {
-			trackpad = L_TRACKPAD;
-		}
-		uint32_t addr = strtol(argv[3], NULL, 0);
-		uint32_t val = strtol(argv[4], NULL, 0);
-
-		printf("Writing 0x%02x to register 0x%02x of %s Trackpad.\n",
-			val, addr, trackpad == R_TRACKPAD ? "right":"left");
-		
-		writeTpadReg(trackpad, addr, val);
-	} else {
-		trackpadCmdUsage();
-		return -1;
-	}
-
-#endif // ANYMEAS_EN
-
-	return 0;
+	trackpadSchedStart(TPAD_SCHED_DFLT_FPS);
 }
@@ -0,0 +1,815 @@
+/**
+ * \file trackpad_cal.c
+ * \brief Encompasses calibration of Trackpad AnyMeas compensation values
+ *	(including for alternate hop frequencies), tuning of AnyMeas ADC 
+ *	settings and calibration of geometric correction.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int16_t tpadAdcComps[2][NUM_ANYMEAS_ADCS]; //!< Compensation values 
+	//!< for AnyMeas ADC channels used to calculate X/Y position.
+TpadCompSrc tpadCompSrcs[2]; //!< Where tpadAdcComps came from.
+uint32_t tpadCompUs[2]; //!< How long it took to get tpadAdcComps.
+
+#define NUM_COMP_AVGS (16) //!< Number of frames averaged to compute 
+	//!< compensation values during full recalibration.
+#define NUM_COMP_CHECK_FRAMES (2) //!< Number of frames captured to sanity
+	//!< check compensation values loaded from EEPROM.
+#define MAX_COMP_DEV (200) //!< Largest average difference allowed between
+	//!< any ADC value and its compensation value (with no input) before 
+	//!< loaded compensation values are considered stale.
+
+#define TPAD_CORR_CAL_SETTLE_FRAMES (32) //!< Frames finger must be down 
+	//!< before averaging of a calibration point starts.
+#define TPAD_CORR_CAL_FRAMES (64) //!< Frames averaged for each calibration
+	//!< point.
+#define TPAD_CORR_CAL_LIFT_FRAMES (16) //!< Frames finger must be up before
+	//!< next calibration point is started.
+
+/**
+ * AnyMeas ADC settings used until a Trackpad has been tuned (i.e. what 
+ *  official firmware uses).
+ */
+const TpadAdcTune TPAD_ADC_TUNE_DFLT = {
+	.gain = TPAD_ADC_GAIN0,
+	.toggleFreq = TPAD_ADC_TOGGLE_FREQ_0,
+	.sampleLen = TPAD_ADC_SAMPLEN_256,
+	.aperture = TPAD_ADC_APETURE_500NS,
+	.sigScale = TPAD_TUNE_SIG_SCALE_ONE
+};
+
+// Settings swept by tuneTpad(). Every combination is tried
+static const TpadAdcGain TPAD_TUNE_GAINS[] = {
+	TPAD_ADC_GAIN0, TPAD_ADC_GAIN2
+};
+static const TpadAdcToggleFreq TPAD_TUNE_TOGGLE_FREQS[] = {
+	TPAD_ADC_TOGGLE_FREQ_0, TPAD_ADC_TOGGLE_FREQ_4
+};
+static const TpadAdcSampleLen TPAD_TUNE_SAMPLE_LENS[] = {
+	TPAD_ADC_SAMPLEN_128, TPAD_ADC_SAMPLEN_256, TPAD_ADC_SAMPLEN_512
+};
+static const TpadAdcAperture TPAD_TUNE_APERTURES[] = {
+	TPAD_ADC_APETURE_250NS, TPAD_ADC_APETURE_500NS, TPAD_ADC_APETURE_1000NS
+};
+
+#define NUM_TPAD_TUNE_CANDS (ARRAY_SIZE(TPAD_TUNE_GAINS) * \
+	ARRAY_SIZE(TPAD_TUNE_TOGGLE_FREQS) * ARRAY_SIZE(TPAD_TUNE_SAMPLE_LENS) * \
+	ARRAY_SIZE(TPAD_TUNE_APERTURES)) //!< Number of settings swept by tuning.
+
+#define TPAD_TUNE_SETTLE_FRAMES (2) //!< Frames thrown away after changing
+	//!< settings during tuning.
+#define TPAD_TUNE_NOISE_FRAMES (8) //!< Frames used to measure noise (and 
+	//!< scan time) for each setting.
+#define TPAD_TUNE_SIGNAL_FRAMES (4) //!< Frames used to measure signal for
+	//!< each setting.
+#define TPAD_TUNE_STEADY_FRAMES (16) //!< Frames in a row finger must be on
+	//!< (or off) Trackpad before tuning moves on.
+
+TpadAdcTune tpadAdcTunes[2]; //!< AnyMeas ADC settings for each 
+	//!< Trackpad.
+TpadTuneSrc tpadTuneSrcs[2]; //!< Where tpadAdcTunes came from.
+
+// Toggle frequencies the scan scheduler can hop to when the tuned one is 
+//  noisy. The first NUM_TPAD_HOP_FREQS - 1 that differ from the tuned one
+//  are used
+static const TpadAdcToggleFreq TPAD_HOP_ALT_FREQS[] = {
+	TPAD_ADC_TOGGLE_FREQ_6, TPAD_ADC_TOGGLE_FREQ_2, TPAD_ADC_TOGGLE_FREQ_4
+};
+
+uint8_t tpadHopFreqs[2][NUM_TPAD_HOP_FREQS]; //!< Toggle frequencies
+	//!< hopped between for each Trackpad (tuned one first).
+SRAM1_BSS static int16_t tpadHopComps[2][NUM_TPAD_HOP_FREQS][NUM_ANYMEAS_ADCS];
+	//!< Compensation values for each frequency. Values for the frequency 
+	//!< in use are stale, as tpadAdcComps is tracked instead.
+
+static uint8_t tpadHopCompSlots[2]; //!< Index into tpadHopFreqs of 
+	//!< frequency tpadAdcComps are for.
+
+/**
+ * Capture a single frame of AnyMeas ADC values, waiting for it to complete.
+ *  Scan scheduler must not be running.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param[out] adcs Where to store NUM_ANYMEAS_ADCS values.
+ * 
+ * \return None.
+ */
+static void captureTpadFrame(Trackpad trackpad, int16_t* adcs) {
+	// Request X and Y AnyMeas ADC measurements
+	trackpadLocUpdate(trackpad);
+
+	while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_ADCS) {
+		__WFI();
+	}
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		adcs[idx] = tpadAdcDatas[trackpad][idx];
+	}
+}
+
+/**
+ * Compute compensation values (i.e. average value of ADCs, assuming no input
+ *  during calibration). Scan scheduler must not be running.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param[out] comps Where to store NUM_ANYMEAS_ADCS values.
+ * 
+ * \return None.
+ */
+static void calTpadComps(Trackpad trackpad, int16_t* comps) {
+	int comp_accums[NUM_ANYMEAS_ADCS];
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	memset(comp_accums, 0, sizeof(int) * NUM_ANYMEAS_ADCS);
+
+	for (int comp_cnt = 0; comp_cnt < NUM_COMP_AVGS; comp_cnt++) {
+		captureTpadFrame(trackpad, adcs);
+
+		for (int comp_idx = 0; comp_idx < NUM_ANYMEAS_ADCS; comp_idx++) {
+			comp_accums[comp_idx] += adcs[comp_idx];
+		}
+	}
+
+	for (int comp_idx = 0; comp_idx < NUM_ANYMEAS_ADCS; comp_idx++) {
+		comps[comp_idx] = comp_accums[comp_idx] / NUM_COMP_AVGS;
+	}
+}
+
+/**
+ * Quick sanity scan to check if compensation values loaded from EEPROM still
+ *  match what the Trackpad is reading (assuming no input). Scan scheduler
+ *  must not be running.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param[in] comps Compensation values to check.
+ * 
+ * \return 0 if compensation values can be used.
+ */
+static int checkTpadComps(Trackpad trackpad, const int16_t* comps) {
+	int dev_accums[NUM_ANYMEAS_ADCS];
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	memset(dev_accums, 0, sizeof(int) * NUM_ANYMEAS_ADCS);
+
+	for (int frame = 0; frame < NUM_COMP_CHECK_FRAMES; frame++) {
+		captureTpadFrame(trackpad, adcs);
+
+		for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+			dev_accums[idx] += adcs[idx] - comps[idx];
+		}
+	}
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		int dev = dev_accums[idx] / NUM_COMP_CHECK_FRAMES;
+		if (dev > MAX_COMP_DEV || dev < -MAX_COMP_DEV) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Restart baseline tracking from current compensation values. Needs to be 
+ *  called with scan scheduler frames unable to preempt.
+ * 
+ * \param trackpad Specifies which trackpad to restart tracking for. 
+ * 
+ * \return None.
+ */
+void seedTpadBaseline(Trackpad trackpad) {
+	uint32_t now = getUsTickCnt();
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		tpadBaselines[trackpad][idx] = tpadAdcComps[trackpad][idx] * 
+			(1 << TPAD_BASELINE_FRAC_BITS);
+		tpadBaselineRefs[trackpad][idx] = tpadAdcComps[trackpad][idx];
+	}
+	tpadBaselineUs[trackpad] = now;
+	tpadBaselineCheckUs[trackpad] = now;
+	tpadBaselineFrozens[trackpad] = false;
+	tpadBaselineSeedReqs[trackpad] = false;
+}
+
+/**
+ * Swap in compensation values for toggle frequency measurements are being
+ *  taken with, if they are not already in use. Needs to be called with scan 
+ *  scheduler frames unable to preempt.
+ * 
+ * \param trackpad Specifies which trackpad to swap compensation values for. 
+ * 
+ * \return None.
+ */
+void applyTpadHopComps(Trackpad trackpad) {
+	int slot = tpadHopSlots[trackpad];
+	int comp_slot = tpadHopCompSlots[trackpad];
+
+	if (slot == comp_slot) {
+		return;
+	}
+
+	// Keep what baseline tracking learned for when we hop back
+	memcpy(tpadHopComps[trackpad][comp_slot], tpadAdcComps[trackpad], 
+		sizeof(tpadAdcComps[trackpad]));
+	memcpy(tpadAdcComps[trackpad], tpadHopComps[trackpad][slot], 
+		sizeof(tpadAdcComps[trackpad]));
+	tpadHopCompSlots[trackpad] = slot;
+
+	// Baseline tracking is not done from here, so it restarts itself
+	tpadBaselineSeedReqs[trackpad] = true;
+}
+
+/**
+ * Work out which toggle frequencies Trackpad can hop between (based on tuned
+ *  one) and reset hopping state. Scan scheduler must not be running.
+ * 
+ * \param trackpad Specifies which trackpad to setup hopping for. 
+ * 
+ * \return None.
+ */
+static void initTpadHopFreqs(Trackpad trackpad) {
+	const TpadAdcTune* tune = &tpadAdcTunes[trackpad];
+	uint8_t* freqs = tpadHopFreqs[trackpad];
+	int num_freqs = 0;
+
+	freqs[num_freqs++] = tune->toggleFreq;
+	for (int idx = 0; idx < ARRAY_SIZE(TPAD_HOP_ALT_FREQS) && 
+		num_freqs < NUM_TPAD_HOP_FREQS; idx++) {
+		if (TPAD_HOP_ALT_FREQS[idx] != tune->toggleFreq) {
+			freqs[num_freqs++] = TPAD_HOP_ALT_FREQS[idx];
+		}
+	}
+
+	tpadHopSlots[trackpad] = 0;
+	tpadHopNextSlots[trackpad] = 0;
+	tpadHopCompSlots[trackpad] = 0;
+	tpadHopFrames[trackpad] = 0;
+	tpadHopNoisys[trackpad] = false;
+	memset(tpadHopSlotNoises[trackpad], 0, 
+		sizeof(tpadHopSlotNoises[trackpad]));
+}
+
+/**
+ * Compute compensation values for each toggle frequency Trackpad can hop to
+ *  (other than tuned one, which tpadAdcComps must already be set for) and 
+ *  save them to EEPROM. Scan scheduler must not be running and nothing can
+ *  be on Trackpad.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return 0 on success (i.e. values were saved).
+ */
+static int calTpadHopComps(Trackpad trackpad) {
+	const TpadAdcTune* tune = &tpadAdcTunes[trackpad];
+	const uint8_t* freqs = tpadHopFreqs[trackpad];
+	TpadHopComps hop_comps;
+
+	initTpadHopFreqs(trackpad);
+
+	for (int slot = 1; slot < NUM_TPAD_HOP_FREQS; slot++) {
+		setTpadReg(trackpad, TPAD_ADCCFG1_ADDR, tune->gain | freqs[slot]);
+		calTpadComps(trackpad, tpadHopComps[trackpad][slot]);
+		hop_comps.freqs[slot - 1] = freqs[slot];
+		memcpy(hop_comps.comps[slot - 1], tpadHopComps[trackpad][slot],
+			sizeof(hop_comps.comps[slot - 1]));
+	}
+	setTpadReg(trackpad, TPAD_ADCCFG1_ADDR, tune->gain | freqs[0]);
+
+	return tpadCompSaveHop(trackpad, &hop_comps);
+}
+
+/**
+ * Fill in compensation values for each toggle frequency Trackpad can hop to
+ *  from EEPROM. Saved values are only used if they are for the same 
+ *  frequencies and pass sanity scan. Scan scheduler must not be running.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return 0 if saved values are in use. Otherwise calTpadHopComps() needs
+ *	to be called.
+ */
+static int loadTpadHopComps(Trackpad trackpad) {
+	const TpadAdcTune* tune = &tpadAdcTunes[trackpad];
+	const uint8_t* freqs = tpadHopFreqs[trackpad];
+	TpadHopComps hop_comps;
+	int retval = 0;
+
+	initTpadHopFreqs(trackpad);
+
+	if (tpadCompLoadHopSaved(trackpad, &hop_comps) || 
+		memcmp(hop_comps.freqs, &freqs[1], sizeof(hop_comps.freqs))) {
+		return -1;
+	}
+
+	for (int slot = 1; slot < NUM_TPAD_HOP_FREQS; slot++) {
+		setTpadReg(trackpad, TPAD_ADCCFG1_ADDR, tune->gain | freqs[slot]);
+		if (checkTpadComps(trackpad, hop_comps.comps[slot - 1])) {
+			retval = -2;
+			break;
+		}
+		memcpy(tpadHopComps[trackpad][slot], hop_comps.comps[slot - 1],
+			sizeof(hop_comps.comps[slot - 1]));
+	}
+	setTpadReg(trackpad, TPAD_ADCCFG1_ADDR, tune->gain | freqs[0]);
+
+	return retval;
+}
+
+/**
+ * Go back to tuned toggle frequency (i.e. so calibration and other direct
+ *  access see the same settings as at setup). Scan scheduler must not be 
+ *  running.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return None.
+ */
+void restoreTpadHopFreq(Trackpad trackpad) {
+	tpadHopSlots[trackpad] = 0;
+	tpadHopNextSlots[trackpad] = 0;
+	applyTpadHopComps(trackpad);
+	if (tpadBaselineSeedReqs[trackpad]) {
+		seedTpadBaseline(trackpad);
+	}
+	setTpadReg(trackpad, TPAD_ADCCFG1_ADDR, tpadAdcTunes[trackpad].gain | 
+		tpadHopFreqs[trackpad][0]);
+
+	tpadHopFrames[trackpad] = 0;
+	tpadHopNoisys[trackpad] = false;
+}
+
+/**
+ * Fill in compensation values for Trackpad. Values saved in EEPROM (by this
+ *  firmware, or factory values) are used if they pass sanity scan. Otherwise
+ *  a full recalibration is done and the result is saved for next boot.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return None.
+ */
+void loadTpadComps(Trackpad trackpad) {
+	int16_t* comps = tpadAdcComps[trackpad];
+	uint32_t start = getUsTickCnt();
+
+	if (!tpadCompLoadSaved(trackpad, comps) && 
+		!checkTpadComps(trackpad, comps)) {
+		tpadCompSrcs[trackpad] = TPAD_COMP_SRC_SAVED;
+	} else if (!tpadCompLoadFactory(trackpad, comps) && 
+		!checkTpadComps(trackpad, comps)) {
+		tpadCompSrcs[trackpad] = TPAD_COMP_SRC_FACTORY;
+	} else {
+		calTpadComps(trackpad, comps);
+		tpadCompSave(trackpad, comps);
+		tpadCompSrcs[trackpad] = TPAD_COMP_SRC_CALIBRATED;
+	}
+
+	seedTpadBaseline(trackpad);
+
+	// Hop frequencies only need calibrating if tuned one did, or if their
+	//  saved values are missing or stale
+	if (tpadCompSrcs[trackpad] == TPAD_COMP_SRC_CALIBRATED || 
+		loadTpadHopComps(trackpad)) {
+		calTpadHopComps(trackpad);
+	}
+
+	tpadCompUs[trackpad] = getUsTickCnt() - start;
+}
+
+/**
+ * Force full recalibration of Trackpad compensation values and save result
+ *  to EEPROM.
+ * 
+ * \param trackpad Specifies which trackpad to recalibrate. 
+ * 
+ * \return 0 on success.
+ */
+int recalTpad(Trackpad trackpad) {
+	int16_t comps[NUM_ANYMEAS_ADCS];
+	bool sched_en = tpadSchedEn;
+
+	trackpadSchedStop();
+
+	uint32_t start = getUsTickCnt();
+	calTpadComps(trackpad, comps);
+	tpadCompUs[trackpad] = getUsTickCnt() - start;
+
+	// Swap in all at once so frames are not decoded with mix of old and
+	//  new values
+	__disable_irq();
+	memcpy(tpadAdcComps[trackpad], comps, sizeof(comps));
+	tpadCompSrcs[trackpad] = TPAD_COMP_SRC_CALIBRATED;
+	seedTpadBaseline(trackpad);
+	__enable_irq();
+
+	int retval = tpadCompSave(trackpad, comps);
+	if (calTpadHopComps(trackpad) && !retval) {
+		retval = -1;
+	}
+
+	if (sched_en) {
+		trackpadSchedStart(tpadSchedFps);
+	}
+
+	return retval;
+}
+
+/**
+ * Get one of the settings swept during tuning.
+ * 
+ * \param idx Which settings to get (0 to NUM_TPAD_TUNE_CANDS - 1).
+ * \param[out] tune Where to store settings.
+ * 
+ * \return None.
+ */
+static void getTpadTuneCand(int idx, TpadAdcTune* tune) {
+	tune->gain = TPAD_TUNE_GAINS[idx % ARRAY_SIZE(TPAD_TUNE_GAINS)];
+	idx /= ARRAY_SIZE(TPAD_TUNE_GAINS);
+	tune->toggleFreq = TPAD_TUNE_TOGGLE_FREQS[idx % 
+		ARRAY_SIZE(TPAD_TUNE_TOGGLE_FREQS)];
+	idx /= ARRAY_SIZE(TPAD_TUNE_TOGGLE_FREQS);
+	tune->sampleLen = TPAD_TUNE_SAMPLE_LENS[idx % 
+		ARRAY_SIZE(TPAD_TUNE_SAMPLE_LENS)];
+	idx /= ARRAY_SIZE(TPAD_TUNE_SAMPLE_LENS);
+	tune->aperture = TPAD_TUNE_APERTURES[idx];
+	tune->sigScale = TPAD_TUNE_SIG_SCALE_ONE;
+}
+
+/**
+ * Print ADC settings in human readable form.
+ * 
+ * \param[in] tune Settings to print.
+ * 
+ * \return None.
+ */
+void printTpadAdcTune(const TpadAdcTune* tune) {
+	// Gain bits count down from highest gain
+	printf("gain %d, toggle freq 0x%02x, sample len %3d, aperture %4d ns",
+		3 - (tune->gain >> 6), tune->toggleFreq, 
+		64 << tune->sampleLen, 125 * tune->aperture);
+}
+
+/**
+ * Wait for finger to be on (or off) Trackpad for a number of frames in a row.
+ *  Current ADC settings and compensation values of Trackpad must match. Scan 
+ *  scheduler must not be running.
+ * 
+ * \param trackpad Specifies which Trackpad to watch.
+ * \param touch True to wait for finger to be down.
+ * 
+ * \return 0 on success. Negative value if aborted by key press.
+ */
+static int waitTpadTune(Trackpad trackpad, bool touch) {
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	int32_t bins[NUM_TPAD_MAX_BINS];
+	uint32_t cnt = 0;
+
+	while (cnt < TPAD_TUNE_STEADY_FRAMES) {
+		if (usb_tstc()) {
+			printf("Aborted\n");
+			return -1;
+		}
+
+		captureTpadFrame(trackpad, adcs);
+		bool touched = tpadDecodeAxisQ(TPAD_AXIS_X, adcs, 
+			tpadAdcComps[trackpad], bins) != TPAD_POS_INVALID;
+		cnt = touched == touch ? cnt + 1 : 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Use new ADC settings on Trackpad. Compensation values are recalibrated 
+ *  (so nothing can be on Trackpad) and both are saved to EEPROM for next 
+ *  boot. Scan scheduler must not be running.
+ * 
+ * \param trackpad Specifies which Trackpad to update.
+ * \param[in] tune New settings.
+ * \param src Where settings came from.
+ * 
+ * \return 0 on success.
+ */
+int setTpadAdcTune(Trackpad trackpad, const TpadAdcTune* tune,
+	TpadTuneSrc src) {
+	int16_t comps[NUM_ANYMEAS_ADCS];
+
+	tpadAdcTunes[trackpad] = *tune;
+	tpadTuneSrcs[trackpad] = src;
+	applyTpadAdcTune(trackpad, tune);
+
+	uint32_t start = getUsTickCnt();
+	calTpadComps(trackpad, comps);
+	tpadCompUs[trackpad] = getUsTickCnt() - start;
+
+	__disable_irq();
+	memcpy(tpadAdcComps[trackpad], comps, sizeof(comps));
+	tpadCompSrcs[trackpad] = TPAD_COMP_SRC_CALIBRATED;
+	seedTpadBaseline(trackpad);
+	__enable_irq();
+
+	if (tpadCompSave(trackpad, comps) || calTpadHopComps(trackpad)) {
+		return -1;
+	}
+
+	if (tpadTuneSave(trackpad, tune)) {
+		return -2;
+	}
+
+	return 0;
+}
+
+/**
+ * Measure noise, scan time and signal of Trackpad for each setting in sweep
+ *  and pick fastest that meets signal to noise target. User is guided 
+ *  through keeping Trackpad clear and then holding a finger at its center.
+ *  Picked settings are used right away and saved to EEPROM. Scan scheduler 
+ *  must not be running.
+ * 
+ * \param trackpad Specifies which Trackpad to tune.
+ * \param minSnr Signal to noise ratio target.
+ * 
+ * \return 0 on success.
+ */
+int tuneTpad(Trackpad trackpad, uint32_t minSnr) {
+	const char* name = trackpad == R_TRACKPAD ? "right":"left";
+	TpadAdcTune orig_tune = tpadAdcTunes[trackpad];
+	TpadAdcTune dflt_tune = TPAD_ADC_TUNE_DFLT;
+	TpadAdcTune tune;
+	TpadTuneAccum accum;
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	int retval = -1;
+	int dflt_idx = -1;
+
+	TpadTuneResult* results = malloc(sizeof(TpadTuneResult) * 
+		NUM_TPAD_TUNE_CANDS);
+	int16_t* means = malloc(sizeof(int16_t) * NUM_ANYMEAS_ADCS * 
+		NUM_TPAD_TUNE_CANDS);
+	if (!results || !means) {
+		printf("malloc failed\n");
+		goto exit;
+	}
+
+	printf("Keep %s Trackpad clear (press any key to abort)...\n", name);
+	usb_flush();
+	if (waitTpadTune(trackpad, false)) {
+		goto exit;
+	}
+
+	// Noise and scan time with nothing on Trackpad
+	for (int cand = 0; cand < NUM_TPAD_TUNE_CANDS; cand++) {
+		TpadTuneResult* result = &results[cand];
+		int16_t* cand_means = &means[cand * NUM_ANYMEAS_ADCS];
+		int32_t adc_sums[NUM_ANYMEAS_ADCS];
+		uint32_t scan_us = 0;
+
+		getTpadTuneCand(cand, &tune);
+		dflt_tune.sigScale = tune.sigScale;
+		if (!memcmp(&tune, &dflt_tune, sizeof(tune))) {
+			dflt_idx = cand;
+		}
+		applyTpadAdcTune(trackpad, &tune);
+
+		for (int frame = 0; frame < TPAD_TUNE_SETTLE_FRAMES; frame++) {
+			captureTpadFrame(trackpad, cand_means);
+		}
+
+		memset(result, 0, sizeof(*result));
+		memset(adc_sums, 0, sizeof(adc_sums));
+		tpadTuneAccumReset(&accum);
+		for (int frame = 0; frame < TPAD_TUNE_NOISE_FRAMES; frame++) {
+			uint32_t start = getUsTickCnt();
+			captureTpadFrame(trackpad, adcs);
+			scan_us += getUsTickCnt() - start;
+
+			// Last settle frame is fine as reference for noise
+			if (tpadTuneAccumAdd(&accum, adcs, cand_means)) {
+				result->clipped = true;
+			}
+			for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+				adc_sums[idx] += adcs[idx];
+			}
+		}
+
+		result->scanUs = scan_us / TPAD_TUNE_NOISE_FRAMES;
+		result->noiseQ4 = tpadTuneNoiseQ4(&accum);
+		for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+			cand_means[idx] = adc_sums[idx] / TPAD_TUNE_NOISE_FRAMES;
+		}
+	}
+
+	applyTpadAdcTune(trackpad, &orig_tune);
+	printf("Touch and hold center of %s Trackpad...\n", name);
+	usb_flush();
+	if (waitTpadTune(trackpad, true)) {
+		goto exit;
+	}
+
+	// Signal with finger held down
+	for (int cand = 0; cand < NUM_TPAD_TUNE_CANDS; cand++) {
+		TpadTuneResult* result = &results[cand];
+
+		getTpadTuneCand(cand, &tune);
+		applyTpadAdcTune(trackpad, &tune);
+
+		for (int frame = 0; frame < TPAD_TUNE_SETTLE_FRAMES; frame++) {
+			captureTpadFrame(trackpad, adcs);
+		}
+
+		tpadTuneAccumReset(&accum);
+		for (int frame = 0; frame < TPAD_TUNE_SIGNAL_FRAMES; frame++) {
+			captureTpadFrame(trackpad, adcs);
+			if (tpadTuneAccumAdd(&accum, adcs, 
+				&means[cand * NUM_ANYMEAS_ADCS])) {
+				result->clipped = true;
+			}
+		}
+		result->signal = tpadTuneSignal(&accum);
+	}
+
+	// Make sure finger stayed down for whole sweep
+	applyTpadAdcTune(trackpad, &orig_tune);
+	if (waitTpadTune(trackpad, true)) {
+		goto exit;
+	}
+
+	printf("Lift finger...\n");
+	usb_flush();
+	if (waitTpadTune(trackpad, false)) {
+		goto exit;
+	}
+
+	for (int cand = 0; cand < NUM_TPAD_TUNE_CANDS; cand++) {
+		TpadTuneResult* result = &results[cand];
+		getTpadTuneCand(cand, &tune);
+		printf("%2d: ", cand);
+		printTpadAdcTune(&tune);
+		printf(": %5d us, SNR %4d%s\n", result->scanUs, 
+			tpadTuneSnr(result), result->clipped ? " (clipped)":"");
+	}
+
+	bool met_target = false;
+	int best = tpadTuneSelect(results, NUM_TPAD_TUNE_CANDS, minSnr, 
+		&met_target);
+	if (best < 0 || dflt_idx < 0 || !results[best].signal || 
+		!results[dflt_idx].signal) {
+		printf("No usable settings found\n");
+		goto exit;
+	}
+	if (!met_target) {
+		printf("No settings met SNR target of %d. Using best SNR\n", 
+			minSnr);
+	}
+
+	getTpadTuneCand(best, &tune);
+	uint32_t sig_scale = (uint32_t)results[best].signal * 
+		TPAD_TUNE_SIG_SCALE_ONE / results[dflt_idx].signal;
+	if (!sig_scale) {
+		sig_scale = 1;
+	} else if (sig_scale > 0xFFFF) {
+		sig_scale = 0xFFFF;
+	}
+	tune.sigScale = sig_scale;
+
+	printf("Using %d: ", best);
+	printTpadAdcTune(&tune);
+	printf("\n");
+
+	retval = setTpadAdcTune(trackpad, &tune, TPAD_TUNE_SRC_TUNED);
+	if (retval) {
+		printf("Failed to save settings to EEPROM (%d)\n", retval);
+	}
+
+exit:
+	if (retval) {
+		applyTpadAdcTune(trackpad, &tpadAdcTunes[trackpad]);
+	}
+	free(results);
+	free(means);
+
+	return retval;
+}
+
+/**
+ * Wait for next frame from Trackpad while checking for key press.
+ *
+ * \param trackpad Specifies which Trackpad to wait on.
+ * \param[inout] seq Sequence number of last frame seen.
+ * \param[out] pos Position from new frame.
+ *
+ * \return 0 when new frame is available. -1 if key was pressed.
+ */
+static int tpadCorrCalWait(Trackpad trackpad, uint32_t* seq, 
+	TrackpadPos* pos) {
+	while (!trackpadGetFramePos(trackpad, seq, pos)) {
+		if (usb_tstc()) {
+			printf("Aborted\n");
+			return -1;
+		}
+		__WFI();
+	}
+
+	return 0;
+}
+
+/**
+ * Guide user through touching calibration points, then build geometric 
+ *  correction grid from where they decoded to. Grid is used right away and 
+ *  is saved to EEPROM.
+ *
+ * \param trackpad Specifies which Trackpad to calibrate.
+ *
+ * \return 0 on success.
+ */
+int tpadCorrCal(Trackpad trackpad) {
+	int32_t xs[TPAD_CORR_NUM_CAL_PTS];
+	int32_t ys[TPAD_CORR_NUM_CAL_PTS];
+	uint32_t seq = 0;
+	TrackpadPos pos;
+
+	if (!tpadSchedEn) {
+		printf("Scan scheduler must be running\n");
+		return -1;
+	}
+
+	for (int pt = 0; pt < TPAD_CORR_NUM_CAL_PTS; pt++) {
+		const char* name = NULL;
+		int32_t x_sum = 0;
+		int32_t y_sum = 0;
+		uint32_t cnt = 0;
+
+		tpadCorrCalTarget(pt, NULL, NULL, &name);
+		printf("Touch and hold %s of %s Trackpad (press any key to "
+			"abort)...\n", name, trackpad == R_TRACKPAD ? "right":"left");
+		usb_flush();
+
+		// Let finger settle, then average (starting over if finger lifts)
+		while (cnt < TPAD_CORR_CAL_SETTLE_FRAMES + TPAD_CORR_CAL_FRAMES) {
+			if (tpadCorrCalWait(trackpad, &seq, &pos)) {
+				return -1;
+			}
+			if (!pos.touch) {
+				cnt = 0;
+				x_sum = 0;
+				y_sum = 0;
+				continue;
+			}
+			cnt++;
+			if (cnt > TPAD_CORR_CAL_SETTLE_FRAMES) {
+				x_sum += pos.xRaw;
+				y_sum += pos.yRaw;
+			}
+		}
+		xs[pt] = x_sum / TPAD_CORR_CAL_FRAMES;
+		ys[pt] = y_sum / TPAD_CORR_CAL_FRAMES;
+
+		printf("  Decoded to %d/%d (1/16 units). Lift finger...\n", 
+			xs[pt], ys[pt]);
+		usb_flush();
+
+		cnt = 0;
+		while (cnt < TPAD_CORR_CAL_LIFT_FRAMES) {
+			if (tpadCorrCalWait(trackpad, &seq, &pos)) {
+				return -1;
+			}
+			cnt = pos.touch ? 0 : cnt + 1;
+		}
+	}
+
+	TpadCorrGrid grid;
+	int ret = tpadCorrBuild(&grid, xs, ys);
+	if (ret == -1) {
+		printf("A point decoded too far from where expected. Wrong spot "
+			"touched?\n");
+		return -1;
+	} else if (ret) {
+		printf("Edge points are not in order around center\n");
+		return -1;
+	}
+
+	return tpadSetCorr(trackpad, &grid, TPAD_CORR_SRC_CALIBRATED);
+}
@@ -0,0 +1,514 @@
+/**
+ * \file trackpad_cmd.c
+ * \brief Encompasses the trackpad console command.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Print command usage details to console.
+ *
+ * \return None.
+ */
+void trackpadCmdUsage(void) {
+	printf(
+		"usage: trackpad monitor\n"
+		"       trackpad getRaw\n"
+		"       trackpad stream\n"
+		"       trackpad readReg left/right addr\n"
+		"       trackpad writeReg left/right addr val\n"
+		"       trackpad bench left/right numFrames\n"
+		"       trackpad sched start targetFps\n"
+		"       trackpad sched stop\n"
+		"       trackpad fps\n"
+		"       trackpad regStats [reset]\n"
+		"       trackpad presence [on/off/reset]\n"
+		"       trackpad presence thresh val\n"
+		"       trackpad baseline [on/off/save]\n"
+		"       trackpad pos\n"
+		"       trackpad contacts\n"
+		"       trackpad filter [on/off]\n"
+		"       trackpad filter minCutoff/beta/dCutoff val\n"
+		"       trackpad gesture [on/off/reset/monitor]\n"
+		"       trackpad gesture flickSpeed/tau/stopSpeed val\n"
+		"       trackpad gesture circleRadius/circleStep val\n"
+		"       trackpad corr [on/off]\n"
+		"       trackpad corr cal/clear left/right\n"
+		"       trackpad comp\n"
+		"       trackpad recal left/right\n"
+		"       trackpad tune\n"
+		"       trackpad tune run left/right [minSnr]\n"
+		"       trackpad tune clear left/right\n"
+		"       trackpad hop [on/off/reset]\n"
+		"       trackpad hop thresh high low\n"
+		"       trackpad mode [left/right anymeas"
+#if TPAD_ABS_MODE_EN
+		"/abs"
+#endif
+		"]\n"
+		"       trackpad modeStats [reset]\n"
+		"       trackpad latency [reset]\n"
+		"\n"
+		"monitor: Monitor X/Y position calculated for each Trackpad\n"
+		"getRaw: print single set of raw ADC readings and compensation\n" 
+		"	data (ideal for inserting into simulations)\n"
+		"stream: send every frame from both Trackpads as binary records\n"
+		"	until a key is pressed (scan scheduler must be running).\n"
+		"	See Firmware/TrackpadTools for decoding captures\n"
+		"readReg/writeReg: Access Trackpad ASIC Regiters\n"
+		"bench: record numFrames (up to 32) frames and time decoding\n"
+		"	them against legacy unrolled decode and multi-touch decode\n"
+		"sched: start (0 = as fast as possible) or stop scan scheduler\n"
+		"	that keeps both Trackpads capturing frames continuously\n"
+		"fps: measure frames per second being captured for each\n"
+		"	Trackpad\n"
+		"regStats: show (or reset) count of register writes sent to\n"
+		"	and skipped by register cache for each Trackpad ASIC\n"
+		"presence: show stats (or enable, disable, reset stats) for\n"
+		"	scan scheduler only running a short presence probe on idle\n"
+		"	Trackpads. thresh sets probe deviation considered a touch\n"
+		"baseline: show (or enable, disable) background tracking of\n"
+		"	compensation values, or save current values to EEPROM\n"
+		"pos: monitor raw and filtered fixed point position for each\n"
+		"	Trackpad (1/16 units)\n"
+		"contacts: monitor up to two fingers (with IDs that stay the\n"
+		"	same while finger is down) for each Trackpad\n"
+		"filter: show (or enable, disable, tune) speed adaptive\n"
+		"	position filter. minCutoff and dCutoff are in mHz. beta is\n"
+		"	mHz of cutoff added per unit/second of speed\n"
+		"gesture: show settings and cycles per frame (or enable,\n"
+		"	disable, reset stats, tune) of flick/inertia and circular\n"
+		"	scroll recognition. monitor prints gestures until a key is\n"
+		"	pressed. Speeds are units/second, tau is ms of inertia\n"
+		"	decay, circleStep is 1/65536 turn per scroll step\n"
+		"corr: show (or enable, disable) geometric correction grids.\n"
+		"	cal guides through touching 9 points to build a grid and\n"
+		"	save it to EEPROM. clear saves a grid that does nothing\n"
+		"comp: show where compensation values came from at boot\n"
+		"recal: force recalibration of compensation values (with no\n"
+		"	input) and save them to EEPROM for next boot\n"
+		"tune: show AnyMeas ADC settings for each Trackpad. run sweeps\n"
+		"	gain, toggle frequency, sample length and aperture, and\n"
+		"	saves fastest settings that meet minSnr (default 20).\n"
+		"	clear goes back to default settings\n"
+		"hop: show noise stats (or enable, disable, reset stats) for\n"
+		"	scan scheduler hopping to another toggle frequency while\n"
+		"	frames are noisy. thresh sets average frame noise that\n"
+		"	starts (high) and stops (low) hopping\n"
+		"mode: show (or set) whether each Trackpad runs in AnyMeas\n"
+		"	mode (firmware decodes raw ADCs) or absolute mode (ASIC\n"
+		"	reports position"
+#if !TPAD_ABS_MODE_EN
+		", needs TPAD_ABS_MODE_EN build option"
+#endif
+		")\n"
+		"modeStats: show (or reset) frame rate, DR to position latency,\n"
+		"	capture time and CPU load for each Trackpad and mode\n"
+		"latency: dump (or reset) histograms of time spent in each\n"
+		"	stage from measurement start to position handed to USB\n"
+		"	report for each Trackpad"
+#if !TPAD_LAT_HIST_EN
+		" (needs TPAD_LAT_HIST_EN build option)"
+#endif
+		"\n"
+	);
+}
+
+/**
+ * Handle trackpad query/control command line function.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
+ */
+int trackpadCmdFnc(int argc, const char* argv[]) {
+
+	if (argc < 2) {
+		trackpadCmdUsage();
+		return -1;
+	}
+
+	if (!strcmp("monitor", argv[1])) {
+		tpadMonitor();
+	} else if (!strcmp("getRaw", argv[1])) {
+		tpadGetRaw();
+	} else if (!strcmp("stream", argv[1])) {
+		return tpadStream();
+	} else if (!strcmp("readReg", argv[1])) {
+		if (argc != 4) {
+			trackpadCmdUsage();
+			return -1;
+		}
+		Trackpad trackpad = R_TRACKPAD;
+		if (!strcmp("left", argv[2])) {
+			trackpad = L_TRACKPAD;
+		}
+		uint32_t addr = strtol(argv[3], NULL, 0);
+
+		printf("Read 0x%02x from register 0x%02x of %s Trackpad.\n",
+			readTpadReg(trackpad, addr), addr, 
+			trackpad == R_TRACKPAD ? "right":"left");
+	} else if (!strcmp("writeReg", argv[1])) {
+		if (argc != 5) {
+			trackpadCmdUsage();
+			return -1;
+		}
+		Trackpad trackpad = R_TRACKPAD;
+		if (!strcmp("left", argv[2])) {
+			trackpad = L_TRACKPAD;
+		}
+		uint32_t addr = strtol(argv[3], NULL, 0);
+		uint32_t val = strtol(argv[4], NULL, 0);
+
+		printf("Writing 0x%02x to register 0x%02x of %s Trackpad.\n",
+			val, addr, trackpad == R_TRACKPAD ? "right":"left");
+		
+		writeTpadReg(trackpad, addr, val);
+	} else if (!strcmp("bench", argv[1])) {
+		if (argc != 4) {
+			trackpadCmdUsage();
+			return -1;
+		}
+		Trackpad trackpad = R_TRACKPAD;
+		if (!strcmp("left", argv[2])) {
+			trackpad = L_TRACKPAD;
+		}
+		uint32_t num_frames = strtol(argv[3], NULL, 0);
+
+		return tpadBench(trackpad, num_frames);
+	} else if (!strcmp("sched", argv[1])) {
+		if (argc == 4 && !strcmp("start", argv[2])) {
+			trackpadSchedStart(strtol(argv[3], NULL, 0));
+		} else if (argc == 3 && !strcmp("stop", argv[2])) {
+			if (trackpadSchedStop()) {
+				printf("Frame in progress did not complete and "
+					"was abandoned.\n");
+				return -1;
+			}
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("fps", argv[1])) {
+		tpadPrintFps();
+	} else if (!strcmp("regStats", argv[1])) {
+		if (argc == 3 && !strcmp("reset", argv[2])) {
+			for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+				tpadRegWrites[tpad] = 0;
+				tpadRegElided[tpad] = 0;
+				tpadRegStatsSeqs[tpad] = trackpadGetFrameSeq(tpad);
+			}
+		} else {
+			tpadPrintRegStats();
+		}
+	} else if (!strcmp("presence", argv[1])) {
+		if (argc == 2) {
+			tpadPrintPresence();
+		} else if (argc == 3 && !strcmp("on", argv[2])) {
+			tpadPresenceEn = true;
+		} else if (argc == 3 && !strcmp("off", argv[2])) {
+			tpadPresenceEn = false;
+		} else if (argc == 3 && !strcmp("reset", argv[2])) {
+			__disable_irq();
+			memset((void*)tpadPresenceStats, 0, 
+				sizeof(tpadPresenceStats));
+			__enable_irq();
+		} else if (argc == 4 && !strcmp("thresh", argv[2])) {
+			tpadPresenceThresh = strtol(argv[3], NULL, 0);
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("baseline", argv[1])) {
+		if (argc == 2) {
+			tpadPrintBaseline();
+		} else if (argc == 3 && !strcmp("on", argv[2])) {
+			tpadBaselineEn = true;
+		} else if (argc == 3 && !strcmp("off", argv[2])) {
+			tpadBaselineEn = false;
+		} else if (argc == 3 && !strcmp("save", argv[2])) {
+			for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+				int16_t comps[NUM_ANYMEAS_ADCS];
+
+				__disable_irq();
+				memcpy(comps, tpadAdcComps[tpad], sizeof(comps));
+				__enable_irq();
+
+				if (tpadCompSave(tpad, comps)) {
+					printf("Failed to save compensation values "
+						"to EEPROM\n");
+					return -1;
+				}
+			}
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("pos", argv[1])) {
+		tpadPosMonitor();
+	} else if (!strcmp("contacts", argv[1])) {
+		tpadContactsMonitor();
+	} else if (!strcmp("filter", argv[1])) {
+		if (argc == 2) {
+			tpadPrintFilt();
+		} else if (argc == 3 && !strcmp("on", argv[2])) {
+			tpadFiltEn = true;
+		} else if (argc == 3 && !strcmp("off", argv[2])) {
+			tpadFiltEn = false;
+		} else if (argc == 4 && !strcmp("minCutoff", argv[2])) {
+			tpadFiltParams.minCutoffMhz = strtol(argv[3], NULL, 0);
+		} else if (argc == 4 && !strcmp("beta", argv[2])) {
+			tpadFiltParams.beta = strtol(argv[3], NULL, 0);
+		} else if (argc == 4 && !strcmp("dCutoff", argv[2])) {
+			tpadFiltParams.dCutoffMhz = strtol(argv[3], NULL, 0);
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("gesture", argv[1])) {
+		if (argc == 2) {
+			tpadPrintGesture();
+		} else if (argc == 3 && !strcmp("on", argv[2])) {
+			tpadGestureEn = true;
+		} else if (argc == 3 && !strcmp("off", argv[2])) {
+			tpadGestureEn = false;
+		} else if (argc == 3 && !strcmp("reset", argv[2])) {
+			__disable_irq();
+			memset((void*)tpadGestureStats, 0, sizeof(tpadGestureStats));
+			__enable_irq();
+		} else if (argc == 3 && !strcmp("monitor", argv[2])) {
+			tpadGestureMonitor();
+		} else if (argc == 4 && !strcmp("flickSpeed", argv[2])) {
+			tpadGestureParams.flickSpeed = strtol(argv[3], NULL, 0);
+		} else if (argc == 4 && !strcmp("tau", argv[2])) {
+			tpadGestureParams.inertiaTauMs = strtol(argv[3], NULL, 0);
+		} else if (argc == 4 && !strcmp("stopSpeed", argv[2])) {
+			tpadGestureParams.stopSpeed = strtol(argv[3], NULL, 0);
+		} else if (argc == 4 && !strcmp("circleRadius", argv[2])) {
+			tpadGestureParams.circleRadius = strtol(argv[3], NULL, 0);
+		} else if (argc == 4 && !strcmp("circleStep", argv[2])) {
+			tpadGestureParams.circleStep = strtol(argv[3], NULL, 0);
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("corr", argv[1])) {
+		if (argc == 2) {
+			tpadPrintCorr();
+		} else if (argc == 3 && !strcmp("on", argv[2])) {
+			tpadCorrEn = true;
+		} else if (argc == 3 && !strcmp("off", argv[2])) {
+			tpadCorrEn = false;
+		} else if (argc == 4 && (!strcmp("cal", argv[2]) || 
+			!strcmp("clear", argv[2]))) {
+			Trackpad trackpad = R_TRACKPAD;
+			if (!strcmp("left", argv[3])) {
+				trackpad = L_TRACKPAD;
+			}
+			if (!strcmp("cal", argv[2])) {
+				return tpadCorrCal(trackpad);
+			}
+
+			TpadCorrGrid grid;
+			tpadCorrIdentity(&grid);
+			return tpadSetCorr(trackpad, &grid, TPAD_CORR_SRC_NONE);
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("comp", argv[1])) {
+		for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+			printf("%s Trackpad: %s compensation values (took %d us)\n",
+				tpad == R_TRACKPAD ? "Right":"Left",
+				tpadCompSrcStr(tpadCompSrcs[tpad]), tpadCompUs[tpad]);
+		}
+	} else if (!strcmp("recal", argv[1])) {
+		if (argc != 3) {
+			trackpadCmdUsage();
+			return -1;
+		}
+		Trackpad trackpad = R_TRACKPAD;
+		if (!strcmp("left", argv[2])) {
+			trackpad = L_TRACKPAD;
+		}
+
+		if (tpadModes[trackpad] != TPAD_MODE_ANYMEAS) {
+			printf("Trackpad must be in AnyMeas mode\n");
+			return -1;
+		}
+
+		printf("Recalibrating %s Trackpad. Do not touch...\n",
+			trackpad == R_TRACKPAD ? "right":"left");
+
+		if (recalTpad(trackpad)) {
+			printf("Failed to save compensation values to EEPROM\n");
+			return -1;
+		}
+		printf("Done (took %d us). Saved to EEPROM.\n", 
+			tpadCompUs[trackpad]);
+	} else if (!strcmp("tune", argv[1])) {
+		if (argc == 2) {
+			tpadPrintTune();
+			return 0;
+		}
+		if (argc < 4 || argc > 5 || (strcmp("run", argv[2]) && 
+			strcmp("clear", argv[2])) || 
+			(argc == 5 && strcmp("run", argv[2]))) {
+			trackpadCmdUsage();
+			return -1;
+		}
+		Trackpad trackpad = R_TRACKPAD;
+		if (!strcmp("left", argv[3])) {
+			trackpad = L_TRACKPAD;
+		}
+		uint32_t min_snr = TPAD_TUNE_DFLT_MIN_SNR;
+		if (argc == 5) {
+			min_snr = strtol(argv[4], NULL, 0);
+		}
+
+		if (tpadModes[trackpad] != TPAD_MODE_ANYMEAS) {
+			printf("Trackpad must be in AnyMeas mode\n");
+			return -1;
+		}
+
+		bool sched_en = tpadSchedEn;
+		trackpadSchedStop();
+
+		int retval = 0;
+		if (!strcmp("run", argv[2])) {
+			retval = tuneTpad(trackpad, min_snr);
+		} else {
+			printf("Recalibrating %s Trackpad. Do not touch...\n",
+				trackpad == R_TRACKPAD ? "right":"left");
+			retval = setTpadAdcTune(trackpad, &TPAD_ADC_TUNE_DFLT, 
+				TPAD_TUNE_SRC_NONE);
+			if (retval) {
+				printf("Failed to save settings to EEPROM (%d)\n", 
+					retval);
+			}
+		}
+
+		if (sched_en) {
+			trackpadSchedStart(tpadSchedFps);
+		}
+
+		if (retval) {
+			return -1;
+		}
+	} else if (!strcmp("hop", argv[1])) {
+		if (argc == 2) {
+			tpadPrintHop();
+		} else if (argc == 3 && !strcmp("on", argv[2])) {
+			tpadHopEn = true;
+		} else if (argc == 3 && !strcmp("off", argv[2])) {
+			tpadHopEn = false;
+		} else if (argc == 3 && !strcmp("reset", argv[2])) {
+			__disable_irq();
+			memset((void*)tpadHopStats, 0, sizeof(tpadHopStats));
+			__enable_irq();
+		} else if (argc == 5 && !strcmp("thresh", argv[2])) {
+			int32_t high = strtol(argv[3], NULL, 0);
+			int32_t low = strtol(argv[4], NULL, 0);
+			if (low > high) {
+				printf("low must not be more than high\n");
+				return -1;
+			}
+			tpadHopHighThresh = high << TPAD_NOISE_FRAC_BITS;
+			tpadHopLowThresh = low << TPAD_NOISE_FRAC_BITS;
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("mode", argv[1])) {
+		if (argc == 2) {
+			for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+				printf("%s Trackpad: %s\n", 
+					tpad == R_TRACKPAD ? "Right":"Left",
+					tpadModes[tpad] == TPAD_MODE_ABS ? 
+					"absolute":"AnyMeas");
+			}
+		} else if (argc == 4) {
+			Trackpad trackpad = R_TRACKPAD;
+			if (!strcmp("left", argv[2])) {
+				trackpad = L_TRACKPAD;
+			}
+
+			TrackpadMode mode = TPAD_MODE_ANYMEAS;
+#if TPAD_ABS_MODE_EN
+			if (!strcmp("abs", argv[3])) {
+				mode = TPAD_MODE_ABS;
+			} else if (strcmp("anymeas", argv[3])) {
+#else
+			if (strcmp("anymeas", argv[3])) {
+#endif
+				trackpadCmdUsage();
+				return -1;
+			}
+
+			int retval = trackpadSetMode(trackpad, mode);
+			if (retval) {
+				printf("Trackpad setup failed (%d)\n", retval);
+				return -1;
+			}
+		} else {
+			trackpadCmdUsage();
+			return -1;
+		}
+	} else if (!strcmp("modeStats", argv[1])) {
+		if (argc == 3 && !strcmp("reset", argv[2])) {
+			__disable_irq();
+			memset((void*)tpadModeStats, 0, sizeof(tpadModeStats));
+			for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+				tpadModeSinceUs[tpad] = getUsTickCnt();
+			}
+			__enable_irq();
+		} else {
+			tpadPrintModeStats();
+		}
+	} else if (!strcmp("latency", argv[1])) {
+#if TPAD_LAT_HIST_EN
+		if (argc == 3 && !strcmp("reset", argv[2])) {
+			__disable_irq();
+			memset((void*)tpadLatHists, 0, sizeof(tpadLatHists));
+			__enable_irq();
+		} else {
+			tpadPrintLatency();
+		}
+#else
+		printf("Needs TPAD_LAT_HIST_EN build option.\n");
+		return -1;
+#endif
+	} else {
+		trackpadCmdUsage();
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * \file trackpad_comp.c
+ * \brief Encompasses storing and retrieving AnyMeas ADC compensation values
+ *	for the Trackpads in EEPROM. Values can come from a versioned record
+ *	saved by this firmware, or from the factory tables left in EEPROM by
+ *	the official firmware. Callers are responsible for checking that 
+ *	loaded values still make sense for the Trackpad.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_comp.h"
+
+#include "trackpad_decode.h"
+#include "eeprom_access.h"
+
+#include <string.h>
+
+#define TPAD_COMP_EEPROM_OFFSET (0xC00) //!< Where first saved record lives.
+	//!< This is just past the space reserved for Jingle Data.
+#define TPAD_COMP_EEPROM_STRIDE (0x40) //!< Space reserved per Trackpad.
+#define TPAD_HOP_COMP_EEPROM_OFFSET (0xDE0) //!< Where first saved record of
+	//!< hop frequency compensation values lives. This is just past the 
+	//!< space reserved for ADC settings.
+#define TPAD_HOP_COMP_EEPROM_STRIDE (0x60) //!< Space reserved per Trackpad.
+
+#define R_TPAD_FACTORY_COMP_OFFSET (0x602) //!< Where official firmware keeps
+	//!< compensation values for Right Trackpad.
+#define L_TPAD_FACTORY_COMP_OFFSET (0x628) //!< Where official firmware keeps
+	//!< compensation values for Left Trackpad.
+
+/**
+ * Compensation values saved in EEPROM by this firmware. Payload is 
+ *  NUM_ANYMEAS_ADCS values.
+ */
+static const EepromRecordDesc TPAD_COMP_RECORD = {
+	.offset = TPAD_COMP_EEPROM_OFFSET,
+	.stride = TPAD_COMP_EEPROM_STRIDE,
+	.magicWord = 0xc0c5,
+	.version = 1, // Bump whenever AnyMeas configuration changes in a way
+		// that invalidates saved values.
+	.len = sizeof(int16_t) * NUM_ANYMEAS_ADCS
+};
+
+/**
+ * Compensation values for hop frequencies saved in EEPROM by this firmware.
+ *  Payload is a TpadHopComps.
+ */
+static const EepromRecordDesc TPAD_HOP_COMP_RECORD = {
+	.offset = TPAD_HOP_COMP_EEPROM_OFFSET,
+	.stride = TPAD_HOP_COMP_EEPROM_STRIDE,
+	.magicWord = 0xc0f5,
+	.version = 1, // Bump whenever AnyMeas configuration changes in a way
+		// that invalidates saved values.
+	.len = sizeof(TpadHopComps)
+};
+
+/**
+ * Check if compensation values look like they could be real (i.e. are not
+ *  erased or cleared EEPROM).
+ *
+ * \param[in] comps Compensation values to check.
+ *
+ * \return 0 if values are plausible.
+ */
+static int checkCompsPlausible(const int16_t* comps) {
+	int num_blank = 0;
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		if (comps[idx] == 0 || comps[idx] == -1) {
+			num_blank++;
+		}
+	}
+
+	if (num_blank == NUM_ANYMEAS_ADCS) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Load compensation values previously saved with tpadCompSave().
+ *
+ * \param trackpad Specifies which Trackpad to load values for.
+ * \param[out] comps Where to store NUM_ANYMEAS_ADCS values. Not modified
+ *	unless load succeeds.
+ *
+ * \return 0 on success. Negative value if no valid record is saved.
+ */
+int tpadCompLoadSaved(Trackpad trackpad, int16_t* comps) {
+	int16_t saved_comps[NUM_ANYMEAS_ADCS];
+
+	int retval = eepromRecordLoad(&TPAD_COMP_RECORD, trackpad, saved_comps);
+	if (retval) {
+		return retval;
+	}
+
+	if (checkCompsPlausible(saved_comps)) {
+		return -5;
+	}
+
+	memcpy(comps, saved_comps, sizeof(saved_comps));
+
+	return 0;
+}
+
+/**
+ * Load factory compensation values left in EEPROM by official firmware.
+ *
+ * \param trackpad Specifies which Trackpad to load values for.
+ * \param[out] comps Where to store NUM_ANYMEAS_ADCS values. Not modified
+ *	unless load succeeds.
+ *
+ * \return 0 on success. Negative value if factory values are not present.
+ */
+int tpadCompLoadFactory(Trackpad trackpad, int16_t* comps) {
+	int16_t factory_comps[NUM_ANYMEAS_ADCS];
+	uint32_t offset = R_TPAD_FACTORY_COMP_OFFSET;
+
+	if (trackpad == L_TRACKPAD) {
+		offset = L_TPAD_FACTORY_COMP_OFFSET;
+	}
+
+	if (eepromRead(offset, factory_comps, sizeof(factory_comps))) {
+		return -1;
+	}
+
+	if (checkCompsPlausible(factory_comps)) {
+		return -2;
+	}
+
+	memcpy(comps, factory_comps, sizeof(factory_comps));
+
+	return 0;
+}
+
+/**
+ * Save compensation values so that they can be loaded on next boot.
+ *
+ * \param trackpad Specifies which Trackpad values are for.
+ * \param[in] comps NUM_ANYMEAS_ADCS compensation values.
+ *
+ * \return 0 on success.
+ */
+int tpadCompSave(Trackpad trackpad, const int16_t* comps) {
+	return eepromRecordSave(&TPAD_COMP_RECORD, trackpad, comps);
+}
+
+/**
+ * Load hop frequency compensation values previously saved with 
+ *  tpadCompSaveHop(). Caller must check values are for the frequencies it
+ *  hops between.
+ *
+ * \param trackpad Specifies which Trackpad to load values for.
+ * \param[out] hopComps Where to store values. Not modified unless load
+ *	succeeds.
+ *
+ * \return 0 on success. Negative value if no valid record is saved.
+ */
+int tpadCompLoadHopSaved(Trackpad trackpad, TpadHopComps* hopComps) {
+	TpadHopComps saved;
+
+	int retval = eepromRecordLoad(&TPAD_HOP_COMP_RECORD, trackpad, &saved);
+	if (retval) {
+		return retval;
+	}
+
+	for (int idx = 0; idx < NUM_TPAD_HOP_ALT_FREQS; idx++) {
+		if (checkCompsPlausible(saved.comps[idx])) {
+			return -5;
+		}
+	}
+
+	*hopComps = saved;
+
+	return 0;
+}
+
+/**
+ * Save hop frequency compensation values so that they can be loaded on next
+ *  boot.
+ *
+ * \param trackpad Specifies which Trackpad values are for.
+ * \param[in] hopComps Values to save.
+ *
+ * \return 0 on success.
+ */
+int tpadCompSaveHop(Trackpad trackpad, const TpadHopComps* hopComps) {
+	return eepromRecordSave(&TPAD_HOP_COMP_RECORD, trackpad, hopComps);
+}
+
+/**
+ * Get human readable name for source of compensation values.
+ *
+ * \param src Source of compensation values.
+ *
+ * \return Name of source.
+ */
+const char* tpadCompSrcStr(TpadCompSrc src) {
+	switch (src) {
+	case TPAD_COMP_SRC_SAVED:
+		return "saved";
+	case TPAD_COMP_SRC_FACTORY:
+		return "factory";
+	case TPAD_COMP_SRC_CALIBRATED:
+		return "calibrated";
+	default:
+		break;
+	}
+	return "none";
+}
@@ -0,0 +1,387 @@
+/**
+ * \file trackpad_corr.c
+ * \brief Encompasses geometric correction (i.e. skew and edge linearity) of
+ *	Trackpad positions. A small grid of offsets is applied using integer 
+ *	bilinear interpolation, so correcting a position only costs a handful
+ *	of multiplies. Grids are built from a short calibration (touching the
+ *	center and 8 points around the edge of the Trackpad) and are saved in
+ *	EEPROM.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_corr.h"
+
+#include "eeprom_access.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define TPAD_CORR_EEPROM_OFFSET (0xC80) //!< Where first saved record lives.
+	//!< This is just past the space reserved for compensation values.
+#define TPAD_CORR_EEPROM_STRIDE (0xA0) //!< Space reserved per Trackpad.
+
+#define CORR_FRAC_BITS (8) //!< Fractional bits of position within a cell.
+#define CORR_ONE (1 << CORR_FRAC_BITS) //!< 1.0 in cell fractional units.
+
+#define CORR_MAX_X_Q (TPAD_MAX_X << TPAD_POS_FRAC_BITS) //!< Largest X 
+	//!< position in fixed point.
+#define CORR_MAX_Y_Q (TPAD_MAX_Y << TPAD_POS_FRAC_BITS) //!< Largest Y 
+	//!< position in fixed point.
+#define CORR_X_SCALE ((TPAD_CORR_CELLS_X << (CORR_FRAC_BITS + 16)) / \
+	CORR_MAX_X_Q + 1) //!< Multiply by this and shift right by 16 to convert
+	//!< X position to cells (with CORR_FRAC_BITS fractional bits).
+#define CORR_Y_SCALE ((TPAD_CORR_CELLS_Y << (CORR_FRAC_BITS + 16)) / \
+	CORR_MAX_Y_Q + 1) //!< Multiply by this and shift right by 16 to convert
+	//!< Y position to cells (with CORR_FRAC_BITS fractional bits).
+
+#define CAL_RIM_PCT (85) //!< How far (percent of half of range) toward the 
+	//!< edge the centroid of a finger pressed against the edge should be.
+#define CAL_RIM_X ((TPAD_MAX_X / 2) * CAL_RIM_PCT / 100) //!< X distance from
+	//!< center of calibration points on edge.
+#define CAL_RIM_Y ((TPAD_MAX_Y / 2) * CAL_RIM_PCT / 100) //!< Y distance from
+	//!< center of calibration points on edge.
+#define CAL_MIN_CROSS (TPAD_MAX_X * TPAD_MAX_Y / 64) //!< Smallest cross 
+	//!< product (i.e. twice area of triangle) allowed between center and 
+	//!< neighbouring edge calibration points.
+#define CAL_DIAG(val) ((val) * 181 / 256) //!< Scale by cos(45 degrees).
+
+/**
+ * Where each calibration point should decode to (in whole units). Center 
+ *  first, then counter clockwise around edge starting at right.
+ */
+static const int16_t CAL_TARGETS[TPAD_CORR_NUM_CAL_PTS][2] = {
+	{TPAD_MAX_X / 2, TPAD_MAX_Y / 2},
+	{TPAD_MAX_X / 2 + CAL_RIM_X, TPAD_MAX_Y / 2},
+	{TPAD_MAX_X / 2 + CAL_DIAG(CAL_RIM_X), 
+		TPAD_MAX_Y / 2 + CAL_DIAG(CAL_RIM_Y)},
+	{TPAD_MAX_X / 2, TPAD_MAX_Y / 2 + CAL_RIM_Y},
+	{TPAD_MAX_X / 2 - CAL_DIAG(CAL_RIM_X), 
+		TPAD_MAX_Y / 2 + CAL_DIAG(CAL_RIM_Y)},
+	{TPAD_MAX_X / 2 - CAL_RIM_X, TPAD_MAX_Y / 2},
+	{TPAD_MAX_X / 2 - CAL_DIAG(CAL_RIM_X), 
+		TPAD_MAX_Y / 2 - CAL_DIAG(CAL_RIM_Y)},
+	{TPAD_MAX_X / 2, TPAD_MAX_Y / 2 - CAL_RIM_Y},
+	{TPAD_MAX_X / 2 + CAL_DIAG(CAL_RIM_X), 
+		TPAD_MAX_Y / 2 - CAL_DIAG(CAL_RIM_Y)},
+};
+
+/**
+ * Where user is asked to touch for each calibration point.
+ */
+static const char* const CAL_NAMES[TPAD_CORR_NUM_CAL_PTS] = {
+	"center", "right edge", "top right edge", "top edge", "top left edge",
+	"left edge", "bottom left edge", "bottom edge", "bottom right edge"
+};
+
+/**
+ * Correction grid saved in EEPROM by this firmware. Payload is a 
+ *  TpadCorrGrid.
+ */
+static const EepromRecordDesc TPAD_CORR_RECORD = {
+	.offset = TPAD_CORR_EEPROM_OFFSET,
+	.stride = TPAD_CORR_EEPROM_STRIDE,
+	.magicWord = 0xc0aa,
+	.version = 1, // Bump whenever grid layout changes in a way that
+		// invalidates saved values.
+	.len = sizeof(TpadCorrGrid)
+};
+
+/**
+ * Limit value to range.
+ *
+ * \param val Value to limit.
+ * \param min Smallest allowed value.
+ * \param max Largest allowed value.
+ *
+ * \return Limited value.
+ */
+static inline int32_t clampVal(int32_t val, int32_t min, int32_t max) {
+	if (val < min) {
+		return min;
+	}
+	if (val > max) {
+		return max;
+	}
+	return val;
+}
+
+/**
+ * Set grid so that it makes no changes to positions.
+ *
+ * \param[out] grid Grid to clear.
+ *
+ * \return None.
+ */
+void tpadCorrIdentity(TpadCorrGrid* grid) {
+	memset(grid, 0, sizeof(*grid));
+}
+
+/**
+ * Correct position using bilinear interpolation of offsets at the four grid
+ *  nodes around it.
+ *
+ * \param[in] grid Correction offsets.
+ * \param[inout] xPos X position (TPAD_POS_FRAC_BITS fixed point).
+ * \param[inout] yPos Y position (TPAD_POS_FRAC_BITS fixed point).
+ *
+ * \return None.
+ */
+void tpadCorrApply(const TpadCorrGrid* grid, int32_t* xPos, int32_t* yPos) {
+	int32_t x = clampVal(*xPos, 0, CORR_MAX_X_Q);
+	int32_t y = clampVal(*yPos, 0, CORR_MAX_Y_Q);
+
+	// Multiply by reciprocal rather than divide by cell size
+	int32_t u = (x * CORR_X_SCALE) >> 16;
+	int32_t v = (y * CORR_Y_SCALE) >> 16;
+	int col = u >> CORR_FRAC_BITS;
+	int row = v >> CORR_FRAC_BITS;
+	int32_t fx = u & (CORR_ONE - 1);
+	int32_t fy = v & (CORR_ONE - 1);
+	if (col >= TPAD_CORR_CELLS_X) {
+		col = TPAD_CORR_CELLS_X - 1;
+		fx = CORR_ONE;
+	}
+	if (row >= TPAD_CORR_CELLS_Y) {
+		row = TPAD_CORR_CELLS_Y - 1;
+		fy = CORR_ONE;
+	}
+
+	const int16_t* dxs0 = &grid->dxs[row][col];
+	const int16_t* dxs1 = &grid->dxs[row + 1][col];
+	const int16_t* dys0 = &grid->dys[row][col];
+	const int16_t* dys1 = &grid->dys[row + 1][col];
+
+	int32_t dx = (dxs0[0] * (CORR_ONE - fx) + dxs0[1] * fx) * 
+		(CORR_ONE - fy) + (dxs1[0] * (CORR_ONE - fx) + dxs1[1] * fx) * fy;
+	int32_t dy = (dys0[0] * (CORR_ONE - fx) + dys0[1] * fx) * 
+		(CORR_ONE - fy) + (dys1[0] * (CORR_ONE - fx) + dys1[1] * fx) * fy;
+
+	const int32_t round = 1 << (2 * CORR_FRAC_BITS - 1);
+	*xPos = clampVal(x + ((dx + round) >> (2 * CORR_FRAC_BITS)), 0, 
+		CORR_MAX_X_Q);
+	*yPos = clampVal(y + ((dy + round) >> (2 * CORR_FRAC_BITS)), 0, 
+		CORR_MAX_Y_Q);
+}
+
+/**
+ * Get details on a calibration point.
+ *
+ * \param idx Which calibration point (0 to TPAD_CORR_NUM_CAL_PTS-1).
+ * \param[out] xPos Where point should decode to (TPAD_POS_FRAC_BITS fixed
+ *	point). May be NULL.
+ * \param[out] yPos Where point should decode to (TPAD_POS_FRAC_BITS fixed
+ *	point). May be NULL.
+ * \param[out] name Where user should touch. May be NULL.
+ *
+ * \return None.
+ */
+void tpadCorrCalTarget(int idx, int32_t* xPos, int32_t* yPos, 
+	const char** name) {
+	if (xPos) {
+		*xPos = CAL_TARGETS[idx][0] << TPAD_POS_FRAC_BITS;
+	}
+	if (yPos) {
+		*yPos = CAL_TARGETS[idx][1] << TPAD_POS_FRAC_BITS;
+	}
+	if (name) {
+		*name = CAL_NAMES[idx];
+	}
+}
+
+/**
+ * Compute 2D cross product of vectors from center point to two points.
+ *
+ * \param[in] xs X values (center at index 0).
+ * \param[in] ys Y values (center at index 0).
+ * \param a Index of first point.
+ * \param b Index of second point.
+ *
+ * \return Cross product (positive if b is counter clockwise from a).
+ */
+static inline int32_t calCross(const int32_t* xs, const int32_t* ys, int a,
+	int b) {
+	return (xs[a] - xs[0]) * (ys[b] - ys[0]) - 
+		(ys[a] - ys[0]) * (xs[b] - xs[0]);
+}
+
+/**
+ * Build correction grid from decoded positions of calibration points. The
+ *  center and edge points split the Trackpad into 8 triangles. Offset at 
+ *  each grid node is interpolated (using barycentric weights) from the 
+ *  offsets of the corners of the triangle it falls in. Nodes beyond the edge
+ *  points use offsets interpolated along the edge.
+ *
+ * \param[out] grid Where to store built grid. Not modified unless build 
+ *	succeeds.
+ * \param[in] xPoss Decoded X position (TPAD_POS_FRAC_BITS fixed point) of
+ *	each of TPAD_CORR_NUM_CAL_PTS calibration points.
+ * \param[in] yPoss Decoded Y position (TPAD_POS_FRAC_BITS fixed point) of
+ *	each of TPAD_CORR_NUM_CAL_PTS calibration points.
+ *
+ * \return 0 on success. -1 if a point needs too large an offset (i.e. 
+ *	wrong spot touched). -2 if points are not in order around center.
+ */
+int tpadCorrBuild(TpadCorrGrid* grid, const int32_t* xPoss, 
+	const int32_t* yPoss) {
+	const int num_rim = TPAD_CORR_NUM_CAL_PTS - 1;
+	// Extra entry for grid node being worked on
+	int32_t xs[TPAD_CORR_NUM_CAL_PTS + 1];
+	int32_t ys[TPAD_CORR_NUM_CAL_PTS + 1];
+	int32_t dxs[TPAD_CORR_NUM_CAL_PTS];
+	int32_t dys[TPAD_CORR_NUM_CAL_PTS];
+	TpadCorrGrid new_grid;
+
+	for (int idx = 0; idx < TPAD_CORR_NUM_CAL_PTS; idx++) {
+		int32_t tgt_x = 0;
+		int32_t tgt_y = 0;
+		tpadCorrCalTarget(idx, &tgt_x, &tgt_y, NULL);
+		dxs[idx] = tgt_x - xPoss[idx];
+		dys[idx] = tgt_y - yPoss[idx];
+		if (dxs[idx] < -TPAD_CORR_MAX_OFFSET || 
+			dxs[idx] > TPAD_CORR_MAX_OFFSET ||
+			dys[idx] < -TPAD_CORR_MAX_OFFSET || 
+			dys[idx] > TPAD_CORR_MAX_OFFSET) {
+			return -1;
+		}
+		// Whole units are plenty for working out weights and keep
+		//  cross products well clear of overflow
+		xs[idx] = xPoss[idx] >> TPAD_POS_FRAC_BITS;
+		ys[idx] = yPoss[idx] >> TPAD_POS_FRAC_BITS;
+	}
+
+	for (int idx = 1; idx <= num_rim; idx++) {
+		int next = idx % num_rim + 1;
+		if (calCross(xs, ys, idx, next) < CAL_MIN_CROSS) {
+			return -2;
+		}
+	}
+
+	const int node = TPAD_CORR_NUM_CAL_PTS;
+	for (int row = 0; row < TPAD_CORR_NODES_Y; row++) {
+		for (int col = 0; col < TPAD_CORR_NODES_X; col++) {
+			xs[node] = col * TPAD_MAX_X / TPAD_CORR_CELLS_X;
+			ys[node] = row * TPAD_MAX_Y / TPAD_CORR_CELLS_Y;
+
+			// Find triangle (i.e. center and two edge points) node
+			//  falls in
+			int rim0 = 1;
+			int rim1 = 2;
+			for (int idx = 1; idx <= num_rim; idx++) {
+				int next = idx % num_rim + 1;
+				if (calCross(xs, ys, idx, node) >= 0 &&
+					calCross(xs, ys, node, next) >= 0) {
+					rim0 = idx;
+					rim1 = next;
+					break;
+				}
+			}
+
+			int32_t det = calCross(xs, ys, rim0, rim1);
+			int32_t w0 = calCross(xs, ys, node, rim1) * CORR_ONE / det;
+			int32_t w1 = calCross(xs, ys, rim0, node) * CORR_ONE / det;
+			w0 = w0 < 0 ? 0 : w0;
+			w1 = w1 < 0 ? 0 : w1;
+			if (w0 + w1 > CORR_ONE) {
+				// Beyond edge, so stick to edge
+				w0 = w0 * CORR_ONE / (w0 + w1);
+				w1 = CORR_ONE - w0;
+			}
+			int32_t wc = CORR_ONE - w0 - w1;
+
+			int32_t dx = wc * dxs[0] + w0 * dxs[rim0] + w1 * dxs[rim1];
+			int32_t dy = wc * dys[0] + w0 * dys[rim0] + w1 * dys[rim1];
+			new_grid.dxs[row][col] = (dx + CORR_ONE / 2) >> 
+				CORR_FRAC_BITS;
+			new_grid.dys[row][col] = (dy + CORR_ONE / 2) >> 
+				CORR_FRAC_BITS;
+		}
+	}
+
+	*grid = new_grid;
+
+	return 0;
+}
+
+/**
+ * Load correction grid previously saved with tpadCorrSave().
+ *
+ * \param trackpad Specifies which Trackpad to load grid for.
+ * \param[out] grid Where to store grid. Not modified unless load succeeds.
+ *
+ * \return 0 on success. Negative value if no valid record is saved.
+ */
+int tpadCorrLoadSaved(Trackpad trackpad, TpadCorrGrid* grid) {
+	TpadCorrGrid saved_grid;
+
+	int retval = eepromRecordLoad(&TPAD_CORR_RECORD, trackpad, &saved_grid);
+	if (retval) {
+		return retval;
+	}
+
+	for (int row = 0; row < TPAD_CORR_NODES_Y; row++) {
+		for (int col = 0; col < TPAD_CORR_NODES_X; col++) {
+			if (saved_grid.dxs[row][col] < -TPAD_CORR_MAX_OFFSET ||
+				saved_grid.dxs[row][col] > TPAD_CORR_MAX_OFFSET ||
+				saved_grid.dys[row][col] < -TPAD_CORR_MAX_OFFSET ||
+				saved_grid.dys[row][col] > TPAD_CORR_MAX_OFFSET) {
+				return -5;
+			}
+		}
+	}
+
+	*grid = saved_grid;
+
+	return 0;
+}
+
+/**
+ * Save correction grid so that it can be loaded on next boot.
+ *
+ * \param trackpad Specifies which Trackpad grid is for.
+ * \param[in] grid Correction offsets.
+ *
+ * \return 0 on success.
+ */
+int tpadCorrSave(Trackpad trackpad, const TpadCorrGrid* grid) {
+	return eepromRecordSave(&TPAD_CORR_RECORD, trackpad, grid);
+}
+
+/**
+ * Get human readable name for source of correction grid.
+ *
+ * \param src Source of correction grid.
+ *
+ * \return Name of source.
+ */
+const char* tpadCorrSrcStr(TpadCorrSrc src) {
+	switch (src) {
+	case TPAD_CORR_SRC_SAVED:
+		return "saved";
+	case TPAD_CORR_SRC_CALIBRATED:
+		return "calibrated";
+	default:
+		break;
+	}
+	return "none";
+}
@@ -0,0 +1,1307 @@
+/**
+ * \file trackpad_decode.c
+ * \brief Encompasses functions for converting AnyMeas ADC readings from a
+ *	Trackpad ASIC into X/Y locations. Nothing here touches hardware, so
+ *	this can also be built and run on a host PC.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_decode.h"
+
+#include <stddef.h>
+
+typedef void (*TpadDemodFnc)(const int32_t* meas, int32_t* bins);
+
+/**
+ * Everything needed to turn the AnyMeas ADC readings for one axis into a
+ *  position.
+ */
+typedef struct TpadAxisCfg {
+	uint8_t adcIdx; //!< Index of first AnyMeas ADC used for this axis.
+	uint8_t numMeas; //!< Number of AnyMeas ADCs demodulated into profile.
+	uint8_t numBins; //!< Number of values in the demodulated profile.
+	uint8_t scale; //!< Clamped profile values are multiplied by scale/4.
+	int16_t flipPos; //!< If non-zero position is reported as flipPos - pos.
+	const uint16_t* signMasks; //!< One entry per measurement. Bit n set
+		//!< means the measurement is subtracted from profile value n,
+		//!< otherwise it is added.
+	TpadDemodFnc demod; //!< Fast demodulation taking advantage of the
+		//!< structure of the sign pattern.
+} TpadAxisCfg;
+
+/**
+ * Sign patterns for X axis measurements. This is based on simulation of
+ *  official firmware. Rows form a 12x12 Hadamard matrix (Paley construction,
+ *  with the all-ones row not being measured): the first 11 columns are a
+ *  circulant of the quadratic residues mod 11 and the last column is all
+ *  negative.
+ */
+static const uint16_t X_SIGN_MASKS[NUM_ANYMEAS_X_ADCS] = {
+	0x0dc4, 0x0b89, 0x0f12, 0x0e25, 0x0c4b, 0x0897,
+	0x092e, 0x0a5c, 0x0cb8, 0x0971, 0x0ae2
+};
+
+/**
+ * Sign patterns for Y axis measurements. This is based on simulation of
+ *  official firmware. Rows 1-7 of an 8x8 Walsh-Hadamard matrix (with a sign
+ *  flip applied to some rows). Last Y ADC (i.e. sample [18]) is not used.
+ */
+static const uint16_t Y_SIGN_MASKS[NUM_ANYMEAS_Y_ADCS - 1] = {
+	0x0055, 0x0033, 0x0066, 0x000f, 0x005a, 0x003c, 0x0069
+};
+
+/**
+ * Demodulate X measurements by exploiting circulant structure of sign
+ *  pattern. For columns 0-10 the positive entries of row m sit at offsets
+ *  {0, 1, 3, 4, 5, 9} from m (mod 11), so each value is twice the sum of 6
+ *  measurements minus the sum of all of them. Column 11 is always negative.
+ *
+ * \param[in] meas Compensated X measurements.
+ * \param[out] bins X profile.
+ *
+ * \return None.
+ */
+static void demodX(const int32_t* meas, int32_t* bins) {
+	// Two copies back to back so (j - offset) mod 11 never needs a mod
+	int32_t dbl[2 * NUM_ANYMEAS_X_ADCS];
+	int32_t total = 0;
+
+	for (int idx = 0; idx < NUM_ANYMEAS_X_ADCS; idx++) {
+		dbl[idx] = meas[idx];
+		dbl[idx + NUM_ANYMEAS_X_ADCS] = meas[idx];
+		total += meas[idx];
+	}
+
+	for (int idx = 0; idx < NUM_ANYMEAS_X_ADCS; idx++) {
+		const int32_t* w = &dbl[idx + NUM_ANYMEAS_X_ADCS];
+		int32_t pos = w[0] + w[-1] + w[-3] + w[-4] + w[-5] + w[-9];
+		bins[idx] = 2 * pos - total;
+	}
+
+	bins[NUM_ANYMEAS_X_ADCS] = -total;
+}
+
+/**
+ * Demodulate Y measurements with an 8 point fast Walsh-Hadamard transform
+ *  (i.e. 3 butterfly stages).
+ *
+ * \param[in] meas Compensated Y measurements.
+ * \param[out] bins Y profile.
+ *
+ * \return None.
+ */
+static void demodY(const int32_t* meas, int32_t* bins) {
+	// Measurement n corresponds to Walsh-Hadamard row n+1. Sign of the row
+	//  is given by its first column
+	bins[0] = 0;
+	for (int idx = 0; idx < NUM_ANYMEAS_Y_ADCS - 1; idx++) {
+		bins[idx + 1] = (Y_SIGN_MASKS[idx] & 1) ? -meas[idx] : meas[idx];
+	}
+
+	for (int half = 1; half < NUM_TPAD_Y_BINS; half <<= 1) {
+		for (int blk = 0; blk < NUM_TPAD_Y_BINS; blk += 2 * half) {
+			for (int idx = blk; idx < blk + half; idx++) {
+				int32_t a = bins[idx];
+				int32_t b = bins[idx + half];
+				bins[idx] = a + b;
+				bins[idx + half] = a - b;
+			}
+		}
+	}
+}
+
+static const TpadAxisCfg AXIS_CFGS[2] = {
+	[TPAD_AXIS_X] = {
+		.adcIdx = 0,
+		.numMeas = NUM_ANYMEAS_X_ADCS,
+		.numBins = NUM_TPAD_X_BINS,
+		.scale = 4,
+		.flipPos = 1200,
+		.signMasks = X_SIGN_MASKS,
+		.demod = demodX
+	},
+	[TPAD_AXIS_Y] = {
+		.adcIdx = NUM_ANYMEAS_X_ADCS,
+		.numMeas = NUM_ANYMEAS_Y_ADCS - 1,
+		.numBins = NUM_TPAD_Y_BINS,
+		.scale = 5,
+		.flipPos = 0,
+		.signMasks = Y_SIGN_MASKS,
+		.demod = demodY
+	},
+};
+
+/**
+ * Check if profile looks like a single finger is down.
+ *
+ * At this point the difference in ajacent profile values shows one period of
+ *  a sine wave for each detected finger (but maybe can only distinguish
+ *  between two fingers). All other differences are 0. If we see anything
+ *  other than a single finger down, we treat it as though no fingers are
+ *  down (see findAxisContacts() for two finger support).
+ *
+ * \param[in] bins Profile (with negative values already clamped to 0).
+ * \param numBins Number of values in bins.
+ *
+ * \return Non-zero if exactly one finger is down.
+ */
+static int isSingleTouch(const int32_t* bins, int numBins) {
+	// This has to do with searching across adjacent profile values in
+	//  search of sine wave(s) representing down fingers
+	enum TransitionState {
+		WAIT_FOR_0_TO_P, // Searching for start of sine wave
+			// representing down finger
+		WAIT_FOR_P_TO_N, // Searching for zero crossing in sine wave
+			// representing donw finger
+		WAIT_FOR_N_TO_0, // Searching for end of sine wave
+			// representing down finger
+		WAIT_FOR_END, // Waiting for end of data (i.e. expecting nothing
+			// but 0's from this point out).
+		POS_INVALID // Something went "wrong" (i.e. no finger down or
+			// multiple down).
+	};
+
+	enum TransitionState transition_state = WAIT_FOR_0_TO_P;
+
+	if (bins[0] > 0) {
+		transition_state = WAIT_FOR_P_TO_N;
+	} else if (bins[0] < 0) {
+		return 0;
+	}
+
+	for (int idx = 0; idx < numBins - 1; idx++) {
+		int32_t diff = bins[idx+1] - bins[idx];
+		if (transition_state == WAIT_FOR_0_TO_P) {
+			if (diff > 0) {
+				transition_state = WAIT_FOR_P_TO_N;
+			} else if (diff < 0) {
+				return 0;
+			}
+		} else if (transition_state == WAIT_FOR_P_TO_N) {
+			if (diff < 0) {
+				transition_state = WAIT_FOR_N_TO_0;
+			} else if (diff == 0) {
+				return 0;
+			}
+		} else if (transition_state == WAIT_FOR_N_TO_0) {
+			if (diff == 0) {
+				transition_state = WAIT_FOR_END;
+			} else if (diff > 0) {
+				return 0;
+			}
+		} else if (transition_state == WAIT_FOR_END) {
+			// Should only get 0 differences if waiting for end
+			if (diff != 0) {
+				return 0;
+			}
+		}
+	}
+
+	return transition_state == WAIT_FOR_N_TO_0
+		|| transition_state == WAIT_FOR_END;
+}
+
+/**
+ * Compensate and demodulate measurements for an axis.
+ *
+ * \param[in] cfg Axis details.
+ * \param demod Function used to demodulate measurements into profile.
+ * \param[in] adcs All AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] bins Demodulated profile. Must have room for cfg->numBins
+ *	values.
+ *
+ * \return None.
+ */
+static void demodAxis(const TpadAxisCfg* cfg, TpadDemodFnc demod,
+	const volatile int16_t* adcs, const int16_t* comps, int32_t* bins) {
+	int32_t meas[NUM_ANYMEAS_X_ADCS];
+
+	for (int idx = 0; idx < cfg->numMeas; idx++) {
+		meas[idx] = adcs[cfg->adcIdx + idx] - comps[cfg->adcIdx + idx];
+	}
+
+	demod(meas, bins);
+}
+
+/**
+ * Demodulate measurements for an axis into profile, with negative values 
+ *  clamped to 0 and scaling applied.
+ *
+ * \param[in] cfg Axis details.
+ * \param demod Function used to demodulate measurements into profile.
+ * \param[in] adcs All AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] bins Profile. Must have room for cfg->numBins values.
+ *
+ * \return None.
+ */
+static void profileAxis(const TpadAxisCfg* cfg, TpadDemodFnc demod,
+	const volatile int16_t* adcs, const int16_t* comps, int32_t* bins) {
+	demodAxis(cfg, demod, adcs, comps, bins);
+
+	for (int idx = 0; idx < cfg->numBins; idx++) {
+		if (bins[idx] < 0) {
+			bins[idx] = 0;
+		}
+		bins[idx] = (cfg->scale * bins[idx]) >> 2;
+	}
+}
+
+/**
+ * Compute centroid of a section of a profile.
+ *
+ * \param[in] cfg Axis details.
+ * \param[in] bins Profile (with negative values already clamped to 0).
+ * \param start First profile value in section.
+ * \param end Last profile value in section.
+ * \param halfIdx Index of profile value that only counts half (i.e. valley
+ *	shared with another section). -1 if none.
+ * \param[out] strength Sum of profile values in section. May be NULL.
+ *
+ * \return Position (with TPAD_POS_FRAC_BITS fractional bits) or
+ *	TPAD_POS_INVALID.
+ */
+static int32_t calcCentroid(const TpadAxisCfg* cfg, const int32_t* bins,
+	int start, int end, int halfIdx, int32_t* strength) {
+	int32_t dividend = 0;
+	int32_t divisor = 0;
+	int32_t factor = start * 100;
+	for (int idx = start; idx <= end; idx++) {
+		int32_t val = idx == halfIdx ? bins[idx] >> 1 : bins[idx];
+		dividend += factor * val;
+		divisor += val;
+		factor += 100;
+	}
+
+	if (strength) {
+		*strength = divisor;
+	}
+
+	if (!divisor) {
+		return TPAD_POS_INVALID;
+	}
+
+	// Remainder is less than divisor, so fractional bits can be worked out
+	//  without risk of dividend overflowing
+	int32_t pos = (dividend / divisor) << TPAD_POS_FRAC_BITS;
+	pos += ((dividend % divisor) << TPAD_POS_FRAC_BITS) / divisor;
+	if (cfg->flipPos) {
+		pos = (cfg->flipPos << TPAD_POS_FRAC_BITS) - pos;
+	}
+
+	return pos;
+}
+
+/**
+ * Demodulate, validate and compute centroid for an axis.
+ *
+ * \param[in] cfg Axis details.
+ * \param demod Function used to demodulate measurements into profile.
+ * \param[in] adcs All AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] bins Demodulated profile. Must have room for cfg->numBins
+ *	values.
+ *
+ * \return Position (with TPAD_POS_FRAC_BITS fractional bits) or
+ *	TPAD_POS_INVALID.
+ */
+static int32_t decodeAxis(const TpadAxisCfg* cfg, TpadDemodFnc demod,
+	const volatile int16_t* adcs, const int16_t* comps, int32_t* bins) {
+	profileAxis(cfg, demod, adcs, comps, bins);
+
+	if (!isSingleTouch(bins, cfg->numBins)) {
+		return TPAD_POS_INVALID;
+	}
+
+	return calcCentroid(cfg, bins, 0, cfg->numBins - 1, -1, NULL);
+}
+
+/**
+ * Round fixed point position to nearest integer.
+ *
+ * \param posQ Position with TPAD_POS_FRAC_BITS fractional bits, or
+ *	TPAD_POS_INVALID.
+ *
+ * \return Integer position or TPAD_POS_INVALID.
+ */
+static inline int32_t roundPos(int32_t posQ) {
+	if (posQ < 0) {
+		return TPAD_POS_INVALID;
+	}
+
+	return (posQ + (1 << (TPAD_POS_FRAC_BITS - 1))) >> TPAD_POS_FRAC_BITS;
+}
+
+/**
+ * Convert AnyMeas ADC values to position along one axis.
+ *
+ * \param axis Which axis to decode.
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] bins Demodulated profile (i.e. for debug or further
+ *	processing). Must have room for NUM_TPAD_MAX_BINS values.
+ *
+ * \return Position (X 0-1200, 0 is left. Y 0-700, 0 is bottom) or
+ *	TPAD_POS_INVALID if a single finger is not down.
+ */
+int32_t tpadDecodeAxis(TpadAxis axis, const volatile int16_t* adcs,
+	const int16_t* comps, int32_t* bins) {
+	const TpadAxisCfg* cfg = &AXIS_CFGS[axis];
+
+	return roundPos(decodeAxis(cfg, cfg->demod, adcs, comps, bins));
+}
+
+/**
+ * Same as tpadDecodeAxis(), but keeps fractional part of position.
+ *
+ * \param axis Which axis to decode.
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] bins Demodulated profile. Must have room for NUM_TPAD_MAX_BINS
+ *	values.
+ *
+ * \return Position with TPAD_POS_FRAC_BITS fractional bits or 
+ *	TPAD_POS_INVALID.
+ */
+int32_t tpadDecodeAxisQ(TpadAxis axis, const volatile int16_t* adcs,
+	const int16_t* comps, int32_t* bins) {
+	const TpadAxisCfg* cfg = &AXIS_CFGS[axis];
+
+	return decodeAxis(cfg, cfg->demod, adcs, comps, bins);
+}
+
+/**
+ * Convert AnyMeas ADC values to X/Y position of a single finger.
+ *
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] xPos X position with TPAD_POS_FRAC_BITS fractional bits. Only
+ *	updated if finger is down.
+ * \param[out] yPos Y position with TPAD_POS_FRAC_BITS fractional bits. Only
+ *	updated if finger is down.
+ *
+ * \return True if a single finger is down.
+ */
+bool tpadDecodePos(const volatile int16_t* adcs, const int16_t* comps,
+	int32_t* xPos, int32_t* yPos) {
+	int32_t bins[NUM_TPAD_MAX_BINS];
+
+	int32_t x_pos = tpadDecodeAxisQ(TPAD_AXIS_X, adcs, comps, bins);
+	if (x_pos < 0) {
+		return false;
+	}
+	int32_t y_pos = tpadDecodeAxisQ(TPAD_AXIS_Y, adcs, comps, bins);
+
+	if (x_pos > 0 && y_pos > 0)  {
+		*xPos = x_pos;
+		*yPos = y_pos;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Convert AnyMeas ADC values to X/Y location using the hand unrolled decode
+ *  trackpadGetLastXY() shipped with before the table driven kernel. Kept
+ *  verbatim (other than taking ADC and compensation values as arguments) so 
+ *  the kernel can be checked and benchmarked against what it replaced. Do 
+ *  not clean this up.
+ *
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] xPos X location (0-1200, truncated). Negative if finger is not
+ *	down.
+ * \param[out] yPos Y location (0-700, truncated). Negative if finger is not
+ *	down or X decode already failed.
+ *
+ * \return None.
+ */
+void tpadDecodeLegacy(const volatile int16_t* adcs, const int16_t* comps,
+	int32_t* xPos, int32_t* yPos) {
+
+	// Calculate xLoc
+	int32_t adc_vals_x[12];
+
+	// This is based on simulation of official firmware. Cannot say I
+	//  understand it...
+	int32_t compensated_val = adcs[0] - comps[0];
+	adc_vals_x[0] = compensated_val;
+	adc_vals_x[1] = compensated_val;
+	adc_vals_x[2] = -compensated_val;
+	adc_vals_x[3] = compensated_val;
+	adc_vals_x[4] = compensated_val;
+	adc_vals_x[5] = compensated_val;
+	adc_vals_x[6] = -compensated_val;
+	adc_vals_x[7] = -compensated_val;
+	adc_vals_x[8] = -compensated_val;
+	adc_vals_x[9] = compensated_val;
+	adc_vals_x[10] = -compensated_val;
+	adc_vals_x[11] = -compensated_val;
+
+	compensated_val = adcs[1] - comps[1];
+	adc_vals_x[0] -= compensated_val;
+	adc_vals_x[1] += compensated_val;
+	adc_vals_x[2] += compensated_val;
+	adc_vals_x[3] -= compensated_val;
+	adc_vals_x[4] += compensated_val;
+	adc_vals_x[5] += compensated_val;
+	adc_vals_x[6] += compensated_val;
+	adc_vals_x[7] -= compensated_val;
+	adc_vals_x[8] -= compensated_val;
+	adc_vals_x[9] -= compensated_val;
+	adc_vals_x[10] += compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[2] - comps[2];
+	adc_vals_x[0] += compensated_val;
+	adc_vals_x[1] -= compensated_val;
+	adc_vals_x[2] += compensated_val;
+	adc_vals_x[3] += compensated_val;
+	adc_vals_x[4] -= compensated_val;
+	adc_vals_x[5] += compensated_val;
+	adc_vals_x[6] += compensated_val;
+	adc_vals_x[7] += compensated_val;
+	adc_vals_x[8] -= compensated_val;
+	adc_vals_x[9] -= compensated_val;
+	adc_vals_x[10] -= compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[3] - comps[3];
+	adc_vals_x[0] -= compensated_val;
+	adc_vals_x[1] += compensated_val;
+	adc_vals_x[2] -= compensated_val;
+	adc_vals_x[3] += compensated_val;
+	adc_vals_x[4] += compensated_val;
+	adc_vals_x[5] -= compensated_val;
+	adc_vals_x[6] += compensated_val;
+	adc_vals_x[7] += compensated_val;
+	adc_vals_x[8] += compensated_val;
+	adc_vals_x[9] -= compensated_val;
+	adc_vals_x[10] -= compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[4] - comps[4];
+	adc_vals_x[0] -= compensated_val;
+	adc_vals_x[1] -= compensated_val;
+	adc_vals_x[2] += compensated_val;
+	adc_vals_x[3] -= compensated_val;
+	adc_vals_x[4] += compensated_val;
+	adc_vals_x[5] += compensated_val;
+	adc_vals_x[6] -= compensated_val;
+	adc_vals_x[7] += compensated_val;
+	adc_vals_x[8] += compensated_val;
+	adc_vals_x[9] += compensated_val;
+	adc_vals_x[10] -= compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[5] - comps[5];
+	adc_vals_x[0] -= compensated_val;
+	adc_vals_x[1] -= compensated_val;
+	adc_vals_x[2] -= compensated_val;
+	adc_vals_x[3] += compensated_val;
+	adc_vals_x[4] -= compensated_val;
+	adc_vals_x[5] += compensated_val;
+	adc_vals_x[6] += compensated_val;
+	adc_vals_x[7] -= compensated_val;
+	adc_vals_x[8] += compensated_val;
+	adc_vals_x[9] += compensated_val;
+	adc_vals_x[10] += compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[6] - comps[6];
+	adc_vals_x[0] += compensated_val;
+	adc_vals_x[1] -= compensated_val;
+	adc_vals_x[2] -= compensated_val;
+	adc_vals_x[3] -= compensated_val;
+	adc_vals_x[4] += compensated_val;
+	adc_vals_x[5] -= compensated_val;
+	adc_vals_x[6] += compensated_val;
+	adc_vals_x[7] += compensated_val;
+	adc_vals_x[8] -= compensated_val;
+	adc_vals_x[9] += compensated_val;
+	adc_vals_x[10] += compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[7] - comps[7];
+	adc_vals_x[0] += compensated_val;
+	adc_vals_x[1] += compensated_val;
+	adc_vals_x[2] -= compensated_val;
+	adc_vals_x[3] -= compensated_val;
+	adc_vals_x[4] -= compensated_val;
+	adc_vals_x[5] += compensated_val;
+	adc_vals_x[6] -= compensated_val;
+	adc_vals_x[7] += compensated_val;
+	adc_vals_x[8] += compensated_val;
+	adc_vals_x[9] -= compensated_val;
+	adc_vals_x[10] += compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[8] - comps[8];
+	adc_vals_x[0] += compensated_val;
+	adc_vals_x[1] += compensated_val;
+	adc_vals_x[2] += compensated_val;
+	adc_vals_x[3] -= compensated_val;
+	adc_vals_x[4] -= compensated_val;
+	adc_vals_x[5] -= compensated_val;
+	adc_vals_x[6] += compensated_val;
+	adc_vals_x[7] -= compensated_val;
+	adc_vals_x[8] += compensated_val;
+	adc_vals_x[9] += compensated_val;
+	adc_vals_x[10] -= compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[9] - comps[9];
+	adc_vals_x[0] -= compensated_val;
+	adc_vals_x[1] += compensated_val;
+	adc_vals_x[2] += compensated_val;
+	adc_vals_x[3] += compensated_val;
+	adc_vals_x[4] -= compensated_val;
+	adc_vals_x[5] -= compensated_val;
+	adc_vals_x[6] -= compensated_val;
+	adc_vals_x[7] += compensated_val;
+	adc_vals_x[8] -= compensated_val;
+	adc_vals_x[9] += compensated_val;
+	adc_vals_x[10] += compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	compensated_val = adcs[10] - comps[10];
+	adc_vals_x[0] += compensated_val;
+	adc_vals_x[1] -= compensated_val;
+	adc_vals_x[2] += compensated_val;
+	adc_vals_x[3] += compensated_val;
+	adc_vals_x[4] += compensated_val;
+	adc_vals_x[5] -= compensated_val;
+	adc_vals_x[6] -= compensated_val;
+	adc_vals_x[7] -= compensated_val;
+	adc_vals_x[8] += compensated_val;
+	adc_vals_x[9] -= compensated_val;
+	adc_vals_x[10] += compensated_val;
+	adc_vals_x[11] -= compensated_val;
+
+	for (int idx = 0; idx < 12; idx++) {
+		if (adc_vals_x[idx] < 0)
+			adc_vals_x[idx] = 0;
+	}
+
+	// At this point the difference in ajacent samples of adc_vals_x 
+	//  shows has one period of a sine wave for each detected finger
+	//  (but maybe can only distinguish between two fingers). All other
+	//  differences are 0. For now if we see anything other than a 
+	//  single finger down, we treat it as though no fingers are down
+	// TODO: revisit this and look into better way of checking for finger
+	//  down and how we could make detect multi-touch??
+
+	/*
+	// Debug print to illustrate how difference in adjacent samples
+	//  can show where finger(s) are on trackpad
+	printf("%4d\n", adc_vals_x[0]);
+	for (int idx = 0; idx < 11; idx++) {
+		printf("%4d\n", adc_vals_x[idx+1] - adc_vals_x[idx]);
+	}
+	printf("\n");
+	*/
+
+	// This has to do with searching across adjacent adc_vals_* in
+	//  search of sine wave(s) representing down fingers
+	enum TransitionState {
+		WAIT_FOR_0_TO_P, // Searching for start of sine wave 
+			// representing down finger
+		WAIT_FOR_P_TO_N, // Searching for zero crossing in sine wave
+			// representing donw finger
+		WAIT_FOR_N_TO_0, // Searching for end of sine wave 
+			// representing down finger
+		WAIT_FOR_END, // Waiting for end of data (i.e. expecting nothing
+			// but 0's from this point out).
+		POS_INVALID // Something went "wrong" (i.e. no finger down or
+			// multiple down). 
+	};
+
+	enum TransitionState transition_state = WAIT_FOR_0_TO_P;
+
+	// Checking for finger down based on logic detailed above
+	if (adc_vals_x[0] > 0) {
+		transition_state = WAIT_FOR_P_TO_N;
+	} else if (adc_vals_x[0] < 0) {
+		transition_state = POS_INVALID;
+	}
+
+	for (int idx = 0; idx < 11; idx++) {
+		int32_t diff = adc_vals_x[idx+1] - adc_vals_x[idx];
+		if (transition_state == WAIT_FOR_0_TO_P) {
+			if (diff > 0) {
+				transition_state = WAIT_FOR_P_TO_N;
+			} else if (diff < 0) {
+				transition_state = POS_INVALID;
+			}
+		} else if (transition_state == WAIT_FOR_P_TO_N) {
+			if (diff < 0) {
+				transition_state = WAIT_FOR_N_TO_0;
+			} else if (diff == 0) {
+				transition_state = POS_INVALID;
+			}
+		} else if (transition_state == WAIT_FOR_N_TO_0) {
+			if (diff == 0) {
+				transition_state = WAIT_FOR_END;
+			} else if (diff > 0) {
+				transition_state = POS_INVALID;
+			}
+		} else if (transition_state == WAIT_FOR_END) {
+			// Should only get 0 differences if waiting for end
+			if (diff != 0) {
+				transition_state = POS_INVALID;
+			}
+		} else {
+			break;
+		}
+	}
+
+	int32_t x_pos = -1;
+
+	if (transition_state == WAIT_FOR_N_TO_0 || transition_state == WAIT_FOR_END) {
+		int32_t dividend = 0;
+		int32_t divisor = 0;
+		int32_t factor = 0;
+		for (int idx = 0; idx < 12; idx++) {
+			dividend += factor * adc_vals_x[idx];
+			divisor += adc_vals_x[idx];
+			factor += 100;
+		}
+
+		if (divisor) {
+			x_pos = dividend / divisor;	
+			x_pos = 1200 - x_pos;
+		}
+	}
+
+	*xPos = x_pos;
+	*yPos = -1;
+
+	// Early exit if no finger down detected in X position calculation
+	if (x_pos < 0) {
+		return;
+	}
+
+	// Calculate yLoc
+	int32_t adc_vals_y[8];
+
+	compensated_val = adcs[11] - comps[11];
+	adc_vals_y[0] = -compensated_val;
+	adc_vals_y[1] = compensated_val;
+	adc_vals_y[2] = -compensated_val;
+	adc_vals_y[3] = compensated_val;
+	adc_vals_y[4] = -compensated_val;
+	adc_vals_y[5] = compensated_val;
+	adc_vals_y[6] = -compensated_val;
+	adc_vals_y[7] = compensated_val;
+
+	compensated_val = adcs[12] - comps[12];
+	adc_vals_y[0] -= compensated_val;
+	adc_vals_y[1] -= compensated_val;
+	adc_vals_y[2] += compensated_val;
+	adc_vals_y[3] += compensated_val;
+	adc_vals_y[4] -= compensated_val;
+	adc_vals_y[5] -= compensated_val;
+	adc_vals_y[6] += compensated_val;
+	adc_vals_y[7] += compensated_val;
+
+	compensated_val = adcs[13] - comps[13];
+	adc_vals_y[0] += compensated_val;
+	adc_vals_y[1] -= compensated_val;
+	adc_vals_y[2] -= compensated_val;
+	adc_vals_y[3] += compensated_val;
+	adc_vals_y[4] += compensated_val;
+	adc_vals_y[5] -= compensated_val;
+	adc_vals_y[6] -= compensated_val;
+	adc_vals_y[7] += compensated_val;
+
+	compensated_val = adcs[14] - comps[14];
+	adc_vals_y[0] -= compensated_val;
+	adc_vals_y[1] -= compensated_val;
+	adc_vals_y[2] -= compensated_val;
+	adc_vals_y[3] -= compensated_val;
+	adc_vals_y[4] += compensated_val;
+	adc_vals_y[5] += compensated_val;
+	adc_vals_y[6] += compensated_val;
+	adc_vals_y[7] += compensated_val;
+
+	compensated_val = adcs[15] - comps[15];
+	adc_vals_y[0] += compensated_val;
+	adc_vals_y[1] -= compensated_val;
+	adc_vals_y[2] += compensated_val;
+	adc_vals_y[3] -= compensated_val;
+	adc_vals_y[4] -= compensated_val;
+	adc_vals_y[5] += compensated_val;
+	adc_vals_y[6] -= compensated_val;
+	adc_vals_y[7] += compensated_val;
+
+	compensated_val = adcs[16] - comps[16];
+	adc_vals_y[0] += compensated_val;
+	adc_vals_y[1] += compensated_val;
+	adc_vals_y[2] -= compensated_val;
+	adc_vals_y[3] -= compensated_val;
+	adc_vals_y[4] -= compensated_val;
+	adc_vals_y[5] -= compensated_val;
+	adc_vals_y[6] += compensated_val;
+	adc_vals_y[7] += compensated_val;
+
+	compensated_val = adcs[17] - comps[17];
+	adc_vals_y[0] -= compensated_val;
+	adc_vals_y[1] += compensated_val;
+	adc_vals_y[2] += compensated_val;
+	adc_vals_y[3] -= compensated_val;
+	adc_vals_y[4] += compensated_val;
+	adc_vals_y[5] -= compensated_val;
+	adc_vals_y[6] -= compensated_val;
+	adc_vals_y[7] += compensated_val;
+
+	for (int idx = 0; idx < 8; idx++) {
+		if (adc_vals_y[idx] < 0)
+			adc_vals_y[idx] = 0;
+		adc_vals_y[idx] = 1250 * adc_vals_y[idx] / 1000;
+	}
+
+	/*
+	// Debug print to illustrate how difference in adjacent samples
+	//  can show where finger(s) are on trackpad
+	printf("%4d\n", adc_vals_y[0]);
+	for (int idx = 0; idx < 7; idx++) {
+		printf("%4d\n", adc_vals_y[idx+1] - adc_vals_y[idx]);
+	}
+	printf("\n");
+	*/
+
+	transition_state = WAIT_FOR_0_TO_P;
+
+	// Checking for finger down based on logic detailed above
+	if (adc_vals_y[0] > 0) {
+		transition_state = WAIT_FOR_P_TO_N;
+	} else if (adc_vals_y[0] < 0) {
+		transition_state = POS_INVALID;
+	}
+
+	for (int idx = 0; idx < 7; idx++) {
+		int32_t diff = adc_vals_y[idx+1] - adc_vals_y[idx];
+		if (transition_state == WAIT_FOR_0_TO_P) {
+			if (diff > 0) {
+				transition_state = WAIT_FOR_P_TO_N;
+			} else if (diff < 0) {
+				transition_state = POS_INVALID;
+			}
+		} else if (transition_state == WAIT_FOR_P_TO_N) {
+			if (diff < 0) {
+				transition_state = WAIT_FOR_N_TO_0;
+			} else if (diff == 0) {
+				transition_state = POS_INVALID;
+			}
+		} else if (transition_state == WAIT_FOR_N_TO_0) {
+			if (diff == 0) {
+				transition_state = WAIT_FOR_END;
+			} else if (diff > 0) {
+				transition_state = POS_INVALID;
+			}
+		} else if (transition_state == WAIT_FOR_END) {
+			// Should only get 0 differences if waiting for end
+			if (diff != 0) {
+				transition_state = POS_INVALID;
+			}
+		} else {
+			break;
+		}
+	}
+
+	int32_t y_pos = -1;
+
+	if (transition_state == WAIT_FOR_N_TO_0 || transition_state == WAIT_FOR_END) {
+		int32_t dividend = 0;
+		int32_t divisor = 0;
+		int32_t factor = 0;
+		for (int idx = 0; idx < 8; idx++) {
+			dividend += factor * adc_vals_y[idx];
+			divisor += adc_vals_y[idx];
+			factor += 100;
+		}
+
+		if (divisor) {
+			y_pos = dividend / divisor;	
+		}
+	}
+
+	*yPos = y_pos;
+}
+
+/**
+ * Get raw demodulated profile for one axis (i.e. before negative values are
+ *  clamped and scaling is applied). A finger shows up as positive values, 
+ *  while negative values mean compensation values were taken with something
+ *  on the Trackpad.
+ *
+ * \param axis Which axis to demodulate.
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[out] bins Demodulated profile. Must have room for NUM_TPAD_MAX_BINS
+ *	values.
+ *
+ * \return Number of values written to bins.
+ */
+int tpadDemodAxis(TpadAxis axis, const volatile int16_t* adcs,
+	const int16_t* comps, int32_t* bins) {
+	const TpadAxisCfg* cfg = &AXIS_CFGS[axis];
+
+	demodAxis(cfg, cfg->demod, adcs, comps, bins);
+
+	return cfg->numBins;
+}
+
+/**
+ * Estimate how much noise is in a frame from how far each AnyMeas ADC value
+ *  is from a straight line through the same ADC in the last two frames 
+ *  (i.e. second difference over time). Nothing on the Trackpad, a still
+ *  finger, or a finger moving at a steady speed leave little behind, while
+ *  interference (i.e. from a charger or radio) at a frequency near the 
+ *  toggle frequency does not cancel out.
+ *
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] prev ADC values from last frame.
+ * \param[in] prevPrev ADC values from frame before last.
+ *
+ * \return Average absolute second difference of ADC values, with 
+ *	TPAD_NOISE_FRAC_BITS fractional bits.
+ */
+int32_t tpadFrameNoise(const volatile int16_t* adcs, const int16_t* prev,
+	const int16_t* prevPrev) {
+	int32_t sum = 0;
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		int32_t diff = adcs[idx] - 2 * prev[idx] + prevPrev[idx];
+		sum += diff < 0 ? -diff : diff;
+	}
+
+	return (sum << TPAD_NOISE_FRAC_BITS) / NUM_ANYMEAS_ADCS;
+}
+
+#define MT_MIN_PEAK_SHIFT (2) //!< Smaller of two peaks on an axis must be at
+	//!< least 1/2^shift of larger one to count as a second finger.
+#define MT_MAX_JUMP (300 << TPAD_POS_FRAC_BITS) //!< Furthest (X + Y 
+	//!< distance) a contact can move between frames and keep its ID.
+
+/**
+ * Fingers found along a single axis.
+ */
+typedef struct AxisContacts {
+	int num; //!< Number of valid entries.
+	int32_t pos[TPAD_MAX_CONTACTS]; //!< Centroid of each finger (fixed 
+		//!< point, in order along profile).
+	int32_t strength[TPAD_MAX_CONTACTS]; //!< Sum of profile values for
+		//!< each finger.
+} AxisContacts;
+
+/**
+ * Split profile into up to two fingers and find centroid of each.
+ *
+ * Same approach as isSingleTouch(), but a second rise after the profile
+ *  falls starts a second finger instead of making the profile invalid. Value
+ *  where second rise starts (i.e. valley) is split between both fingers.
+ *
+ * \param[in] cfg Axis details.
+ * \param[in] bins Profile (with negative values already clamped to 0).
+ * \param[out] contacts Fingers found.
+ *
+ * \return Number of fingers found.
+ */
+static int findAxisContacts(const TpadAxisCfg* cfg, const int32_t* bins,
+	AxisContacts* contacts) {
+	enum TransitionState {
+		WAIT_FOR_0_TO_P, // Searching for start of first finger
+		WAIT_FOR_P_TO_N, // Searching for peak of finger
+		WAIT_FOR_N_TO_0, // Searching for end of finger (or valley)
+		WAIT_FOR_END // Only flat or rising (i.e. next finger) expected
+	};
+
+	enum TransitionState transition_state = WAIT_FOR_0_TO_P;
+	int num_humps = 0;
+	int peaks[TPAD_MAX_CONTACTS] = {0, 0};
+	int valley = -1;
+
+	contacts->num = 0;
+
+	if (bins[0] > 0) {
+		transition_state = WAIT_FOR_P_TO_N;
+		num_humps = 1;
+	}
+
+	for (int idx = 0; idx < cfg->numBins - 1; idx++) {
+		int32_t diff = bins[idx+1] - bins[idx];
+		if (transition_state == WAIT_FOR_0_TO_P) {
+			if (diff > 0) {
+				transition_state = WAIT_FOR_P_TO_N;
+				num_humps = 1;
+			} else if (diff < 0) {
+				return 0;
+			}
+		} else if (transition_state == WAIT_FOR_P_TO_N) {
+			if (diff < 0) {
+				peaks[num_humps - 1] = idx;
+				transition_state = WAIT_FOR_N_TO_0;
+			} else if (diff == 0) {
+				return 0;
+			}
+		} else if (diff > 0) {
+			// Rising again after a peak means another finger
+			if (num_humps == TPAD_MAX_CONTACTS) {
+				return 0;
+			}
+			valley = idx;
+			num_humps++;
+			transition_state = WAIT_FOR_P_TO_N;
+		} else if (transition_state == WAIT_FOR_N_TO_0) {
+			if (diff == 0) {
+				transition_state = WAIT_FOR_END;
+			}
+		} else if (diff < 0) {
+			// Should only get flat or rising if waiting for end
+			return 0;
+		}
+	}
+
+	if (transition_state != WAIT_FOR_N_TO_0 && 
+		transition_state != WAIT_FOR_END) {
+		return 0;
+	}
+
+	if (num_humps == 1) {
+		// Exactly matches single finger decode
+		contacts->pos[0] = calcCentroid(cfg, bins, 0, cfg->numBins - 1,
+			-1, &contacts->strength[0]);
+		contacts->num = contacts->pos[0] < 0 ? 0 : 1;
+		return contacts->num;
+	}
+
+	int32_t peak0 = bins[peaks[0]];
+	int32_t peak1 = bins[peaks[1]];
+
+	// Small bump next to a finger is more likely noise than a finger
+	if (peak1 < (peak0 >> MT_MIN_PEAK_SHIFT)) {
+		contacts->pos[0] = calcCentroid(cfg, bins, 0, valley, valley,
+			&contacts->strength[0]);
+	} else if (peak0 < (peak1 >> MT_MIN_PEAK_SHIFT)) {
+		contacts->pos[0] = calcCentroid(cfg, bins, valley, 
+			cfg->numBins - 1, valley, &contacts->strength[0]);
+	} else {
+		contacts->pos[0] = calcCentroid(cfg, bins, 0, valley, valley,
+			&contacts->strength[0]);
+		contacts->pos[1] = calcCentroid(cfg, bins, valley, 
+			cfg->numBins - 1, valley, &contacts->strength[1]);
+		contacts->num = (contacts->pos[0] < 0 || contacts->pos[1] < 0) ?
+			0 : 2;
+		return contacts->num;
+	}
+
+	contacts->num = contacts->pos[0] < 0 ? 0 : 1;
+	return contacts->num;
+}
+
+/**
+ * Distance between two contacts (i.e. sum of X and Y distances, which is
+ *  cheaper than true distance and good enough for pairing).
+ *
+ * \param[in] a First contact.
+ * \param[in] b Second contact.
+ *
+ * \return Distance in fixed point units.
+ */
+static inline int32_t contactDist(const TrackpadContact* a, 
+	const TrackpadContact* b) {
+	int32_t dx = a->x - b->x;
+	int32_t dy = a->y - b->y;
+
+	return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+}
+
+/**
+ * Find cheapest pairing of contacts with contacts from last frame.
+ *
+ * \param[in] tracker Contacts from last frame.
+ * \param[in] contacts Contacts from this frame.
+ * \param num Number of contacts.
+ * \param[out] map For each contact, index of contact from last frame it 
+ *	pairs with, or -1 if it is a new finger.
+ *
+ * \return Cost of pairing (lower is better).
+ */
+static int32_t pairContacts(const TpadContactTracker* tracker,
+	const TrackpadContact* contacts, int num, int* map) {
+	int32_t best_cost = 0x7FFFFFFF;
+
+	// At most two contacts each frame, so just try every option
+	for (int m0 = -1; m0 < tracker->num; m0++) {
+		for (int m1 = -1; m1 < tracker->num; m1++) {
+			if ((num < 2 && m1 >= 0) || (m0 >= 0 && m0 == m1)) {
+				continue;
+			}
+
+			const int try_map[TPAD_MAX_CONTACTS] = {m0, m1};
+			int32_t cost = 0;
+			for (int idx = 0; idx < num; idx++) {
+				int32_t dist = MT_MAX_JUMP;
+				if (try_map[idx] >= 0) {
+					dist = contactDist(&contacts[idx],
+						&tracker->contacts[try_map[idx]]);
+				}
+				if (dist > MT_MAX_JUMP) {
+					cost = 0x7FFFFFFF;
+					break;
+				}
+				cost += dist;
+			}
+
+			if (cost < best_cost) {
+				best_cost = cost;
+				map[0] = m0;
+				map[1] = m1;
+			}
+		}
+	}
+
+	return best_cost;
+}
+
+/**
+ * Reset contact tracking (i.e. all contacts in next frame are new).
+ *
+ * \param[out] tracker Tracker to reset.
+ *
+ * \return None.
+ */
+void tpadContactTrackerReset(TpadContactTracker* tracker) {
+	tracker->num = 0;
+	tracker->nextId = 1;
+}
+
+/**
+ * Find up to TPAD_MAX_CONTACTS fingers on Trackpad. Each axis profile is 
+ *  split into up to two fingers, which are then paired up into X/Y contacts.
+ *  If both axes have two fingers, pairing that best matches last frame's 
+ *  contacts is used (or strongest X with strongest Y if there is no 
+ *  history). Contacts are given IDs that stay the same across frames.
+ *
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs.
+ * \param[inout] tracker Contacts from last frame. Updated with contacts 
+ *	from this frame.
+ * \param[out] contacts Fingers found. Must have room for TPAD_MAX_CONTACTS.
+ *
+ * \return Number of fingers found.
+ */
+int tpadDecodeContacts(const volatile int16_t* adcs, const int16_t* comps,
+	TpadContactTracker* tracker, TrackpadContact* contacts) {
+	int32_t bins[NUM_TPAD_MAX_BINS];
+	AxisContacts xs;
+	AxisContacts ys;
+	int num = 0;
+
+	profileAxis(&AXIS_CFGS[TPAD_AXIS_X], demodX, adcs, comps, bins);
+	if (findAxisContacts(&AXIS_CFGS[TPAD_AXIS_X], bins, &xs)) {
+		profileAxis(&AXIS_CFGS[TPAD_AXIS_Y], demodY, adcs, comps, bins);
+		findAxisContacts(&AXIS_CFGS[TPAD_AXIS_Y], bins, &ys);
+	} else {
+		ys.num = 0;
+	}
+
+	if (xs.num && ys.num) {
+		num = xs.num > ys.num ? xs.num : ys.num;
+		for (int idx = 0; idx < num; idx++) {
+			// Axis with a single finger is shared by both contacts
+			int x_idx = xs.num > 1 ? idx : 0;
+			int y_idx = ys.num > 1 ? idx : 0;
+			contacts[idx].x = xs.pos[x_idx];
+			contacts[idx].y = ys.pos[y_idx];
+			contacts[idx].strength = 
+				(xs.strength[x_idx] >> (num - xs.num)) + 
+				(ys.strength[y_idx] >> (num - ys.num));
+		}
+	}
+
+	int map[TPAD_MAX_CONTACTS] = {-1, -1};
+	int32_t cost = pairContacts(tracker, contacts, num, map);
+
+	if (xs.num == 2 && ys.num == 2) {
+		// Other way X and Y could be paired up
+		TrackpadContact swapped[TPAD_MAX_CONTACTS] = {contacts[0], 
+			contacts[1]};
+		swapped[0].y = contacts[1].y;
+		swapped[1].y = contacts[0].y;
+		swapped[0].strength = (xs.strength[0] >> 1) + 
+			(ys.strength[1] >> 1);
+		swapped[1].strength = (xs.strength[1] >> 1) + 
+			(ys.strength[0] >> 1);
+
+		int swapped_map[TPAD_MAX_CONTACTS] = {-1, -1};
+		int32_t swapped_cost = pairContacts(tracker, swapped, num, 
+			swapped_map);
+
+		bool use_swapped = swapped_cost < cost;
+		if (swapped_cost == cost) {
+			// No history to go on, so pair strongest with strongest
+			use_swapped = (xs.strength[0] > xs.strength[1]) != 
+				(ys.strength[0] > ys.strength[1]);
+		}
+
+		if (use_swapped) {
+			contacts[0] = swapped[0];
+			contacts[1] = swapped[1];
+			map[0] = swapped_map[0];
+			map[1] = swapped_map[1];
+		}
+	}
+
+	for (int idx = 0; idx < num; idx++) {
+		contacts[idx].id = map[idx] >= 0 ? 
+			tracker->contacts[map[idx]].id : 0;
+	}
+
+	for (int idx = 0; idx < num; idx++) {
+		if (contacts[idx].id) {
+			continue;
+		}
+
+		// New finger. ID must not be 0 or clash with other contact
+		uint8_t other_id = contacts[num - 1 - idx].id;
+		do {
+			contacts[idx].id = tracker->nextId++;
+		} while (!contacts[idx].id || contacts[idx].id == other_id);
+	}
+
+	tracker->num = num;
+	for (int idx = 0; idx < num; idx++) {
+		tracker->contacts[idx] = contacts[idx];
+	}
+
+	return num;
+}
+
+#define FILT_FRAC_BITS (8) //!< Fractional bits of filtered position state.
+#define FILT_ALPHA_BITS (12) //!< Fractional bits of smoothing factors.
+#define FILT_MAX_DT_US (50 * 1000) //!< Filter restarts if positions are
+	//!< further apart than this.
+#define FILT_MAX_SPEED (100000) //!< Speed estimates (units/second) are 
+	//!< clamped to this to keep math in 32 bits.
+#define FILT_MAX_CUTOFF_MHZ (1000 * 1000) //!< Largest cutoff frequency.
+#define FILT_TAU_US_MHZ (159154943) //!< 10^9 / (2 * pi). Dividing this by
+	//!< cutoff frequency in mHz gives filter time constant in us.
+
+/**
+ * Compute smoothing factor for exponential filter (i.e. 1 / (1 + tau/dt)).
+ *
+ * \param cutoffMhz Cutoff frequency in mHz.
+ * \param dtUs Time since last sample.
+ *
+ * \return Smoothing factor with FILT_ALPHA_BITS fractional bits.
+ */
+static int32_t calcFiltAlpha(uint32_t cutoffMhz, uint32_t dtUs) {
+	if (!cutoffMhz) {
+		cutoffMhz = 1;
+	}
+	uint32_t tau_us = FILT_TAU_US_MHZ / cutoffMhz;
+
+	return (dtUs << FILT_ALPHA_BITS) / (dtUs + tau_us);
+}
+
+/**
+ * Single step of exponential smoothing.
+ *
+ * \param prev Last smoothed value.
+ * \param val New sample.
+ * \param alpha Smoothing factor with FILT_ALPHA_BITS fractional bits.
+ *
+ * \return New smoothed value.
+ */
+static inline int32_t lowPass(int32_t prev, int32_t val, int32_t alpha) {
+	return prev + ((alpha * (val - prev) + (1 << (FILT_ALPHA_BITS - 1))) 
+		>> FILT_ALPHA_BITS);
+}
+
+/**
+ * Restart position filter (i.e. when finger is lifted).
+ *
+ * \param[out] filt Filter state to reset.
+ *
+ * \return None.
+ */
+void tpadFiltReset(TpadFilt* filt) {
+	filt->valid = false;
+	filt->pos = 0;
+	filt->speed = 0;
+}
+
+/**
+ * Speed adaptive (One Euro) filter for one axis of position. Cutoff 
+ *  frequency rises with (smoothed) speed, so slow motion is heavily smoothed
+ *  while fast motion sees very little lag. All math is 32-bit integer.
+ *
+ * \param[inout] filt Filter state.
+ * \param[in] params Filter tuning.
+ * \param posQ New position with TPAD_POS_FRAC_BITS fractional bits.
+ * \param dtUs Time since last position passed to filter.
+ *
+ * \return Filtered position with TPAD_POS_FRAC_BITS fractional bits.
+ */
+int32_t tpadFilt(TpadFilt* filt, const TpadFiltParams* params, int32_t posQ,
+	uint32_t dtUs) {
+	int32_t pos = posQ * (1 << (FILT_FRAC_BITS - TPAD_POS_FRAC_BITS));
+
+	if (!filt->valid || !dtUs || dtUs > FILT_MAX_DT_US) {
+		filt->valid = true;
+		filt->pos = pos;
+		filt->speed = 0;
+		return posQ;
+	}
+
+	// Speed in units/second. 10^6 = 15625 * 64, which keeps intermediate
+	//  values in range
+	int32_t delta = (pos - filt->pos) / 
+		(1 << (FILT_FRAC_BITS - TPAD_POS_FRAC_BITS));
+	int32_t speed = delta * 15625 / (int32_t)dtUs * 
+		(64 >> TPAD_POS_FRAC_BITS);
+	if (speed > FILT_MAX_SPEED) {
+		speed = FILT_MAX_SPEED;
+	} else if (speed < -FILT_MAX_SPEED) {
+		speed = -FILT_MAX_SPEED;
+	}
+
+	filt->speed = lowPass(filt->speed, speed, 
+		calcFiltAlpha(params->dCutoffMhz, dtUs));
+
+	uint32_t cutoff = params->minCutoffMhz + params->beta * 
+		(filt->speed < 0 ? -filt->speed : filt->speed);
+	if (cutoff > FILT_MAX_CUTOFF_MHZ) {
+		cutoff = FILT_MAX_CUTOFF_MHZ;
+	}
+
+	filt->pos = lowPass(filt->pos, pos, calcFiltAlpha(cutoff, dtUs));
+
+	return (filt->pos + (1 << (FILT_FRAC_BITS - TPAD_POS_FRAC_BITS - 1))) >>
+		(FILT_FRAC_BITS - TPAD_POS_FRAC_BITS);
+}
@@ -0,0 +1,985 @@
+/**
+ * \file trackpad_diag.c
+ * \brief Encompasses Trackpad diagnostics used by the trackpad command: 
+ *	monitors, raw frame streaming and capture, benchmarking and printing
+ *	of statistics.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_int.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TPAD_STREAM_SYNC (0x5AA5) //!< Starts each binary stream record (i.e.
+	//!< bytes 0xA5 0x5A) so host can find records among console text.
+#define TPAD_STREAM_FLAG_IDLE (1 << 0) //!< Stream record flag for presence
+	//!< probe only frame (adcs are from last full frame).
+#define TPAD_STREAM_FLAG_ABS (1 << 1) //!< Stream record flag for absolute
+	//!< mode frame (adcs are from last AnyMeas frame).
+
+/**
+ * Binary record sent for each frame by 'trackpad stream'. All fields are 
+ *  naturally aligned so there is no padding, and multi-byte fields are little
+ *  endian. Keep in sync with Firmware/TrackpadTools/tpad_stream_to_csv.py.
+ */
+typedef struct TpadStreamRec {
+	uint16_t sync; //!< TPAD_STREAM_SYNC.
+	uint8_t trackpad; //!< Trackpad frame is from (i.e. R_TRACKPAD).
+	uint8_t flags; //!< TPAD_STREAM_FLAG_* bits.
+	uint32_t seq; //!< Frame sequence number. Gaps mean frames were dropped.
+	uint32_t timestampUs; //!< When last ADC of frame was read.
+	uint16_t drops; //!< Frames from this Trackpad not sent since stream
+		//!< started (saturates).
+	int16_t adcs[NUM_ANYMEAS_ADCS]; //!< Raw AnyMeas ADC values.
+	int16_t comps[NUM_ANYMEAS_ADCS]; //!< Compensation values frame is
+		//!< decoded against.
+	uint16_t check; //!< Fletcher-16 checksum of all bytes before this.
+} TpadStreamRec;
+
+uint32_t tpadRegStatsSeqs[2]; //!< Frame sequence numbers when 
+	//!< register write counters were last reset.
+
+/**
+ * Print details on how Trackpad initialization went.
+ *
+ * \return None.
+ */
+void trackpadPrintInitStats(void) {
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		printf("%s Trackpad init %s (%d). Took %d us (%d us Extended "
+			"Register programming).\n", 
+			tpad == R_TRACKPAD ? "Right":"Left", 
+			tpadInitRets[tpad] ? "failed":"succeeded", tpadInitRets[tpad],
+			tpadInitUs[tpad], tpadEraUs[tpad]);
+
+		const TpadMeasStats* stats = &tpadMeasStats[tpad];
+		if (stats->meas) {
+			printf("  %d single AnyMeas measurements took %d us on "
+				"average (max %d us, %d timed out)\n", stats->meas,
+				stats->usSum / stats->meas, stats->usMax, 
+				stats->timeouts);
+		}
+	}
+}
+
+/**
+ * Function that will entire loop which prints out X/Y position for each 
+ *  Trackpad until a key is pressed to exit.
+ *
+ * \return None.
+ */
+void tpadMonitor(void) {
+	printf("Trackpad X/Y Location (Press any key to exit):\n");
+	printf("\n");
+	printf("Time             Left X Left Y Right X Right Y\n");
+	printf("----------------------------------------------\n");
+
+	while (!usb_tstc()) {
+		uint16_t x_loc = 0;
+		uint16_t y_loc = 0;
+
+		// Does nothing if scan scheduler is running
+		trackpadLocUpdate(L_TRACKPAD);
+		trackpadLocUpdate(R_TRACKPAD);
+
+		printf("0x%08x       ", getUsTickCnt());
+
+		trackpadGetLastXY(L_TRACKPAD, &x_loc, &y_loc);
+
+		printf("  %4d ", x_loc);
+		printf("  %4d ", y_loc);
+
+		trackpadGetLastXY(R_TRACKPAD, &x_loc, &y_loc);
+
+		printf("   %4d ", x_loc);
+		printf("   %4d ", y_loc);
+
+		int16_t r_adcs[NUM_ANYMEAS_ADCS];
+		int16_t l_adcs[NUM_ANYMEAS_ADCS];
+		readTpadFrame(R_TRACKPAD, r_adcs, NULL);
+		readTpadFrame(L_TRACKPAD, l_adcs, NULL);
+		printf(" %4d %4d", r_adcs[18], l_adcs[18]);
+
+		printf("\r");
+		usb_flush();
+
+		usleep(10 * 1000);
+	}
+}
+
+/**
+ * Compute Fletcher-16 checksum.
+ *
+ * \param[in] data Bytes to compute checksum over.
+ * \param len Number of bytes in data.
+ *
+ * \return Checksum.
+ */
+static uint16_t calcFletcher16(const uint8_t* data, uint32_t len) {
+	uint32_t sum1 = 0;
+	uint32_t sum2 = 0;
+
+	for (int idx = 0; idx < len; idx++) {
+		sum1 = (sum1 + data[idx]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+
+	return (sum2 << 8) | sum1;
+}
+
+/**
+ * Stream every frame captured by scan scheduler from both Trackpads as binary
+ *  records (see TpadStreamRec) until a key is pressed. Records are dropped
+ *  (and counted) rather than waited on if USB CDC transmit FIFO is full, so 
+ *  scan rate is never affected. Use Firmware/TrackpadTools/tpad_stream_to_csv.py
+ *  to convert a capture to CSV.
+ *
+ * \return 0 on success.
+ */
+int tpadStream(void) {
+	uint32_t last_seqs[2] = {0, 0};
+	uint32_t sents[2] = {0, 0};
+	uint32_t fifo_drops[2] = {0, 0};
+	uint32_t misses[2] = {0, 0};
+	TpadStreamRec rec;
+
+	if (!tpadSchedEn) {
+		printf("Scan scheduler must be running\n");
+		return -1;
+	}
+
+	printf("Streaming binary Trackpad frames (Press any key to exit):\n");
+	usb_flush();
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		last_seqs[tpad] = trackpadGetFrameSeq(tpad);
+	}
+
+	while (!usb_tstc()) {
+		for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+			TpadFrameInfo info;
+
+			// Cheap check so frame is only copied when new
+			if (trackpadGetFrameSeq(tpad) == last_seqs[tpad]) {
+				continue;
+			}
+
+			uint32_t seq = readTpadFrame(tpad, rec.adcs, &info);
+			misses[tpad] += seq - last_seqs[tpad] - 1;
+			last_seqs[tpad] = seq;
+
+			uint32_t drops = fifo_drops[tpad] + misses[tpad];
+			rec.sync = TPAD_STREAM_SYNC;
+			rec.trackpad = tpad;
+			rec.flags = (info.idle ? TPAD_STREAM_FLAG_IDLE : 0) |
+				(info.mode == TPAD_MODE_ABS ? 
+				TPAD_STREAM_FLAG_ABS : 0);
+			rec.seq = seq;
+			rec.timestampUs = info.timestampUs;
+			rec.drops = drops > 0xFFFF ? 0xFFFF : drops;
+			memcpy(rec.comps, info.comps, sizeof(rec.comps));
+			rec.check = calcFletcher16((const uint8_t*)&rec, 
+				offsetof(TpadStreamRec, check));
+
+			if (usb_tryPutb((const char*)&rec, sizeof(rec))) {
+				fifo_drops[tpad]++;
+			} else {
+				sents[tpad]++;
+			}
+		}
+	}
+	usb_getc();
+
+	// Make sure summary starts on its own line after binary data
+	printf("\n");
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		printf("%s Trackpad: %d frames sent, %d dropped (FIFO full), "
+			"%d missed\n", tpad == R_TRACKPAD ? "Right":"Left", 
+			sents[tpad], fifo_drops[tpad], misses[tpad]);
+	}
+
+	return 0;
+}
+
+/**
+ * Print single set of raw ADC readings and compensation data (ideal for 
+ *  inserting into simulations)"
+ *
+ * \return None.
+ */
+void tpadGetRaw(void) {
+	int16_t eeprom_comps[NUM_ANYMEAS_ADCS];
+	memset(eeprom_comps, 0, sizeof(eeprom_comps));
+	tpadCompLoadFactory(L_TRACKPAD, eeprom_comps);
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		printf("Left Compensation Vals[%d] = %d %d\n", idx, 
+			tpadAdcComps[L_TRACKPAD][idx], eeprom_comps[idx]);
+	}
+	printf("\n");
+
+	memset(eeprom_comps, 0, sizeof(eeprom_comps));
+	tpadCompLoadFactory(R_TRACKPAD, eeprom_comps);
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		printf("Right Compensation Vals[%d] = %d %d\n", idx, 
+			tpadAdcComps[R_TRACKPAD][idx], eeprom_comps[idx]);
+	}
+	printf("\n");
+
+	uint16_t x_loc = 0;
+	uint16_t y_loc = 0;
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+
+	trackpadLocUpdate(L_TRACKPAD);
+	trackpadLocUpdate(R_TRACKPAD);
+
+	printf("# Left Trackpad AnyMeas ADC Vals:\n");
+
+	// Wait for requested frame to be captured
+	trackpadGetLastXY(L_TRACKPAD, &x_loc, &y_loc);
+	readTpadFrame(L_TRACKPAD, adcs, NULL);
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		uint32_t base_addr = 0x10000a5e;
+		printf("set {short}0x%08x = %d\n", base_addr + 2 * idx, 
+			adcs[idx]);
+		printf("set {short}0x%08x = %d\n", 0x4c + base_addr + 2 * idx, 
+			adcs[idx]);
+	}
+	printf("\n");
+
+	printf("# Right Trackpad AnyMeas ADC Vals:\n");
+
+	trackpadGetLastXY(R_TRACKPAD, &x_loc, &y_loc);
+	readTpadFrame(R_TRACKPAD, adcs, NULL);
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		uint32_t base_addr = 0x10000a38;
+		printf("set {short}0x%08x = %d\n", base_addr + 2 * idx, 
+			adcs[idx]);
+		printf("set {short}0x%08x = %d\n", 0x4c + base_addr + 2 * idx, 
+			adcs[idx]);
+	}
+	printf("\n");
+}
+
+#define TPAD_BENCH_MAX_FRAMES (32) //!< Most frames tpadBench() records, as
+	//!< they are all held on heap at once.
+
+/**
+ * Record frames of AnyMeas ADC values from a Trackpad and then time how long
+ *  decoding them to X/Y takes. Decode kernel is compared against the hand
+ *  unrolled decode it replaced (see tpadDecodeLegacy()) and results are 
+ *  checked to match.
+ *
+ * \param trackpad Specifies which Trackpad to record frames from.
+ * \param numFrames Number of frames to record and decode (up to 
+ *	TPAD_BENCH_MAX_FRAMES).
+ *
+ * \return 0 on success.
+ */
+int tpadBench(Trackpad trackpad, uint32_t numFrames) {
+	const uint32_t NUM_REPS = 16;
+	int32_t bins[NUM_TPAD_MAX_BINS];
+
+	if (!numFrames || numFrames > TPAD_BENCH_MAX_FRAMES) {
+		printf("numFrames must be 1 to %d\n", TPAD_BENCH_MAX_FRAMES);
+		return -1;
+	}
+
+	if (tpadModes[trackpad] != TPAD_MODE_ANYMEAS) {
+		printf("Trackpad must be in AnyMeas mode\n");
+		return -1;
+	}
+
+	int16_t* frames = malloc(sizeof(int16_t) * NUM_ANYMEAS_ADCS * numFrames);
+	if (!frames) {
+		printf("malloc failed for %d frames\n", numFrames);
+		return -1;
+	}
+
+	printf("Recording %d frames from %s Trackpad...\n", numFrames,
+		trackpad == R_TRACKPAD ? "right":"left");
+
+	// Take frames by hand so that none are skipped
+	bool sched_en = tpadSchedEn;
+	trackpadSchedStop();
+
+	for (int frame = 0; frame < numFrames; frame++) {
+		trackpadLocUpdate(trackpad);
+		while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_ADCS) {
+			__WFI();
+		}
+		for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+			frames[frame * NUM_ANYMEAS_ADCS + idx] = 
+				tpadAdcDatas[trackpad][idx];
+		}
+	}
+
+	if (sched_en) {
+		trackpadSchedStart(tpadSchedFps);
+	}
+
+	const int16_t* comps = tpadAdcComps[trackpad];
+	uint32_t num_touches = 0;
+	uint32_t mismatches = 0;
+	uint32_t num_multi = 0;
+	uint32_t mt_mismatches = 0;
+	TpadContactTracker tracker;
+	TrackpadContact contacts[TPAD_MAX_CONTACTS];
+	tpadContactTrackerReset(&tracker);
+	for (int frame = 0; frame < numFrames; frame++) {
+		const int16_t* adcs = &frames[frame * NUM_ANYMEAS_ADCS];
+		int32_t legacy_x = 0;
+		int32_t legacy_y = 0;
+		tpadDecodeLegacy(adcs, comps, &legacy_x, &legacy_y);
+		bool legacy_touch = legacy_x > 0 && legacy_y > 0;
+
+		// Legacy decode truncated centroid before flipping X, where kernel
+		//  keeps fractional bits
+		int32_t x_q = tpadDecodeAxisQ(TPAD_AXIS_X, adcs, comps, bins);
+		int32_t y_q = tpadDecodeAxisQ(TPAD_AXIS_Y, adcs, comps, bins);
+		int32_t x = x_q < 0 ? x_q : 
+			(x_q + (1 << TPAD_POS_FRAC_BITS) - 1) >> TPAD_POS_FRAC_BITS;
+		int32_t y = y_q < 0 ? y_q : y_q >> TPAD_POS_FRAC_BITS;
+		bool touch = x > 0 && y > 0;
+
+		if (touch != legacy_touch || (touch && (x != legacy_x ||
+			y != legacy_y))) {
+			mismatches++;
+		}
+		if (touch) {
+			num_touches++;
+		}
+
+		// Single finger frames must decode the same with multi-touch
+		int num = tpadDecodeContacts(adcs, comps, &tracker, contacts);
+		if (num > 1) {
+			num_multi++;
+		}
+		if (x_q > 0 && y_q > 0 && (num != 1 || contacts[0].x != x_q ||
+			contacts[0].y != y_q)) {
+			mt_mismatches++;
+		}
+	}
+
+	// Decode both axes every time so cost does not depend on finger state
+	//  (legacy decode skips Y when X has no finger)
+	uint32_t start = getUsTickCnt();
+	for (int rep = 0; rep < NUM_REPS; rep++) {
+		for (int frame = 0; frame < numFrames; frame++) {
+			const int16_t* adcs = &frames[frame * NUM_ANYMEAS_ADCS];
+			int32_t x;
+			int32_t y;
+			tpadDecodeLegacy(adcs, comps, &x, &y);
+		}
+	}
+	uint32_t ref_us = getUsTickCnt() - start;
+
+	start = getUsTickCnt();
+	for (int rep = 0; rep < NUM_REPS; rep++) {
+		for (int frame = 0; frame < numFrames; frame++) {
+			const int16_t* adcs = &frames[frame * NUM_ANYMEAS_ADCS];
+			tpadDecodeAxis(TPAD_AXIS_X, adcs, comps, bins);
+			tpadDecodeAxis(TPAD_AXIS_Y, adcs, comps, bins);
+		}
+	}
+	uint32_t fast_us = getUsTickCnt() - start;
+
+	start = getUsTickCnt();
+	for (int rep = 0; rep < NUM_REPS; rep++) {
+		for (int frame = 0; frame < numFrames; frame++) {
+			const int16_t* adcs = &frames[frame * NUM_ANYMEAS_ADCS];
+			tpadDecodeContacts(adcs, comps, &tracker, contacts);
+		}
+	}
+	uint32_t multi_us = getUsTickCnt() - start;
+
+	free(frames);
+
+	uint32_t num_decodes = NUM_REPS * numFrames;
+	uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+	printf("%d frames (%d with finger down), %d mismatches\n", numFrames,
+		num_touches, mismatches);
+	printf("Legacy:    %d us total, %d cycles/frame\n", ref_us,
+		ref_us * cycles_per_us / num_decodes);
+	printf("Kernel:    %d us total, %d cycles/frame\n", fast_us,
+		fast_us * cycles_per_us / num_decodes);
+	printf("Multi:     %d us total, %d cycles/frame\n", multi_us,
+		multi_us * cycles_per_us / num_decodes);
+	printf("%d frames with 2 contacts, %d single finger mismatches\n",
+		num_multi, mt_mismatches);
+	if (tpadSchedFps) {
+		// Share of CPU if every frame from both Trackpads is decoded
+		uint32_t multi_permille = (uint64_t)multi_us * tpadSchedFps * 2 /
+			num_decodes / 1000;
+		printf("Multi at %d fps (both Trackpads): %d.%d%% of CPU\n",
+			tpadSchedFps, multi_permille / 10, multi_permille % 10);
+	}
+
+	return (mismatches || mt_mismatches) ? -1 : 0;
+}
+
+/**
+ * Measure and print rate at which frames are being captured for each 
+ *  Trackpad.
+ *
+ * \return None.
+ */
+void tpadPrintFps(void) {
+	const uint32_t MEAS_US = 1000000;
+
+	if (tpadSchedEn) {
+		printf("Scan scheduler running. Target = ");
+		if (tpadSchedFps) {
+			printf("%d fps\n", tpadSchedFps);
+		} else {
+			printf("as fast as possible\n");
+		}
+	} else {
+		printf("Scan scheduler stopped\n");
+	}
+
+	uint32_t r_start_cnt = trackpadGetFrameSeq(R_TRACKPAD);
+	uint32_t l_start_cnt = trackpadGetFrameSeq(L_TRACKPAD);
+	uint32_t start = getUsTickCnt();
+
+	usleep(MEAS_US);
+
+	uint32_t r_cnt = trackpadGetFrameSeq(R_TRACKPAD) - r_start_cnt;
+	uint32_t l_cnt = trackpadGetFrameSeq(L_TRACKPAD) - l_start_cnt;
+	uint32_t elapsed_ms = (getUsTickCnt() - start) / 1000;
+
+	printf("Right Trackpad: %d fps\n", r_cnt * 1000 / elapsed_ms);
+	printf("Left Trackpad:  %d fps\n", l_cnt * 1000 / elapsed_ms);
+}
+
+/**
+ * Print how many register writes have been sent to each Trackpad ASIC and
+ *  how many were skipped thanks to register cache.
+ *
+ * \return None.
+ */
+void tpadPrintRegStats(void) {
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		uint32_t writes = tpadRegWrites[tpad];
+		uint32_t elided = tpadRegElided[tpad];
+		uint32_t frames = trackpadGetFrameSeq(tpad) - 
+			tpadRegStatsSeqs[tpad];
+
+		printf("%s Trackpad: %d writes, %d elided over %d frames", 
+			tpad == R_TRACKPAD ? "Right":"Left", writes, elided, 
+			frames);
+		if (frames) {
+			printf(" (%d.%02d writes, %d.%02d elided per frame)",
+				writes / frames, (100 * writes / frames) % 100,
+				elided / frames, (100 * elided / frames) % 100);
+		}
+		printf("\n");
+	}
+}
+
+/**
+ * Print frame rate, latency, capture time and CPU load for each Trackpad in
+ *  each mode it has spent time in since stats were last reset.
+ *
+ * \return None.
+ */
+void tpadPrintModeStats(void) {
+	static const char* const MODE_STRS[2] = {"AnyMeas", "Absolute"};
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		printf("%s Trackpad (currently %s):\n", 
+			tpad == R_TRACKPAD ? "Right":"Left", 
+			MODE_STRS[tpadModes[tpad]]);
+
+		for (int mode = TPAD_MODE_ANYMEAS; mode <= TPAD_MODE_ABS; mode++) {
+			TpadModeStats stats;
+
+			__disable_irq();
+			memcpy(&stats, (void*)&tpadModeStats[tpad][mode], 
+				sizeof(stats));
+			if (mode == tpadModes[tpad]) {
+				stats.activeUs += getUsTickCnt() - 
+					tpadModeSinceUs[tpad];
+			}
+			__enable_irq();
+
+			if (!stats.activeUs) {
+				continue;
+			}
+
+			uint32_t fps = (uint64_t)stats.frames * 1000000 / 
+				stats.activeUs;
+			uint32_t lat_us = stats.latencies ? 
+				stats.latencyUsSum / stats.latencies : 0;
+			uint32_t cap_us = stats.frames ? 
+				stats.captureUsSum / stats.frames : 0;
+			// CPU load in hundredths of a percent
+			uint32_t cpu = (uint64_t)(stats.isrCycles + 
+				stats.decodeCycles + stats.deferCycles) * 10000 / 
+				((uint64_t)(SystemCoreClock / 1000000) * 
+				stats.activeUs);
+
+			printf("  %-8s %4d fps, latency %d us (max %d), capture "
+				"%d us (max %d), CPU %d.%02d%% (%d ISR, %d decode, "
+				"%d tracking cycles/frame)\n", MODE_STRS[mode], fps,
+				lat_us, stats.latencyUsMax, cap_us, 
+				stats.captureUsMax, cpu / 100, cpu % 100, 
+				stats.frames ? stats.isrCycles / stats.frames : 0, 
+				stats.frames ? stats.decodeCycles / stats.frames : 0,
+				stats.frames ? stats.deferCycles / stats.frames : 0);
+			if (stats.abandoned) {
+				printf("           %d frames abandoned waiting for "
+					"DR\n", stats.abandoned);
+			}
+		}
+	}
+}
+
+#if TPAD_LAT_HIST_EN
+/**
+ * Work out upper edge of histogram bucket a percentile of samples falls in.
+ *
+ * \param[in] hist Histogram to check.
+ * \param num Total number of samples in histogram.
+ * \param pct Percentile to find.
+ *
+ * \return Upper edge of bucket (in us). Largest sample if percentile falls 
+ *	in last bucket.
+ */
+static uint32_t calcTpadLatPct(const TpadLatHist* hist, uint32_t num, 
+	uint32_t pct) {
+	// Round up so small counts still land on a sample
+	uint32_t target = ((uint64_t)num * pct + 99) / 100;
+	uint32_t cnt = 0;
+
+	for (int bucket = 0; bucket < NUM_TPAD_LAT_BUCKETS - 1; bucket++) {
+		cnt += hist->counts[bucket];
+		if (cnt >= target) {
+			return TPAD_LAT_BUCKET0_US << bucket;
+		}
+	}
+
+	return hist->usMax;
+}
+
+/**
+ * Dump latency histogram of each pipeline stage for each Trackpad.
+ *
+ * \return None.
+ */
+void tpadPrintLatency(void) {
+	static const char* const STAGE_STRS[NUM_TPAD_LAT_STAGES] = {
+		"drWait", "spiRead", "capture", "decWait", "decode", "total"
+	};
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		printf("%s Trackpad (us, bucket counts are < upper edge):\n", 
+			tpad == R_TRACKPAD ? "Right":"Left");
+		printf("  stage          num    avg    p50    p99    max |");
+		for (int bucket = 0; bucket < NUM_TPAD_LAT_BUCKETS - 1; 
+			bucket++) {
+			printf(" %6d", TPAD_LAT_BUCKET0_US << bucket);
+		}
+		printf("   more\n");
+
+		for (int stage = 0; stage < NUM_TPAD_LAT_STAGES; stage++) {
+			TpadLatHist hist;
+			uint32_t num = 0;
+
+			__disable_irq();
+			memcpy(&hist, (void*)&tpadLatHists[tpad][stage], 
+				sizeof(hist));
+			__enable_irq();
+
+			for (int bucket = 0; bucket < NUM_TPAD_LAT_BUCKETS; 
+				bucket++) {
+				num += hist.counts[bucket];
+			}
+
+			printf("  %-8s %9d %6d %6d %6d %6d |", STAGE_STRS[stage],
+				num, num ? hist.usSum / num : 0, 
+				num ? calcTpadLatPct(&hist, num, 50) : 0,
+				num ? calcTpadLatPct(&hist, num, 99) : 0,
+				hist.usMax);
+			for (int bucket = 0; bucket < NUM_TPAD_LAT_BUCKETS; 
+				bucket++) {
+				printf(" %6d", hist.counts[bucket]);
+			}
+			printf("\n");
+		}
+	}
+}
+#endif
+
+/**
+ * Print AnyMeas ADC settings in use for each Trackpad and where they came
+ *  from.
+ *
+ * \return None.
+ */
+void tpadPrintTune(void) {
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		const TpadAdcTune* tune = &tpadAdcTunes[tpad];
+
+		printf("%s Trackpad (%s): ", tpad == R_TRACKPAD ? "Right":"Left",
+			tpadTuneSrcStr(tpadTuneSrcs[tpad]));
+		printTpadAdcTune(tune);
+		printf(", signal scale %d/%d\n", tune->sigScale, 
+			TPAD_TUNE_SIG_SCALE_ONE);
+	}
+}
+
+/**
+ * Print frequency hopping settings, as well as noise seen and hops made for
+ *  each Trackpad.
+ *
+ * \return None.
+ */
+void tpadPrintHop(void) {
+	printf("Frequency hopping %s. Thresholds = %d/%d\n", 
+		tpadHopEn ? "enabled":"disabled", 
+		tpadHopHighThresh >> TPAD_NOISE_FRAC_BITS,
+		tpadHopLowThresh >> TPAD_NOISE_FRAC_BITS);
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		TpadHopStats stats;
+		int32_t slot_noises[NUM_TPAD_HOP_FREQS];
+
+		__disable_irq();
+		memcpy(&stats, (void*)&tpadHopStats[tpad], sizeof(stats));
+		memcpy(slot_noises, tpadHopSlotNoises[tpad], sizeof(slot_noises));
+		int slot = tpadHopSlots[tpad];
+		int32_t noise = tpadHopNoises[tpad];
+		bool noisy = tpadHopNoisys[tpad];
+		__enable_irq();
+
+		printf("%s Trackpad: toggle freq 0x%02x, noise %d.%02d%s, %d hops,"
+			" noisy for %d of %d frames\n", 
+			tpad == R_TRACKPAD ? "Right":"Left", 
+			tpadHopFreqs[tpad][slot], 
+			noise >> TPAD_NOISE_FRAC_BITS, 
+			100 * (noise & ((1 << TPAD_NOISE_FRAC_BITS) - 1)) >> 
+			TPAD_NOISE_FRAC_BITS, noisy ? " (noisy)":"", stats.hops, 
+			stats.noisyFrames, stats.frames);
+
+		printf("  Noise when last used:");
+		for (int idx = 0; idx < NUM_TPAD_HOP_FREQS; idx++) {
+			printf(" 0x%02x = %d", tpadHopFreqs[tpad][idx], 
+				slot_noises[idx] >> TPAD_NOISE_FRAC_BITS);
+		}
+		printf("\n");
+	}
+}
+
+/**
+ * Print presence probe settings and how often each Trackpad was idle, as
+ *  well as how long it took to go from idle to having a full frame with
+ *  touch.
+ *
+ * \return None.
+ */
+void tpadPrintPresence(void) {
+	printf("Presence probe %s. Threshold = %d\n", 
+		tpadPresenceEn ? "enabled":"disabled", tpadPresenceThresh);
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		TpadPresenceStats stats;
+
+		__disable_irq();
+		memcpy(&stats, (const void*)&tpadPresenceStats[tpad], 
+			sizeof(stats));
+		__enable_irq();
+
+		uint32_t frames = stats.probeFrames + stats.fullFrames;
+
+		printf("%s Trackpad: %s (last dev = %d). %d probe only, %d full"
+			" frames", tpad == R_TRACKPAD ? "Right":"Left", 
+			tpadTouchs[tpad] ? "touched":"idle", tpadPresenceDevs[tpad],
+			stats.probeFrames, stats.fullFrames);
+		if (frames) {
+			printf(" (%d%% probe only)", 
+				100 * stats.probeFrames / frames);
+		}
+		printf("\n");
+
+		printf("  %d wakes", stats.wakes);
+		if (stats.wakes) {
+			printf(". Idle to detect: avg %d us, max %d us. Detect to "
+				"full frame: avg %d us, max %d us", 
+				stats.detectUsSum / stats.wakes, stats.detectUsMax,
+				stats.fullUsSum / stats.wakes, stats.fullUsMax);
+		}
+		printf("\n");
+	}
+}
+
+/**
+ * Print raw and filtered fixed point positions for each Trackpad until a key
+ *  is pressed.
+ *
+ * \return None.
+ */
+void tpadPosMonitor(void) {
+	uint32_t seqs[2] = {0, 0};
+	TrackpadPos poss[2];
+	memset(poss, 0, sizeof(poss));
+
+	printf("Trackpad position in 1/16 units (Press any key to exit):\n");
+	printf("\n");
+	printf("Left Raw X/Y  Left Filt X/Y  Right Raw X/Y Right Filt X/Y\n");
+	printf("-----------------------------------------------------------\n");
+
+	while (!usb_tstc()) {
+		for (int tpad = L_TRACKPAD; tpad >= R_TRACKPAD; tpad--) {
+			const TrackpadPos* pos = &poss[tpad];
+			trackpadGetFramePos(tpad, &seqs[tpad], &poss[tpad]);
+			printf("%6d %6d %6d %6d ", pos->xRaw, pos->yRaw, pos->x,
+				pos->y);
+		}
+
+		printf("\r");
+		usb_flush();
+
+		usleep(10 * 1000);
+	}
+}
+
+/**
+ * Print contacts found on each Trackpad until key is pressed.
+ *
+ * \return None.
+ */
+void tpadContactsMonitor(void) {
+	uint32_t seqs[2] = {0, 0};
+	TrackpadContacts contacts[2];
+	memset(contacts, 0, sizeof(contacts));
+
+	printf("Trackpad contacts (ID X/Y strength) in 1/16 units "
+		"(Press any key to exit):\n");
+	printf("\n");
+
+	while (!usb_tstc()) {
+		for (int tpad = L_TRACKPAD; tpad >= R_TRACKPAD; tpad--) {
+			trackpadGetFrameContacts(tpad, &seqs[tpad], 
+				&contacts[tpad]);
+			printf("%s:", tpad == L_TRACKPAD ? "L" : "R");
+			for (int idx = 0; idx < TPAD_MAX_CONTACTS; idx++) {
+				const TrackpadContact* contact = 
+					&contacts[tpad].contacts[idx];
+				if (idx < contacts[tpad].num) {
+					printf(" %3d %5d %5d %6d", contact->id,
+						contact->x, contact->y, 
+						contact->strength);
+				} else {
+					printf("   - %5s %5s %6s", "-", "-", "-");
+				}
+			}
+			printf("  ");
+		}
+
+		printf("\r");
+		usb_flush();
+
+		usleep(10 * 1000);
+	}
+}
+
+/**
+ * Print speed adaptive position filter settings.
+ *
+ * \return None.
+ */
+void tpadPrintFilt(void) {
+	printf("Position filter %s. minCutoff = %d mHz, beta = %d, dCutoff = "
+		"%d mHz\n", tpadFiltEn ? "enabled":"disabled", 
+		tpadFiltParams.minCutoffMhz, tpadFiltParams.beta, 
+		tpadFiltParams.dCutoffMhz);
+}
+
+/**
+ * Print gesture recognition settings and how many cycles it takes per frame.
+ *
+ * \return None.
+ */
+void tpadPrintGesture(void) {
+	TpadGestureStats stats[2];
+
+	printf("Gesture recognition %s. flickSpeed = %d units/s, tau = %d ms, "
+		"stopSpeed = %d units/s, circleRadius = %d, circleStep = %d/65536 "
+		"turn\n", tpadGestureEn ? "enabled":"disabled", 
+		tpadGestureParams.flickSpeed, tpadGestureParams.inertiaTauMs,
+		tpadGestureParams.stopSpeed, tpadGestureParams.circleRadius,
+		tpadGestureParams.circleStep);
+
+	__disable_irq();
+	memcpy(stats, (void*)tpadGestureStats, sizeof(stats));
+	__enable_irq();
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		const TpadGestureStats* stat = &stats[tpad];
+		printf("%s Trackpad: %d frames, %d cycles/frame avg, %d max\n",
+			tpad == L_TRACKPAD ? "Left" : "Right", stat->frames,
+			stat->frames ? stat->cyclesSum / stat->frames : 0,
+			stat->cyclesMax);
+	}
+}
+
+/**
+ * Print gesture events, motion and scroll steps for each Trackpad until a
+ *  key is pressed.
+ *
+ * \return None.
+ */
+void tpadGestureMonitor(void) {
+	int32_t sums[2][3];
+	memset(sums, 0, sizeof(sums));
+
+	printf("Trackpad gestures. X/Y are summed motion in 1/16 units "
+		"(Press any key to exit):\n");
+	printf("\n");
+
+	while (!usb_tstc()) {
+		for (int tpad = L_TRACKPAD; tpad >= R_TRACKPAD; tpad--) {
+			TrackpadGesture gesture;
+			trackpadGetGesture(tpad, &gesture);
+			sums[tpad][0] += gesture.dx;
+			sums[tpad][1] += gesture.dy;
+			sums[tpad][2] += gesture.scrollSteps;
+
+			if (gesture.events & TPAD_GESTURE_FLICK) {
+				printf("\n%s flick at %d/%d units/s\n", 
+					tpad == L_TRACKPAD ? "L" : "R", gesture.vx, 
+					gesture.vy);
+			}
+			if (gesture.events & TPAD_GESTURE_CIRCLE_START) {
+				printf("\n%s circle start\n", 
+					tpad == L_TRACKPAD ? "L" : "R");
+			}
+
+			printf("%s: %7d %7d %5d %c%c  ", 
+				tpad == L_TRACKPAD ? "L" : "R", sums[tpad][0], 
+				sums[tpad][1], sums[tpad][2], 
+				gesture.coasting ? 'I' : '-',
+				gesture.circling ? 'C' : '-');
+		}
+
+		printf("\r");
+		usb_flush();
+
+		usleep(10 * 1000);
+	}
+}
+
+/**
+ * Print how background baseline tracking is going for each Trackpad.
+ *
+ * \return None.
+ */
+void tpadPrintBaseline(void) {
+	printf("Baseline tracking %s\n", tpadBaselineEn ? "enabled":"disabled");
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		TpadBaselineStats stats;
+		uint32_t age_us = 0;
+		int32_t dev = 0;
+		int max_drift = 0;
+		int max_drift_idx = 0;
+
+		__disable_irq();
+		memcpy(&stats, (const void*)&tpadBaselineStats[tpad], 
+			sizeof(stats));
+		trackpadGetBaseline(tpad, &age_us, &dev);
+		for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+			int drift = tpadAdcComps[tpad][idx] - 
+				tpadBaselineRefs[tpad][idx];
+			if (abs(drift) > abs(max_drift)) {
+				max_drift = drift;
+				max_drift_idx = idx;
+			}
+		}
+		__enable_irq();
+
+		printf("%s Trackpad: updated %d ms ago, last frame dev = %d, "
+			"max drift = %d (ADC %d)\n", 
+			tpad == R_TRACKPAD ? "Right":"Left", age_us / 1000, dev,
+			max_drift, max_drift_idx);
+		printf("  %d updates, %d fast updates, %d frozen frames, %d "
+			"restarts from unchanging touch\n", stats.updates, 
+			stats.fastUpdates, stats.frozen, stats.reseeds);
+	}
+}
+
+/**
+ * Print source and offsets of geometric correction grid for each Trackpad.
+ *
+ * \return None.
+ */
+void tpadPrintCorr(void) {
+	printf("Geometric correction %s\n", tpadCorrEn ? "enabled":"disabled");
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		printf("%s Trackpad: %s grid. X/Y offsets in 1/16 units "
+			"(top row first):\n", tpad == R_TRACKPAD ? "Right":"Left",
+			tpadCorrSrcStr(tpadCorrSrcs[tpad]));
+		for (int row = TPAD_CORR_NODES_Y - 1; row >= 0; row--) {
+			printf(" ");
+			for (int col = 0; col < TPAD_CORR_NODES_X; col++) {
+				printf(" %5d/%5d", tpadCorrGrids[tpad].dxs[row][col],
+					tpadCorrGrids[tpad].dys[row][col]);
+			}
+			printf("\n");
+		}
+	}
+}
+
+/**
+ * Start using geometric correction grid for a Trackpad and save it to 
+ *  EEPROM.
+ *
+ * \param trackpad Specifies which Trackpad grid is for.
+ * \param[in] grid Correction offsets.
+ * \param src Where grid came from.
+ *
+ * \return 0 on success.
+ */
+int tpadSetCorr(Trackpad trackpad, const TpadCorrGrid* grid, 
+	TpadCorrSrc src) {
+	__disable_irq();
+	tpadCorrGrids[trackpad] = *grid;
+	tpadCorrSrcs[trackpad] = src;
+	__enable_irq();
+
+	if (tpadCorrSave(trackpad, grid)) {
+		printf("Failed to save correction grid to EEPROM\n");
+		return -1;
+	}
+	printf("Saved correction grid to EEPROM.\n");
+
+	return 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * \file trackpad_gesture.c
+ * \brief Encompasses recognizing gestures (flicks with inertia and circular
+ *	scroll) from filtered Trackpad positions. Integer only and nothing here
+ *	touches hardware, so this can also be built and run on a host PC.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_gesture.h"
+
+#include <string.h>
+
+#define GESTURE_MAX_DT_US (50000) //!< Longer gaps between frames (i.e. 
+	//!< Trackpad was not being scanned) restart velocity estimate and limit
+	//!< how far inertia moves in one update.
+#define GESTURE_VEL_WEIGHT (2) //!< Each new velocity measurement moves 
+	//!< smoothed velocity 1/GESTURE_VEL_WEIGHT of the way toward it.
+#define GESTURE_US_PER_SEC_Q (1000000 >> TPAD_POS_FRAC_BITS) //!< Fixed point
+	//!< position delta times this over microseconds is units/second.
+
+#define GESTURE_CENTER_X ((TPAD_MAX_X / 2) << TPAD_POS_FRAC_BITS) //!< Center
+	//!< circular scroll goes around.
+#define GESTURE_CENTER_Y ((TPAD_MAX_Y / 2) << TPAD_POS_FRAC_BITS) //!< Center
+	//!< circular scroll goes around.
+
+#define CORDIC_INV_GAIN (39797) //!< 1/1.64676 (CORDIC gain) with 16 
+	//!< fractional bits.
+
+/**
+ * atan(2^-idx) in 1/65536 turn units for each CORDIC iteration.
+ */
+static const uint16_t cordicAtans[] = {
+	8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1
+};
+
+#define NUM_CORDIC_ITERS ((int)(sizeof(cordicAtans) / \
+	sizeof(cordicAtans[0]))) //!< Iterations (i.e. bits of angle) computed.
+
+/**
+ * Put gesture recognition back to state it is in with no finger down.
+ * 
+ * \param gesture Gesture state to reset.
+ *
+ * \return None.
+ */
+void tpadGestureReset(TpadGesture* gesture) {
+	memset(gesture, 0, sizeof(*gesture));
+}
+
+/**
+ * Compute angle and length of a vector using CORDIC (i.e. only shifts and
+ *  adds, with a fixed number of iterations).
+ * 
+ * \param x X component. Must be within +/-32767.
+ * \param y Y component. Must be within +/-32767.
+ * \param[out] mag Length of vector. Can be NULL if not needed.
+ *
+ * \return Angle counterclockwise from positive X axis in 1/65536 turn units.
+ */
+uint16_t tpadGestureAngle(int32_t x, int32_t y, int32_t* mag) {
+	uint16_t angle = 0;
+
+	// CORDIC only converges within about +/-90 degrees, so rotate left half
+	//  plane by half a turn first
+	if (x < 0) {
+		x = -x;
+		y = -y;
+		angle = 0x8000;
+	}
+
+	// Rotate vector onto X axis, keeping track of how far it was rotated
+	for (int idx = 0; idx < NUM_CORDIC_ITERS; idx++) {
+		int32_t x_step = x >> idx;
+		int32_t y_step = y >> idx;
+		if (y > 0) {
+			x += y_step;
+			y -= x_step;
+			angle += cordicAtans[idx];
+		} else {
+			x -= y_step;
+			y += x_step;
+			angle -= cordicAtans[idx];
+		}
+	}
+
+	if (mag) {
+		*mag = ((uint32_t)x * CORDIC_INV_GAIN) >> 16;
+	}
+
+	return angle;
+}
+
+/**
+ * Limit velocity so inertia math cannot overflow.
+ * 
+ * \param vel Velocity in units/second.
+ *
+ * \return Velocity within +/-TPAD_GESTURE_MAX_SPEED.
+ */
+static inline int32_t clampVel(int32_t vel) {
+	if (vel > TPAD_GESTURE_MAX_SPEED) {
+		return TPAD_GESTURE_MAX_SPEED;
+	} else if (vel < -TPAD_GESTURE_MAX_SPEED) {
+		return -TPAD_GESTURE_MAX_SPEED;
+	}
+	return vel;
+}
+
+/**
+ * Approximate magnitude of velocity (larger axis plus half of smaller is 
+ *  within about 12% of true length).
+ * 
+ * \param vx X velocity.
+ * \param vy Y velocity.
+ *
+ * \return Approximate speed.
+ */
+static inline uint32_t approxSpeed(int32_t vx, int32_t vy) {
+	uint32_t ax = vx < 0 ? -vx : vx;
+	uint32_t ay = vy < 0 ? -vy : vy;
+
+	if (ax > ay) {
+		return ax + ay / 2;
+	}
+	return ay + ax / 2;
+}
+
+/**
+ * Apply exponential decay to a velocity over a time step (first order, with
+ *  decrease rounded up so velocity always reaches zero).
+ * 
+ * \param vel Velocity in units/second.
+ * \param dtUs Time step in microseconds.
+ * \param tauUs Time constant of decay in microseconds.
+ *
+ * \return Decayed velocity.
+ */
+static int32_t decayVel(int32_t vel, uint32_t dtUs, uint32_t tauUs) {
+	uint32_t mag = vel < 0 ? -vel : vel;
+
+	if (dtUs >= tauUs) {
+		return 0;
+	}
+
+	uint32_t dec = (mag * dtUs + tauUs - 1) / tauUs;
+	mag = dec >= mag ? 0 : mag - dec;
+
+	return vel < 0 ? -(int32_t)mag : (int32_t)mag;
+}
+
+/**
+ * Convert position to vector from center used for circular scroll. Y is 
+ *  scaled up so a circle that fills Trackpad is round.
+ * 
+ * \param xPos X position (TPAD_POS_FRAC_BITS fixed point).
+ * \param yPos Y position (TPAD_POS_FRAC_BITS fixed point).
+ * \param[out] x X component of vector.
+ * \param[out] y Y component of vector.
+ *
+ * \return None.
+ */
+static inline void calcCircleVec(int32_t xPos, int32_t yPos, int32_t* x, 
+	int32_t* y) {
+	*x = xPos - GESTURE_CENTER_X;
+	*y = (yPos - GESTURE_CENTER_Y) * TPAD_MAX_X / TPAD_MAX_Y;
+}
+
+/**
+ * Check if finger touched down on ring where circular scroll can start.
+ * 
+ * \param gesture Gesture state.
+ * \param params Gesture tuning.
+ * \param xPos X position (TPAD_POS_FRAC_BITS fixed point).
+ * \param yPos Y position (TPAD_POS_FRAC_BITS fixed point).
+ *
+ * \return None.
+ */
+static void startCircle(TpadGesture* gesture, const TpadGestureParams* params,
+	int32_t xPos, int32_t yPos) {
+	int32_t x = 0;
+	int32_t y = 0;
+	int32_t mag = 0;
+
+	calcCircleVec(xPos, yPos, &x, &y);
+	gesture->angle = tpadGestureAngle(x, y, &mag);
+	gesture->angleSum = 0;
+
+	if (params->circleStep && 
+		mag >= (int32_t)(params->circleRadius << TPAD_POS_FRAC_BITS)) {
+		gesture->circle = TPAD_CIRCLE_ARMED;
+	} else {
+		gesture->circle = TPAD_CIRCLE_NONE;
+	}
+}
+
+/**
+ * Accumulate angle finger has gone around center and turn it into circular
+ *  scroll steps.
+ * 
+ * \param gesture Gesture state.
+ * \param params Gesture tuning.
+ * \param xPos X position (TPAD_POS_FRAC_BITS fixed point).
+ * \param yPos Y position (TPAD_POS_FRAC_BITS fixed point).
+ * \param[out] out Events and steps are added to this.
+ *
+ * \return None.
+ */
+static void updateCircle(TpadGesture* gesture, const TpadGestureParams* params,
+	int32_t xPos, int32_t yPos, TpadGestureOut* out) {
+	int32_t x = 0;
+	int32_t y = 0;
+	int32_t mag = 0;
+	int32_t step = params->circleStep;
+
+	if (gesture->circle == TPAD_CIRCLE_NONE) {
+		return;
+	}
+
+	calcCircleVec(xPos, yPos, &x, &y);
+	uint16_t angle = tpadGestureAngle(x, y, &mag);
+
+	if (!step || 
+		mag < (int32_t)((params->circleRadius << TPAD_POS_FRAC_BITS) * 3/4)) {
+		if (gesture->circle == TPAD_CIRCLE_ACTIVE) {
+			out->events |= TPAD_GESTURE_CIRCLE_END;
+		}
+		gesture->circle = TPAD_CIRCLE_NONE;
+		return;
+	}
+
+	// Wrap around is handled by difference being taken modulo one turn
+	gesture->angleSum += (int16_t)(angle - gesture->angle);
+	gesture->angle = angle;
+
+	if (gesture->circle == TPAD_CIRCLE_ARMED) {
+		if (gesture->angleSum < 2 * step && gesture->angleSum > -2 * step) {
+			return;
+		}
+		gesture->circle = TPAD_CIRCLE_ACTIVE;
+		out->events |= TPAD_GESTURE_CIRCLE_START;
+	}
+
+	int32_t steps = gesture->angleSum / step;
+	if (steps) {
+		gesture->angleSum -= steps * step;
+		// Angle increases counterclockwise
+		out->steps -= steps;
+		out->events |= TPAD_GESTURE_CIRCLE_STEP;
+	}
+}
+
+/**
+ * Move by inertia and decay it.
+ * 
+ * \param gesture Gesture state.
+ * \param params Gesture tuning.
+ * \param dtUs Time since last update.
+ * \param[out] out Events and motion are added to this.
+ *
+ * \return None.
+ */
+static void coast(TpadGesture* gesture, const TpadGestureParams* params,
+	uint32_t dtUs, TpadGestureOut* out) {
+	// Remainders carry motion too small to output to next update
+	int32_t x_num = gesture->vx * (int32_t)dtUs + gesture->remX;
+	int32_t y_num = gesture->vy * (int32_t)dtUs + gesture->remY;
+	out->dx += x_num / GESTURE_US_PER_SEC_Q;
+	out->dy += y_num / GESTURE_US_PER_SEC_Q;
+	gesture->remX = x_num % GESTURE_US_PER_SEC_Q;
+	gesture->remY = y_num % GESTURE_US_PER_SEC_Q;
+
+	uint32_t tau_us = params->inertiaTauMs * 1000;
+	gesture->vx = decayVel(gesture->vx, dtUs, tau_us);
+	gesture->vy = decayVel(gesture->vy, dtUs, tau_us);
+
+	int32_t stop = params->stopSpeed;
+	if (gesture->vx <= stop && gesture->vx >= -stop && 
+		gesture->vy <= stop && gesture->vy >= -stop) {
+		gesture->coasting = false;
+		gesture->vx = 0;
+		gesture->vy = 0;
+		out->events |= TPAD_GESTURE_INERTIA_END;
+	}
+}
+
+/**
+ * Run gesture recognition on position from a new frame. Cost is bounded: at
+ *  most one CORDIC, a handful of divides and no loops that depend on input.
+ * 
+ * \param gesture Gesture state for Trackpad frame is from.
+ * \param params Gesture tuning.
+ * \param touch True if finger is down.
+ * \param xPos X position (TPAD_POS_FRAC_BITS fixed point). Ignored if touch
+ *	is false.
+ * \param yPos Y position (TPAD_POS_FRAC_BITS fixed point). Ignored if touch
+ *	is false.
+ * \param timestampUs When frame was captured.
+ * \param[out] out What this frame produced.
+ *
+ * \return None.
+ */
+void tpadGestureUpdate(TpadGesture* gesture, const TpadGestureParams* params,
+	bool touch, int32_t xPos, int32_t yPos, uint32_t timestampUs, 
+	TpadGestureOut* out) {
+	memset(out, 0, sizeof(*out));
+
+	uint32_t dt_us = timestampUs - gesture->lastUs;
+	bool stale = dt_us > GESTURE_MAX_DT_US;
+	if (stale) {
+		dt_us = GESTURE_MAX_DT_US;
+	}
+	gesture->lastUs = timestampUs;
+
+	if (touch) {
+		if (gesture->coasting) {
+			// Finger caught whatever was coasting
+			gesture->coasting = false;
+			out->events |= TPAD_GESTURE_INERTIA_END;
+		}
+
+		if (!gesture->touch || stale) {
+			gesture->vx = 0;
+			gesture->vy = 0;
+			startCircle(gesture, params, xPos, yPos);
+		} else {
+			int32_t dx = xPos - gesture->x;
+			int32_t dy = yPos - gesture->y;
+			out->dx = dx;
+			out->dy = dy;
+			if (dt_us) {
+				int32_t vx = clampVel(dx * GESTURE_US_PER_SEC_Q / 
+					(int32_t)dt_us);
+				int32_t vy = clampVel(dy * GESTURE_US_PER_SEC_Q / 
+					(int32_t)dt_us);
+				gesture->vx += (vx - gesture->vx) / GESTURE_VEL_WEIGHT;
+				gesture->vy += (vy - gesture->vy) / GESTURE_VEL_WEIGHT;
+			}
+			updateCircle(gesture, params, xPos, yPos, out);
+		}
+
+		gesture->touch = true;
+		gesture->x = xPos;
+		gesture->y = yPos;
+		return;
+	}
+
+	if (gesture->touch) {
+		gesture->touch = false;
+		if (gesture->circle == TPAD_CIRCLE_ACTIVE) {
+			// Motion was for scrolling, so it should not coast
+			out->events |= TPAD_GESTURE_CIRCLE_END;
+		} else if (!stale && approxSpeed(gesture->vx, gesture->vy) >= 
+			params->flickSpeed) {
+			gesture->coasting = true;
+			gesture->remX = 0;
+			gesture->remY = 0;
+			out->events |= TPAD_GESTURE_FLICK;
+		}
+		gesture->circle = TPAD_CIRCLE_NONE;
+
+		if (!gesture->coasting) {
+			gesture->vx = 0;
+			gesture->vy = 0;
+		}
+		return;
+	}
+
+	if (gesture->coasting) {
+		coast(gesture, params, dt_us, out);
+	}
+}
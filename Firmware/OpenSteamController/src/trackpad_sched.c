@@ -0,0 +1,923 @@
+/**
+ * \file trackpad_sched.c
+ * \brief Encompasses scheduling of Trackpad frames. Timer and Data Ready 
+ *	interrupt handlers only capture and publish frames, while presence,
+ *	baseline and noise tracking is deferred to PendSV.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_int.h"
+
+#include <string.h>
+
+volatile uint32_t tpadDrUs[2]; //!< When DR was last seen for each
+	//!< Trackpad.
+volatile uint32_t tpadFrameStartUs[2]; //!< When frame in progress was
+	//!< started for each Trackpad.
+
+static volatile uint32_t tpadMeasStartUs[2]; //!< When last measurement was
+	//!< requested or last ADC value read for each Trackpad (i.e. when
+	//!< Trackpad ASIC started working towards next DR).
+
+#define TPAD_BASELINE_UPDATE_US (50 * 1000) //!< Baseline is updated from at
+	//!< most one frame per period. Idle Trackpads also get a full frame
+	//!< (instead of presence probe) at this rate so baseline keeps tracking.
+#define TPAD_BASELINE_SHIFT (6) //!< New frame is given 1/2^shift weight in
+	//!< baseline average (i.e. ~3.2 second time constant).
+#define TPAD_BASELINE_FAST_SHIFT (2) //!< Weight used (every frame) when 
+	//!< profile shows baseline was taken with something on Trackpad.
+#define TPAD_BASELINE_TOUCH_THRESH (400) //!< Largest raw demodulated profile
+	//!< value (of either sign) for frame to be considered to have nothing
+	//!< on Trackpad.
+#define TPAD_BASELINE_STUCK_US (60 * 1000 * 1000) //!< Baseline is restarted
+	//!< from current frame if frames that look like touch have not changed
+	//!< for this long, so drift that looks like touch cannot freeze it for
+	//!< good. A finger moves at least a little in this time.
+#define TPAD_BASELINE_STILL_DEV (50) //!< Largest difference in any ADC value
+	//!< between frames for profile to be considered unchanged.
+
+volatile bool tpadBaselineEn = true; //!< Enables background update of
+	//!< tpadAdcComps from frames with no touch.
+SRAM1_BSS int32_t tpadBaselines[2][NUM_ANYMEAS_ADCS]; //!< Running 
+	//!< average of ADC values with no touch (TPAD_BASELINE_FRAC_BITS fixed point). 
+	//!< tpadAdcComps is this rounded to integer.
+SRAM1_BSS int16_t tpadBaselineRefs[2][NUM_ANYMEAS_ADCS]; //!< 
+	//!< Compensation values baseline tracking started from (i.e. at boot or
+	//!< recalibration).
+uint32_t tpadBaselineUs[2]; //!< When baseline was last updated.
+uint32_t tpadBaselineCheckUs[2]; //!< When a full frame was last 
+	//!< checked for baseline update.
+bool tpadBaselineFrozens[2]; //!< True while baseline is frozen by
+	//!< touch.
+static uint32_t tpadBaselineFreezeUs[2]; //!< When frames that froze 
+	//!< baseline last changed (i.e. start of current run of frozen frames 
+	//!< that look the same).
+SRAM1_BSS static int16_t tpadBaselineStills[2][NUM_ANYMEAS_ADCS]; //!< ADC
+	//!< values of frame that started current run of frozen frames that 
+	//!< look the same.
+volatile int32_t tpadBaselineDevs[2]; //!< Raw profile value furthest
+	//!< from zero in last checked frame.
+volatile TpadBaselineStats tpadBaselineStats[2]; //!< Baseline stats
+	//!< for each Trackpad.
+volatile bool tpadBaselineSeedReqs[2]; //!< Set when tpadAdcComps are
+	//!< swapped (i.e. by frequency hop) so baseline tracking restarts from 
+	//!< them. Baseline does not update tpadAdcComps while this is set.
+
+LPC_TIMER_T* const tpadSchedTimer = LPC_TIMER32_1; //!< Timer used to
+	//!< start frames at target rate. Match register N is for Trackpad N.
+volatile bool tpadSchedEn = false; //!< True when scan scheduler is
+	//!< keeping Trackpads scanning continuously (i.e. trackpadLocUpdate()
+	//!< is not needed).
+uint32_t tpadSchedFps = 0; //!< Target frame rate of scan scheduler.
+static uint32_t tpadSchedPeriodUs = 0; //!< Time between frame starts. 0
+	//!< means next frame is started as soon as last one is complete.
+static uint32_t tpadSchedStarts[2]; //!< When (in tpadSchedTimer ticks) 
+	//!< current frame was scheduled to start for each Trackpad.
+#define TPAD_SCHED_STOP_TIMEOUT_US (50 * 1000) //!< Longest trackpadSchedStop()
+	//!< waits for frame in progress before abandoning it (i.e. because a
+	//!< DR edge was missed).
+
+#define TPAD_DEFER_POS (1 << 0) //!< Deferred work flag: pass position from
+	//!< latest frame to tpadPosCallback.
+#define TPAD_DEFER_FULL (1 << 1) //!< Deferred work flag: presence, baseline
+	//!< and noise tracking for latest full frame.
+volatile uint8_t tpadDefers[2]; //!< TPAD_DEFER_* flags set by SSP0 
+	//!< IRQ once frame is published, for PendSV to act on.
+
+#define NUM_TPAD_PROBE_ADCS (2) //!< Number of AnyMeas ADCs (from start of X
+	//!< axis measurements) taken by presence probe while Trackpad is idle.
+	//!< Every X measurement sees every electrode column (with a sign of 
+	//!< +/-1), so any finger shows up in each of them. Two are used so 
+	//!< that two fingers cancelling out in one measurement are still seen.
+#define TPAD_PRESENCE_DFLT_THRESH (150) //!< Default sum of absolute 
+	//!< differences between probe ADCs and compensation values that is
+	//!< considered a touch.
+#define TPAD_PRESENCE_HOLD_FRAMES (16) //!< Number of full frames in a row
+	//!< that must be under half the threshold before Trackpad goes back to
+	//!< presence probe only.
+
+volatile bool tpadPresenceEn = true; //!< When set scan scheduler only
+	//!< runs presence probe on idle Trackpads.
+volatile int32_t tpadPresenceThresh = TPAD_PRESENCE_DFLT_THRESH; //!<
+	//!< Probe deviation that is considered a touch.
+volatile bool tpadTouchs[2]; //!< True while Trackpad is considered 
+	//!< touched (i.e. full frames are captured).
+volatile bool tpadProbings[2]; //!< True while frame in progress is 
+	//!< only a presence probe.
+static bool tpadWakings[2]; //!< True while frame in progress was upgraded
+	//!< from a probe to a full frame.
+static uint32_t tpadNoTouchCnts[2]; //!< Number of full frames in a row that
+	//!< have been under release threshold.
+static uint32_t tpadIdleUs[2]; //!< When Trackpad was last seen idle.
+static uint32_t tpadWakeUs[2]; //!< When probe detected touch.
+volatile int32_t tpadPresenceDevs[2]; //!< Last probe deviation.
+volatile TpadPresenceStats tpadPresenceStats[2]; //!< Presence probe
+	//!< stats for each Trackpad.
+
+#define TPAD_HOP_DFLT_HIGH_THRESH (40 << TPAD_NOISE_FRAC_BITS) //!< Default 
+	//!< average frame noise (in default ADC settings units) above which a
+	//!< Trackpad is considered to be in a noisy environment.
+#define TPAD_HOP_DFLT_LOW_THRESH (20 << TPAD_NOISE_FRAC_BITS) //!< Default
+	//!< average frame noise below which a Trackpad is no longer considered
+	//!< to be in a noisy environment.
+#define TPAD_HOP_AVG_SHIFT (3) //!< New frame noise is given 1/2^shift weight
+	//!< in average.
+#define TPAD_HOP_MIN_FRAMES (8) //!< Full frames that must be measured on a 
+	//!< frequency before hopping away from it.
+#define TPAD_HOP_DWELL_US (250 * 1000) //!< Shortest time spent on a frequency
+	//!< before hopping away from it (or considering hopping again).
+
+volatile bool tpadHopEn = true; //!< When set scan scheduler hops 
+	//!< between toggle frequencies when noise is seen.
+volatile int32_t tpadHopHighThresh = TPAD_HOP_DFLT_HIGH_THRESH; //!<
+	//!< Average frame noise that starts hopping.
+volatile int32_t tpadHopLowThresh = TPAD_HOP_DFLT_LOW_THRESH; //!<
+	//!< Average frame noise that ends hopping.
+
+volatile uint8_t tpadHopSlots[2]; //!< Index into tpadHopFreqs of
+	//!< frequency measurements are taken with. Latched from tpadHopNextSlots
+	//!< at start of each frame so a frame is never split across two.
+volatile uint8_t tpadHopNextSlots[2]; //!< Index into tpadHopFreqs of
+	//!< frequency noise tracking has chosen.
+
+volatile bool tpadHopNoisys[2]; //!< True while Trackpad is 
+	//!< considered to be in a noisy environment.
+volatile int32_t tpadHopNoises[2]; //!< Average frame noise on 
+	//!< current frequency.
+int32_t tpadHopSlotNoises[2][NUM_TPAD_HOP_FREQS]; //!< Average frame
+	//!< noise when each frequency was last used. Fades over time so noisy
+	//!< frequencies eventually get retried.
+uint32_t tpadHopFrames[2]; //!< Full frames taken since last hop.
+static uint32_t tpadHopUs[2]; //!< When frequency was last changed (or 
+	//!< considered for change).
+SRAM1_BSS static int16_t tpadNoiseHists[2][2][NUM_ANYMEAS_ADCS]; //!< Last
+	//!< (and one before last) full frame of ADC values for each Trackpad.
+volatile TpadHopStats tpadHopStats[2]; //!< Hop stats for each 
+	//!< Trackpad.
+
+/**
+ * Setup and start AnyMeas measurements from ISR context. All register writes
+ *  are done in a single SPI burst, with writes to registers that already 
+ *  have the needed value left out. When scan scheduler is running this 
+ *  is also where hops to a new toggle frequency take effect.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * \param adcAddr Defines where ADC reads start.
+ * \param numMeas The number of measurements to take.
+ * 
+ * \return None.
+ */
+static void startTpadMeasIsr(Trackpad trackpad, uint16_t adcAddr, 
+	uint8_t numMeas) {
+	const uint8_t regs[4][2] = {
+		{TPAD_ADC_START_ADDR_HI_ADDR, 0xFF & (adcAddr >> 8)},
+		{TPAD_ADC_START_ADDR_LO_ADDR, 0xFF & adcAddr},
+		{TPAD_MEASCTRL_ADDR, TPAD_MEASCTRL_NUMMEAS_MASK & numMeas},
+		{TPAD_ADCCFG1_ADDR, tpadAdcTunes[trackpad].gain | 
+			tpadHopFreqs[trackpad][tpadHopSlots[trackpad]]}
+	};
+	const uint8_t syscfg1 = TPAD_SYSCFG1_ANYMEASEN_BIT | 
+		TPAD_SYSCFG1_TRACKDIS_BIT;
+	uint8_t* tx_data = tpadMeasStartTxDatas[trackpad];
+	uint8_t len = 0;
+	// Only scan scheduler hops frequencies. Otherwise toggle frequency is 
+	//  left alone (i.e. so tuning can sweep it)
+	int num_regs = tpadSchedEn ? 4 : 3;
+
+	for (int idx = 0; idx < num_regs; idx++) {
+		if (tpadRegHasVal(trackpad, regs[idx][0], regs[idx][1])) {
+			tpadRegElided[trackpad]++;
+			continue;
+		}
+		tx_data[len++] = 0x80 | regs[idx][0];
+		tx_data[len++] = regs[idx][1];
+		noteTpadRegWrite(trackpad, regs[idx][0], regs[idx][1]);
+	}
+
+	// Start the measurements
+	tx_data[len++] = 0x80 | TPAD_SYSCFG1_ADDR;
+	tx_data[len++] = syscfg1;
+	noteTpadRegWrite(trackpad, TPAD_SYSCFG1_ADDR, syscfg1);
+
+	tpadMeasStartXfers[trackpad].len = len;
+	tpadMeasStartUs[trackpad] = getUsTickCnt();
+	tpadSpiSubmit(&tpadMeasStartXfers[trackpad]);
+}
+
+/**
+ * Start capturing a new frame (i.e. X and then Y AnyMeas ADC values). If 
+ *  Trackpad is idle and presence probing is enabled only the first 
+ *  NUM_TPAD_PROBE_ADCS X ADCs are requested, and the rest are only requested
+ *  if a touch is seen (see tpadProbeDone()). Exception is when baseline 
+ *  tracking is due a full frame. Does nothing if Trackpad is not in AnyMeas
+ *  mode. Needs to be called with IRQs that update tpadAdcIdxs unable to 
+ *  preempt.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return None.
+ */
+static void startTpadFrame(Trackpad trackpad) {
+	// Trackpad ASIC sends frames on its own in absolute mode
+	if (tpadModes[trackpad] != TPAD_MODE_ANYMEAS) {
+		return;
+	}
+
+	tpadAdcIdxs[trackpad] = 0;
+	tpadFrameStartUs[trackpad] = getUsTickCnt();
+	tpadHopSlots[trackpad] = tpadHopNextSlots[trackpad];
+
+	// Idle Trackpads still need occasional full frame for baseline tracking
+	bool baseline_due = tpadBaselineEn && getUsTickCnt() - 
+		tpadBaselineCheckUs[trackpad] >= TPAD_BASELINE_UPDATE_US;
+
+	if (tpadPresenceEn && !tpadTouchs[trackpad] && !baseline_due) {
+		tpadProbings[trackpad] = true;
+		startTpadMeasIsr(trackpad, ANYMEAS_X_ADC_ADDR, 
+			NUM_TPAD_PROBE_ADCS);
+	} else {
+		tpadProbings[trackpad] = false;
+		startTpadMeasIsr(trackpad, ANYMEAS_X_ADC_ADDR, 
+			NUM_ANYMEAS_X_ADCS);
+	}
+}
+
+/**
+ * Compute how far presence probe ADCs are from compensation values.
+ * 
+ * \param trackpad Specifies which trackpad to check.
+ * \param[in] adcs AnyMeas ADC values (only probe ones are looked at).
+ * \param[in] comps Compensation values for adcs.
+ * 
+ * \return Sum of absolute differences of probe ADCs.
+ */
+static int32_t calcTpadProbeDev(Trackpad trackpad, 
+	const volatile int16_t* adcs, const int16_t* comps) {
+	int32_t dev = 0;
+
+	for (int idx = 0; idx < NUM_TPAD_PROBE_ADCS; idx++) {
+		int32_t diff = adcs[idx] - comps[idx];
+		dev += diff < 0 ? -diff : diff;
+	}
+
+	tpadPresenceDevs[trackpad] = dev;
+
+	return dev;
+}
+
+/**
+ * Called once presence probe ADCs have been read. If a touch is seen the 
+ *  rest of the frame is requested right away, otherwise an idle frame is 
+ *  published.
+ * 
+ * \param trackpad Specifies which trackpad probe was run on.
+ * 
+ * \return True if frame is continuing as a full frame.
+ */
+static bool tpadProbeDone(Trackpad trackpad) {
+	volatile TpadPresenceStats* stats = &tpadPresenceStats[trackpad];
+	uint32_t now = getUsTickCnt();
+
+	if (calcTpadProbeDev(trackpad, tpadAdcDatas[trackpad], 
+		tpadAdcComps[trackpad]) < 
+		scaleTpadThresh(trackpad, tpadPresenceThresh)) {
+		tpadIdleUs[trackpad] = now;
+		stats->probeFrames++;
+		publishTpadFrame(trackpad, true, NULL);
+		deferTpadWork(trackpad, TPAD_DEFER_POS);
+		return false;
+	}
+
+	uint32_t detect_us = now - tpadIdleUs[trackpad];
+	stats->wakes++;
+	stats->detectUsSum += detect_us;
+	if (detect_us > stats->detectUsMax) {
+		stats->detectUsMax = detect_us;
+	}
+
+	tpadTouchs[trackpad] = true;
+	tpadNoTouchCnts[trackpad] = 0;
+	tpadProbings[trackpad] = false;
+	tpadWakings[trackpad] = true;
+	tpadWakeUs[trackpad] = now;
+
+	// Probe ADCs are first X ADCs, so carry on from there
+	startTpadMeasIsr(trackpad, ANYMEAS_X_ADC_ADDR + NUM_TPAD_PROBE_ADCS * 
+		ANYMEAS_ADC_ADDR_STEP, NUM_ANYMEAS_X_ADCS - NUM_TPAD_PROBE_ADCS);
+
+	return true;
+}
+
+/**
+ * Called (from PendSV) once a full frame has been published by scan 
+ *  scheduler to decide if Trackpad has gone idle.
+ * 
+ * \param trackpad Specifies which trackpad frame is from.
+ * \param[in] adcs AnyMeas ADC values of frame.
+ * \param[in] comps Compensation values of frame.
+ * 
+ * \return None.
+ */
+static void tpadFullFrameDone(Trackpad trackpad, const int16_t* adcs, 
+	const int16_t* comps) {
+	volatile TpadPresenceStats* stats = &tpadPresenceStats[trackpad];
+	uint32_t now = getUsTickCnt();
+
+	stats->fullFrames++;
+
+	if (tpadWakings[trackpad]) {
+		uint32_t full_us = now - tpadWakeUs[trackpad];
+		stats->fullUsSum += full_us;
+		if (full_us > stats->fullUsMax) {
+			stats->fullUsMax = full_us;
+		}
+		tpadWakings[trackpad] = false;
+	}
+
+	// Release at half of threshold so probe noise near threshold does 
+	//  not keep flipping between probe and full frames
+	if (calcTpadProbeDev(trackpad, adcs, comps) >= 
+		scaleTpadThresh(trackpad, tpadPresenceThresh) / 2) {
+		tpadNoTouchCnts[trackpad] = 0;
+	} else if (++tpadNoTouchCnts[trackpad] >= TPAD_PRESENCE_HOLD_FRAMES) {
+		tpadTouchs[trackpad] = false;
+		tpadIdleUs[trackpad] = now;
+	}
+}
+
+/**
+ * Called (from PendSV) once a full frame has been published by scan 
+ *  scheduler to update baseline (i.e. compensation values) if frame has 
+ *  nothing on Trackpad.
+ *
+ * Frame is classified using raw demodulated profile: a finger shows up as a
+ *  positive value, so baseline is frozen. A large negative value means 
+ *  baseline was taken with something on the Trackpad (i.e. hand resting on
+ *  it at boot) and it is pulled in quickly. Otherwise a slow exponential
+ *  moving average follows drift.
+ *
+ * Frames that look like touch are never averaged in. Drift large enough to 
+ *  look like touch is told apart from a finger by the frame not changing at 
+ *  all for TPAD_BASELINE_STUCK_US, in which case baseline is restarted from
+ *  the frame.
+ *
+ * SSP0 IRQ can swap in other compensation values (i.e. frequency hop) at any
+ *  point, so baseline restarts from those if it has, frames captured against
+ *  any others are skipped, and tpadAdcComps is only written with IRQs 
+ *  disabled.
+ * 
+ * \param trackpad Specifies which trackpad frame is from.
+ * \param[in] adcs AnyMeas ADC values of frame.
+ * \param[in] comps Compensation values of frame.
+ * 
+ * \return None.
+ */
+static void trackTpadBaseline(Trackpad trackpad, const int16_t* adcs, 
+	const int16_t* comps) {
+	volatile TpadBaselineStats* stats = &tpadBaselineStats[trackpad];
+	int16_t* stills = tpadBaselineStills[trackpad];
+	int32_t bins[NUM_TPAD_MAX_BINS];
+	int32_t pos_max = 0;
+	int32_t neg_max = 0;
+	uint32_t now = getUsTickCnt();
+
+	tpadBaselineCheckUs[trackpad] = now;
+
+	__disable_irq();
+	if (tpadBaselineSeedReqs[trackpad]) {
+		seedTpadBaseline(trackpad);
+	}
+	bool stale = memcmp(comps, tpadAdcComps[trackpad], 
+		sizeof(tpadAdcComps[trackpad]));
+	__enable_irq();
+
+	if (stale) {
+		return;
+	}
+
+	for (int axis = TPAD_AXIS_X; axis <= TPAD_AXIS_Y; axis++) {
+		int num_bins = tpadDemodAxis(axis, adcs, comps, bins);
+		for (int idx = 0; idx < num_bins; idx++) {
+			if (bins[idx] > pos_max) {
+				pos_max = bins[idx];
+			} else if (-bins[idx] > neg_max) {
+				neg_max = -bins[idx];
+			}
+		}
+	}
+	tpadBaselineDevs[trackpad] = pos_max >= neg_max ? pos_max : -neg_max;
+
+	int shift = TPAD_BASELINE_SHIFT;
+	int32_t thresh = scaleTpadThresh(trackpad, TPAD_BASELINE_TOUCH_THRESH);
+	if (pos_max > thresh) {
+		stats->frozen++;
+
+		bool still = tpadBaselineFrozens[trackpad];
+		int32_t still_dev = scaleTpadThresh(trackpad, 
+			TPAD_BASELINE_STILL_DEV);
+		for (int idx = 0; still && idx < NUM_ANYMEAS_ADCS; idx++) {
+			int32_t diff = adcs[idx] - stills[idx];
+			still = diff <= still_dev && diff >= -still_dev;
+		}
+
+		if (!still) {
+			tpadBaselineFrozens[trackpad] = true;
+			tpadBaselineFreezeUs[trackpad] = now;
+			for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+				stills[idx] = adcs[idx];
+			}
+			return;
+		}
+
+		if (now - tpadBaselineFreezeUs[trackpad] < 
+			TPAD_BASELINE_STUCK_US) {
+			return;
+		}
+
+		// Nothing but drift stays this still, so frame becomes baseline
+		tpadBaselineFrozens[trackpad] = false;
+		shift = 0;
+		stats->reseeds++;
+	} else {
+		tpadBaselineFrozens[trackpad] = false;
+		if (neg_max > thresh) {
+			shift = TPAD_BASELINE_FAST_SHIFT;
+			stats->fastUpdates++;
+		} else if (now - tpadBaselineUs[trackpad] < 
+			TPAD_BASELINE_UPDATE_US) {
+			return;
+		} else {
+			stats->updates++;
+		}
+	}
+
+	tpadBaselineUs[trackpad] = now;
+
+	int32_t* baselines = tpadBaselines[trackpad];
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		int32_t adc = adcs[idx] * (1 << TPAD_BASELINE_FRAC_BITS);
+		baselines[idx] += (adc - baselines[idx]) >> shift;
+	}
+
+	__disable_irq();
+	for (int idx = 0; !tpadBaselineSeedReqs[trackpad] && 
+		idx < NUM_ANYMEAS_ADCS; idx++) {
+		tpadAdcComps[trackpad][idx] = (baselines[idx] + 
+			(1 << (TPAD_BASELINE_FRAC_BITS - 1))) >> 
+			TPAD_BASELINE_FRAC_BITS;
+	}
+	__enable_irq();
+}
+
+/**
+ * Update noise estimate for Trackpad from last full frame and hop to another
+ *  toggle frequency if Trackpad is in a noisy environment. Trackpad is
+ *  considered noisy once average frame noise goes over tpadHopHighThresh
+ *  and until it drops under tpadHopLowThresh. While noisy, every 
+ *  TPAD_HOP_DWELL_US the frequency that was quietest when it was last used
+ *  is hopped to, if it was quieter than the current one. Hop takes effect 
+ *  when next frame is started. Called from PendSV once full frame has been
+ *  published.
+ * 
+ * \param trackpad Specifies which trackpad frame was captured for.
+ * \param[in] adcs AnyMeas ADC values of frame.
+ * \param slot Index into tpadHopFreqs of frequency frame was measured with.
+ * 
+ * \return None.
+ */
+static void trackTpadNoise(Trackpad trackpad, const int16_t* adcs, int slot) {
+	volatile TpadHopStats* stats = &tpadHopStats[trackpad];
+	int16_t (*hists)[NUM_ANYMEAS_ADCS] = tpadNoiseHists[trackpad];
+	uint32_t frames = tpadHopFrames[trackpad];
+	int32_t noise = 0;
+
+	// Frame was started before last hop took effect
+	if (slot != tpadHopNextSlots[trackpad]) {
+		return;
+	}
+
+	if (frames >= 2) {
+		noise = tpadFrameNoise(adcs, hists[0], hists[1]);
+	}
+
+	memcpy(hists[1], hists[0], sizeof(hists[1]));
+	memcpy(hists[0], adcs, sizeof(hists[0]));
+	tpadHopFrames[trackpad] = frames + 1;
+
+	if (frames < 2) {
+		return;
+	}
+
+	int32_t avg = tpadHopNoises[trackpad];
+	if (frames == 2) {
+		avg = noise;
+	} else {
+		avg += (noise - avg) >> TPAD_HOP_AVG_SHIFT;
+	}
+	tpadHopNoises[trackpad] = avg;
+
+	if (avg > scaleTpadThresh(trackpad, tpadHopHighThresh)) {
+		tpadHopNoisys[trackpad] = true;
+	} else if (avg < scaleTpadThresh(trackpad, tpadHopLowThresh)) {
+		tpadHopNoisys[trackpad] = false;
+	}
+
+	stats->frames++;
+	if (!tpadHopNoisys[trackpad]) {
+		return;
+	}
+	stats->noisyFrames++;
+
+	uint32_t now = getUsTickCnt();
+	if (!tpadHopEn || frames < TPAD_HOP_MIN_FRAMES || 
+		now - tpadHopUs[trackpad] < TPAD_HOP_DWELL_US) {
+		return;
+	}
+	tpadHopUs[trackpad] = now;
+
+	int32_t* slot_noises = tpadHopSlotNoises[trackpad];
+	int best = -1;
+
+	slot_noises[slot] = avg;
+	for (int idx = 0; idx < NUM_TPAD_HOP_FREQS; idx++) {
+		if (idx != slot && (best < 0 || 
+			slot_noises[idx] < slot_noises[best])) {
+			best = idx;
+		}
+	}
+
+	// Let noise remembered for other frequencies fade so they get retried
+	for (int idx = 0; idx < NUM_TPAD_HOP_FREQS; idx++) {
+		if (idx != slot) {
+			slot_noises[idx] -= slot_noises[idx] >> 2;
+		}
+	}
+
+	if (slot_noises[best] < avg) {
+		tpadHopNextSlots[trackpad] = best;
+		tpadHopFrames[trackpad] = 0;
+		stats->hops++;
+	}
+}
+
+/**
+ * Called by scan scheduler once a frame is complete to start the next one
+ *  now, or arm timer to start it once target period has elapsed.
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return None.
+ */
+static void schedNextTpadFrame(Trackpad trackpad) {
+	// Do not bother with timer if match would be too close to catch
+	const int32_t MIN_WAIT_US = 20;
+
+	if (!tpadSchedPeriodUs) {
+		startTpadFrame(trackpad);
+		return;
+	}
+
+	uint32_t now = Chip_TIMER_ReadCount(tpadSchedTimer);
+	uint32_t next = tpadSchedStarts[trackpad] + tpadSchedPeriodUs;
+
+	if ((int32_t)(next - now) < MIN_WAIT_US) {
+		// Frame took longer than target period. Start immediately and 
+		//  schedule relative to now
+		tpadSchedStarts[trackpad] = now;
+		startTpadFrame(trackpad);
+	} else {
+		tpadSchedStarts[trackpad] = next;
+		Chip_TIMER_SetMatch(tpadSchedTimer, trackpad, next);
+		Chip_TIMER_ClearMatch(tpadSchedTimer, trackpad);
+		Chip_TIMER_MatchEnableInt(tpadSchedTimer, trackpad);
+	}
+}
+
+/**
+ * Called once ISR driven read of AnyMeas ADC value is complete.
+ * 
+ * \param[in] xfer The completed read. 
+ * 
+ * \return None.
+ */
+void tpadAdcReadDone(TpadSpiXfer* xfer) {
+	Trackpad trackpad = xfer->trackpad;
+	uint32_t start = getCycleCnt();
+	int tpad_adc_idx = tpadAdcIdxs[trackpad];
+
+	// Frame was abandoned by trackpadSchedStop()
+	if (tpad_adc_idx >= NUM_ANYMEAS_ADCS) {
+		return;
+	}
+
+	// Reading ADC value clears DR, which lets next measurement (if any)
+	//  complete
+	tpadMeasStartUs[trackpad] = getUsTickCnt();
+	addTpadLat(trackpad, TPAD_LAT_SPI_READ, 
+		tpadMeasStartUs[trackpad] - tpadDrUs[trackpad]);
+
+	tpadAdcDatas[trackpad][tpad_adc_idx] = parseTpadAdc(xfer->rxData);
+	tpad_adc_idx++;
+	noteTpadRegWrite(trackpad, TPAD_STATUS1_ADDR, 0x00);
+
+	if (tpadProbings[trackpad] && tpad_adc_idx == NUM_TPAD_PROBE_ADCS) {
+		applyTpadHopComps(trackpad);
+		if (!tpadProbeDone(trackpad)) {
+			// No touch, so nothing more to measure for this frame
+			tpad_adc_idx = NUM_ANYMEAS_ADCS;
+		}
+	} else if (tpad_adc_idx == NUM_ANYMEAS_X_ADCS) {
+		// Request measurements used for position on Y axis
+		startTpadMeasIsr(trackpad, ANYMEAS_Y_ADC_ADDR, 
+			NUM_ANYMEAS_Y_ADCS);
+	} else if (tpad_adc_idx == NUM_ANYMEAS_ADCS) {
+		// Frame may be first since a hop to a new toggle frequency
+		applyTpadHopComps(trackpad);
+		publishTpadFrame(trackpad, false, NULL);
+		deferTpadWork(trackpad, tpadSchedEn ? 
+			TPAD_DEFER_POS | TPAD_DEFER_FULL : TPAD_DEFER_POS);
+	}
+
+	tpadAdcIdxs[trackpad] = tpad_adc_idx;
+
+	if (tpad_adc_idx == NUM_ANYMEAS_ADCS && tpadSchedEn) {
+		schedNextTpadFrame(trackpad);
+	}
+
+	tpadModeStats[trackpad][TPAD_MODE_ANYMEAS].isrCycles += 
+		cyclesSince(start);
+}
+
+/**
+ * Called once ISR driven read of absolute mode packet is complete.
+ * 
+ * \param[in] xfer The completed read. 
+ * 
+ * \return None.
+ */
+void tpadAbsReadDone(TpadSpiXfer* xfer) {
+	Trackpad trackpad = xfer->trackpad;
+	uint32_t start = getCycleCnt();
+	TrackpadAbsData abs_data;
+
+	addTpadLat(trackpad, TPAD_LAT_SPI_READ, 
+		getUsTickCnt() - tpadDrUs[trackpad]);
+
+	parseTpadAbs(xfer->rxData, &abs_data);
+	noteTpadRegWrite(trackpad, TPAD_STATUS1_ADDR, 0x00);
+
+	// Mode may have changed while read was in flight
+	if (tpadModes[trackpad] == TPAD_MODE_ABS) {
+		publishTpadFrame(trackpad, false, &abs_data);
+		deferTpadWork(trackpad, TPAD_DEFER_POS);
+	}
+
+	tpadModeStats[trackpad][TPAD_MODE_ABS].isrCycles += cyclesSince(start);
+}
+
+/**
+ * Presence, baseline and noise tracking for latest full frame from a 
+ *  Trackpad. Frames published while this was pending are skipped. Only to 
+ *  be called from PendSV context.
+ * 
+ * \param trackpad Specifies which Trackpad frame is from. 
+ * 
+ * \return None.
+ */
+static void trackTpadFrame(Trackpad trackpad) {
+	int16_t adcs[NUM_ANYMEAS_ADCS];
+	TpadFrameInfo info;
+	uint32_t start = getCycleCnt();
+
+	// Idle frames leave last full frame in place, so this is still it
+	readTpadFrame(trackpad, adcs, &info);
+	if (info.mode != TPAD_MODE_ANYMEAS) {
+		return;
+	}
+
+	tpadFullFrameDone(trackpad, adcs, info.comps);
+	if (tpadBaselineEn) {
+		trackTpadBaseline(trackpad, adcs, info.comps);
+	}
+	trackTpadNoise(trackpad, adcs, info.hopSlot);
+
+	tpadModeStats[trackpad][TPAD_MODE_ANYMEAS].deferCycles += 
+		cyclesSince(start);
+}
+
+/**
+ * PendSV handler. Does work SSP0 IRQ deferred once it published frames (see
+ *  deferTpadWork()). Lowest priority, so this never holds up capture.
+ * 
+ * \return None.
+ */
+void PendSV_Handler(void) {
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		__disable_irq();
+		uint8_t defers = tpadDefers[tpad];
+		tpadDefers[tpad] = 0;
+		__enable_irq();
+
+		// Position first, as something may be waiting on it
+		if (defers & TPAD_DEFER_POS) {
+			notifyTpadPos(tpad);
+		}
+		if (defers & TPAD_DEFER_FULL) {
+			trackTpadFrame(tpad);
+		}
+	}
+}
+
+/**
+ * Function to be called by ISR to handle next ADC value. This only queues
+ *  the read; it completes in tpadAdcReadDone().
+ * 
+ * \param trackpad Specifies which trackpad to communicate with. 
+ * 
+ * \return None.
+ */
+void getNextTpadAdcValIsr(Trackpad trackpad) {
+	tpadSpiSubmit(&tpadAdcXfers[trackpad]);
+}
+
+/**
+ * Handle rising edge of Trackpad DR pin. In AnyMeas mode this means next ADC
+ *  value is ready, in absolute mode that a new position packet is ready.
+ * 
+ * \param trackpad Specifies which Trackpad asserted DR. 
+ * 
+ * \return None.
+ */
+static void tpadDrIsr(Trackpad trackpad) {
+	uint32_t start = getCycleCnt();
+	TrackpadMode mode = tpadModes[trackpad];
+
+	tpadDrUs[trackpad] = getUsTickCnt();
+
+	if (mode == TPAD_MODE_ABS) {
+		// DR stays asserted until packet is read, so a DR while a read
+		//  is still in flight is not a new packet
+		if (tpadAbsXfers[trackpad].done) {
+			tpadFrameStartUs[trackpad] = tpadDrUs[trackpad];
+			tpadSpiSubmit(&tpadAbsXfers[trackpad]);
+		}
+	} else {
+		addTpadLat(trackpad, TPAD_LAT_DR_WAIT, 
+			tpadDrUs[trackpad] - tpadMeasStartUs[trackpad]);
+		getNextTpadAdcValIsr(trackpad);
+	}
+
+	tpadModeStats[trackpad][mode].isrCycles += cyclesSince(start);
+}
+
+/**
+ * ISR for CT32B1. Used by scan scheduler to start frames at target rate.
+ * 
+ * \return None.
+ */
+void TIMER32_1_IRQHandler(void) {
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		if (Chip_TIMER_MatchPending(tpadSchedTimer, tpad)) {
+			Chip_TIMER_ClearMatch(tpadSchedTimer, tpad);
+			Chip_TIMER_MatchDisableInt(tpadSchedTimer, tpad);
+			if (tpadSchedEn) {
+				startTpadFrame(tpad);
+			}
+		}
+	}
+}
+
+/**
+ * Stop scan scheduler. Returns once any frames in progress are complete so
+ *  that AnyMeas ADCs can be accessed directly. Frames that do not complete
+ *  within TPAD_SCHED_STOP_TIMEOUT_US are abandoned.
+ * 
+ * \return 0 on success. -1 if a frame had to be abandoned.
+ */
+int trackpadSchedStop(void) {
+	int retval = 0;
+
+	__disable_irq();
+	tpadSchedEn = false;
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		Chip_TIMER_MatchDisableInt(tpadSchedTimer, tpad);
+		Chip_TIMER_ClearMatch(tpadSchedTimer, tpad);
+	}
+	__enable_irq();
+
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		// No __WFI() here, as with DR missed there may be no IRQ to 
+		//  wake on before timeout
+		uint32_t start_us = getUsTickCnt();
+		while (tpadAdcIdxs[tpad] < NUM_ANYMEAS_ADCS) {
+			if (getUsTickCnt() - start_us < 
+				TPAD_SCHED_STOP_TIMEOUT_US) {
+				continue;
+			}
+
+			// Late reads of abandoned frame are dropped by 
+			//  tpadAdcReadDone()
+			__disable_irq();
+			if (tpadAdcIdxs[tpad] < NUM_ANYMEAS_ADCS) {
+				tpadAdcIdxs[tpad] = NUM_ANYMEAS_ADCS;
+				tpadProbings[tpad] = false;
+				tpadModeStats[tpad][TPAD_MODE_ANYMEAS].abandoned++;
+				retval = -1;
+			}
+			__enable_irq();
+		}
+
+		if (tpadModes[tpad] == TPAD_MODE_ANYMEAS) {
+			restoreTpadHopFreq(tpad);
+		}
+	}
+
+	return retval;
+}
+
+/**
+ * Start scan scheduler, which keeps both Trackpads capturing frames 
+ *  continuously. Start of Left Trackpad frames are offset by half a period
+ *  from Right Trackpad frames so that SPI read-out of one Trackpad overlaps
+ *  with conversion time of the other.
+ * 
+ * \param targetFps Rate at which to start frames on each Trackpad. 0 means
+ *	start next frame as soon as last is complete.
+ * 
+ * \return None.
+ */
+void trackpadSchedStart(uint32_t targetFps) {
+	trackpadSchedStop();
+
+	tpadSchedFps = targetFps;
+	tpadSchedPeriodUs = targetFps ? 1000000 / targetFps : 0;
+
+	__disable_irq();
+	tpadSchedEn = true;
+
+	// Start off probing for presence on both Trackpads
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		tpadTouchs[tpad] = false;
+		tpadWakings[tpad] = false;
+		tpadIdleUs[tpad] = getUsTickCnt();
+	}
+
+	uint32_t now = Chip_TIMER_ReadCount(tpadSchedTimer);
+
+	tpadSchedStarts[R_TRACKPAD] = now;
+	startTpadFrame(R_TRACKPAD);
+
+	if (tpadSchedPeriodUs) {
+		// Makes schedNextTpadFrame() arm timer half a period from now
+		tpadSchedStarts[L_TRACKPAD] = now - tpadSchedPeriodUs / 2;
+		schedNextTpadFrame(L_TRACKPAD);
+	} else {
+		startTpadFrame(L_TRACKPAD);
+	}
+	__enable_irq();
+}
+
+/**
+ * ISR for 3 - GPIO pin interrupt 3, which occurs on rising edge of Right 
+ *  Haptic DR.
+ * 
+ * \return None.
+ */
+void FLEX_INT3_IRQHandler(void) {
+	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_R_TRACKPAD));
+
+	tpadDrIsr(R_TRACKPAD);
+}
+
+/**
+ * ISR for 4 - GPIO pin interrupt 4, which occurs on rising edge of Left 
+ *  Haptic DR.
+ * 
+ * \return None.
+ */
+void FLEX_INT4_IRQHandler(void) {
+	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(PINT_L_TRACKPAD));
+
+	tpadDrIsr(L_TRACKPAD);
+}
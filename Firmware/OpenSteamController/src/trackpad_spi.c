@@ -0,0 +1,268 @@
+/**
+ * \file trackpad_spi.c
+ * \brief Encompasses queued, interrupt driven SPI (SSP0) transactions with the
+ *	Trackpad ASICs. Callers submit transaction descriptors, which are
+ *	drained through the SSP FIFO by the SSP0 interrupt handler. This means
+ *	interrupts only need to be disabled while a descriptor is handed off,
+ *	and not for the duration of the transaction.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_spi.h"
+
+#include "lpc_types.h"
+#include "chip.h"
+#include "ssp_11xx.h"
+
+#include <stddef.h>
+
+static LPC_SSP_T* const spiRegs = LPC_SSP0;
+
+#define GPIO_SSP0_SCK0 1, 29 //!< SPI Clock Pin
+#define GPIO_SSP0_MISO0 0, 8 //!< SPI Master In Slave Out Pin
+#define GPIO_SSP0_MOSI0 0, 9 //!< SPI Master Out Slave In Pin
+
+#define GPIO_R_TRACKPAD_CS_N 1, 15 //!< Chip select pin for communicating with
+		//!< Right Trackpad.
+#define GPIO_L_TRACKPAD_CS_N 1, 6 //!< Chip select pin for communicating with
+		//!< Left Trackpad.
+
+#define SSP_FIFO_DEPTH (8) //!< Number of frames SSP TX and RX FIFOs can hold.
+
+static TpadSpiXfer* volatile xferHead = NULL; //!< Transaction currently
+	//!< in progress. NULL if SSP0 is idle.
+static TpadSpiXfer* volatile xferTail = NULL; //!< Last transaction in queue.
+
+/**
+ * Drive chip select for a Trackpad ASIC.
+ *
+ * \param trackpad Specifies which Trackpad to select.
+ * \param select True to pull chip select low.
+ *
+ * \return None.
+ */
+static inline void setTpadCs(Trackpad trackpad, bool select) {
+	if (R_TRACKPAD == trackpad) {
+		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, !select);
+	} else if (L_TRACKPAD == trackpad) {
+		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, !select);
+	}
+}
+
+/**
+ * Push as many bytes of transaction into TX FIFO as possible without
+ *  risking overflow of RX FIFO.
+ *
+ * \param[inout] xfer Transaction being worked on.
+ *
+ * \return None.
+ */
+static inline void fillTxFifo(TpadSpiXfer* xfer) {
+	while (xfer->txCnt < xfer->len &&
+		xfer->txCnt - xfer->rxCnt < SSP_FIFO_DEPTH &&
+		Chip_SSP_GetStatus(spiRegs, SSP_STAT_TNF)) {
+		Chip_SSP_SendFrame(spiRegs, xfer->txData[xfer->txCnt]);
+		xfer->txCnt++;
+	}
+}
+
+/**
+ * Select Trackpad and start clocking out transaction.
+ *
+ * \param[inout] xfer Transaction to start.
+ *
+ * \return None.
+ */
+static void startXfer(TpadSpiXfer* xfer) {
+	setTpadCs(xfer->trackpad, true);
+	fillTxFifo(xfer);
+}
+
+/**
+ * Move bytes in and out of SSP FIFOs for transaction in progress and handle
+ *  completion. Needs to be called with SSP0 IRQ unable to preempt.
+ *
+ * \return None.
+ */
+static void serviceXfer(void) {
+	// Clear timeout (and overrun) interrupt. RX half full clears itself
+	//  as FIFO is drained
+	spiRegs->ICR = SSP_INT_CLEAR_BITMASK;
+
+	TpadSpiXfer* xfer = xferHead;
+	if (!xfer) {
+		return;
+	}
+
+	while (xfer->rxCnt < xfer->len &&
+		Chip_SSP_GetStatus(spiRegs, SSP_STAT_RNE)) {
+		uint8_t val = Chip_SSP_ReceiveFrame(spiRegs);
+		if (xfer->rxData) {
+			xfer->rxData[xfer->rxCnt] = val;
+		}
+		xfer->rxCnt++;
+	}
+
+	if (xfer->rxCnt < xfer->len) {
+		fillTxFifo(xfer);
+		return;
+	}
+
+	setTpadCs(xfer->trackpad, false);
+
+	xferHead = xfer->next;
+	if (xferHead) {
+		startXfer(xferHead);
+	} else {
+		xferTail = NULL;
+	}
+
+	// Transaction is off queue, so callback is free to resubmit it
+	xfer->done = 1;
+	if (xfer->callback) {
+		xfer->callback(xfer);
+	}
+}
+
+/**
+ * Setup SSP0 and chip select pins for communicating with Trackpad ASICs.
+ *
+ * \return None.
+ */
+void initTpadSpi(void) {
+	// Set Interrupt Priority for SSP0 to one below highest
+	NVIC_SetPriority(SSP0_IRQn, 1);
+
+	// Setup SSP0 pins
+	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_SCK0, IOCON_FUNC1);
+	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_MISO0, IOCON_FUNC1);
+	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_MOSI0, IOCON_FUNC1);
+
+	// Configure SPI
+	Chip_SSP_Init(spiRegs);
+	Chip_SSP_SetFormat(spiRegs, SSP_BITS_8, SSP_FRAMEFORMAT_SPI,
+		SSP_CLOCK_CPHA1_CPOL0);
+	Chip_SSP_Set_Mode(spiRegs, SSP_MODE_MASTER);
+	Chip_SSP_SetBitRate(spiRegs, 6000000);
+	Chip_SSP_Enable(spiRegs);
+
+	// Chip selects
+	Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, true);
+	Chip_GPIO_SetPinDIROutput(LPC_GPIO, GPIO_R_TRACKPAD_CS_N);
+	Chip_IOCON_PinMux(LPC_IOCON, GPIO_R_TRACKPAD_CS_N, IOCON_DIGMODE_EN |
+		IOCON_MODE_INACT, IOCON_FUNC0);
+
+	Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
+	Chip_GPIO_SetPinDIROutput(LPC_GPIO, GPIO_L_TRACKPAD_CS_N);
+	Chip_IOCON_PinMux(LPC_IOCON, GPIO_L_TRACKPAD_CS_N, IOCON_DIGMODE_EN |
+		IOCON_MODE_INACT, IOCON_FUNC0);
+
+	// Interrupt when RX FIFO is half full, or when data has been sitting
+	//  in it (i.e. tail end of transaction)
+	spiRegs->ICR = SSP_INT_CLEAR_BITMASK;
+	spiRegs->IMSC = SSP_RTIM | SSP_RXIM;
+	NVIC_ClearPendingIRQ(SSP0_IRQn);
+	NVIC_EnableIRQ(SSP0_IRQn);
+}
+
+/**
+ * Queue a transaction. Transaction will be started immediately if SSP0 is
+ *  idle.
+ *
+ * \param[inout] xfer Transaction details. Must persist until xfer->done is set.
+ *
+ * \return None.
+ */
+void tpadSpiSubmit(TpadSpiXfer* xfer) {
+	xfer->done = 0;
+	xfer->txCnt = 0;
+	xfer->rxCnt = 0;
+	xfer->next = NULL;
+
+	// Only need IRQs disabled for hand-off of descriptor. May be called with
+	//  IRQs already disabled (i.e. from trackpadSchedStart()), in which 
+	//  case they must stay that way
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (xferTail) {
+		xferTail->next = xfer;
+		xferTail = xfer;
+	} else {
+		xferHead = xfer;
+		xferTail = xfer;
+		startXfer(xfer);
+	}
+
+	if (!primask) {
+		__enable_irq();
+	}
+}
+
+/**
+ * Perform transaction and wait for it to finish.
+ *
+ * \param trackpad Specifies which Trackpad to communicate with.
+ * \param[in] txData Bytes to send.
+ * \param[out] rxData Location to store received bytes. May be NULL.
+ * \param len Number of bytes in transaction.
+ *
+ * \return None.
+ */
+void tpadSpiXferBlocking(Trackpad trackpad, const uint8_t* txData,
+	uint8_t* rxData, uint8_t len) {
+	TpadSpiXfer xfer = {
+		.trackpad = trackpad,
+		.txData = txData,
+		.rxData = rxData,
+		.len = len,
+		.callback = NULL
+	};
+
+	tpadSpiSubmit(&xfer);
+
+	while (!xfer.done) {
+		// If we are in an ISR (i.e. USB building a report) or have IRQs
+		//  masked the SSP0 IRQ may not be able to preempt us, so we
+		//  need to move the transaction along ourselves
+		if (__get_IPSR() || __get_PRIMASK()) {
+			uint32_t primask = __get_PRIMASK();
+			__disable_irq();
+			serviceXfer();
+			if (!primask) {
+				__enable_irq();
+			}
+		}
+	}
+}
+
+/**
+ * ISR for SSP0. Drains RX FIFO, refills TX FIFO and moves on to next queued
+ *  transaction.
+ *
+ * \return None.
+ */
+void SSP0_IRQHandler(void) {
+	serviceXfer();
+}
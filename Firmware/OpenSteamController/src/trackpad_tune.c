@@ -0,0 +1,320 @@
+/**
+ * \file trackpad_tune.c
+ * \brief Encompasses picking AnyMeas ADC settings (i.e. gain, toggle
+ *	frequency, sample length and aperture) for each Trackpad. Noise and
+ *	signal are measured on demodulated profiles (i.e. what positions are
+ *	worked out from) and the fastest settings that meet a target signal to
+ *	noise ratio are picked. Picked settings are saved in EEPROM.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_tune.h"
+
+#include "eeprom_access.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define TPAD_TUNE_EEPROM_OFFSET (0xDC0) //!< Where first saved record lives.
+	//!< This is just past the space reserved for correction grids.
+#define TPAD_TUNE_EEPROM_STRIDE (0x10) //!< Space reserved per Trackpad.
+
+#define TPAD_TUNE_CLIP_LEVEL (30000) //!< ADC values at or beyond this (of
+	//!< either sign) are considered to be clipping.
+
+#define NUM_TPAD_TUNE_BINS (NUM_TPAD_X_BINS + NUM_TPAD_Y_BINS) //!< Number of
+	//!< profile values tracked by TpadTuneAccum.
+
+/**
+ * ADC settings saved in EEPROM by this firmware. Payload is a TpadAdcTune.
+ */
+static const EepromRecordDesc TPAD_TUNE_RECORD = {
+	.offset = TPAD_TUNE_EEPROM_OFFSET,
+	.stride = TPAD_TUNE_EEPROM_STRIDE,
+	.magicWord = 0xc07e,
+	.version = 1, // Bump whenever record layout changes in a way that
+		// invalidates saved values.
+	.len = sizeof(TpadAdcTune)
+};
+
+/**
+ * Integer square root.
+ *
+ * \param val Value to take square root of.
+ *
+ * \return Largest integer whose square is not more than val.
+ */
+static uint32_t isqrt64(uint64_t val) {
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+
+	while (bit > val) {
+		bit >>= 2;
+	}
+
+	while (bit) {
+		if (val >= root + bit) {
+			val -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+/**
+ * Clear running sums so a new set of frames can be added.
+ *
+ * \param[out] accum Sums to clear.
+ *
+ * \return None.
+ */
+void tpadTuneAccumReset(TpadTuneAccum* accum) {
+	memset(accum, 0, sizeof(*accum));
+}
+
+/**
+ * Demodulate frame and add profiles to running sums.
+ *
+ * \param[inout] accum Sums to add to.
+ * \param[in] adcs All NUM_ANYMEAS_ADCS AnyMeas ADC values for the Trackpad.
+ * \param[in] comps Compensation values for adcs. For noise measurements any
+ *	fixed values (i.e. an earlier frame) will do.
+ *
+ * \return True if any ADC value in frame looks to be clipping.
+ */
+bool tpadTuneAccumAdd(TpadTuneAccum* accum, const volatile int16_t* adcs,
+	const int16_t* comps) {
+	int32_t bins[NUM_TPAD_MAX_BINS];
+	bool clipped = false;
+	int bin_idx = 0;
+
+	for (int idx = 0; idx < NUM_ANYMEAS_ADCS; idx++) {
+		if (adcs[idx] >= TPAD_TUNE_CLIP_LEVEL ||
+			adcs[idx] <= -TPAD_TUNE_CLIP_LEVEL) {
+			clipped = true;
+		}
+	}
+
+	for (int axis = TPAD_AXIS_X; axis <= TPAD_AXIS_Y; axis++) {
+		int num_bins = tpadDemodAxis(axis, adcs, comps, bins);
+		for (int idx = 0; idx < num_bins; idx++, bin_idx++) {
+			accum->sums[bin_idx] += bins[idx];
+			accum->sqSums[bin_idx] += (int64_t)bins[idx] * bins[idx];
+		}
+	}
+
+	accum->frames++;
+
+	return clipped;
+}
+
+/**
+ * Work out noise from frames taken with nothing on Trackpad.
+ *
+ * \param[in] accum Sums of frames.
+ *
+ * \return RMS (over all profile values) of standard deviation of each
+ *	profile value, with 4 fractional bits. Saturates at 0xFFFF.
+ */
+uint16_t tpadTuneNoiseQ4(const TpadTuneAccum* accum) {
+	uint64_t n = accum->frames;
+	uint64_t var_sum = 0;
+
+	if (n < 2) {
+		return 0;
+	}
+
+	for (int idx = 0; idx < NUM_TPAD_TUNE_BINS; idx++) {
+		int64_t sum = accum->sums[idx];
+		// n^2 * variance
+		var_sum += n * accum->sqSums[idx] - (uint64_t)(sum * sum);
+	}
+
+	// Scale by 2^8 before root for 4 fractional bits
+	uint32_t noise = isqrt64((var_sum << 8) / (n * n * NUM_TPAD_TUNE_BINS));
+	if (noise > 0xFFFF) {
+		noise = 0xFFFF;
+	}
+
+	return noise;
+}
+
+/**
+ * Work out signal from frames taken with a finger held on Trackpad.
+ *
+ * \param[in] accum Sums of frames (demodulated against compensation values
+ *	taken with nothing on Trackpad).
+ *
+ * \return Smaller of largest average X profile value and largest average Y
+ *	profile value. Saturates at 0xFFFF.
+ */
+uint16_t tpadTuneSignal(const TpadTuneAccum* accum) {
+	int32_t peaks[2] = {0, 0};
+
+	if (!accum->frames) {
+		return 0;
+	}
+
+	for (int idx = 0; idx < NUM_TPAD_TUNE_BINS; idx++) {
+		int axis = idx < NUM_TPAD_X_BINS ? TPAD_AXIS_X : TPAD_AXIS_Y;
+		int32_t avg = accum->sums[idx] / (int32_t)accum->frames;
+		if (avg > peaks[axis]) {
+			peaks[axis] = avg;
+		}
+	}
+
+	int32_t signal = peaks[TPAD_AXIS_X] < peaks[TPAD_AXIS_Y] ?
+		peaks[TPAD_AXIS_X] : peaks[TPAD_AXIS_Y];
+	if (signal > 0xFFFF) {
+		signal = 0xFFFF;
+	}
+
+	return signal;
+}
+
+/**
+ * \param[in] result Measurements for one set of settings.
+ *
+ * \return Signal to noise ratio (rounded down).
+ */
+uint32_t tpadTuneSnr(const TpadTuneResult* result) {
+	uint32_t noise = result->noiseQ4 ? result->noiseQ4 : 1;
+
+	return ((uint32_t)result->signal << 4) / noise;
+}
+
+/**
+ * Pick settings with shortest scan time that meet signal to noise target.
+ *  Settings that clipped are never picked. If no settings meet target, the
+ *  ones with best signal to noise ratio are picked.
+ *
+ * \param[in] results Measurements for each set of settings.
+ * \param numResults Number of entries in results.
+ * \param minSnr Signal to noise ratio target.
+ * \param[out] metTarget Set to true if picked settings meet target. May be
+ *	NULL.
+ *
+ * \return Index into results of picked settings. Negative if all clipped.
+ */
+int tpadTuneSelect(const TpadTuneResult* results, int numResults,
+	uint32_t minSnr, bool* metTarget) {
+	int best = -1;
+	int best_snr_idx = -1;
+	uint32_t best_snr = 0;
+
+	for (int idx = 0; idx < numResults; idx++) {
+		const TpadTuneResult* result = &results[idx];
+		if (result->clipped) {
+			continue;
+		}
+
+		uint32_t snr = tpadTuneSnr(result);
+		if (best_snr_idx < 0 || snr > best_snr) {
+			best_snr_idx = idx;
+			best_snr = snr;
+		}
+
+		if (snr < minSnr) {
+			continue;
+		}
+
+		// Break ties on scan time with better signal to noise ratio
+		if (best < 0 || result->scanUs < results[best].scanUs ||
+			(result->scanUs == results[best].scanUs &&
+			snr > tpadTuneSnr(&results[best]))) {
+			best = idx;
+		}
+	}
+
+	if (metTarget) {
+		*metTarget = best >= 0;
+	}
+
+	if (best < 0) {
+		best = best_snr_idx;
+	}
+
+	return best;
+}
+
+/**
+ * Load ADC settings previously saved with tpadTuneSave().
+ *
+ * \param trackpad Specifies which Trackpad to load settings for.
+ * \param[out] tune Where to store settings. Not modified unless load
+ *	succeeds.
+ *
+ * \return 0 on success. Negative value if no valid record is saved.
+ */
+int tpadTuneLoadSaved(Trackpad trackpad, TpadAdcTune* tune) {
+	TpadAdcTune saved_tune;
+
+	int retval = eepromRecordLoad(&TPAD_TUNE_RECORD, trackpad, &saved_tune);
+	if (retval) {
+		return retval;
+	}
+
+	if (!saved_tune.sigScale) {
+		return -5;
+	}
+
+	*tune = saved_tune;
+
+	return 0;
+}
+
+/**
+ * Save ADC settings so that they can be loaded on next boot.
+ *
+ * \param trackpad Specifies which Trackpad settings are for.
+ * \param[in] tune ADC settings.
+ *
+ * \return 0 on success.
+ */
+int tpadTuneSave(Trackpad trackpad, const TpadAdcTune* tune) {
+	return eepromRecordSave(&TPAD_TUNE_RECORD, trackpad, tune);
+}
+
+/**
+ * Get human readable name for source of ADC settings.
+ *
+ * \param src Source of ADC settings.
+ *
+ * \return Name of source.
+ */
+const char* tpadTuneSrcStr(TpadTuneSrc src) {
+	switch (src) {
+	case TPAD_TUNE_SRC_SAVED:
+		return "saved";
+	case TPAD_TUNE_SRC_TUNED:
+		return "tuned";
+	default:
+		break;
+	}
+	return "default";
+}
@@ -46,6 +46,7 @@
 #include "chip.h"
 
 #include "led_ctrl.h"
+#include "time.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -99,35 +100,43 @@ typedef struct {
 
 	uint8_t* rxFifo; //!< Buffer treated as a FIFO which stores character
 		//!< data that has been received via USB CDC UART
-	volatile uint32_t rxWrapIdx; //!< Defines where rxFifo wraps around. 
-		//!< This index and anything beyond it in rxFifo does not have 
-		//!< valid data to read.  We need this because ReadEP can return
-		//!< up to USB_MAX_PACKET_SZ bytes, but we don't know ahead of 
-		//!< time how many we are actually getting.  This allows us to 
-		//!< maximize memory usage, while not overflowing rxFifo.
 	volatile uint32_t rxRdIdx; //!< Defines where next character is read
 		//!< from in rxFifo. If rxRdIdx == rxWrIdx FIFO is empty.
 	volatile uint32_t rxWrIdx; //!< Defines where next character(s) are to
 		//!< to be stored when received from USB CDC UART.
-	uint32_t rxStalled; //!< Flag that we did not have enough room for 
-		//!< incoming data in rxFifo and did not call ReadEP. We will
-		//!< need to call ReadEP to get the buffered data and have 
-		//!< interrupts start working again once room opens in txFIFO.
-		//!< Note that even though we do not call ReadEP, incoming 
-		//!< USB packets may be dropped and into data lost. Still
-		//!< looking for solutions to fix this.
+	uint8_t* rxPkt; //!< Buffer (in USB RAM) OUT endpoint is armed with.
+		//!< Packets are copied from here into rxFifo.
+	volatile bool rxArmed; //!< A read is queued on rxPkt, so host can
+		//!< send next packet.
+	volatile bool rxStalled; //!< OUT endpoint was left un-armed as rxFifo
+		//!< did not have room for a full packet. Hardware NAKs host 
+		//!< (which keeps retrying) until usb_getc() makes room.
+	UsbRxStats rxStats; //!< Receive path counters. Only updated with USB
+		//!< interrupt unable to run (i.e. in USB ISR).
 
 	volatile int txBusy; //!< Indicates transmission is in progress. This 
 		//!< does not guarantee that txFifo will be drained (use 
 		//!< usb_flush() for this).
 	uint8_t* txFifo; //!< Buffer treated as a FIFO which stores character
 		//!< data to be transmitted via USB CDC UART
+	uint8_t* txPkt; //!< Staging buffer (USB_MAX_PACKET_SZ bytes) packet 
+		//!< being sent is copied into, so data that wraps around end
+		//!< of txFifo still goes out in one full packet.
 	uint32_t txRdIdx; //!< The index of where the next read sample
 		//!< exists in txFifo
 	uint32_t txWrIdx; //!< The index of where the next write 
 		//!< sample will be put in txFifo
 	uint32_t txSent; //!< Number of bytes WriteEP reports it last 
 		//!< sent.
+	volatile bool txFlushReq; //!< Everything queued should go out at next
+		//!< SOF, even if that means a short packet.
+	bool txUnflushed; //!< Data was queued since last flush point (see 
+		//!< usbTxNoteFlushPoint()).
+	uint32_t txLingerFrames; //!< Number of SOFs queued data has waited 
+		//!< for packet to fill.
+	UsbTxStats txStats; //!< Transmit path counters. Packet counts are only
+		//!< updated by usbUartTxStart() (which txBusy keeps from running
+		//!< in two contexts at once), stall cycles only in thread context.
 } UsbUartData;
 
 static const uint32_t USB_MAX_PACKET_SZ = USB_FS_MAX_BULK_PACKET; //!< Maximum 
@@ -135,10 +144,12 @@ static const uint32_t USB_MAX_PACKET_SZ = USB_FS_MAX_BULK_PACKET; //!< Maximum
 
 static const uint32_t USB_UART_TXFIFO_SZ = 256; //!< Number of bytes in txFifo.
 	//!< This must be a power of 2!
-static const uint32_t USB_UART_TXFIFO_THRESH = 128; //!< Determines when
-	//!< transmission of txFifo data starts automatically.
+static volatile uint32_t usbUartTxLinger = 2; //!< Number of frames (i.e.
+	//!< ms) data can wait in txFifo for a full packet before it is sent
+	//!< anyway, when nothing has asked for it to be flushed.
 
 static const uint32_t USB_UART_RXFIFO_SZ = 256; //!< Number of bytes in rxFifo.
+	//!< This must be a power of 2!
 
 static UsbUartData usbUartData; //!< Virtual Comm port control data 
 	//!< instance. 
@@ -331,41 +342,85 @@ ALIGNED(4) const uint8_t USB_StringDescriptor[] = {
  * \return The number of bytes in txFifo ready to be sent.
  */
 static uint32_t usbTxFifoNumBytes(const UsbUartData* uartData) {
-	if (uartData->txWrIdx >= uartData->txRdIdx) {
-		return uartData->txWrIdx - uartData->txRdIdx;
+	return (uartData->txWrIdx - uartData->txRdIdx) & (USB_UART_TXFIFO_SZ - 1);
+}
+
+/**
+ * Copy data into txFifo (at most two spans, split where FIFO wraps). Caller
+ *  must have made sure there is room for all of it.
+ *
+ * \param[inout] uartData Contains details on Virtual Comm to transmit via.
+ * \param[in] buff Data to queue.
+ * \param len Number of bytes in buff.
+ *
+ * \return None.
+ */
+static void usbTxFifoPut(UsbUartData* uartData, const uint8_t* buff, 
+	uint32_t len) {
+	uint32_t wr_idx = uartData->txWrIdx;
+	uint32_t span = USB_UART_TXFIFO_SZ - wr_idx;
+
+	if (span > len) {
+		span = len;
 	}
 
-	return 1 + uartData->txRdIdx + USB_UART_TXFIFO_SZ - uartData->txWrIdx;
+	memcpy(&uartData->txFifo[wr_idx], buff, span);
+	memcpy(uartData->txFifo, &buff[span], len - span);
+
+	// Only move write index once data is in place, as ISR may be reading
+	uartData->txWrIdx = (wr_idx + len) & (USB_UART_TXFIFO_SZ - 1);
+	uartData->txUnflushed = true;
+}
+
+/**
+ * Count a point where output used to be flushed (i.e. a newline or a 
+ *  usb_flush() call) if data was queued since the last one. Each of these
+ *  used to force out at least one packet of its own, so comparing count to
+ *  short packets sent shows how many packets coalescing saved. Only to be
+ *  called from thread context.
+ *
+ * \param[inout] uartData Contains details on Virtual Comm to transmit via.
+ *
+ * \return None.
+ */
+static void usbTxNoteFlushPoint(UsbUartData* uartData) {
+	if (uartData->txUnflushed) {
+		uartData->txUnflushed = false;
+		uartData->txStats.flushPoints++;
+	}
 }
 
 /**
  * Start a (series of) transmission(s) via USB with as much txFifo data as
  *  possible. This will do nothing if a transmission is already in progress
- *  or txFIFO is empty.
+ *  or txFIFO is empty. Packet is staged in txPkt, so it is always full
+ *  (USB_MAX_PACKET_SZ bytes) when at least that much data is queued, even if
+ *  the data wraps around end of txFifo.
  *
  * \param[inout] uartData Contains details on Virtual Comm to transmit via.
+ * \param partial True if less than a full packet can be sent. Otherwise 
+ *	nothing is sent until a full packet is queued.
  *
  * \return None.
  */
-static void usbUartTxStart(UsbUartData* uartData) {
-	// Make sure we are not already busy with a transmit
+static void usbUartTxStart(UsbUartData* uartData, bool partial) {
+	// Called from both thread and USB ISR (SOF and IN events), so claiming
+	//  transmitter must not be interrupted
+	__disable_irq();
 	if (uartData->txBusy) {
+		__enable_irq();
 		return;
 	}
-
-	// Mark that we are busy now
 	uartData->txBusy = 1;
+	__enable_irq();
 
 	// Check if there is any data to send
-	uint32_t bytes_to_send = usbTxFifoNumBytes(uartData);
+	uint32_t rd_idx = uartData->txRdIdx;
+	uint32_t queued = usbTxFifoNumBytes(uartData);
+	uint32_t bytes_to_send = queued;
 
-	// Make sure there is no wrap around in send request
-	if (bytes_to_send + uartData->txRdIdx >= USB_UART_TXFIFO_SZ) {
-		bytes_to_send = USB_UART_TXFIFO_SZ - uartData->txRdIdx;
-	}
-
-	// Make sure we actually have data to send
-	if (!bytes_to_send) {
+	// Make sure we actually have data to send (and enough of it)
+	if (!bytes_to_send || (!partial && bytes_to_send < USB_MAX_PACKET_SZ)) {
 		uartData->txBusy = 0;
 		return;
 	}
@@ -377,25 +432,88 @@ static void usbUartTxStart(UsbUartData* uartData) {
 		bytes_to_send = USB_MAX_PACKET_SZ;
 	}
 
+	// Gather packet into one contiguous buffer
+	uint32_t span = USB_UART_TXFIFO_SZ - rd_idx;
+	if (span > bytes_to_send) {
+		span = bytes_to_send;
+	}
+	memcpy(uartData->txPkt, &uartData->txFifo[rd_idx], span);
+	memcpy(&uartData->txPkt[span], uartData->txFifo, bytes_to_send - span);
+
 	// Apparently IRQs need to be disabled around call to WriteEP. If they
 	//  are not and other interrupts are active of (higher priority)
 	//  (i.e. ADC interrupts) we can get repeated prints or dropped data... 
-	//  Not sure why. Maybe related to built in CDC UART support?
+	//  Not sure why. Maybe related to built in CDC UART support? IN event
+	//  for this packet can also restart transmission as soon as IRQs are
+	//  enabled, so txRdIdx and the rest must be updated before then.
 	__disable_irq();
 
-	// Send the data to the USB EP (the interrupt handler will adjust rxIdx)
+	uint32_t sent = 0;
 	if (USB_IsConfigured(uartData->usbHandle)) {
-		uartData->txSent = USBD_API->hw->WriteEP(uartData->usbHandle, 
-			USB_CDC_IN_EP, &uartData->txFifo[uartData->txRdIdx], 
-			bytes_to_send);
+		sent = USBD_API->hw->WriteEP(uartData->usbHandle, 
+			USB_CDC_IN_EP, uartData->txPkt, bytes_to_send);
 	}
 
-	__enable_irq();
-
 	// Just in case something went wrong
-	if (!uartData->txSent) {
+	if (!sent) {
+		uartData->txSent = 0;
 		uartData->txBusy = 0;
+		__enable_irq();
+		return;
 	}
+
+	// Packet has its own copy of the data, so room in txFifo can be reused
+	//  while it is being sent
+	uartData->txSent = sent;
+	uartData->txRdIdx = (rd_idx + sent) & (USB_UART_TXFIFO_SZ - 1);
+
+	uartData->txStats.bytes += sent;
+	uartData->txStats.packets++;
+	if (sent < USB_MAX_PACKET_SZ) {
+		uartData->txStats.shortPackets++;
+	}
+
+	// Flush is done once everything that was queued is on its way. Data
+	//  queued since queued was read may miss a flush request made at the 
+	//  same time, but it still goes out once it lingers long enough
+	if (sent == queued) {
+		uartData->txFlushReq = false;
+		uartData->txLingerFrames = 0;
+	}
+
+	__enable_irq();
+}
+
+/**
+ * Wait for room in txFifo, keeping track of time spent waiting.
+ *
+ * \param[inout] uartData Contains details on Virtual Comm to transmit via.
+ * \param len Number of bytes room is needed for. Must be less than
+ *	USB_UART_TXFIFO_SZ.
+ *
+ * \return Number of bytes of room in txFifo (at least len).
+ */
+static uint32_t usbTxFifoWaitRoom(UsbUartData* uartData, uint32_t len) {
+	// One byte is always left empty so full and empty can be told apart
+	uint32_t room = USB_UART_TXFIFO_SZ - 1 - usbTxFifoNumBytes(uartData);
+	if (room >= len) {
+		return room;
+	}
+
+	uint32_t last = getCycleCnt();
+	while (room < len) {
+		// Make sure FIFO is draining
+		usbUartTxStart(uartData, true);
+
+		// Counted in steps as cycle counter wraps quickly
+		uint32_t now = getCycleCnt();
+		uartData->txStats.stallCycles += (now - last) & CYCLE_CNT_MASK;
+		last = now;
+
+		room = USB_UART_TXFIFO_SZ - 1 - usbTxFifoNumBytes(uartData);
+	}
+
+	return room;
 }
 
 /**
@@ -407,35 +525,56 @@ static void usbUartTxStart(UsbUartData* uartData) {
  * \return Character queued. Function will stall until character is queued.
  */
 int usb_putc(int character) {
-	uint32_t next_wr_idx = 0;
-	// Wait until FIFO is not full
-	// Note: this is a wasteful "full" calculation as there is still
-	//  one byte left in the FIFO, however, this makes calculating the
-	//  number of bytes in the FIFO simpler.
-	do {
-		next_wr_idx = (usbUartData.txWrIdx + 1) % USB_UART_TXFIFO_SZ;
-	} while (next_wr_idx == usbUartData.txRdIdx);
+	uint8_t byte = character;
+
+	usbTxFifoWaitRoom(&usbUartData, 1);
 
 	// Put new character info FIFO
-	usbUartData.txFifo[usbUartData.txWrIdx] = character;
-	usbUartData.txWrIdx = next_wr_idx;
-
-	// Check if transmit should be initiated
-	if (usbUartData.txBusy) {
-		// Transmit is already taking place. New character may or may
-		//  not make it out
-		return character;
-	}
+	usbTxFifoPut(&usbUartData, &byte, 1);
 
-	// Request starting a new (series of) transmission(s) if the FIFO has
-	//  filled up adequately
-	if (usbTxFifoNumBytes(&usbUartData) >= USB_UART_TXFIFO_THRESH) {
-		usbUartTxStart(&usbUartData);
+	// Start a new (series of) transmission(s) once there is a full packet. 
+	//  Anything less is left for SOF handler to coalesce
+	if (!usbUartData.txBusy) {
+		usbUartTxStart(&usbUartData, false);
 	}
 
 	return character;
 }
 
+/**
+ * Queue data for output via USB CDC UART, copying it into transmit FIFO in
+ *  spans (as much as there is room for at a time) rather than per character.
+ *  This does not guarantee data will be sent upon function return (use 
+ *  usb_flush() to guarantee). Only to be called from thread context.
+ *
+ * \param[in] buff Data to write out via virtual serial.
+ * \param len Number of bytes in buff.
+ * 
+ * \return Number of bytes queued (i.e. len). Function will stall until all
+ *	data is queued.
+ */
+int usb_write(const void* buff, uint32_t len) {
+	const uint8_t* src = buff;
+	uint32_t left = len;
+
+	while (left) {
+		uint32_t span = usbTxFifoWaitRoom(&usbUartData, 1);
+		if (span > left) {
+			span = left;
+		}
+
+		usbTxFifoPut(&usbUartData, src, span);
+		src += span;
+		left -= span;
+
+		if (!usbUartData.txBusy) {
+			usbUartTxStart(&usbUartData, false);
+		}
+	}
+
+	return len;
+}
+
 /**
  * Queue the data in the buffer for output via USB CDC UART. Useful for cases
  *  in which we want to only print some characters of a string, or print from
@@ -447,29 +586,146 @@ int usb_putc(int character) {
  * \return None.
  */
 void usb_putb(const char* buff, uint32_t len) {
-	for (int idx = 0; idx < len; idx++){
-		usb_putc(buff[idx]);
+	usb_write(buff, len);
+}
+
+/**
+ * Queue all data in the buffer for output via USB CDC UART, but only if the
+ *  transmit FIFO has room for all of it right now. Unlike usb_putb() this never
+ *  waits and data goes out by next SOF at the latest, which suits streaming 
+ *  binary records where dropping a record is better than stalling.
+ *
+ * \param[in] buff Buffer storing data to write out via virtual serial.
+ * \param len Numbers of bytes in buff.
+ * 
+ * \return 0 if data was queued. -1 if there was not enough room in transmit 
+ *	FIFO (nothing is queued in this case).
+ */
+int usb_tryPutb(const char* buff, uint32_t len) {
+	// Read index is only ever moved by ISR to make more room, so this is
+	//  safe to check before copying
+	uint32_t used = usbTxFifoNumBytes(&usbUartData);
+
+	// One byte is always left empty so full and empty can be told apart
+	if (len > USB_UART_TXFIFO_SZ - 1 - used) {
+		return -1;
 	}
+
+	usbTxFifoPut(&usbUartData, (const uint8_t*)buff, len);
+	usbUartData.txFlushReq = true;
+
+	if (!usbUartData.txBusy) {
+		usbUartTxStart(&usbUartData, false);
+	}
+
+	return 0;
 }
 
 /**
- * Make sure any character currently in the transmit FIFO are transmitted via
- *  USB.
+ * Get counters for USB CDC UART transmit path.
+ *
+ * \param[out] stats Counters since boot or last usb_resetTxStats().
  *
- * \return 0 on success. Function will stall until flushing of data in transmit
- *  FIFO is initiated.
+ * \return None.
+ */
+void usb_getTxStats(UsbTxStats* stats) {
+	__disable_irq();
+	*stats = usbUartData.txStats;
+	__enable_irq();
+}
+
+/**
+ * Zero counters for USB CDC UART transmit path.
+ *
+ * \return None.
+ */
+void usb_resetTxStats(void) {
+	__disable_irq();
+	memset(&usbUartData.txStats, 0, sizeof(usbUartData.txStats));
+	__enable_irq();
+}
+
+/**
+ * Set how long data can wait in transmit FIFO for a full packet before it is
+ *  sent anyway (when nothing has called usb_flush()).
+ *
+ * \param frames Number of USB frames (i.e. ms). 0 means next SOF.
+ *
+ * \return None.
+ */
+void usb_setTxLinger(uint32_t frames) {
+	usbUartTxLinger = frames;
+}
+
+/**
+ * \return Number of USB frames data can wait in transmit FIFO for a full 
+ *	packet (see usb_setTxLinger()).
+ */
+uint32_t usb_getTxLinger(void) {
+	return usbUartTxLinger;
+}
+
+/**
+ * Request that characters currently in the transmit FIFO are transmitted via
+ *  USB at next SOF (i.e. within a frame), even if that means a short packet.
+ *  Requests made during the same frame (i.e. echo of each key typed) are
+ *  coalesced into one packet.
+ *
+ * \return 0 on success. Never waits.
  */
 int usb_flush(void) {
-	// Wait for any ongoing transmissions to finish
-	while (usbUartData.txBusy);
+	usbTxNoteFlushPoint(&usbUartData);
+	usbUartData.txFlushReq = true;
+
+	return 0;
+}
+
+/**
+ * Make sure any characters currently in the transmit FIFO have been sent via
+ *  USB before returning.
+ *
+ * \return 0 on success. -1 if USB is not configured (data is left queued).
+ */
+int usb_drain(void) {
+	usb_flush();
 
-	// Start a new transmission that will make sure all data currently in
-	//  txFifo is sent
-	usbUartTxStart(&usbUartData);
+	while (usbTxFifoNumBytes(&usbUartData) || usbUartData.txBusy) {
+		if (!USB_IsConfigured(usbUartData.usbHandle)) {
+			return -1;
+		}
+	}
 
 	return 0;
 }
 
+/**
+ * Called by USB stack at start of each frame (i.e. every ms). Sends data that
+ *  was asked to be flushed, or has waited long enough for a full packet.
+ *
+ * \param usbHandle Handle to USB device stack.
+ *
+ * \return LPC_OK on success.
+ */
+static ErrorCode_t usbSofHandler(USBD_HANDLE_T usbHandle) {
+	UsbUartData* uart_data = &usbUartData;
+
+	if (uart_data->txBusy || !usbTxFifoNumBytes(uart_data)) {
+		return LPC_OK;
+	}
+
+	if (uart_data->txFlushReq) {
+		uart_data->txStats.sofFlushes++;
+		usbUartTxStart(uart_data, true);
+	} else if (uart_data->txLingerFrames >= usbUartTxLinger) {
+		uart_data->txStats.lingerFlushes++;
+		usbUartTxStart(uart_data, true);
+	} else {
+		uart_data->txLingerFrames++;
+	}
+
+	return LPC_OK;
+}
+
 /**
  * Called by bottom level of printf routine within RedLib C library to print
  *  characters. 
@@ -481,74 +737,118 @@ int usb_flush(void) {
  * \return Number of characters queued for printing.
  */
 int WRITEFUNC(int iFileHandle, char *pcBuffer, int iLength) {
+	int start = 0;
+
 	for (int idx = 0; idx < iLength; idx++) {
-		usb_putc(pcBuffer[idx]);
-		// Need to add carriage return and flush after each newline
+		// Need to add carriage return after each newline. Lines are not
+		//  flushed, so they can share packets (see usbSofHandler())
 		if (pcBuffer[idx] == '\n') {
+			usb_write(&pcBuffer[start], idx + 1 - start);
 			usb_putc('\r');
-			usb_flush();
+			usbTxNoteFlushPoint(&usbUartData);
+			start = idx + 1;
 		}
 	}
+	usb_write(&pcBuffer[start], iLength - start);
 
 	return iLength;
 }
 
 /**
- * Receive data from the USB CDC UART. This is called when we already know
- *  that data is waiting for us and ReadEP needs to be called.
+ * \param[in] uartData Contains details on Virtual Comm to check.
+ *
+ * \return Number of bytes that can be put in rxFifo.
+ */
+static uint32_t usbRxFifoRoom(const UsbUartData* uartData) {
+	// One byte is always left empty, so full and empty can be told apart
+	return (uartData->rxRdIdx - uartData->rxWrIdx - 1) & 
+		(USB_UART_RXFIFO_SZ - 1);
+}
+
+/**
+ * Arm OUT endpoint to receive next packet into rxPkt, but only if rxFifo has
+ *  room for a full packet. Otherwise endpoint is left un-armed, so hardware
+ *  NAKs host (instead of ROM ACKing a packet we have no room for) until 
+ *  usb_getc() frees up space. Must be called with USB interrupt unable to 
+ *  run (i.e. from USB ISR or with IRQs disabled).
+ *
+ * \param[inout] uartData Contains details on Virtual Comm to receive from.
  *
- * \param[in] uartData Contains details on Virtual Comm to receive from.
- * 
  * \return None.
  */
-static void rcvUartData(UsbUartData* uartData) {
-	if (uartData->rxRdIdx <= uartData->rxWrIdx) {
-		// Check if there is enough room until end of buffer to 
-		//  contain max number of bytes we could receive
-		if (uartData->rxWrIdx + USB_MAX_PACKET_SZ >= 
-			USB_UART_TXFIFO_SZ) {
-
-			// At this point we know rxWrIdx needs to wrap to 0:
-
-			// If rxRdIdx is 0 this would look like FIFO is empty, 
-			//  so stall until reads occur
-			if (uartData->rxRdIdx == 0) {
-				// Mark as stalled we so try again next getc()
-				uartData->rxStalled = 1;
-				return;
-			}
+static void usbRxArm(UsbUartData* uartData) {
+	if (uartData->rxArmed) {
+		return;
+	}
 
-			// If FIFO is empty we also need to move rxRdIdx so
-			//  that garbage samples are not read
-			if (uartData->rxRdIdx == uartData->rxWrIdx) {
-				uartData->rxRdIdx = 0;
-			}
-			uartData->rxWrapIdx = uartData->rxWrIdx;
-			uartData->rxWrIdx = 0;
+	if (usbRxFifoRoom(uartData) < USB_MAX_PACKET_SZ) {
+		if (!uartData->rxStalled) {
+			uartData->rxStalled = true;
+			uartData->rxStats.stalls++;
+			// Host retries NAKed packets constantly, so do not take an
+			//  interrupt for each of them
+			USBD_API->hw->EnableEvent(uartData->usbHandle, 
+				USB_CDC_OUT_EP, USB_EVT_OUT_NAK, 0);
 		}
-	} 
-
-	if (uartData->rxRdIdx > uartData->rxWrIdx) {
-		// Check if this write could overflow read pointer
-		if (uartData->rxWrIdx + USB_MAX_PACKET_SZ >= 
-			uartData->rxRdIdx) {
+		return;
+	}
 
-			// Mark as stalled we so try again next getc()
-			uartData->rxStalled = 1;
-			return;
-		}
+	if (uartData->rxStalled) {
+		uartData->rxStalled = false;
+		USBD_API->hw->EnableEvent(uartData->usbHandle, USB_CDC_OUT_EP, 
+			USB_EVT_OUT_NAK, 1);
 	}
 
-	uint32_t bytes_rcvd = USBD_API->hw->ReadEP(usbHandle, 
-		USB_CDC_OUT_EP, 
-		&uartData->rxFifo[uartData->rxWrIdx]);
+	USBD_API->hw->ReadReqEP(uartData->usbHandle, USB_CDC_OUT_EP, 
+		uartData->rxPkt, USB_MAX_PACKET_SZ);
+	uartData->rxArmed = true;
+}
 
-	uartData->rxWrIdx += bytes_rcvd;
+/**
+ * Handler for USB bus reset. Any read that was queued on OUT endpoint is
+ *  dropped by reset, so receive path goes back to waiting for first NAK from
+ *  host to arm it again.
+ *
+ * \param usbHandle Handle to USB device stack.
+ *
+ * \return LPC_OK on success.
+ */
+static ErrorCode_t usbResetHandler(USBD_HANDLE_T usbHandle) {
+	UsbUartData* uart_data = &usbUartData;
+
+	uart_data->rxArmed = false;
+	uart_data->rxStalled = false;
+	USBD_API->hw->EnableEvent(usbHandle, USB_CDC_OUT_EP, USB_EVT_OUT_NAK, 1);
+
+	return LPC_OK;
+}
 
-	if (uartData->rxWrIdx >= uartData->rxWrapIdx) {
-		// Update wrap index if necessary
-		uartData->rxWrapIdx = uartData->rxWrIdx + 1;
+/**
+ * Receive data from the USB CDC UART. This is called when a packet has been
+ *  received into rxPkt.
+ *
+ * \param[in] uartData Contains details on Virtual Comm to receive from.
+ * 
+ * \return None.
+ */
+static void rcvUartData(UsbUartData* uartData) {
+	uint32_t bytes_rcvd = USBD_API->hw->ReadEP(uartData->usbHandle, 
+		USB_CDC_OUT_EP, uartData->rxPkt);
+	uartData->rxArmed = false;
+
+	// Endpoint is only armed when there is room for a full packet, and only
+	//  usb_getc() changes room since then (by making more)
+	uint32_t wr_idx = uartData->rxWrIdx;
+	for (uint32_t idx = 0; idx < bytes_rcvd; idx++) {
+		uartData->rxFifo[wr_idx] = uartData->rxPkt[idx];
+		wr_idx = (wr_idx + 1) & (USB_UART_RXFIFO_SZ - 1);
 	}
+	uartData->rxWrIdx = wr_idx;
+
+	uartData->rxStats.bytes += bytes_rcvd;
+	uartData->rxStats.packets++;
+
+	usbRxArm(uartData);
 }
 
 /**
@@ -573,22 +873,43 @@ int usb_getc(void) {
 
 	char c = usbUartData.rxFifo[usbUartData.rxRdIdx];
 
-	usbUartData.rxRdIdx++;
-
-	if (usbUartData.rxRdIdx >= usbUartData.rxWrapIdx) {
-		usbUartData.rxRdIdx = 0;
-	}
+	usbUartData.rxRdIdx = (usbUartData.rxRdIdx + 1) & 
+		(USB_UART_RXFIFO_SZ - 1);
 
-	// If we stalled previously, try to receive that pending data and 
-	//  startup receive callback
+	// If host is being held off, let it send again once there is room
 	if (usbUartData.rxStalled) {
-		usbUartData.rxStalled = 0;
-		rcvUartData(&usbUartData);
+		__disable_irq();
+		usbRxArm(&usbUartData);
+		__enable_irq();
 	}
 
 	return c;
 }
 
+/**
+ * Copy counters for USB CDC UART receive path.
+ *
+ * \param[out] stats Filled in with current counter values.
+ *
+ * \return None.
+ */
+void usb_getRxStats(UsbRxStats* stats) {
+	__disable_irq();
+	*stats = usbUartData.rxStats;
+	__enable_irq();
+}
+
+/**
+ * Zero counters for USB CDC UART receive path.
+ *
+ * \return None.
+ */
+void usb_resetRxStats(void) {
+	__disable_irq();
+	memset(&usbUartData.rxStats, 0, sizeof(usbUartData.rxStats));
+	__enable_irq();
+}
+
 /**
  * Called by bottom level of scanf routine within RedLib C library to read
  *  a character. 
@@ -617,14 +938,13 @@ static ErrorCode_t usbUartBulkHandler(USBD_HANDLE_T usbHandle, void* data,
 	switch (event) {
 	// A transfer from us to the USB host that we queued has completed
 	case USB_EVT_IN:
-		// Update read index
-		usb_uart_data->txRdIdx = (usb_uart_data->txRdIdx + 
-			usb_uart_data->txSent) % USB_UART_TXFIFO_SZ;
+		// Read index was already moved when packet was staged
 		usb_uart_data->txSent = 0;
 		usb_uart_data->txBusy = 0;
 
-		// Attempt to start another transmission
-		usbUartTxStart(usb_uart_data);
+		// Attempt to start another transmission. Anything less than a
+		//  full packet waits for SOF unless a flush was requested
+		usbUartTxStart(usb_uart_data, usb_uart_data->txFlushReq);
 		break;
 
 	// We received a transfer from the USB host. 
@@ -632,6 +952,15 @@ static ErrorCode_t usbUartBulkHandler(USBD_HANDLE_T usbHandle, void* data,
 		rcvUartData(usb_uart_data);
 		break;
 
+	// Host tried to send. If a read is queued host is just being faster
+	//  than hardware, otherwise endpoint was never armed (i.e. at start or
+	//  after bus reset, see usbResetHandler())
+	case USB_EVT_OUT_NAK:
+		if (!usb_uart_data->rxArmed) {
+			usbRxArm(usb_uart_data);
+		}
+		break;
+
 	case ERR_USBD_STALL:
 		setLedIntensity(0);
 		break;
@@ -807,7 +1136,17 @@ static ErrorCode_t usbUartInit(USBD_HANDLE_T usbHandle,
 		usbUartData.rxFifo = (uint8_t *) cdc_param.mem_base;
 		cdc_param.mem_base += USB_UART_RXFIFO_SZ;
 		cdc_param.mem_size -= USB_UART_RXFIFO_SZ;
-		usbUartData.rxWrapIdx = USB_UART_RXFIFO_SZ;
+
+		// Allocate staging buffer for packet being transmitted. This 
+		//  keeps it in USB RAM and on a USB_MAX_PACKET_SZ boundary
+		usbUartData.txPkt = (uint8_t *) cdc_param.mem_base;
+		cdc_param.mem_base += USB_MAX_PACKET_SZ;
+		cdc_param.mem_size -= USB_MAX_PACKET_SZ;
+
+		// Same for packet being received
+		usbUartData.rxPkt = (uint8_t *) cdc_param.mem_base;
+		cdc_param.mem_base += USB_MAX_PACKET_SZ;
+		cdc_param.mem_size -= USB_MAX_PACKET_SZ;
 
 		/* register endpoint interrupt handler */
 		ep_indx = (((USB_CDC_IN_EP & 0x0F) << 1) + 1);
@@ -864,6 +1203,8 @@ int usbConfig(void){
 	usb_param.max_num_ep = 3 + 1;
 	usb_param.mem_base = USB_STACK_MEM_BASE;
 	usb_param.mem_size = USB_STACK_MEM_SIZE;
+	usb_param.USB_SOF_Event = usbSofHandler;
+	usb_param.USB_Reset_Event = usbResetHandler;
 
 	/* Set the USB descriptors */
 	usb_desc.device_desc = (uint8_t *)&USB_DeviceDescriptor[0];
@@ -895,6 +1236,13 @@ int usbConfig(void){
 		return -1;
 	}
 
+	// SOF drives coalesced flushing of transmit FIFO
+	USBD_API->hw->EnableEvent(usbHandle, 0, USB_EVT_SOF, 1);
+
+	// OUT endpoint is armed on first NAK, as read cannot be queued until 
+	//  host configures device
+	USBD_API->hw->EnableEvent(usbHandle, USB_CDC_OUT_EP, USB_EVT_OUT_NAK, 1);
+
 	/* Make sure USB and UART IRQ priorities are same for this example */
 	NVIC_SetPriority(USB0_IRQn, 1);
 	/*  enable USB interrupts */
@@ -1266,10 +1614,9 @@ static uint8_t convToPowerAJoyPos(uint32_t rawVal, uint32_t centerWidth,
  * \return None.
  */
 static void updateReports(void) {
-	// Start long conversions run via IRQs
+	// Start long conversions run via IRQs. Trackpad frames are captured
+	//  continuously by scan scheduler, so latest are just taken below
 	updateAdcVals();
-	trackpadLocUpdate(L_TRACKPAD);
-	trackpadLocUpdate(R_TRACKPAD);
 
 	// Associate Steam Controller buttons to Switch Controller buttons:
 	controllerUsbData.statusReport.rightTrigger = getRightTriggerState();
@@ -1298,6 +1645,17 @@ static void updateReports(void) {
 		JOYSTICK_MAX_Y-getAdcVal(ADC_JOYSTICK_Y), 128, JOYSTICK_MAX_Y/2,
 		JOYSTICK_MAX_Y);
 
+	// Latest Trackpad locations. Only decoded again when scan scheduler
+	//  has published a newer frame, so reports never wait on Trackpads
+	static uint32_t tpad_seqs[2] = {0, 0};
+	static uint16_t tpad_xs[2] = {TPAD_MAX_X/2, TPAD_MAX_X/2};
+	static uint16_t tpad_ys[2] = {TPAD_MAX_Y/2, TPAD_MAX_Y/2};
+
+	trackpadGetFrameXY(L_TRACKPAD, &tpad_seqs[L_TRACKPAD], 
+		&tpad_xs[L_TRACKPAD], &tpad_ys[L_TRACKPAD], NULL);
+	trackpadGetFrameXY(R_TRACKPAD, &tpad_seqs[R_TRACKPAD], 
+		&tpad_xs[R_TRACKPAD], &tpad_ys[R_TRACKPAD], NULL);
+
 	uint16_t tpad_x = 0;
 	uint16_t tpad_y = 0;
 
@@ -1308,7 +1666,8 @@ static void updateReports(void) {
 	// Only check (and convert) finger position to DPAD location on click
 	if (getLeftTrackpadClickState()) {
 
-		trackpadGetLastXY(L_TRACKPAD, &tpad_x, &tpad_y);
+		tpad_x = tpad_xs[L_TRACKPAD];
+		tpad_y = tpad_ys[L_TRACKPAD];
 
 		if (tpad_x > TPAD_MAX_X * 3/8 && tpad_x < TPAD_MAX_X * 5/8) {
 			if (tpad_y > TPAD_MAX_Y * 3/8 && tpad_y < TPAD_MAX_Y * 5/8) {
@@ -1340,7 +1699,8 @@ static void updateReports(void) {
 	}
 
 	// Have Right Trackpad act as Right Analog:
-	trackpadGetLastXY(R_TRACKPAD, &tpad_x, &tpad_y);
+	tpad_x = tpad_xs[R_TRACKPAD];
+	tpad_y = tpad_ys[R_TRACKPAD];
 	controllerUsbData.statusReport.rightAnalogX = convToPowerAJoyPos(tpad_x, 
 		0, TPAD_MAX_X/2, TPAD_MAX_X);
 	controllerUsbData.statusReport.rightAnalogY = convToPowerAJoyPos(
@@ -1569,6 +1929,53 @@ int usb_putc(int character) {
 void usb_putb(const char* buff, uint32_t len) {
 }
 
+/**
+ * Not used in this build configuration.
+ */
+int usb_tryPutb(const char* buff, uint32_t len) {
+	return -1;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+int usb_write(const void* buff, uint32_t len) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+int usb_drain(void) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+void usb_setTxLinger(uint32_t frames) {
+}
+
+/**
+ * Not used in this build configuration.
+ */
+uint32_t usb_getTxLinger(void) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+void usb_getTxStats(UsbTxStats* stats) {
+	memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ * Not used in this build configuration.
+ */
+void usb_resetTxStats(void) {
+}
+
 /**
  * Not used in this build configuration.
  */
@@ -1582,4 +1989,17 @@ int usb_tstc(void) {
 int usb_getc(void) {
 	return 0;
 }
+
+/**
+ * Not used in this build configuration.
+ */
+void usb_getRxStats(UsbRxStats* stats) {
+	memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ * Not used in this build configuration.
+ */
+void usb_resetRxStats(void) {
+}
 #endif
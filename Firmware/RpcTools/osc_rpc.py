@@ -0,0 +1,304 @@
+#!/usr/bin/env python
+#
+# Host side of the binary RPC channel (see rpc.c) that shares the 
+#	OpenSteamController USB CDC serial port with the console. Each operation
+#	is a single checked request/response frame instead of typed console 
+#	commands and matched output. Needs pyserial.
+#
+# MIT License
+#
+#  Copyright (c) 2018 Gregory Gluszek
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#  SOFTWARE.
+
+from __future__ import print_function
+
+import sys
+import struct
+import time
+
+MAGIC = 0x02
+RSP_BIT = 0x80
+
+CMD_PING = 0x00
+CMD_MEM_READ = 0x01
+CMD_EEPROM_READ = 0x02
+CMD_JINGLE_WRITE = 0x03
+CMD_JINGLE_COMMIT = 0x04
+CMD_TELEM_SUB = 0x05
+EVT_TELEM = 0x40
+
+STATUS_STRS = {-1: 'bad arguments', -2: 'unsupported command',
+	-3: 'operation failed'}
+
+# Keep in sync with rpcSendTelem() in rpc.c
+TELEM_FMT = '<IH8H'
+BUTTON_STRS = ['steam', 'frontLeft', 'frontRight', 'joyClick', 'x', 'y', 'b',
+	'a', 'rightGrip', 'leftGrip', 'rightTpadClick', 'leftTpadClick',
+	'rightTrigger', 'leftTrigger', 'rightBumper', 'leftBumper']
+
+def crc16(data):
+	"""CRC-16/CCITT-FALSE.
+	"""
+	crc = 0xFFFF
+	for byte in bytearray(data):
+		crc ^= byte << 8
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+			crc &= 0xFFFF
+	return crc
+
+def cobsEncode(data):
+	out = bytearray([0])
+	code_idx = 0
+	code = 1
+	for byte in bytearray(data):
+		if byte:
+			out.append(byte)
+			code += 1
+		if not byte or code == 0xFF:
+			out[code_idx] = code
+			code = 1
+			code_idx = len(out)
+			out.append(0)
+	out[code_idx] = code
+	return out
+
+def cobsDecode(data):
+	data = bytearray(data)
+	out = bytearray()
+	idx = 0
+	while idx < len(data):
+		code = data[idx]
+		idx += 1
+		if not code or idx + code - 1 > len(data):
+			return None
+		out += data[idx:idx + code - 1]
+		idx += code - 1
+		if code != 0xFF and idx < len(data):
+			out.append(0)
+	return out
+
+def encodeFrame(seq, cmd, args):
+	frame = bytearray([seq, cmd]) + bytearray(args)
+	frame += struct.pack('<H', crc16(frame))
+	return bytearray([MAGIC]) + cobsEncode(frame) + bytearray([0])
+
+class RpcError(Exception):
+	pass
+
+class FrameParser:
+	"""Pulls frames out of a byte stream that may also hold console text.
+	"""
+
+	def __init__(self):
+		self.buf = None
+		self.badFrames = 0
+
+	def feed(self, data):
+		"""Generator returning (seq, cmd, status, data) for each valid frame.
+		"""
+		for byte in bytearray(data):
+			if self.buf is None:
+				if byte == MAGIC:
+					self.buf = bytearray()
+				continue
+			if byte:
+				self.buf.append(byte)
+				continue
+
+			frame = cobsDecode(self.buf)
+			self.buf = None
+			if (frame is None or len(frame) < 5 or
+				struct.unpack('<H', bytes(frame[-2:]))[0] != crc16(frame[:-2])):
+				self.badFrames += 1
+				continue
+			status = struct.unpack('<b', bytes(frame[2:3]))[0]
+			yield frame[0], frame[1] & ~RSP_BIT, status, bytes(frame[3:-2])
+
+class RpcClient:
+	def __init__(self, port, timeout=0.2, retries=3):
+		import serial
+		self.ser = serial.Serial(port, timeout=0.01)
+		self.timeout = timeout
+		self.retries = retries
+		self.seq = 0
+		self.parser = FrameParser()
+		self.telemCallback = None
+		self.maxData = 0
+		self.retried = 0
+
+	def transact(self, cmd, args=b''):
+		"""Send request and wait for matching response, resending (with the
+		same seq, as every command is idempotent) on timeout.
+		"""
+		self.seq = (self.seq + 1) & 0xFF
+		req = encodeFrame(self.seq, cmd, args)
+
+		for _ in range(self.retries + 1):
+			self.ser.write(req)
+			deadline = time.time() + self.timeout
+			while time.time() < deadline:
+				for seq, rsp_cmd, status, data in self.parser.feed(
+					self.ser.read(256)):
+					if rsp_cmd == EVT_TELEM:
+						if self.telemCallback:
+							self.telemCallback(seq, data)
+					elif seq == self.seq and rsp_cmd == cmd:
+						if status:
+							raise RpcError(STATUS_STRS.get(status, status))
+						return data
+			self.retried += 1
+
+		raise RpcError('no response')
+
+	def ping(self):
+		major, minor, self.maxData = struct.unpack('<BBH',
+			self.transact(CMD_PING))
+		return major, minor
+
+	def memRead(self, addr, wordSize, numWords):
+		if not self.maxData:
+			self.ping()
+		bytes_per_word = wordSize // 8
+		words_per_req = self.maxData // bytes_per_word
+		data = b''
+		while numWords:
+			cnt = min(numWords, words_per_req)
+			data += self.transact(CMD_MEM_READ, struct.pack('<IBH', addr,
+				wordSize, cnt))
+			addr += cnt * bytes_per_word
+			numWords -= cnt
+		return data
+
+	def eepromRead(self, offset, numBytes):
+		if not self.maxData:
+			self.ping()
+		data = b''
+		while numBytes:
+			cnt = min(numBytes, self.maxData)
+			data += self.transact(CMD_EEPROM_READ, struct.pack('<HH', offset,
+				cnt))
+			offset += cnt
+			numBytes -= cnt
+		return data
+
+	def jingleUpload(self, blob, save=False):
+		"""Write raw Jingle Data blob (see jingle_data.c for layout) and make
+		it active. Returns number of Jingles.
+		"""
+		if not self.maxData:
+			self.ping()
+		for offset in range(0, len(blob), self.maxData):
+			self.transact(CMD_JINGLE_WRITE, struct.pack('<H', offset) +
+				blob[offset:offset + self.maxData])
+		return bytearray(self.transact(CMD_JINGLE_COMMIT,
+			struct.pack('<B', 1 if save else 0)))[0]
+
+	def telemSubscribe(self, periodMs, callback=None):
+		self.telemCallback = callback
+		self.transact(CMD_TELEM_SUB, struct.pack('<H', periodMs))
+
+	def poll(self):
+		"""Handle any telemetry events received.
+		"""
+		for seq, cmd, status, data in self.parser.feed(self.ser.read(256)):
+			if cmd == EVT_TELEM and self.telemCallback:
+				self.telemCallback(seq, data)
+
+def printTelem(seq, data):
+	fields = struct.unpack(TELEM_FMT, data)
+	pressed = [name for idx, name in enumerate(BUTTON_STRS)
+		if fields[1] & (1 << idx)]
+	print('%3d %10d R(%4d,%4d) L(%4d,%4d) trig(%4d,%4d) joy(%4d,%4d) %s' % (
+		(seq,) + fields[0:1] + fields[2:] + (' '.join(pressed),)))
+
+def usage():
+	print('Usage: osc_rpc.py port ping\n'
+		'       osc_rpc.py port bench count\n'
+		'       osc_rpc.py port mem address wordSize numWords\n'
+		'       osc_rpc.py port eeprom offset numBytes [out.bin]\n'
+		'       osc_rpc.py port jingle blob.bin [save]\n'
+		'       osc_rpc.py port telem periodMs seconds', file=sys.stderr)
+
+def hexDump(addr, data, wordSize):
+	bytes_per_word = wordSize // 8
+	fmt = '<' + {1: 'B', 2: 'H', 4: 'I'}[bytes_per_word]
+	for idx in range(0, len(data), 8 * bytes_per_word):
+		chunk = data[idx:idx + 8 * bytes_per_word]
+		words = [struct.unpack(fmt, chunk[off:off + bytes_per_word])[0]
+			for off in range(0, len(chunk), bytes_per_word)]
+		print('%08X: %s' % (addr + idx, ' '.join('%0*X' % (
+			2 * bytes_per_word, word) for word in words)))
+
+def main(argv):
+	if len(argv) < 2:
+		usage()
+		sys.exit(2)
+
+	client = RpcClient(argv[0])
+	cmd = argv[1]
+	args = argv[2:]
+
+	try:
+		if cmd == 'ping':
+			print('OpenSteamController Ver %d.%d' % client.ping())
+		elif cmd == 'bench' and len(args) == 1:
+			count = int(args[0], 0)
+			client.ping()
+			start = time.time()
+			for _ in range(count):
+				client.transact(CMD_PING)
+			elapsed = time.time() - start
+			print('%d round trips in %.3f s (%.2f ms each, %d retried)' % (
+				count, elapsed, 1000 * elapsed / count, client.retried))
+		elif cmd == 'mem' and len(args) == 3:
+			addr = int(args[0], 0)
+			word_size = int(args[1], 0)
+			hexDump(addr, client.memRead(addr, word_size, int(args[2], 0)),
+				word_size)
+		elif cmd == 'eeprom' and len(args) in (2, 3):
+			offset = int(args[0], 0)
+			data = client.eepromRead(offset, int(args[1], 0))
+			if len(args) == 3:
+				with open(args[2], 'wb') as f:
+					f.write(data)
+			else:
+				hexDump(offset, data, 8)
+		elif cmd == 'jingle' and len(args) in (1, 2):
+			with open(args[0], 'rb') as f:
+				blob = bytearray(f.read())
+			save = len(args) == 2 and args[1] == 'save'
+			print('%d Jingles loaded%s' % (client.jingleUpload(blob, save),
+				' and saved to EEPROM' if save else ''))
+		elif cmd == 'telem' and len(args) == 2:
+			client.telemSubscribe(int(args[0], 0), printTelem)
+			end = time.time() + float(args[1])
+			while time.time() < end:
+				client.poll()
+			client.telemSubscribe(0)
+		else:
+			usage()
+			sys.exit(2)
+	except RpcError as err:
+		print('Error: %s' % err, file=sys.stderr)
+		sys.exit(1)
+
+if __name__ == '__main__':
+	main(sys.argv[1:])
@@ -0,0 +1,644 @@
+/**
+ * \file tpad_replay.c
+ * \brief Host PC harness that replays recorded Trackpad frames through the
+ *	firmware decode and filter code (trackpad_decode.c), compares positions
+ *	against golden outputs and benchmarks decode cost.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2018 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trackpad_decode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STREAM_SYNC_0 (0xA5) //!< First byte of 'trackpad stream' record.
+#define STREAM_SYNC_1 (0x5A) //!< Second byte of 'trackpad stream' record.
+#define STREAM_REC_SZ (92) //!< Size of 'trackpad stream' record (see
+	//!< TpadStreamRec in trackpad_diag.c).
+#define STREAM_FLAG_IDLE (1 << 0) //!< Presence probe only frame.
+#define STREAM_FLAG_ABS (1 << 1) //!< Absolute mode frame.
+
+#define MAX_MISMATCH_PRINTS (10) //!< Mismatches printed before going quiet.
+
+/**
+ * A recorded frame, along with what was worked out from it.
+ */
+typedef struct ReplayFrame {
+	Trackpad trackpad; //!< Trackpad frame is from.
+	uint8_t flags; //!< STREAM_FLAG_* bits.
+	uint32_t seq; //!< Frame sequence number.
+	uint32_t timestampUs; //!< When frame was captured.
+	int16_t adcs[NUM_ANYMEAS_ADCS]; //!< Raw AnyMeas ADC values.
+	int16_t comps[NUM_ANYMEAS_ADCS]; //!< Compensation values.
+	bool touch; //!< Output: finger was down.
+	int32_t xRaw; //!< Output: decoded X position (TPAD_POS_FRAC_BITS).
+	int32_t yRaw; //!< Output: decoded Y position (TPAD_POS_FRAC_BITS).
+	int32_t x; //!< Output: filtered X position (TPAD_POS_FRAC_BITS).
+	int32_t y; //!< Output: filtered Y position (TPAD_POS_FRAC_BITS).
+} ReplayFrame;
+
+/**
+ * Per Trackpad state carried between frames (i.e. what TpadPosState holds in
+ *  firmware).
+ */
+typedef struct ReplayState {
+	uint32_t lastTimestampUs; //!< Timestamp of last frame.
+	TpadFilt filts[2]; //!< Filter state for X and Y.
+} ReplayState;
+
+static const TpadFiltParams FILT_PARAMS = {
+	.minCutoffMhz = TPAD_FILT_DFLT_MIN_CUTOFF_MHZ,
+	.beta = TPAD_FILT_DFLT_BETA,
+	.dCutoffMhz = TPAD_FILT_DFLT_D_CUTOFF_MHZ
+};
+
+/**
+ * Get current time from monotonic clock.
+ *
+ * \return Time in ns.
+ */
+static uint64_t getNs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Read whole file into memory.
+ *
+ * \param[in] path File to read.
+ * \param[out] len Number of bytes read.
+ *
+ * \return Buffer (NUL terminated, to be freed by caller) or NULL on error.
+ */
+static char* readFile(const char* path, size_t* len) {
+	char* data = NULL;
+	long size = 0;
+	FILE* file = fopen(path, "rb");
+
+	if (!file) {
+		return NULL;
+	}
+
+	if (fseek(file, 0, SEEK_END) || (size = ftell(file)) < 0 ||
+		fseek(file, 0, SEEK_SET)) {
+		goto exit;
+	}
+
+	data = malloc(size + 1);
+	if (!data) {
+		goto exit;
+	}
+
+	if (fread(data, 1, size, file) != (size_t)size) {
+		free(data);
+		data = NULL;
+		goto exit;
+	}
+	data[size] = '\0';
+	*len = size;
+
+exit:
+	fclose(file);
+
+	return data;
+}
+
+/**
+ * Get little endian 16-bit value.
+ *
+ * \param[in] data Where value is stored.
+ *
+ * \return Value.
+ */
+static inline uint16_t getLe16(const uint8_t* data) {
+	return data[0] | (data[1] << 8);
+}
+
+/**
+ * Get little endian 32-bit value.
+ *
+ * \param[in] data Where value is stored.
+ *
+ * \return Value.
+ */
+static inline uint32_t getLe32(const uint8_t* data) {
+	return getLe16(data) | ((uint32_t)getLe16(data + 2) << 16);
+}
+
+/**
+ * Compute Fletcher-16 checksum (same as firmware).
+ *
+ * \param[in] data Bytes to compute checksum over.
+ * \param len Number of bytes in data.
+ *
+ * \return Checksum.
+ */
+static uint16_t calcFletcher16(const uint8_t* data, size_t len) {
+	uint32_t sum1 = 0;
+	uint32_t sum2 = 0;
+
+	for (size_t idx = 0; idx < len; idx++) {
+		sum1 = (sum1 + data[idx]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+
+	return (sum2 << 8) | sum1;
+}
+
+/**
+ * Parse capture of 'trackpad stream' output. Anything that is not a valid
+ *  record (i.e. console text) is skipped.
+ *
+ * \param[in] data Capture.
+ * \param len Number of bytes in data.
+ * \param[out] frames Where to store frames. Must have room for
+ *	len / STREAM_REC_SZ frames.
+ *
+ * \return Number of frames parsed.
+ */
+static int parseStream(const uint8_t* data, size_t len, ReplayFrame* frames) {
+	int num_frames = 0;
+	size_t idx = 0;
+
+	while (idx + STREAM_REC_SZ <= len) {
+		const uint8_t* rec = &data[idx];
+
+		if (rec[0] != STREAM_SYNC_0 || rec[1] != STREAM_SYNC_1 ||
+			rec[2] > L_TRACKPAD || getLe16(&rec[STREAM_REC_SZ - 2]) !=
+			calcFletcher16(rec, STREAM_REC_SZ - 2)) {
+			idx++;
+			continue;
+		}
+		idx += STREAM_REC_SZ;
+
+		ReplayFrame* frame = &frames[num_frames++];
+		memset(frame, 0, sizeof(*frame));
+		frame->trackpad = rec[2];
+		frame->flags = rec[3];
+		frame->seq = getLe32(&rec[4]);
+		frame->timestampUs = getLe32(&rec[8]);
+		for (int adc = 0; adc < NUM_ANYMEAS_ADCS; adc++) {
+			frame->adcs[adc] = getLe16(&rec[14 + 2 * adc]);
+			frame->comps[adc] = getLe16(&rec[14 + 2 *
+				(NUM_ANYMEAS_ADCS + adc)]);
+		}
+	}
+
+	return num_frames;
+}
+
+/**
+ * Parse output of 'trackpad getRaw' (i.e. one frame from each Trackpad).
+ *
+ * \param[in] text Console output.
+ * \param[out] frames Where to store frames. Must have room for 2 frames.
+ *
+ * \return Number of frames parsed, or negative value on error.
+ */
+static int parseGetRaw(const char* text, ReplayFrame* frames) {
+	int comp_cnts[2] = {0, 0};
+	int adc_cnts[2] = {0, 0};
+	int cur_tpad = -1;
+	char line[128];
+	char side[8];
+	int idx = 0;
+	int val = 0;
+	unsigned int addr = 0;
+
+	memset(frames, 0, 2 * sizeof(*frames));
+
+	while (*text) {
+		const char* eol = strchr(text, '\n');
+		size_t line_len = eol ? (size_t)(eol - text) : strlen(text);
+		Trackpad tpad = R_TRACKPAD;
+
+		// Work on a copy of line, as sscanf() would happily skip over
+		//  newline of an empty line and match next one
+		if (line_len >= sizeof(line)) {
+			line_len = sizeof(line) - 1;
+		}
+		memcpy(line, text, line_len);
+		line[line_len] = '\0';
+
+		if (sscanf(line, "%7s Compensation Vals[%d] = %d", side, &idx,
+			&val) == 3) {
+			tpad = strcmp(side, "Left") ? R_TRACKPAD : L_TRACKPAD;
+			if (idx >= 0 && idx < NUM_ANYMEAS_ADCS) {
+				frames[tpad].comps[idx] = val;
+				comp_cnts[tpad]++;
+			}
+		} else if (sscanf(line, "# %7s Trackpad AnyMeas", side) == 1) {
+			cur_tpad = strcmp(side, "Left") ? R_TRACKPAD : L_TRACKPAD;
+		} else if (cur_tpad >= 0 && sscanf(line, "set {short}%x = %d",
+			&addr, &val) == 2) {
+			// Each ADC value is printed twice (i.e. for both copies
+			//  official firmware keeps), so only take first
+			int cnt = adc_cnts[cur_tpad]++;
+			if (!(cnt & 1) && cnt / 2 < NUM_ANYMEAS_ADCS) {
+				frames[cur_tpad].adcs[cnt / 2] = val;
+			}
+		}
+
+		if (!eol) {
+			break;
+		}
+		text = eol + 1;
+	}
+
+	int num_frames = 0;
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		if (comp_cnts[tpad] != NUM_ANYMEAS_ADCS || adc_cnts[tpad] !=
+			2 * NUM_ANYMEAS_ADCS) {
+			continue;
+		}
+		frames[num_frames] = frames[tpad];
+		frames[num_frames].trackpad = tpad;
+		frames[num_frames].seq = 1;
+		num_frames++;
+	}
+
+	return num_frames ? num_frames : -1;
+}
+
+/**
+ * Work out position from a frame the same way updateTpadPos() does in
+ *  firmware (minus geometric correction, which is calibrated per unit).
+ *
+ * \param[inout] frame Frame to work out position for.
+ * \param[inout] state State of Trackpad frame is from.
+ *
+ * \return None.
+ */
+static void replayFrame(ReplayFrame* frame, ReplayState* state) {
+	frame->xRaw = (TPAD_MAX_X/2) << TPAD_POS_FRAC_BITS;
+	frame->yRaw = (TPAD_MAX_Y/2) << TPAD_POS_FRAC_BITS;
+	frame->touch = !(frame->flags & (STREAM_FLAG_IDLE | STREAM_FLAG_ABS)) &&
+		tpadDecodePos(frame->adcs, frame->comps, &frame->xRaw,
+		&frame->yRaw);
+
+	if (frame->touch) {
+		uint32_t dt_us = frame->timestampUs - state->lastTimestampUs;
+		frame->x = tpadFilt(&state->filts[0], &FILT_PARAMS, frame->xRaw,
+			dt_us);
+		frame->y = tpadFilt(&state->filts[1], &FILT_PARAMS, frame->yRaw,
+			dt_us);
+	} else {
+		tpadFiltReset(&state->filts[0]);
+		tpadFiltReset(&state->filts[1]);
+		frame->x = frame->xRaw;
+		frame->y = frame->yRaw;
+	}
+
+	state->lastTimestampUs = frame->timestampUs;
+}
+
+/**
+ * Format what was worked out from a frame as a line of golden output.
+ *
+ * \param[in] frame Replayed frame.
+ * \param[out] line Where to write line (no newline).
+ * \param size Size of line.
+ *
+ * \return None.
+ */
+static void fmtFrame(const ReplayFrame* frame, char* line, size_t size) {
+	snprintf(line, size, "%c %u %d %d %d %d %d",
+		frame->trackpad == R_TRACKPAD ? 'R' : 'L', frame->seq,
+		frame->touch, frame->xRaw, frame->yRaw, frame->x, frame->y);
+}
+
+/**
+ * Replay all frames in order, optionally timing each.
+ *
+ * \param[inout] frames Frames to replay.
+ * \param numFrames Number of frames.
+ * \param[out] frameNs Time each frame took. May be NULL.
+ *
+ * \return None.
+ */
+static void replayAll(ReplayFrame* frames, int numFrames, uint64_t* frameNs) {
+	ReplayState states[2];
+
+	memset(states, 0, sizeof(states));
+	for (int tpad = R_TRACKPAD; tpad <= L_TRACKPAD; tpad++) {
+		tpadFiltReset(&states[tpad].filts[0]);
+		tpadFiltReset(&states[tpad].filts[1]);
+	}
+
+	for (int idx = 0; idx < numFrames; idx++) {
+		ReplayFrame* frame = &frames[idx];
+		uint64_t start = frameNs ? getNs() : 0;
+
+		replayFrame(frame, &states[frame->trackpad]);
+
+		if (frameNs) {
+			frameNs[idx] = getNs() - start;
+		}
+	}
+}
+
+/**
+ * Write golden output for replayed frames.
+ *
+ * \param[in] path File to write.
+ * \param[in] frames Replayed frames.
+ * \param numFrames Number of frames.
+ *
+ * \return 0 on success.
+ */
+static int writeGolden(const char* path, const ReplayFrame* frames,
+	int numFrames) {
+	char line[128];
+	FILE* file = fopen(path, "w");
+
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", path);
+		return -1;
+	}
+
+	fprintf(file, "# trackpad seq touch xRaw yRaw x y (positions are 1/%d "
+		"units)\n", 1 << TPAD_POS_FRAC_BITS);
+	for (int idx = 0; idx < numFrames; idx++) {
+		fmtFrame(&frames[idx], line, sizeof(line));
+		fprintf(file, "%s\n", line);
+	}
+
+	fclose(file);
+
+	return 0;
+}
+
+/**
+ * Compare replayed frames against golden output.
+ *
+ * \param[in] path Golden output file.
+ * \param[in] frames Replayed frames.
+ * \param numFrames Number of frames.
+ *
+ * \return Number of mismatched lines, or negative value on error.
+ */
+static int checkGolden(const char* path, const ReplayFrame* frames,
+	int numFrames) {
+	char line[128];
+	char golden[128];
+	int mismatches = 0;
+	int idx = 0;
+	FILE* file = fopen(path, "r");
+
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", path);
+		return -1;
+	}
+
+	while (fgets(golden, sizeof(golden), file)) {
+		golden[strcspn(golden, "\r\n")] = '\0';
+		if (golden[0] == '#' || !golden[0]) {
+			continue;
+		}
+
+		if (idx >= numFrames) {
+			mismatches++;
+			continue;
+		}
+
+		fmtFrame(&frames[idx], line, sizeof(line));
+		if (strcmp(line, golden)) {
+			if (mismatches < MAX_MISMATCH_PRINTS) {
+				printf("Frame %d mismatch:\n  expected %s\n"
+					"  got      %s\n", idx, golden, line);
+			}
+			mismatches++;
+		}
+		idx++;
+	}
+	mismatches += numFrames - idx;
+
+	fclose(file);
+
+	return mismatches;
+}
+
+/**
+ * Compare function for sorting frame times.
+ */
+static int cmpNs(const void* a, const void* b) {
+	uint64_t ns_a = *(const uint64_t*)a;
+	uint64_t ns_b = *(const uint64_t*)b;
+
+	return ns_a < ns_b ? -1 : ns_a > ns_b;
+}
+
+/**
+ * Time decode and filter of all frames, repeated a number of times, and print
+ *  per frame cost and throughput.
+ *
+ * \param[inout] frames Frames to replay.
+ * \param numFrames Number of frames.
+ * \param numReps Number of times to replay all frames.
+ *
+ * \return 0 on success.
+ */
+static int bench(ReplayFrame* frames, int numFrames, int numReps) {
+	uint64_t* frame_ns = malloc(numFrames * sizeof(*frame_ns));
+	uint64_t* best_ns = malloc(numFrames * sizeof(*best_ns));
+	int retval = 0;
+
+	if (!frame_ns || !best_ns) {
+		retval = -1;
+		goto exit;
+	}
+
+	// Best of all reps is kept for each frame, which filters out
+	//  preemption and cache misses from first pass
+	for (int rep = 0; rep < numReps; rep++) {
+		replayAll(frames, numFrames, frame_ns);
+		for (int idx = 0; idx < numFrames; idx++) {
+			if (!rep || frame_ns[idx] < best_ns[idx]) {
+				best_ns[idx] = frame_ns[idx];
+			}
+		}
+	}
+
+	// Throughput is measured without per frame timing overhead
+	uint64_t start = getNs();
+	for (int rep = 0; rep < numReps; rep++) {
+		replayAll(frames, numFrames, NULL);
+	}
+	uint64_t total_ns = getNs() - start;
+
+	uint64_t sum_ns = 0;
+	for (int idx = 0; idx < numFrames; idx++) {
+		sum_ns += best_ns[idx];
+	}
+	qsort(best_ns, numFrames, sizeof(*best_ns), cmpNs);
+
+	printf("Per frame (best of %d reps, includes timer overhead): avg %lu "
+		"ns, p50 %lu ns, p99 %lu ns, max %lu ns\n", numReps,
+		(unsigned long)(sum_ns / numFrames),
+		(unsigned long)best_ns[numFrames / 2],
+		(unsigned long)best_ns[(uint64_t)numFrames * 99 / 100],
+		(unsigned long)best_ns[numFrames - 1]);
+	printf("Throughput: %lu frames/s (%lu ns/frame over %d frames)\n",
+		(unsigned long)((uint64_t)numFrames * numReps * 1000000000 /
+		(total_ns ? total_ns : 1)),
+		(unsigned long)(total_ns / ((uint64_t)numFrames * numReps)),
+		numFrames * numReps);
+
+exit:
+	free(frame_ns);
+	free(best_ns);
+
+	return retval;
+}
+
+/**
+ * Print usage of this program.
+ *
+ * \param[in] prog Name program was run as.
+ *
+ * \return None.
+ */
+static void usage(const char* prog) {
+	fprintf(stderr,
+		"Usage: %s -i capture [-g golden | -c golden] [-b reps] [-p]\n"
+		"\n"
+		"-i: 'trackpad stream' binary capture or 'trackpad getRaw'\n"
+		"	console output to replay\n"
+		"-g: write decoded positions to golden file\n"
+		"-c: compare decoded positions against golden file (exit\n"
+		"	status is non-zero on any mismatch)\n"
+		"-b: benchmark decode and filter, replaying capture reps times\n"
+		"-p: print decoded positions\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+	const char* in_path = NULL;
+	const char* gen_path = NULL;
+	const char* check_path = NULL;
+	int num_reps = 0;
+	bool print = false;
+	char* data = NULL;
+	size_t len = 0;
+	ReplayFrame* frames = NULL;
+	int num_frames = 0;
+	int retval = 1;
+	int opt = 0;
+
+	while ((opt = getopt(argc, argv, "i:g:c:b:p")) != -1) {
+		switch (opt) {
+		case 'i':
+			in_path = optarg;
+			break;
+		case 'g':
+			gen_path = optarg;
+			break;
+		case 'c':
+			check_path = optarg;
+			break;
+		case 'b':
+			num_reps = atoi(optarg);
+			break;
+		case 'p':
+			print = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (!in_path || (gen_path && check_path)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	data = readFile(in_path, &len);
+	if (!data) {
+		fprintf(stderr, "Cannot read %s\n", in_path);
+		goto exit;
+	}
+
+	frames = malloc((len / STREAM_REC_SZ + 2) * sizeof(*frames));
+	if (!frames) {
+		goto exit;
+	}
+
+	if (strstr(data, "Trackpad AnyMeas ADC Vals")) {
+		num_frames = parseGetRaw(data, frames);
+	} else {
+		num_frames = parseStream((const uint8_t*)data, len, frames);
+	}
+	if (num_frames <= 0) {
+		fprintf(stderr, "No frames found in %s\n", in_path);
+		goto exit;
+	}
+	printf("Replaying %d frames from %s\n", num_frames, in_path);
+
+	replayAll(frames, num_frames, NULL);
+
+	if (print) {
+		char line[128];
+		for (int idx = 0; idx < num_frames; idx++) {
+			fmtFrame(&frames[idx], line, sizeof(line));
+			printf("%s\n", line);
+		}
+	}
+
+	if (gen_path) {
+		if (writeGolden(gen_path, frames, num_frames)) {
+			goto exit;
+		}
+		printf("Wrote golden output to %s\n", gen_path);
+	}
+
+	if (check_path) {
+		int mismatches = checkGolden(check_path, frames, num_frames);
+		if (mismatches) {
+			if (mismatches > 0) {
+				printf("FAIL: %d frames do not match %s\n",
+					mismatches, check_path);
+			}
+			goto exit;
+		}
+		printf("PASS: all frames match %s\n", check_path);
+	}
+
+	if (num_reps > 0 && bench(frames, num_frames, num_reps)) {
+		goto exit;
+	}
+
+	retval = 0;
+
+exit:
+	free(frames);
+	free(data);
+
+	return retval;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python
+#
+# Generates a synthetic 'trackpad stream' capture (see TpadStreamRec in
+#	trackpad_diag.c) of fingers moving over both Trackpads. Each finger is
+#	modelled as a triangular bump over the electrodes of each axis, which is
+#	then modulated with the same sign patterns the firmware demodulates
+#	(see trackpad_decode.c). Output is deterministic, so it can be replayed
+#	against committed golden output.
+#
+# MIT License
+#
+#  Copyright (c) 2018 Gregory Gluszek
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#  SOFTWARE.
+
+from __future__ import print_function
+
+import sys
+import getopt
+import math
+import struct
+
+# Keep in sync with trackpad_decode.c
+X_SIGN_MASKS = [0x0dc4, 0x0b89, 0x0f12, 0x0e25, 0x0c4b, 0x0897,
+	0x092e, 0x0a5c, 0x0cb8, 0x0971, 0x0ae2]
+Y_SIGN_MASKS = [0x0055, 0x0033, 0x0066, 0x000f, 0x005a, 0x003c, 0x0069]
+NUM_X_BINS = 12
+NUM_Y_BINS = 8
+NUM_ADCS = 19
+
+# Keep in sync with TpadStreamRec in trackpad_diag.c
+REC_FMT = '<HBBIIH%dh%dh' % (NUM_ADCS, NUM_ADCS)
+SYNC = 0x5AA5
+
+# Compensation values (i.e. ADC values with nothing on Trackpad). Taken from
+#	a frame recorded on hardware (see ReverseEngineering/gdbCustomCmds).
+COMPS = [469, -12875, 2022, -6205, -3258, -7129, -3450, -5199, 1819, -6687,
+	5447, 112, 760, 1309, 484, 428, 1248, 309, -31]
+
+FRAME_US = 4000
+PEAK = 400
+WIDTH = 1.6
+NOISE = 12
+
+class Lcg:
+	"""Tiny deterministic noise source (same on every Python version).
+	"""
+
+	def __init__(self, seed):
+		self.state = seed
+
+	def next(self, amp):
+		self.state = (self.state * 1103515245 + 12345) & 0x7FFFFFFF
+		return (self.state >> 16) % (2 * amp + 1) - amp
+
+def fletcher16(data):
+	sum1 = 0
+	sum2 = 0
+	for byte in bytearray(data):
+		sum1 = (sum1 + byte) % 255
+		sum2 = (sum2 + sum1) % 255
+	return (sum2 << 8) | sum1
+
+def profile(center, num_bins):
+	"""Triangular bump centered on electrode index center (may be fractional).
+	"""
+	return [max(0.0, PEAK * (1.0 - abs(idx - center) / WIDTH))
+		for idx in range(num_bins)]
+
+def modulate(prof, masks):
+	meas = []
+	for mask in masks:
+		val = 0
+		for idx, p in enumerate(prof):
+			val += -p if mask & (1 << idx) else p
+		meas.append(val)
+	return meas
+
+def makeAdcs(finger, noise):
+	"""ADC values for finger at (x, y) in 0-1 range, or None for no finger.
+	"""
+	meas = [0] * (NUM_ADCS - 1)
+	if finger:
+		x, y = finger
+		# X position is flipped by decode (electrode 0 is right side)
+		meas = modulate(profile((1.0 - x) * (NUM_X_BINS - 1), NUM_X_BINS),
+			X_SIGN_MASKS)
+		meas += modulate(profile(y * (NUM_Y_BINS - 1), NUM_Y_BINS),
+			Y_SIGN_MASKS)
+	meas.append(0)
+
+	adcs = []
+	for comp, val in zip(COMPS, meas):
+		adc = comp + int(round(val)) + noise.next(NOISE)
+		adcs.append(max(-32768, min(32767, adc)))
+	return adcs
+
+def rightPath(frame):
+	"""Swipe, lift, then circle.
+	"""
+	if frame < 100:
+		t = frame / 99.0
+		return (0.15 + 0.7 * t, 0.2 + 0.6 * t)
+	if frame < 110:
+		return None
+	t = (frame - 110) / 100.0
+	return (0.5 + 0.25 * math.cos(2 * math.pi * t),
+		0.5 + 0.25 * math.sin(2 * math.pi * t))
+
+def leftPath(frame):
+	"""Finger resting, then slow drift, then lift.
+	"""
+	if frame < 60:
+		return (0.3, 0.7)
+	if frame < 180:
+		return (0.3 + (frame - 60) / 600.0, 0.7)
+	return None
+
+def main(argv):
+	out_file = None
+	num_frames = 210
+
+	try:
+		opts, args = getopt.getopt(argv, 'ho:n:')
+	except getopt.GetoptError:
+		print('Usage: tpad_synth_capture.py -o capture.bin [-n frames]')
+		sys.exit(2)
+
+	for opt, arg in opts:
+		if opt == '-h':
+			print('Usage: tpad_synth_capture.py -o capture.bin [-n frames]')
+			sys.exit()
+		elif opt == '-o':
+			out_file = arg
+		elif opt == '-n':
+			num_frames = int(arg)
+
+	if not out_file:
+		print('Usage: tpad_synth_capture.py -o capture.bin [-n frames]')
+		sys.exit(2)
+
+	paths = [rightPath, leftPath]
+	noises = [Lcg(1), Lcg(2)]
+
+	with open(out_file, 'wb') as f:
+		f.write(b'Streaming binary Trackpad frames (Press any key to exit):\r\n')
+		for frame in range(num_frames):
+			for tpad in range(2):
+				adcs = makeAdcs(paths[tpad](frame), noises[tpad])
+				rec = struct.pack(REC_FMT, SYNC, tpad, 0, frame + 1,
+					frame * FRAME_US + tpad * FRAME_US // 2, 0, *(adcs + COMPS))
+				f.write(rec + struct.pack('<H', fletcher16(rec)))
+		f.write(b'\r\n')
+
+if __name__ == '__main__':
+	main(sys.argv[1:])
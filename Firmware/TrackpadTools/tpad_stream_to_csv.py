@@ -0,0 +1,168 @@
+#!/usr/bin/env python
+#
+# Converts a capture of 'trackpad stream' output (i.e. raw bytes read from the
+#	OpenSteamController USB CDC serial port) to CSV, one row per frame.
+#	Console text before/after the binary records is skipped, as is anything
+#	that fails the checksum.
+#
+# MIT License
+#
+#  Copyright (c) 2018 Gregory Gluszek
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#  SOFTWARE.
+
+from __future__ import print_function
+
+import sys
+import getopt
+import struct
+
+class TpadStreamDecoder:
+	"""Finds and decodes TpadStreamRec records (see trackpad_diag.c) in a capture.
+	"""
+
+	NUM_ADCS = 19
+	SYNC = b'\xa5\x5a'
+	# sync, trackpad, flags, seq, timestampUs, drops, adcs, comps, check
+	REC_FMT = '<HBBIIH%dh%dhH' % (NUM_ADCS, NUM_ADCS)
+	REC_SZ = struct.calcsize(REC_FMT)
+
+	FLAG_IDLE = 1 << 0
+	FLAG_ABS = 1 << 1
+
+	TRACKPAD_STRS = ['right', 'left']
+
+	def __init__(self, data):
+		self.data = bytearray(data)
+		self.badChecks = 0
+		self.gaps = [0, 0]
+		self.lastSeqs = [None, None]
+
+	@staticmethod
+	def fletcher16(data):
+		sum1 = 0
+		sum2 = 0
+		for byte in data:
+			sum1 = (sum1 + byte) % 255
+			sum2 = (sum2 + sum1) % 255
+		return (sum2 << 8) | sum1
+
+	def records(self):
+		"""Generator returning a dict for each valid record in capture.
+		"""
+		idx = 0
+		while True:
+			idx = self.data.find(self.SYNC, idx)
+			if idx < 0 or idx + self.REC_SZ > len(self.data):
+				return
+
+			raw = self.data[idx:idx + self.REC_SZ]
+			fields = struct.unpack(self.REC_FMT, bytes(raw))
+			if (fields[-1] != self.fletcher16(raw[:-2]) or
+				fields[1] > 1):
+				# Sync bytes were just part of some other data
+				self.badChecks += 1
+				idx += 1
+				continue
+			idx += self.REC_SZ
+
+			rec = {
+				'trackpad': fields[1],
+				'flags': fields[2],
+				'seq': fields[3],
+				'timestampUs': fields[4],
+				'drops': fields[5],
+				'adcs': fields[6:6 + self.NUM_ADCS],
+				'comps': fields[6 + self.NUM_ADCS:6 + 2 * self.NUM_ADCS]
+			}
+
+			last_seq = self.lastSeqs[rec['trackpad']]
+			if last_seq is not None and rec['seq'] != last_seq + 1:
+				self.gaps[rec['trackpad']] += (rec['seq'] - last_seq - 1) & 0xFFFFFFFF
+			self.lastSeqs[rec['trackpad']] = rec['seq']
+
+			yield rec
+
+	def writeCsv(self, out):
+		"""Write a header row and then a row per record.
+		"""
+		hdr = ['trackpad', 'seq', 'timestampUs', 'idle', 'abs', 'drops']
+		hdr += ['adc%d' % idx for idx in range(self.NUM_ADCS)]
+		hdr += ['comp%d' % idx for idx in range(self.NUM_ADCS)]
+		out.write(','.join(hdr) + '\n')
+
+		num_recs = 0
+		for rec in self.records():
+			row = [self.TRACKPAD_STRS[rec['trackpad']], rec['seq'],
+				rec['timestampUs'],
+				1 if rec['flags'] & self.FLAG_IDLE else 0,
+				1 if rec['flags'] & self.FLAG_ABS else 0,
+				rec['drops']]
+			row += list(rec['adcs'])
+			row += list(rec['comps'])
+			out.write(','.join(str(val) for val in row) + '\n')
+			num_recs += 1
+
+		return num_recs
+
+def usage():
+	print('Usage: tpad_stream_to_csv.py -i capture.bin [-o frames.csv]',
+		file=sys.stderr)
+
+def main(argv):
+	in_file = None
+	out_file = None
+
+	try:
+		opts, args = getopt.getopt(argv, 'hi:o:')
+	except getopt.GetoptError:
+		usage()
+		sys.exit(2)
+
+	for opt, arg in opts:
+		if opt == '-h':
+			usage()
+			sys.exit()
+		elif opt == '-i':
+			in_file = arg
+		elif opt == '-o':
+			out_file = arg
+
+	if not in_file:
+		usage()
+		sys.exit(2)
+
+	with open(in_file, 'rb') as f:
+		decoder = TpadStreamDecoder(f.read())
+
+	out = open(out_file, 'w') if out_file else sys.stdout
+	num_recs = decoder.writeCsv(out)
+	if out_file:
+		out.close()
+
+	# Stats go to stderr so CSV can be piped
+	print('%d frames decoded, %d false syncs skipped' % (num_recs,
+		decoder.badChecks), file=sys.stderr)
+	for tpad in range(2):
+		print('%s Trackpad: %d frames missing (sequence gaps)' % (
+			decoder.TRACKPAD_STRS[tpad].capitalize(), decoder.gaps[tpad]),
+			file=sys.stderr)
+
+if __name__ == '__main__':
+	main(sys.argv[1:])
@@ -28,7 +28,6 @@
 
 #include "scserial.h"
 
-#include <QThread>
 #include <QDebug>
 
 /**
@@ -84,6 +83,8 @@ SCSerial::ErrorCode SCSerial::send(QString command, QString response, int fullRe
 
     serial.write(request_data);
 
+    // Firmware NAKs its OUT endpoint while it has no room for another packet,
+    //  so write only completes once controller has taken all of command
     if (!serial.waitForBytesWritten(250)) {
         qDebug() << "serial.waitForBytesWritten() error: " << serial.error();
         return COMMAND_SEND_TIMEOUT;
@@ -108,10 +109,5 @@ SCSerial::ErrorCode SCSerial::send(QString command, QString response, int fullRe
 
     qDebug() << command;
 
-    // Pause after each command to avoid overflowing NXP's faulty USB CDC UART stack
-    // This can be removed if USB CDC UART stack issues are ever fixed
-//TODO: how much can we decrease this?
-    QThread::msleep(5);
-
     return NO_ERROR;
 }